@@ -0,0 +1,50 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+
+#include "cnstream_frame.hpp"
+
+namespace cnstream {
+
+static void BM_CNFrameInfoCreate(benchmark::State& state) {  // NOLINT
+  const std::string stream_id = "stream_0";
+  for (auto _ : state) {
+    auto data = CNFrameInfo::Create(stream_id);
+    data->SetStreamIndex(0);
+    benchmark::DoNotOptimize(data);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CNFrameInfoCreate)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_CNFrameInfoCreateEos(benchmark::State& state) {  // NOLINT
+  const std::string stream_id = "stream_0";
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(CNFrameInfo::Create(stream_id, true));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CNFrameInfoCreateEos);
+
+}  // namespace cnstream
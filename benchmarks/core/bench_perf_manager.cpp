@@ -0,0 +1,60 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "perf_manager.hpp"
+
+namespace cnstream {
+
+static const char kBenchPerfDir[] = "bench_perf_tmp/";
+
+static void BM_PerfManagerRecord(benchmark::State& state) {  // NOLINT
+  const std::vector<std::string> module_names = {"module_0", "module_1", "module_2", "module_3"};
+  const std::string perf_type = PerfManager::GetDefaultType();
+  std::unique_ptr<PerfManager> manager(new PerfManager);
+  PerfManager::CreateDir(kBenchPerfDir);
+  if (!manager->Init(kBenchPerfDir + PerfManager::GetDbFileNamePrefix() + "bench.db")) {
+    state.SkipWithError("Init PerfManager failed");
+    return;
+  }
+  manager->RegisterPerfType(perf_type, PerfManager::GetPrimaryKey(),
+                            PerfManager::GetKeys(module_names, {PerfManager::GetStartTimeSuffix(),
+                                                                PerfManager::GetEndTimeSuffix(),
+                                                                PerfManager::GetThreadSuffix()}));
+  int64_t pts = 0;
+  for (auto _ : state) {
+    // start and end time of a frame passing every module, as Module::RecordTime does
+    for (const auto& name : module_names) manager->Record(false, perf_type, name, pts);
+    for (const auto& name : module_names) manager->Record(true, perf_type, name, pts);
+    ++pts;
+  }
+  state.SetItemsProcessed(state.iterations() * module_names.size() * 2);
+  manager->Stop();
+  manager.reset();
+  PerfManager::ClearDbFiles(kBenchPerfDir);
+}
+BENCHMARK(BM_PerfManagerRecord)->UseRealTime();
+
+}  // namespace cnstream
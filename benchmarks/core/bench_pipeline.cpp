@@ -0,0 +1,146 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnstream_frame.hpp"
+#include "cnstream_module.hpp"
+#include "cnstream_pipeline.hpp"
+
+namespace cnstream {
+
+// Passes frames on without touching them, so only the framework cost is measured.
+class BenchModule : public Module {
+ public:
+  explicit BenchModule(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet param_set) override { return true; }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override { return 0; }
+};  // class BenchModule
+
+class BenchSink : public BenchModule {
+ public:
+  explicit BenchSink(const std::string& name) : BenchModule(name) {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override {
+    count_.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+  }
+  void WaitFor(uint64_t count) const {
+    while (count_.load(std::memory_order_relaxed) < count) {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+
+ private:
+  std::atomic<uint64_t> count_{0};
+};  // class BenchSink
+
+/**
+ * Builds source -> module_0 -> ... -> module_{module_num - 1} -> sink. Each module but the source runs one thread
+ * per stream, as a pipeline configured with parallelism equal to the stream number does.
+ */
+static bool BuildChain(Pipeline* pipeline, int module_num, int stream_num, std::shared_ptr<BenchModule>* source,
+                       std::shared_ptr<BenchSink>* sink) {
+  *source = std::make_shared<BenchModule>("bench_source");
+  *sink = std::make_shared<BenchSink>("bench_sink");
+  std::vector<std::shared_ptr<Module>> modules = {*source};
+  for (int i = 0; i < module_num; ++i) {
+    modules.push_back(std::make_shared<BenchModule>("bench_module_" + std::to_string(i)));
+  }
+  modules.push_back(*sink);
+  for (size_t i = 0; i < modules.size(); ++i) {
+    if (!pipeline->AddModule(modules[i])) return false;
+    if (!pipeline->SetModuleAttribute(modules[i], i == 0 ? 0 : stream_num)) return false;
+    if (i > 0 && pipeline->LinkModules(modules[i - 1], modules[i]).empty()) return false;
+  }
+  return pipeline->Start();
+}
+
+static void BM_PipelineProvideData(benchmark::State& state) {  // NOLINT
+  Pipeline pipeline("bench_pipeline");
+  std::shared_ptr<BenchModule> source;
+  std::shared_ptr<BenchSink> sink;
+  if (!BuildChain(&pipeline, 0, 1, &source, &sink)) {
+    state.SkipWithError("Build pipeline failed");
+    return;
+  }
+  for (auto _ : state) {
+    auto data = CNFrameInfo::Create("stream_0");
+    data->SetStreamIndex(0);
+    pipeline.ProvideData(source.get(), data);
+  }
+  sink->WaitFor(state.iterations());
+  pipeline.Stop();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PipelineProvideData)->UseRealTime();
+
+/**
+ * Runs frames of args[1] streams through args[0] modules. Every iteration feeds kFramesPerStream frames to each
+ * stream from its own thread, as a source module does, and waits until the sink has got all of them.
+ */
+static void BM_PipelineChain(benchmark::State& state) {  // NOLINT
+  static constexpr int kFramesPerStream = 256;
+  const int module_num = state.range(0);
+  const int stream_num = state.range(1);
+  Pipeline pipeline("bench_pipeline");
+  std::shared_ptr<BenchModule> source;
+  std::shared_ptr<BenchSink> sink;
+  if (!BuildChain(&pipeline, module_num, stream_num, &source, &sink)) {
+    state.SkipWithError("Build pipeline failed");
+    return;
+  }
+  uint64_t total = 0;
+  for (auto _ : state) {
+    std::vector<std::thread> feeders;
+    for (int stream_idx = 0; stream_idx < stream_num; ++stream_idx) {
+      feeders.emplace_back([&, stream_idx] {
+        const std::string stream_id = "stream_" + std::to_string(stream_idx);
+        for (int i = 0; i < kFramesPerStream; ++i) {
+          auto data = CNFrameInfo::Create(stream_id);
+          data->SetStreamIndex(stream_idx);
+          data->timestamp = i;
+          pipeline.ProvideData(source.get(), data);
+        }
+      });
+    }
+    for (auto& feeder : feeders) feeder.join();
+    total += static_cast<uint64_t>(kFramesPerStream) * stream_num;
+    sink->WaitFor(total);
+  }
+  pipeline.Stop();
+  state.SetItemsProcessed(total);
+  state.counters["frames_per_stream_per_second"] =
+      benchmark::Counter(static_cast<double>(total) / stream_num, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_PipelineChain)
+    ->ArgNames({"modules", "streams"})
+    ->ArgsProduct({{1, 4, 8}, {1, 4, 16}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace cnstream
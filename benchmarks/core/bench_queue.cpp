@@ -0,0 +1,76 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "cnstream_frame.hpp"
+#include "conveyor.hpp"
+#include "util/cnstream_queue.hpp"
+
+namespace cnstream {
+
+static void BM_ThreadSafeQueuePushPop(benchmark::State& state) {  // NOLINT
+  static ThreadSafeQueue<int> queue;
+  int value = 0;
+  for (auto _ : state) {
+    queue.Push(value);
+    // every thread pops after its own push, so the queue is never empty here
+    queue.TryPop(value);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ThreadSafeQueuePushPop)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_ConveyorPushPop(benchmark::State& state) {  // NOLINT
+  const size_t batch = state.range(0);
+  Conveyor conveyor(batch);
+  auto data = CNFrameInfo::Create("0");
+  for (auto _ : state) {
+    for (size_t i = 0; i < batch; ++i) conveyor.PushDataBuffer(data);
+    for (size_t i = 0; i < batch; ++i) benchmark::DoNotOptimize(conveyor.PopDataBuffer());
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+BENCHMARK(BM_ConveyorPushPop)->Arg(1)->Arg(20)->Arg(256);
+
+// A producer thread keeps the conveyor busy while the benchmark thread pops, as a module thread does.
+static void BM_ConveyorProducerConsumer(benchmark::State& state) {  // NOLINT
+  Conveyor conveyor(state.range(0));
+  auto data = CNFrameInfo::Create("0");
+  std::atomic<bool> running{true};
+  std::thread producer([&] {
+    while (running.load(std::memory_order_relaxed)) {
+      if (!conveyor.PushDataBuffer(data)) std::this_thread::yield();
+    }
+  });
+  for (auto _ : state) {
+    while (!conveyor.PopDataBuffer()) continue;
+  }
+  running.store(false);
+  producer.join();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ConveyorProducerConsumer)->Arg(20)->UseRealTime();
+
+}  // namespace cnstream
@@ -0,0 +1,55 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+/**
+ * Runs the benchmarks. Results are written to cnstream_benchmark.json as well, unless --benchmark_out is given,
+ * so that every run can be tracked over time.
+ */
+int main(int argc, char** argv) {
+  // info messages of pipelines built and stopped by the benchmarks would bury the results
+  FLAGS_min_log_level = cnstream::LOG_WARNING;
+  cnstream::InitCNStreamLogging(nullptr);
+  std::vector<char*> args(argv, argv + argc);
+  bool has_out = false;
+  for (int i = 1; i < argc; ++i) {
+    if (!strncmp(argv[i], "--benchmark_out=", strlen("--benchmark_out="))) has_out = true;
+  }
+  std::string out = "--benchmark_out=cnstream_benchmark.json";
+  std::string out_format = "--benchmark_out_format=json";
+  if (!has_out) {
+    args.push_back(&out[0]);
+    args.push_back(&out_format[0]);
+  }
+  int args_num = static_cast<int>(args.size());
+  benchmark::Initialize(&args_num, args.data());
+  if (benchmark::ReportUnrecognizedArguments(args_num, args.data())) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  cnstream::ShutdownCNStreamLogging();
+  return 0;
+}
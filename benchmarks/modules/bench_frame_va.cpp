@@ -0,0 +1,58 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+
+namespace cnstream {
+
+/**
+ * Converts a CPU frame to BGR, args are the width and height. The frame is rebuilt out of the timed region since
+ * ImageBGR caches its result.
+ */
+static void BM_CNDataFrameImageBGR(benchmark::State& state) {  // NOLINT
+  const int width = state.range(0);
+  const int height = state.range(1);
+  std::vector<uint8_t> y_plane(width * height, 128);
+  std::vector<uint8_t> uv_plane(width * height / 2, 128);
+  for (auto _ : state) {
+    state.PauseTiming();
+    CNDataFrame frame;
+    frame.ctx.dev_type = DevContext::CPU;
+    frame.fmt = CN_PIXEL_FORMAT_YUV420_NV12;
+    frame.width = width;
+    frame.height = height;
+    frame.stride[0] = frame.stride[1] = width;
+    frame.ptr_cpu[0] = y_plane.data();
+    frame.ptr_cpu[1] = uv_plane.data();
+    frame.CopyToSyncMem(false);
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(frame.ImageBGR());
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * width * height * 3 / 2);
+}
+BENCHMARK(BM_CNDataFrameImageBGR)->Args({1280, 720})->Args({1920, 1080})->Unit(benchmark::kMillisecond);
+
+}  // namespace cnstream
@@ -0,0 +1,121 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <benchmark/benchmark.h>
+
+#include <opencv2/core/core.hpp>
+
+#include <cerrno>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "ffmpeg_video_encoder.hpp"
+#include "rtsp_sink.hpp"
+
+#ifdef __GLIBC__
+/*
+ * Counts heap allocations of the whole process, including the ones made by OpenCV, FFmpeg and live555, which do
+ * not go through operator new. Allocations are only counted while g_alloc_counting is set, so that the other
+ * benchmarks of the binary only pay for the forwarding to glibc.
+ */
+static std::atomic<bool> g_alloc_counting{false};
+static std::atomic<uint64_t> g_alloc_count{0};
+
+static inline void CountAlloc() {
+  if (g_alloc_counting.load(std::memory_order_relaxed)) g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+
+void *malloc(size_t size) {
+  CountAlloc();
+  return __libc_malloc(size);
+}
+void *calloc(size_t n, size_t size) {
+  CountAlloc();
+  return __libc_calloc(n, size);
+}
+void *realloc(void *ptr, size_t size) {
+  CountAlloc();
+  return __libc_realloc(ptr, size);
+}
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+  CountAlloc();
+  *ptr = __libc_memalign(alignment, size);
+  return *ptr ? 0 : ENOMEM;
+}
+}  // extern "C"
+
+namespace cnstream {
+
+/**
+ * Encodes BGR frames with the FFmpeg encoder and drains every packet as the rtsp server would. Reports the heap
+ * allocations per frame in steady state, which should stay close to zero since frames and packets are pooled.
+ */
+static void BM_RtspEncoderSteadyState(benchmark::State& state) {  // NOLINT
+  RtspParam param;
+  param.dst_width = 704;
+  param.dst_height = 576;
+  param.frame_rate = 25;
+  param.kbps = 1024;
+  param.gop = 30;
+  param.color_format = NV21;
+  param.codec_type = H264;
+  param.enc_type = FFMPEG;
+  FFmpegVideoEncoder encoder(param);
+  encoder.Start();
+
+  cv::Mat canvas(param.dst_height, param.dst_width, CV_8UC3);
+  cv::randu(canvas, cv::Scalar::all(0), cv::Scalar::all(255));
+  std::vector<uint8_t> rtsp_buffer(0x200000);
+  int64_t timestamp = 0;
+  auto encode_frame = [&]() {
+    if (!encoder.SendFrameBGR(canvas.data, static_cast<int>(canvas.step), timestamp)) {
+      state.SkipWithError("failed to send frame to the encoder");
+    }
+    timestamp += 40;
+    uint32_t size;
+    int64_t pts;
+    while (encoder.GetFrame(rtsp_buffer.data(), rtsp_buffer.size(), &size, &pts)) {
+    }
+  };
+
+  for (int i = 0; i < 50; ++i) encode_frame();  // warm up pools and codec lookahead
+  g_alloc_count.store(0);
+  g_alloc_counting.store(true);
+  for (auto _ : state) {
+    encode_frame();
+  }
+  g_alloc_counting.store(false);
+  encoder.Stop();
+
+  state.SetItemsProcessed(state.iterations());
+  state.counters["allocs_per_frame"] =
+      benchmark::Counter(static_cast<double>(g_alloc_count.load()), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_RtspEncoderSteadyState)->Iterations(500)->Unit(benchmark::kMillisecond);
+
+}  // namespace cnstream
+#endif  // __GLIBC__
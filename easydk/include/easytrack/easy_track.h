@@ -124,6 +124,14 @@ class EasyTrack {
 
 class FeatureMatchPrivate;
 
+/**
+ * @brief Solver of the assignment problems in matching.
+ */
+enum class AssignmentSolver {
+  HUNGARIAN,  ///< Dense Munkres algorithm
+  SPARSE,     ///< Solves each connected component of the pairs under the distance threshold separately
+};
+
 /**
  * @brief Track objects based on match feature.
  *
@@ -153,6 +161,13 @@ class FeatureMatchTrack : public EasyTrack {
    */
   void SetParams(float max_cosine_distance, int nn_budget, float max_iou_distance, int max_age, int n_init);
 
+  /**
+   * @brief Set the assignment solver, Hungarian by default.
+   *
+   * @param solver[in] Assignment solver. The sparse solver is much faster when gating leaves few candidate pairs.
+   */
+  void SetAssignmentSolver(AssignmentSolver solver);
+
   /**
    * @brief Update object status and do tracking using cascade matching and IOU matching.
    *
@@ -170,6 +185,7 @@ class FeatureMatchTrack : public EasyTrack {
   int max_age_ = 30;
   int n_init_ = 3;
   uint32_t nn_budget_ = 100;
+  AssignmentSolver solver_ = AssignmentSolver::HUNGARIAN;
 };  // class FeatureMatchTrack
 
 class KcfTrackPrivate;
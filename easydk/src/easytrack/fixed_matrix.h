@@ -0,0 +1,138 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+/**
+ * @file fixed_matrix.h
+ *
+ * This file contains a matrix type with dimensions fixed at compile time, and the kernels used by the Kalman filter.
+ */
+
+#ifndef EASYTRACK_FIXED_MATRIX_H_
+#define EASYTRACK_FIXED_MATRIX_H_
+
+#include <cmath>
+
+namespace edk {
+
+/**
+ * @brief Row-major matrix stored inline, no heap allocation.
+ *
+ * All loops have constant trip counts, so the compiler unrolls and vectorizes them.
+ */
+template <int R, int C>
+struct alignas(16) FixedMatrix {
+  static constexpr int kRows = R;
+  static constexpr int kCols = C;
+  float data[R * C];
+
+  float &operator()(int r, int c) { return data[r * C + c]; }
+  const float &operator()(int r, int c) const { return data[r * C + c]; }
+
+  void Fill(float value) {
+    for (int i = 0; i < R * C; ++i) data[i] = value;
+  }
+
+  FixedMatrix &operator+=(const FixedMatrix &m) {
+    for (int i = 0; i < R * C; ++i) data[i] += m.data[i];
+    return *this;
+  }
+
+  FixedMatrix &operator-=(const FixedMatrix &m) {
+    for (int i = 0; i < R * C; ++i) data[i] -= m.data[i];
+    return *this;
+  }
+
+  FixedMatrix<C, R> Trans() const {
+    FixedMatrix<C, R> t;
+    for (int r = 0; r < R; ++r) {
+      for (int c = 0; c < C; ++c) t(c, r) = (*this)(r, c);
+    }
+    return t;
+  }
+};
+
+template <int R, int K, int C>
+inline FixedMatrix<R, C> operator*(const FixedMatrix<R, K> &lhs, const FixedMatrix<K, C> &rhs) {
+  FixedMatrix<R, C> ret;
+  ret.Fill(0);
+  // i-k-j order, the inner loop runs over contiguous rows of rhs and ret
+  for (int i = 0; i < R; ++i) {
+    for (int k = 0; k < K; ++k) {
+      float v = lhs(i, k);
+      for (int j = 0; j < C; ++j) ret(i, j) += v * rhs(k, j);
+    }
+  }
+  return ret;
+}
+
+/**
+ * @brief Cholesky factorization A = L * L^T of a symmetric positive definite matrix.
+ *
+ * @return Returns false if the matrix is not positive definite.
+ */
+template <int N>
+inline bool Cholesky(const FixedMatrix<N, N> &a, FixedMatrix<N, N> *l) {
+  l->Fill(0);
+  for (int j = 0; j < N; ++j) {
+    float d = a(j, j);
+    for (int k = 0; k < j; ++k) d -= (*l)(j, k) * (*l)(j, k);
+    if (!(d > 0)) return false;
+    d = std::sqrt(d);
+    (*l)(j, j) = d;
+    for (int i = j + 1; i < N; ++i) {
+      float s = a(i, j);
+      for (int k = 0; k < j; ++k) s -= (*l)(i, k) * (*l)(j, k);
+      (*l)(i, j) = s / d;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Solves L * L^T * X = B with the factor from Cholesky, B is replaced by X.
+ */
+template <int N, int C>
+inline void CholeskySolve(const FixedMatrix<N, N> &l, FixedMatrix<N, C> *b) {
+  // L * Y = B
+  for (int i = 0; i < N; ++i) {
+    for (int k = 0; k < i; ++k) {
+      for (int c = 0; c < C; ++c) (*b)(i, c) -= l(i, k) * (*b)(k, c);
+    }
+    float inv = 1.f / l(i, i);
+    for (int c = 0; c < C; ++c) (*b)(i, c) *= inv;
+  }
+  // L^T * X = Y
+  for (int i = N - 1; i >= 0; --i) {
+    for (int k = i + 1; k < N; ++k) {
+      for (int c = 0; c < C; ++c) (*b)(i, c) -= l(k, i) * (*b)(k, c);
+    }
+    float inv = 1.f / l(i, i);
+    for (int c = 0; c < C; ++c) (*b)(i, c) *= inv;
+  }
+}
+
+using Mat4 = FixedMatrix<4, 4>;
+using Mat8 = FixedMatrix<8, 8>;
+using Vec4 = FixedMatrix<4, 1>;
+using Vec8 = FixedMatrix<8, 1>;
+
+}  // namespace edk
+
+#endif  // EASYTRACK_FIXED_MATRIX_H_
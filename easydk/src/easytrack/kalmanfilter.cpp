@@ -1,35 +1,27 @@
 #include "kalmanfilter.h"
 #include <cmath>
-#include <vector>
+#include <limits>
 
 namespace edk {
 
 KalmanFilter::KalmanFilter() {
-  mean_ = Matrix(1, 8);
-  covariance_ = Matrix(8, 8);
-  // state transition matrix A
-  motion_mat_ = {{1, 0, 0, 0, 1, 0, 0, 0}, {0, 1, 0, 0, 0, 1, 0, 0}, {0, 0, 1, 0, 0, 0, 1, 0},
-                 {0, 0, 0, 1, 0, 0, 0, 1}, {0, 0, 0, 0, 1, 0, 0, 0}, {0, 0, 0, 0, 0, 1, 0, 0},
-                 {0, 0, 0, 0, 0, 0, 1, 0}, {0, 0, 0, 0, 0, 0, 0, 1}};
-  // measurement matrix H
-  update_mat_ = {
-      {1, 0, 0, 0, 0, 0, 0, 0}, {0, 1, 0, 0, 0, 0, 0, 0}, {0, 0, 1, 0, 0, 0, 0, 0}, {0, 0, 0, 1, 0, 0, 0, 0}};
-
+  mean_.Fill(0);
+  covariance_.Fill(0);
   this->std_weight_position_ = 1. / 20;
   this->std_weight_velocity_ = 1. / 160;
 }
 
 void KalmanFilter::Initiate(const BoundingBox &measurement) {
   // initial state X(k-1|k-1)
-  mean_[0][0] = measurement.x;
-  mean_[0][1] = measurement.y;
-  mean_[0][2] = measurement.width;
-  mean_[0][3] = measurement.height;
+  mean_(0, 0) = measurement.x;
+  mean_(1, 0) = measurement.y;
+  mean_(2, 0) = measurement.width;
+  mean_(3, 0) = measurement.height;
   for (int i = 4; i < 8; ++i) {
-    mean_[0][i] = 0;
+    mean_(i, 0) = 0;
   }
 
-  vector<float> std(8, 0);
+  float std[8];
   std[2] = 1e-2;
   std[0] = std[1] = std[3] = 2 * std_weight_position_ * measurement.height;
 
@@ -37,98 +29,92 @@ void KalmanFilter::Initiate(const BoundingBox &measurement) {
   std[4] = std[5] = std[7] = 10 * std_weight_velocity_ * measurement.height;
 
   // init MMSE P(k-1|k-1)
-  for (int i = 0; i < 8; ++i) covariance_[i][i] = std[i] * std[i];
+  covariance_.Fill(0);
+  for (int i = 0; i < 8; ++i) covariance_(i, i) = std[i] * std[i];
 }
 
 void KalmanFilter::Predict() {
-  vector<float> std(8, 0);
-  Matrix motion_cov(8, 8);
+  float std[8];
 
   // process noise covariance Q
-
   std[2] = 1e-2;
-  std[0] = std[1] = std[3] = std_weight_position_ * mean_[0][3];
+  std[0] = std[1] = std[3] = std_weight_position_ * mean_(3, 0);
   std[6] = 1e-5;
-  std[4] = std[5] = std[7] = std_weight_velocity_ * mean_[0][3];
+  std[4] = std[5] = std[7] = std_weight_velocity_ * mean_(3, 0);
 
-  for (int i = 0; i < 8; ++i) {
-    motion_cov[i][i] = std[i] * std[i];
-  }
+  // formula 1：x(k|k-1)=A*x(k-1|k-1), position += velocity
+  for (int i = 0; i < 4; ++i) mean_(i, 0) += mean_(i + 4, 0);
 
-  Matrix mean1(8, 1);
-  Matrix covariance1(8, 8);
-  // formula 1：x(k|k-1)=A*x(k-1|k-1)
-  mean1 = motion_mat_ * mean_.Trans();
   // formula 2：P(k|k-1)=A*P(k-1|k-1)A^T +Q
-  covariance1 = motion_mat_ * covariance_ * motion_mat_.Trans();
-  covariance1 += motion_cov;
-
-  mean_ = mean1.Trans();
-  covariance_ = covariance1;
+  // A*P adds the velocity rows to the position rows, (A*P)*A^T does the same for columns
+  for (int r = 0; r < 4; ++r) {
+    for (int c = 0; c < 8; ++c) covariance_(r, c) += covariance_(r + 4, c);
+  }
+  for (int r = 0; r < 8; ++r) {
+    for (int c = 0; c < 4; ++c) covariance_(r, c) += covariance_(r, c + 4);
+  }
+  for (int i = 0; i < 8; ++i) covariance_(i, i) += std[i] * std[i];
 }
 
-KalHData KalmanFilter::Project(const Matrix &mean, const Matrix &covariance) {
-  vector<float> std(4);
-
+void KalmanFilter::ProjectCovariance(Mat4 *covariance) const {
+  float std[4];
   std[2] = 1e-1;
-  std[0] = std[1] = std[3] = std_weight_position_ * mean[0][3];
+  std[0] = std[1] = std[3] = std_weight_position_ * mean_(3, 0);
 
+  // part of formula 3：(H*P(k|k-1)*H^T + R), H picks the position block
+  for (int r = 0; r < 4; ++r) {
+    for (int c = 0; c < 4; ++c) (*covariance)(r, c) = covariance_(r, c);
+  }
   // measurement noise R
-  Matrix innovation_cov(4, 4);
+  for (int i = 0; i < 4; ++i) (*covariance)(i, i) += std[i] * std[i];
+}
 
-  for (int i = 0; i < 4; ++i) {
-    innovation_cov[i][i] = std[i] * std[i];
-  }
+void KalmanFilter::Update(const BoundingBox &bbox) {
+  Mat4 projected_cov, chol;
+  ProjectCovariance(&projected_cov);
+  if (!Cholesky(projected_cov, &chol)) return;
 
-  Matrix mean1(1, 4);
-  Matrix covariance1(4, 4);
-  mean1 = (update_mat_ * mean_.Trans()).Trans();
+  float innovation[4] = {bbox.x - mean_(0, 0), bbox.y - mean_(1, 0), bbox.width - mean_(2, 0),
+                         bbox.height - mean_(3, 0)};
 
-  // part of formula 3：(H*P(k|k-1)*H^T + R)
-  covariance1 = update_mat_ * covariance * update_mat_.Trans();
-  covariance1 += innovation_cov;
+  // H*P(k|k-1), the first 4 rows of P
+  FixedMatrix<4, 8> hp;
+  for (int i = 0; i < 4 * 8; ++i) hp.data[i] = covariance_.data[i];
 
-  return std::make_pair(mean1, covariance1);
-}
+  // formula 3: Kg = P(k|k-1) * H^T * (H*P(k|k-1)*H^T + R)^(-1), solved as Kg^T = S^(-1) * (H*P(k|k-1))
+  FixedMatrix<4, 8> gain_t = hp;
+  CholeskySolve(chol, &gain_t);
 
-void KalmanFilter::Update(const BoundingBox &bbox) {
-  KalHData pa = Project(mean_, covariance_);
-  Matrix &projected_mean = pa.first;
-  Matrix &projected_cov = pa.second;
-
-  Matrix kalman_gain(8, 4);
-  Matrix measurement(1, 4);
-  measurement[0][0] = bbox.x;
-  measurement[0][1] = bbox.y;
-  measurement[0][2] = bbox.width;
-  measurement[0][3] = bbox.height;
-
-  // formula 3: Kg = P(k|k-1) * H^T * (H*P(k|k-1)*H^T + R)^(-1)
-  kalman_gain = covariance_ * update_mat_.Trans() * projected_cov.Inv();
   // formula 4: x(k|k) = x(k|k-1) + Kg * (m - H * x(k|k-1))
-  mean_ += (measurement - projected_mean) * kalman_gain.Trans();
+  for (int k = 0; k < 4; ++k) {
+    for (int i = 0; i < 8; ++i) mean_(i, 0) += gain_t(k, i) * innovation[k];
+  }
   // formula 5: P(k|k) = P(k|k-1) - Kg * H * P(k|k-1)
-  covariance_ = covariance_ - kalman_gain * update_mat_ * covariance_;
-  // covariance_ = covariance_ - kalman_gain * projected_cov * kalman_gain.Trans();
+  covariance_ -= gain_t.Trans() * hp;
 }
 
-Matrix KalmanFilter::GatingDistance(const std::vector<BoundingBox> &measurements) {
-  KalHData pa = Project(mean_, covariance_);
-  Matrix mean1 = pa.first;
-  Matrix covariance1_inv = pa.second.Inv();
-
-  int num = measurements.size();
-  Matrix d(1, 4);
-  Matrix square_maha(1, num);
-  for (int i = 0; i < num; i++) {
-    d[0][0] = measurements[i].x - mean1[0][0];
-    d[0][1] = measurements[i].y - mean1[0][1];
-    d[0][2] = measurements[i].width - mean1[0][2];
-    d[0][3] = measurements[i].height - mean1[0][3];
-
-    square_maha[0][i] = (d * covariance1_inv * d.Trans())[0][0];
+void KalmanFilter::GatingDistance(const float *measurements, int num, float *square_maha) const {
+  Mat4 projected_cov, chol;
+  ProjectCovariance(&projected_cov);
+  if (!Cholesky(projected_cov, &chol)) {
+    for (int i = 0; i < num; ++i) square_maha[i] = std::numeric_limits<float>::max();
+    return;
+  }
+
+  // d^T * S^(-1) * d = |z|^2 with L * z = d, coefficients are hoisted so the loop over measurements vectorizes
+  const float m0 = mean_(0, 0), m1 = mean_(1, 0), m2 = mean_(2, 0), m3 = mean_(3, 0);
+  const float i00 = 1.f / chol(0, 0), i11 = 1.f / chol(1, 1), i22 = 1.f / chol(2, 2), i33 = 1.f / chol(3, 3);
+  const float l10 = chol(1, 0), l20 = chol(2, 0), l21 = chol(2, 1), l30 = chol(3, 0), l31 = chol(3, 1),
+              l32 = chol(3, 2);
+  const float *x = measurements, *y = measurements + num, *a = measurements + 2 * num,
+              *h = measurements + 3 * num;
+  for (int i = 0; i < num; ++i) {
+    float z0 = (x[i] - m0) * i00;
+    float z1 = (y[i] - m1 - l10 * z0) * i11;
+    float z2 = (a[i] - m2 - l20 * z0 - l21 * z1) * i22;
+    float z3 = (h[i] - m3 - l30 * z0 - l31 * z1 - l32 * z2) * i33;
+    square_maha[i] = z0 * z0 + z1 * z1 + z2 * z2 + z3 * z3;
   }
-  return square_maha;
 }
 
 }  // namespace edk
@@ -2,19 +2,20 @@
 #define EASYTRACK_KALMANFILTER_H
 
 #include "easytrack/easy_track.h"
-#include "matrix.h"
+#include "fixed_matrix.h"
 
 namespace edk {
 
-using KalHData = std::pair<Matrix, Matrix>;
-
 /**
  * @brief Implementation of Kalman filter
+ *
+ * The state is (x, y, a, h, vx, vy, va, vh) and the measurement is (x, y, a, h). The state transition matrix
+ * A = [I I; 0 I] and the measurement matrix H = [I 0] are applied by their block structure.
  */
 class KalmanFilter {
  public:
   /**
-   * @brief Initialize the state transition matrix and measurement matrix
+   * @brief Initialize the noise weights
    */
   KalmanFilter();
 
@@ -28,26 +29,28 @@ class KalmanFilter {
    */
   void Predict();
 
-  /**
-   * @brief Calculate measurement noise R
-   */
-  KalHData Project(const Matrix& mean, const Matrix& covariance);
-
   /**
    * @brief Calculate the Kalman gain and update the state and MMSE
    */
   void Update(const BoundingBox& measurement);
 
   /**
-   * @brief Calculate the mahalanobis distance
+   * @brief Calculate the squared mahalanobis distance to a batch of measurements in one pass
+   *
+   * @param measurements Measurements stored as four planes of num floats: x, y, a, h
+   * @param num Number of measurements
+   * @param square_maha Output, num distances
    */
-  Matrix GatingDistance(const std::vector<BoundingBox>& measurements);
+  void GatingDistance(const float* measurements, int num, float* square_maha) const;
 
  private:
-  Matrix motion_mat_;
-  Matrix update_mat_;
-  Matrix mean_;
-  Matrix covariance_;
+  /**
+   * @brief Calculate H*P(k|k-1)*H^T + R, the covariance of the projected state
+   */
+  void ProjectCovariance(Mat4* covariance) const;
+
+  Vec8 mean_;
+  Mat8 covariance_;
 
   float std_weight_position_;
   float std_weight_velocity_;
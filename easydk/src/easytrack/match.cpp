@@ -1,5 +1,6 @@
 #include "match.h"
 
+#include <algorithm>
 #include <cmath>
 #include <functional>
 #include <limits>
@@ -107,6 +108,103 @@ float MatchAlgorithm::IoU(const Rect& a, const Rect& b) {
   return area_intersection / (area_a + area_b - area_intersection);
 }
 
+static inline float L2Norm(const float* feature, int dim) {
+  float sum = 0;
+  for (int i = 0; i < dim; ++i) sum += feature[i] * feature[i];
+  return std::sqrt(sum);
+}
+
+void FeatureHistory::Add(const std::vector<float>& feature) {
+  int dim = static_cast<int>(feature.size());
+  if (dim == 0) return;
+  if (dim != dim_) {
+    Clear();
+    dim_ = dim;
+  }
+  if (size_ < budget_) {
+    data_.resize(static_cast<size_t>(size_ + 1) * dim_);
+    next_ = size_++;
+  }
+  float* row = data_.data() + static_cast<size_t>(next_) * dim_;
+  float norm = L2Norm(feature.data(), dim_);
+  float scale = norm > 0 ? 1.f / norm : 0.f;
+  for (int i = 0; i < dim_; ++i) row[i] = feature[i] * scale;
+  next_ = (next_ + 1) % budget_;
+}
+
+void PackedFeatures::Pack(const std::vector<const std::vector<float>*>& features) {
+  num = static_cast<int>(features.size());
+  padded_num = (num + kBlock - 1) / kBlock * kBlock;
+  dim = 0;
+  for (auto feature : features) {
+    if (!feature->empty()) {
+      dim = static_cast<int>(feature->size());
+      break;
+    }
+  }
+  data.assign(static_cast<size_t>(dim) * padded_num, 0.f);
+  for (int j = 0; j < num; ++j) {
+    const std::vector<float>& feature = *features[j];
+    if (static_cast<int>(feature.size()) != dim) continue;
+    float norm = L2Norm(feature.data(), dim);
+    if (norm == 0) continue;
+    float scale = 1.f / norm;
+    for (int d = 0; d < dim; ++d) data[static_cast<size_t>(d) * padded_num + j] = feature[d] * scale;
+  }
+}
+
+/*
+ * Largest cosine similarity between rows of a track history (rows x dim) and every detection, clamped to [0, 1].
+ * Blocked like a GEMM: a tile of 4 history rows x kBlock detections is accumulated in registers / L1, streaming
+ * one row of the packed detections per feature dimension. The inner loop has a constant trip count.
+ */
+static void MaxSimilarity(const float* rows, int row_num, const PackedFeatures& dets, float* best) {
+  constexpr int kRows = 4;
+  constexpr int kBlock = PackedFeatures::kBlock;
+  const int dim = dets.dim;
+  const int stride = dets.padded_num;
+  for (int j = 0; j < dets.num; ++j) best[j] = 0;
+  for (int j0 = 0; j0 < stride; j0 += kBlock) {
+    int jn = std::min(kBlock, dets.num - j0);
+    for (int r0 = 0; r0 < row_num; r0 += kRows) {
+      int rn = std::min(kRows, row_num - r0);
+      float acc[kRows][kBlock] = {{0}};
+      const float* a = rows + static_cast<size_t>(r0) * dim;
+      for (int d = 0; d < dim; ++d) {
+        const float* b = dets.data.data() + static_cast<size_t>(d) * stride + j0;
+        for (int r = 0; r < rn; ++r) {
+          const float v = a[r * dim + d];
+          for (int j = 0; j < kBlock; ++j) acc[r][j] += v * b[j];
+        }
+      }
+      for (int r = 0; r < rn; ++r) {
+        for (int j = 0; j < jn; ++j) best[j0 + j] = std::max(best[j0 + j], acc[r][j]);
+      }
+    }
+  }
+  for (int j = 0; j < dets.num; ++j) best[j] = std::min(best[j], 1.f);
+}
+
+void MatchAlgorithm::FeatureDistance(DistanceType type, const std::vector<const FeatureHistory*>& tracks,
+                                     const PackedFeatures& detections, float* cost) {
+  const int det_num = detections.num;
+  for (size_t i = 0; i < tracks.size(); ++i) {
+    float* row = cost + i * det_num;
+    const FeatureHistory* track = tracks[i];
+    if (track->Dim() == detections.dim && detections.dim > 0) {
+      MaxSimilarity(track->Data(), track->Size(), detections, row);
+    } else {
+      std::fill(row, row + det_num, 0.f);
+    }
+    if (type == DistanceType::COSINE) {
+      for (int j = 0; j < det_num; ++j) row[j] = 1 - row[j];
+    } else {
+      // |a - b| = sqrt(2 - 2 * cos) for normalized features
+      for (int j = 0; j < det_num; ++j) row[j] = std::sqrt(2 - 2 * row[j]);
+    }
+  }
+}
+
 CostMatrix MatchAlgorithm::IoUCost(const std::vector<Rect>& det_rects, const std::vector<Rect>& tra_rects) {
   CostMatrix res;
   for (auto& det : det_rects) {
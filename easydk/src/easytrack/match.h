@@ -14,6 +14,53 @@ namespace edk {
 using CostMatrix = std::vector<std::vector<float>>;
 using DistanceFunc = std::function<float(const std::vector<std::vector<float>> &, const std::vector<float> &)>;
 
+enum class DistanceType { COSINE, EUCLIDEAN };
+
+/**
+ * @brief Recent features of a track, L2 normalized once when added and stored in contiguous rows
+ */
+class FeatureHistory {
+ public:
+  void SetBudget(int budget) { budget_ = budget > 0 ? budget : 1; }
+  /**
+   * @brief Add a feature, the oldest one is replaced when the budget is reached
+   */
+  void Add(const std::vector<float> &feature);
+  void Clear() {
+    data_.clear();
+    size_ = next_ = dim_ = 0;
+  }
+  const float *Data() const { return data_.data(); }
+  int Size() const { return size_; }
+  int Dim() const { return dim_; }
+
+ private:
+  std::vector<float> data_;
+  int budget_ = 1;
+  int dim_ = 0;
+  int size_ = 0;
+  int next_ = 0;  // the row replaced next when full
+};  // class FeatureHistory
+
+/**
+ * @brief Normalized features of a batch of detections, packed feature-major (dim rows x padded_num columns)
+ *
+ * Column j is detection j. Columns are padded with zeros to a multiple of kBlock, so the distance kernel always
+ * works on full blocks.
+ */
+struct PackedFeatures {
+  static constexpr int kBlock = 64;
+  std::vector<float> data;
+  int dim = 0;
+  int num = 0;
+  int padded_num = 0;
+
+  /**
+   * @brief Normalize and pack features. Features which are empty, zero, or of another dimension become zero columns.
+   */
+  void Pack(const std::vector<const std::vector<float> *> &features);
+};
+
 class MatchAlgorithm {
  public:
   static MatchAlgorithm *Instance();
@@ -29,6 +76,17 @@ class MatchAlgorithm {
     return distance_algo_[dist_func](std::forward<Args>(args)...);
   }
 
+  /**
+   * @brief Distances from every track to every detection, the smallest one over the features of a track
+   *
+   * @param type Cosine distance, or euclidean distance of normalized features
+   * @param tracks Feature histories of tracks
+   * @param detections Packed detection features
+   * @param cost Output, tracks.size() x detections.num, row-major
+   */
+  void FeatureDistance(DistanceType type, const std::vector<const FeatureHistory *> &tracks,
+                       const PackedFeatures &detections, float *cost);
+
  private:
   MatchAlgorithm();
   float IoU(const Rect &a, const Rect &b);
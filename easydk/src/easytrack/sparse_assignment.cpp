@@ -0,0 +1,174 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "sparse_assignment.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace edk {
+
+// cost of leaving a row unassigned, same as a gated pair in the dense cost matrix
+static inline float UnassignedCost(float max_cost) { return max_cost + 1e-5f; }
+
+int SparseAssignment::Find(int node) {
+  while (parent_[node] != node) {
+    parent_[node] = parent_[parent_[node]];
+    node = parent_[node];
+  }
+  return node;
+}
+
+float SparseAssignment::Solve(const std::vector<std::vector<float>> &cost, float max_cost,
+                              std::vector<int> *assignment) {
+  const int row_num = static_cast<int>(cost.size());
+  assignment->assign(row_num, -1);
+  if (row_num == 0) return 0;
+  const int col_num = static_cast<int>(cost[0].size());
+  if (col_num == 0) return 0;
+
+  // rows are nodes [0, row_num), columns are nodes [row_num, row_num + col_num)
+  const int node_num = row_num + col_num;
+  parent_.resize(node_num);
+  for (int i = 0; i < node_num; ++i) parent_[i] = i;
+  for (int i = 0; i < row_num; ++i) {
+    const float *row = cost[i].data();
+    for (int j = 0; j < col_num; ++j) {
+      if (row[j] > max_cost) continue;
+      int a = Find(i), b = Find(row_num + j);
+      if (a != b) parent_[b] = a;
+    }
+  }
+
+  // group nodes by component, rows before columns inside each group since nodes are visited in order
+  comp_start_.assign(node_num + 1, 0);
+  for (int i = 0; i < node_num; ++i) ++comp_start_[Find(i) + 1];
+  for (int i = 0; i < node_num; ++i) comp_start_[i + 1] += comp_start_[i];
+  comp_nodes_.resize(node_num);
+  comp_fill_.assign(comp_start_.begin(), comp_start_.end() - 1);
+  for (int i = 0; i < node_num; ++i) comp_nodes_[comp_fill_[Find(i)]++] = i;
+
+  float total = 0;
+  for (int root = 0; root < node_num; ++root) {
+    const int begin = comp_start_[root], end = comp_start_[root + 1];
+    if (end - begin < 2) continue;  // isolated row or column
+    rows_.clear();
+    cols_.clear();
+    for (int k = begin; k < end; ++k) {
+      int node = comp_nodes_[k];
+      if (node < row_num) {
+        rows_.push_back(node);
+      } else {
+        cols_.push_back(node - row_num);
+      }
+    }
+    if (rows_.size() == 1 && cols_.size() == 1) {
+      (*assignment)[rows_[0]] = cols_[0];
+      total += cost[rows_[0]][cols_[0]];
+      continue;
+    }
+    total += SolveComponent(cost, max_cost, rows_.data(), static_cast<int>(rows_.size()), cols_.data(),
+                            static_cast<int>(cols_.size()), assignment);
+  }
+  return total;
+}
+
+/*
+ * Rows are augmented one by one along shortest paths in the reduced costs, keeping the row and column potentials
+ * feasible. Every row has its own slack column of UnassignedCost, so the problem is always rectangular with
+ * rows <= columns and every augmenting path ends at a free column. Arrays are 1-based, column 0 is the virtual
+ * source of the current row.
+ */
+float SparseAssignment::SolveComponent(const std::vector<std::vector<float>> &cost, float max_cost, const int *rows,
+                                       int row_num, const int *cols, int col_num, std::vector<int> *assignment) {
+  constexpr float kInf = std::numeric_limits<float>::infinity();
+  const int n = row_num;
+  const int m = col_num + row_num;
+  const float unassigned_cost = UnassignedCost(max_cost);
+
+  local_cost_.resize(static_cast<size_t>(n) * m);
+  for (int i = 0; i < n; ++i) {
+    const float *src = cost[rows[i]].data();
+    float *dst = local_cost_.data() + static_cast<size_t>(i) * m;
+    for (int j = 0; j < col_num; ++j) {
+      float c = src[cols[j]];
+      dst[j] = c > max_cost ? kInf : c;
+    }
+    std::fill(dst + col_num, dst + m, unassigned_cost);
+  }
+
+  u_.assign(n + 1, 0);
+  v_.assign(m + 1, 0);
+  col_row_.assign(m + 1, 0);
+  way_.assign(m + 1, 0);
+  min_dist_.resize(m + 1);
+  used_.resize(m + 1);
+  for (int i = 1; i <= n; ++i) {
+    col_row_[0] = i;
+    int j0 = 0;
+    std::fill(min_dist_.begin(), min_dist_.end(), kInf);
+    std::fill(used_.begin(), used_.end(), 0);
+    do {
+      used_[j0] = 1;
+      const int i0 = col_row_[j0];
+      const float *row = local_cost_.data() + static_cast<size_t>(i0 - 1) * m;
+      float delta = kInf;
+      int j1 = 0;
+      for (int j = 1; j <= m; ++j) {
+        if (used_[j]) continue;
+        float cur = row[j - 1] - u_[i0] - v_[j];
+        if (cur < min_dist_[j]) {
+          min_dist_[j] = cur;
+          way_[j] = j0;
+        }
+        if (min_dist_[j] < delta) {
+          delta = min_dist_[j];
+          j1 = j;
+        }
+      }
+      for (int j = 0; j <= m; ++j) {
+        if (used_[j]) {
+          u_[col_row_[j]] += delta;
+          v_[j] -= delta;
+        } else {
+          min_dist_[j] -= delta;
+        }
+      }
+      j0 = j1;
+    } while (col_row_[j0] != 0);
+    do {
+      int j1 = way_[j0];
+      col_row_[j0] = col_row_[j1];
+      j0 = j1;
+    } while (j0 != 0);
+  }
+
+  float total = 0;
+  for (int j = 1; j <= col_num; ++j) {
+    if (col_row_[j] == 0) continue;
+    int row = rows[col_row_[j] - 1];
+    (*assignment)[row] = cols[j - 1];
+    total += cost[row][cols[j - 1]];
+  }
+  return total;
+}
+
+}  // namespace edk
@@ -0,0 +1,75 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef EASYTRACK_SPARSE_ASSIGNMENT_H_
+#define EASYTRACK_SPARSE_ASSIGNMENT_H_
+
+#include <vector>
+
+namespace edk {
+
+/**
+ * @brief Assignment solver for cost matrices in which most pairs are gated out.
+ *
+ * Pairs whose cost is larger than the threshold are not edges. The bipartite graph of the remaining pairs is split
+ * into connected components, and each component is solved separately by shortest augmenting paths
+ * (Jonker-Volgenant style, with column potentials). A row left unassigned costs as much as a gated pair, so the
+ * result is an optimum of the same problem the dense Hungarian solver sees when gated costs are set just above the
+ * threshold.
+ *
+ * Scratch buffers are kept between calls, one solver must not be used by several threads at the same time.
+ */
+class SparseAssignment {
+ public:
+  /**
+   * @brief Solve the assignment problem.
+   *
+   * @param cost Cost matrix, rows x columns
+   * @param max_cost Pairs with larger cost are never assigned
+   * @param assignment Output, the assigned column of each row, or -1
+   *
+   * @return Total cost of the assigned pairs
+   */
+  float Solve(const std::vector<std::vector<float>> &cost, float max_cost, std::vector<int> *assignment);
+
+ private:
+  int Find(int node);
+  float SolveComponent(const std::vector<std::vector<float>> &cost, float max_cost, const int *rows, int row_num,
+                       const int *cols, int col_num, std::vector<int> *assignment);
+
+  std::vector<int> parent_;
+  std::vector<int> comp_start_;
+  std::vector<int> comp_nodes_;
+  std::vector<int> comp_fill_;
+  // per component
+  std::vector<int> rows_;
+  std::vector<int> cols_;
+  std::vector<float> local_cost_;
+  std::vector<float> u_;
+  std::vector<float> v_;
+  std::vector<float> min_dist_;
+  std::vector<int> col_row_;
+  std::vector<int> way_;
+  std::vector<char> used_;
+};  // class SparseAssignment
+
+}  // namespace edk
+
+#endif  // EASYTRACK_SPARSE_ASSIGNMENT_H_
@@ -28,7 +28,7 @@
 #include "easytrack/easy_track.h"
 #include "kalmanfilter.h"
 #include "match.h"
-#include "matrix.h"
+#include "sparse_assignment.h"
 #include "track_data_type.h"
 
 #define CLIP(x) ((x) < 0 ? 0 : ((x) > 1 ? 1 : (x)))
@@ -55,10 +55,10 @@ struct FeatureMatchTrackObject {
   TrackState state;
   int age = 1;
   int time_since_last_update = 0;
-  std::vector<std::vector<float>> features;
+  FeatureHistory features;
   bool has_feature;
   bool feature_unmatched = false;
-  KalmanFilter *kf;
+  KalmanFilter kf;
 };
 
 class FeatureMatchPrivate {
@@ -71,16 +71,24 @@ class FeatureMatchPrivate {
   MatchResult &MatchIou(std::vector<int> detect_matrices, std::vector<int> track_matrices);
   void InitNewTrack(const DetectObject &obj);
   void MarkMiss(FeatureMatchTrackObject *track);
+  void Assign(const CostMatrix &cost_matrix, float max_cost);
 
   FeatureMatchTrack *fm_;
 
   MatchAlgorithm *match_algo_;
+  SparseAssignment sparse_solver_;
   std::vector<FeatureMatchTrackObject> tracks_;
   std::vector<int> unconfirmed_track_;
   std::vector<int> confirmed_track_;
   std::vector<int> assignments_;
   MatchResult res_feature_;
   MatchResult res_iou_;
+  std::vector<float> measurements_;  // x, y, a, h planes of detections
+  std::vector<float> gating_dist_;   // confirmed tracks x detections
+  std::vector<float> feature_dist_;  // confirmed tracks x detections
+  std::vector<const FeatureHistory *> track_features_;
+  std::vector<const std::vector<float> *> detect_features_;
+  PackedFeatures packed_features_;
   const Objects *detects_ = nullptr;
   std::mutex update_mutex_;
 
@@ -90,12 +98,7 @@ class FeatureMatchPrivate {
 
 FeatureMatchTrack::FeatureMatchTrack() { fm_p_ = new FeatureMatchPrivate(this); }
 
-FeatureMatchTrack::~FeatureMatchTrack() {
-  for (auto& obj : fm_p_->tracks_) {
-    delete obj.kf;
-  }
-  delete fm_p_;
-}
+FeatureMatchTrack::~FeatureMatchTrack() { delete fm_p_; }
 
 void FeatureMatchTrack::SetParams(float max_cosine_distance, int nn_budget, float max_iou_distance, int max_age,
                                   int n_init) {
@@ -112,10 +115,24 @@ void FeatureMatchTrack::SetParams(float max_cosine_distance, int nn_budget, floa
   n_init_ = n_init;
 }
 
+void FeatureMatchTrack::SetAssignmentSolver(AssignmentSolver solver) {
+  std::lock_guard<std::mutex> lk(fm_p_->update_mutex_);
+  solver_ = solver;
+}
+
+void FeatureMatchPrivate::Assign(const CostMatrix &cost_matrix, float max_cost) {
+  if (fm_->solver_ == AssignmentSolver::SPARSE) {
+    sparse_solver_.Solve(cost_matrix, max_cost, &assignments_);
+  } else {
+    match_algo_->HungarianMatch(cost_matrix, &assignments_);
+  }
+}
+
 MatchResult &FeatureMatchPrivate::MatchCascade() {
   const Objects &det_objs = *detects_;
   CostMatrix cost_matrix;
   std::vector<int> track_indices;
+  std::vector<int> track_rows;
   MatchResult &res = res_feature_;
   res.matches.clear();
   res.unmatched_detections.clear();
@@ -126,6 +143,32 @@ MatchResult &FeatureMatchPrivate::MatchCascade() {
   std::set<int> remained_detections;
   remained_detections.insert(res.unmatched_detections.begin(), res.unmatched_detections.end());
   VLOG(5) << "MatchCascade) Match scale, detects " << det_objs.size() << " tracks " << confirmed_track_.size();
+  if (det_objs.empty() || confirmed_track_.empty()) return res;
+
+  // feature and gating distances of all confirmed tracks to all detections, computed once for every cascade round
+  const size_t all_det_num = det_objs.size();
+  const size_t all_tra_num = confirmed_track_.size();
+  measurements_.resize(4 * all_det_num);
+  detect_features_.resize(all_det_num);
+  for (size_t j = 0; j < all_det_num; ++j) {
+    BoundingBox xyah = to_xyah(det_objs[j].bbox);
+    measurements_[j] = xyah.x;
+    measurements_[all_det_num + j] = xyah.y;
+    measurements_[2 * all_det_num + j] = xyah.width;
+    measurements_[3 * all_det_num + j] = xyah.height;
+    detect_features_[j] = &det_objs[j].feature;
+  }
+  track_features_.resize(all_tra_num);
+  gating_dist_.resize(all_tra_num * all_det_num);
+  for (size_t t = 0; t < all_tra_num; ++t) {
+    track_features_[t] = &tracks_[confirmed_track_[t]].features;
+    tracks_[confirmed_track_[t]].kf.GatingDistance(measurements_.data(), all_det_num,
+                                                   gating_dist_.data() + t * all_det_num);
+  }
+  packed_features_.Pack(detect_features_);
+  feature_dist_.resize(all_tra_num * all_det_num);
+  match_algo_->FeatureDistance(DistanceType::COSINE, track_features_, packed_features_, feature_dist_.data());
+
   for (int age = 0; age < fm_->max_age_; ++age) {
     VLOG(6) << "Cascade: Number of remained detections ----- " << remained_detections.size();
     // no remained detections or no confirmed tracks, end match
@@ -135,6 +178,7 @@ MatchResult &FeatureMatchPrivate::MatchCascade() {
     for (size_t t = 0; t < confirmed_track_.size(); ++t) {
       if (tracks_[confirmed_track_[t]].time_since_last_update == age + 1) {
         track_indices.push_back(confirmed_track_[t]);
+        track_rows.push_back(t);
       }
     }
     if (track_indices.empty()) {
@@ -145,18 +189,14 @@ MatchResult &FeatureMatchPrivate::MatchCascade() {
     size_t tra_num = track_indices.size();
     cost_matrix.assign(tra_num, std::vector<float>(det_num, 0));
 
-    // calculate cost matrix
-    std::vector<BoundingBox> measurements;
-    measurements.reserve(det_num);
-    for (size_t i = 0; i < det_num; ++i) {
-      measurements.push_back(to_xyah(det_objs[res.unmatched_detections[i]].bbox));
-    }
+    // gather cost matrix of this round
     for (size_t i = 0; i < tra_num; ++i) {
-      Matrix gating_dist = tracks_[track_indices[i]].kf->GatingDistance(measurements);
+      const float *feature_dist = feature_dist_.data() + track_rows[i] * all_det_num;
+      const float *gating_dist = gating_dist_.data() + track_rows[i] * all_det_num;
       for (size_t j = 0; j < det_num; ++j) {
-        cost_matrix[i][j] = match_algo_->Distance("Cosine", tracks_[track_indices[i]].features,
-                                                  det_objs[res.unmatched_detections[j]].feature);
-        if (cost_matrix[i][j] > fm_->max_cosine_distance_ || gating_dist[0][j] > gating_threshold) {
+        int det_idx = res.unmatched_detections[j];
+        cost_matrix[i][j] = feature_dist[det_idx];
+        if (cost_matrix[i][j] > fm_->max_cosine_distance_ || gating_dist[det_idx] > gating_threshold) {
           VLOG(4) << "object " << i << " - " << j << " feature distance is larger than max_cosine_distance";
           cost_matrix[i][j] = fm_->max_cosine_distance_ + 1e-5;
         }
@@ -164,7 +204,7 @@ MatchResult &FeatureMatchPrivate::MatchCascade() {
     }
 
     // min cost match
-    match_algo_->HungarianMatch(cost_matrix, &assignments_);
+    Assign(cost_matrix, fm_->max_cosine_distance_);
 
     // arrange match result
     for (size_t i = 0; i < assignments_.size(); ++i) {
@@ -176,6 +216,7 @@ MatchResult &FeatureMatchPrivate::MatchCascade() {
       }
     }
     track_indices.clear();
+    track_rows.clear();
     res.unmatched_detections.clear();
     res.unmatched_detections.insert(res.unmatched_detections.end(), remained_detections.begin(),
                                     remained_detections.end());
@@ -213,7 +254,7 @@ MatchResult &FeatureMatchPrivate::MatchIou(std::vector<int> detect_indices, std:
   }
   CostMatrix cost_matrix = match_algo_->IoUCost(tra_rects, det_rects);
   if (cost_matrix.empty()) return res;
-  match_algo_->HungarianMatch(cost_matrix, &assignments_);
+  Assign(cost_matrix, fm_->max_iou_distance_);
 
   for (size_t i = 0; i < assignments_.size(); ++i) {
     if (assignments_[i] < 0 || cost_matrix[i][assignments_[i]] > fm_->max_iou_distance_) {
@@ -236,20 +277,19 @@ void FeatureMatchPrivate::InitNewTrack(const DetectObject &det) {
   obj.class_id = det.label;
   obj.pos = BoundingBox2Rect(det.bbox);
   obj.state = TrackState::TENTATIVE;
-  obj.features.clear();
+  obj.features.SetBudget(fm_->nn_budget_);
   obj.has_feature = false;
   if (!det.feature.empty()) {
     for (auto& val : det.feature) {
       if (val != 0) {
         obj.has_feature = true;
-        obj.features.emplace_back(det.feature);
+        obj.features.Add(det.feature);
         break;
       }
     }
   }
-  obj.kf = new KalmanFilter;
-  obj.kf->Initiate(to_xyah(det.bbox));
-  tracks_.push_back(obj);
+  obj.kf.Initiate(to_xyah(det.bbox));
+  tracks_.push_back(std::move(obj));
 }
 
 void FeatureMatchPrivate::MarkMiss(FeatureMatchTrackObject *track) {
@@ -291,7 +331,7 @@ void FeatureMatchTrack::UpdateFrame(const TrackFrame &frame, const Objects &dete
         fm_p_->unconfirmed_track_.push_back(i);
       }
       fm_p_->tracks_[i].time_since_last_update++;
-      fm_p_->tracks_[i].kf->Predict();
+      fm_p_->tracks_[i].kf.Predict();
     }
 
     // match with features
@@ -328,15 +368,12 @@ void FeatureMatchTrack::UpdateFrame(const TrackFrame &frame, const Objects &dete
     for (auto &pair : res_f.matches) {
       ptrack_obj = &(fm_p_->tracks_[pair.second]);
       pdetect_obj = &detects[pair.first];
-      ptrack_obj->kf->Update(to_xyah(pdetect_obj->bbox));
+      ptrack_obj->kf.Update(to_xyah(pdetect_obj->bbox));
       tracks->push_back(*pdetect_obj);
       tracks->rbegin()->track_id = ptrack_obj->track_id;
       tracks->rbegin()->detect_id = pair.first;
       if (!ptrack_obj->feature_unmatched) {
-        ptrack_obj->features.emplace_back(pdetect_obj->feature);
-        if (ptrack_obj->features.size() > nn_budget_) {
-          ptrack_obj->features.erase(ptrack_obj->features.begin());
-        }
+        ptrack_obj->features.Add(pdetect_obj->feature);
       }
       ptrack_obj->time_since_last_update = 0;
       ptrack_obj->age++;
@@ -365,7 +402,6 @@ void FeatureMatchTrack::UpdateFrame(const TrackFrame &frame, const Objects &dete
     for (auto iter = fm_p_->tracks_.begin(); iter != fm_p_->tracks_.end();) {
       if (iter->state == TrackState::DELETED || iter->time_since_last_update > max_age_) {
         VLOG(4) << "delete track: " << iter->track_id;
-        delete iter->kf;
         iter = fm_p_->tracks_.erase(iter);
       } else {
         iter++;
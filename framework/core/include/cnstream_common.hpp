@@ -28,6 +28,7 @@
 
 #include <atomic>
 #include <iomanip>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <string>
@@ -45,6 +46,7 @@ enum EventType {
   EVENT_EOS,      ///< An EOS event.
   EVENT_STOP,     ///< Stops an event that is called by application layer usually.
   EVENT_STREAM_ERROR,  ///< A stream error event.
+  EVENT_STREAM_THROTTLE,  ///< The frame rate of a stream is reduced or restored by LatencyController.
   EVENT_TYPE_END  ///< Reserved for your custom events.
 };
 
@@ -107,6 +109,75 @@ bool CheckStreamEosReached(const std::string &stream_id, bool sync = true);
 void SetStreamRemoved(const std::string &stream_id, bool value = true);
 bool IsStreamRemoved(const std::string &stream_id);
 
+/**
+ * @brief Scheduling attributes of a stream.
+ *
+ * Conveyors serve frames with a deadline earliest deadline first, and share the rest among streams by weighted fair
+ * queuing, weighted by priority. When a conveyor is full, a frame of higher priority replaces the oldest frame of the
+ * stream of the lowest priority.
+ */
+struct StreamQos {
+  uint32_t priority = 1;     ///< The weight of the stream, at least 1. Streams of lower priority are shed first.
+  uint32_t deadline_ms = 0;  ///< The latency budget of a frame since it is created, 0 means no deadline.
+};
+
+/**
+ * @brief Sets the scheduling attributes of a stream. They apply to the frames created afterwards.
+ */
+void SetStreamQos(const std::string &stream_id, const StreamQos &qos);
+/**
+ * @brief Gets the scheduling attributes of a stream, the default ones if not set.
+ */
+StreamQos GetStreamQos(const std::string &stream_id);
+bool HasStreamQos(const std::string &stream_id);
+void RemoveStreamQos(const std::string &stream_id);
+
+/**
+ * @brief Factors by which the frames of a stream are reduced on top of the configured intervals, adjusted on the fly
+ * by LatencyController.
+ */
+struct StreamThrottle {
+  uint32_t decode_interval = 1;  ///< Multiplies the interval of the source module.
+  uint32_t infer_interval = 1;   ///< Multiplies the infer_interval of the inferencers.
+};
+
+/**
+ * @brief The throttles of the streams of a pipeline by stream index.
+ *
+ * They are written by LatencyController once a period, and read for every frame without locks. Streams not throttled
+ * read factors of 1.
+ */
+class StreamThrottles : private NonCopyable {
+ public:
+  StreamThrottles() : num_(GetMaxStreamNumber()), throttles_(new std::atomic<uint64_t>[num_]) {
+    for (uint32_t i = 0; i < num_; ++i) throttles_[i].store(0, std::memory_order_relaxed);
+  }
+
+  void Set(uint32_t stream_idx, const StreamThrottle &throttle) {
+    if (stream_idx >= num_) return;
+    // both factors in one word, so that a reader never sees half of an update
+    throttles_[stream_idx].store(static_cast<uint64_t>(throttle.infer_interval) << 32 | throttle.decode_interval,
+                                 std::memory_order_relaxed);
+  }
+
+  StreamThrottle Get(uint32_t stream_idx) const {
+    StreamThrottle throttle;
+    if (stream_idx >= num_) return throttle;
+    uint64_t value = throttles_[stream_idx].load(std::memory_order_relaxed);
+    if (static_cast<uint32_t>(value)) throttle.decode_interval = static_cast<uint32_t>(value);
+    if (value >> 32) throttle.infer_interval = static_cast<uint32_t>(value >> 32);
+    return throttle;
+  }
+
+  void Reset(uint32_t stream_idx) {
+    if (stream_idx < num_) throttles_[stream_idx].store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  const uint32_t num_;
+  std::unique_ptr<std::atomic<uint64_t>[]> throttles_;
+};  // class StreamThrottles
+
 /**
  * @brief Converts number to string
  *
@@ -21,6 +21,7 @@
 #ifndef CNSTREAM_FRAME_HPP_
 #define CNSTREAM_FRAME_HPP_
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -28,6 +29,7 @@
 
 #include "cnstream_common.hpp"
 #include "util/cnstream_any.hpp"
+#include "util/cnstream_index.hpp"
 #include "util/cnstream_spinlock.hpp"
 
 /**
@@ -99,6 +101,19 @@ class CNFrameInfo : private NonCopyable {
   std::string stream_id;   ///< The data stream aliases where this frame is located to.
   int64_t timestamp = -1;  ///< The time stamp of this frame.
   size_t flags = 0;        ///< The mask for this frame, ``CNFrameFlag``.
+  StreamQos qos;           ///< The scheduling attributes of the stream when this frame is created.
+  std::chrono::steady_clock::time_point create_time;  ///< The time this frame is created.
+
+  /**
+   * Returns true if the frame has a deadline, see StreamQos.
+   */
+  bool HasDeadline() const { return qos.deadline_ms > 0; }
+  /**
+   * Gets the time by which the frame should have passed the pipeline. Valid only if HasDeadline() is true.
+   */
+  std::chrono::steady_clock::time_point Deadline() const {
+    return create_time + std::chrono::milliseconds(qos.deadline_ms);
+  }
 
   // user-defined DataFrame，InferResult etc...
   std::unordered_map<int, any> datas;
@@ -113,12 +128,17 @@ class CNFrameInfo : private NonCopyable {
    */
   friend class Pipeline;
   mutable uint32_t channel_idx = INVALID_STREAM_IDX;        ///< The index of the channel, stream_index
-  uint64_t MarkPassed(Module* current);  // return changed mask
-  uint64_t GetModulesMask();
+  // returns the number of modules passed including current one, or 0 if current one has passed already
+  uint32_t MarkPassed(Module* current);
+  // returns true only for the first caller, so data is pushed to a module with several upstream nodes only once
+  bool MarkTransmitted(Module* down_node);
+  // returns a copy sharing the datas, for a branch of the pipeline that should not see the datas replaced by others
+  std::shared_ptr<CNFrameInfo> Fork();
 
  private:
-  SpinLock mask_lock_;
-  uint64_t modules_mask_ = 0;
+  AtomicIndexMask modules_mask_{GetMaxModuleNumber()};
+  AtomicIndexMask transmitted_mask_{GetMaxModuleNumber()};
+  std::atomic<uint32_t> passed_num_{0};
 
  private:
   CNFrameInfo() {}
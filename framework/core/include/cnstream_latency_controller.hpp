@@ -0,0 +1,114 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_LATENCY_CONTROLLER_HPP_
+#define CNSTREAM_LATENCY_CONTROLLER_HPP_
+
+/**
+ * @file cnstream_latency_controller.hpp
+ *
+ * This file contains a declaration of the LatencyController class.
+ */
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "cnstream_common.hpp"
+#include "cnstream_frame.hpp"
+
+namespace cnstream {
+
+class EventBus;
+
+/**
+ * @brief Parameters of LatencyController.
+ */
+struct LatencyControlParam {
+  uint32_t target_latency_ms = 0;     ///< The end-to-end latency to hold. 0 disables the controller.
+  uint32_t period_ms = 1000;          ///< The control period.
+  float queue_high_watermark = 0.9f;  ///< The pipeline is overloaded if the fullest queue is fuller than this.
+  float queue_low_watermark = 0.5f;   ///< Streams are restored only if the fullest queue is emptier than this.
+  float relax_ratio = 0.6f;           ///< Streams are restored only if all latencies are below this ratio of targets.
+  uint32_t max_decode_interval = 8;   ///< The maximum factor of the decode interval.
+  uint32_t max_infer_interval = 8;    ///< The maximum factor of infer_interval.
+};
+
+/**
+ * @brief Holds the end-to-end latency of streams by reducing their frames when the pipeline falls behind.
+ *
+ * The latency of a frame is the time from its creation to the end of the pipeline. Once a period, the controller
+ * compares the mean latency of each stream with its target, the deadline of the stream if it has one (see StreamQos),
+ * or else target_latency_ms, and checks the fill of the fullest queue of the pipeline.
+ *
+ * If any stream is late or the queues are above queue_high_watermark, the streams of the lowest priority that could
+ * still be throttled are throttled one step: the infer_interval factor is doubled up to max_infer_interval, then the
+ * decode interval factor up to max_decode_interval. If all streams are well in time and the queues are below
+ * queue_low_watermark, the throttled streams of the highest priority are restored one step in the reverse order.
+ *
+ * The factors are published to StreamThrottles by stream index, and each decision is posted to the event bus as an
+ * EVENT_STREAM_THROTTLE event.
+ */
+class LatencyController : private NonCopyable {
+ public:
+  /**
+   * @param param The parameters.
+   * @param throttles Where the factors are published, it must outlive the controller.
+   * @param event_bus Where the decisions are posted, nullptr to only log them.
+   */
+  LatencyController(const LatencyControlParam& param, StreamThrottles* throttles, EventBus* event_bus = nullptr);
+  ~LatencyController();
+
+  const LatencyControlParam& GetParam() const { return param_; }
+  /**
+   * @brief Records a frame leaving the pipeline. The throttle of a stream is removed on its eos frame.
+   */
+  void OnFrameDone(const std::shared_ptr<CNFrameInfo>& data);
+  /**
+   * @brief Makes one control decision from the frames recorded since the last one.
+   *
+   * @param queue_fill The fill of the fullest queue of the pipeline, from 0 to 1.
+   */
+  void Step(float queue_fill);
+
+ private:
+  struct StreamState {
+    uint32_t stream_idx = INVALID_STREAM_IDX;
+    uint32_t priority = 1;
+    uint32_t target_ms = 0;
+    double latency_sum_ms = 0;
+    uint32_t samples = 0;
+    StreamThrottle throttle;
+  };
+  bool Throttle(StreamThrottle* throttle) const;
+  bool Restore(StreamThrottle* throttle) const;
+  void Publish(const std::string& stream_id, const StreamState& state, bool throttled, float queue_fill);
+
+  LatencyControlParam param_;
+  StreamThrottles* throttles_ = nullptr;
+  EventBus* event_bus_ = nullptr;
+  std::mutex mutex_;
+  std::unordered_map<std::string, StreamState> streams_;
+};  // class LatencyController
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_LATENCY_CONTROLLER_HPP_
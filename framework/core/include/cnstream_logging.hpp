@@ -39,7 +39,8 @@ DECLARE_string(log_filter);
 DECLARE_int32(min_log_level);
 
 /**
- * @brief Flush log file time, in second, default 30s
+ * @brief Flush log file time, in second, default 30s.
+ * Not used any more, the log file is not buffered and messages reach it within milliseconds.
  */
 DECLARE_int32(flush_log_file_secs);
 
@@ -201,6 +202,14 @@ void AddLogSink(LogSink* log_sink);
 
 void RemoveLogSink(LogSink* log_sink);
 
+/**
+ * @brief Gets the number of messages dropped by the log file since InitCNStreamLogging.
+ *
+ * Every thread buffers its messages for the log file. A message is dropped rather than blocking the thread when its
+ * buffer is full. The count is also written to the log file.
+ */
+uint64_t GetDroppedLogCount();
+
 void ShutdownCNStreamLogging();
 
 }  // namespace cnstream
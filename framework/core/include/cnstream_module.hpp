@@ -84,7 +84,7 @@ class Module : private NonCopyable {
    * @param name The name of a module. Modules defined in a pipeline should
    *             have different names.
    */
-  explicit Module(const std::string &name) : name_(name) {}
+  explicit Module(const std::string &name) : name_(name), perf_thread_key_(name + PerfManager::GetThreadSuffix()) {}
   virtual ~Module();
   /**
    * Registers an observer to the module.
@@ -207,6 +207,17 @@ class Module : private NonCopyable {
    * @return Returns the shared_ptr object of PerfManager.
    */
   std::shared_ptr<PerfManager> GetPerfManager(const std::string &stream_id);
+  /**
+   * @brief Gets PerfManager of the stream of a frame.
+   *
+   * Unlike the above, the lookup is cached per thread by stream index and done once per stream, so it is cheap
+   * enough for every frame.
+   *
+   * @param data A pointer to the information of the frame.
+   *
+   * @return Returns the shared_ptr object of PerfManager, nullptr if the stream does not have one.
+   */
+  std::shared_ptr<PerfManager> GetPerfManager(const std::shared_ptr<CNFrameInfo> &data);
 
  public:
   /**
@@ -240,17 +251,16 @@ class Module : private NonCopyable {
   void SetContainer(Pipeline *container);
 
   /* useless for users */
-  std::vector<size_t> GetParentIds() const { return parent_ids_; }
+  const std::vector<size_t> &GetParentIds() const { return parent_ids_; }
 
   /* useless for users, set upstream node id to this module */
   void SetParentId(size_t id) {
     parent_ids_.push_back(id);
-    mask_ = 0;
-    for (auto &v : parent_ids_) mask_ |= (uint64_t)1 << v;
+    mask_.Set(id);
   }
 
   /* useless for users */
-  uint64_t GetModulesMask() const { return mask_; }
+  const IndexMask &GetModulesMask() const { return mask_; }
 
   /**
    * @brief Checks if this module has permission to transmit data by itself.
@@ -304,12 +314,10 @@ class Module : private NonCopyable {
 
  private:
   size_t id_ = INVALID_MODULE_ID;
-  /* supports no more than 64 modules */
-  static SpinLock module_id_spinlock_;
-  static uint64_t module_id_mask_;
+  std::string perf_thread_key_;  ///< The perf key of the thread processing a frame.
 
   std::vector<size_t> parent_ids_;
-  uint64_t mask_ = 0;
+  IndexMask mask_;
 
   IModuleObserver *observer_ = nullptr;
   RwLock observer_lock_;
@@ -28,7 +28,6 @@
  */
 
 #include <atomic>
-#include <bitset>
 #include <future>
 #include <iostream>
 #include <memory>
@@ -43,9 +42,11 @@
 #include "cnstream_common.hpp"
 #include "cnstream_config.hpp"
 #include "cnstream_eventbus.hpp"
+#include "cnstream_latency_controller.hpp"
 #include "cnstream_module.hpp"
 #include "cnstream_source.hpp"
 #include "perf_calculator.hpp"
+#include "util/cnstream_index.hpp"
 #include "util/cnstream_rwlock.hpp"
 
 namespace cnstream {
@@ -113,15 +114,17 @@ class StreamMsgObserver {
 struct LinkStatus {
   bool stopped;                      ///< Whether the data transmissions between the modules are stopped.
   std::vector<uint32_t> cache_size;  ///< The size of each queue that is used to cache data between modules.
+  std::vector<uint64_t> shed_count;  ///< The number of frames dropped by each queue for frames of higher priority.
 };
 
-static constexpr size_t MAX_STREAM_NUM = 64;
+static constexpr size_t MAX_STREAM_NUM = 4096;
+static constexpr size_t MAX_MODULE_NUM = 1024;
 
 /**
  * @brief ModuleId&StreamIdx manager for pipeline.
  *
  * Allocates and deallocates id for Pipeline modules & Streams.
- *
+ * Ids are allocated without locks, the lowest free id first.
  */
 class IdxManager {
  public:
@@ -134,10 +137,10 @@ class IdxManager {
   void ReturnModuleIdx(size_t id_);
 
  private:
-  SpinLock id_lock;
+  SpinLock id_lock;  // guards stream_idx_map
   std::unordered_map<std::string, uint32_t> stream_idx_map;
-  std::bitset<MAX_STREAM_NUM> stream_bitset;
-  uint64_t module_id_mask_ = 0;
+  IndexAllocator stream_idx_allocator_{MAX_STREAM_NUM};
+  IndexAllocator module_idx_allocator_{MAX_MODULE_NUM};
 };  // class IdxManager
 
 /**
@@ -341,6 +344,25 @@ class Pipeline : private NonCopyable {
    */
   bool QueryLinkStatus(LinkStatus* status, const std::string& link_id);
 
+  /**
+   * Enables the latency controller, which reduces the decoded and inferred frames of streams when the pipeline falls
+   * behind, and restores them when it catches up. It is called before Pipeline::Start.
+   *
+   * @param param The parameters, the controller is disabled if param.target_latency_ms is 0.
+   *
+   * @return Returns true if this function has run successfully. Returns false if the pipeline is running.
+   *
+   * @see LatencyController.
+   */
+  bool SetLatencyControl(const LatencyControlParam& param);
+
+  /**
+   * Gets the throttles of the streams set by the latency controller. It is valid as long as the pipeline.
+   *
+   * @return Returns the throttles by stream index.
+   */
+  StreamThrottles* GetStreamThrottles() { return &stream_throttles_; }
+
  public:
   /* -----stream message methods------ */
  public:
@@ -442,6 +464,23 @@ class Pipeline : private NonCopyable {
    * @return std::unordered_map<std::string, std::shared_ptr<PerfManager>>
    */
   std::unordered_map<std::string, std::shared_ptr<PerfManager>> GetPerfManagers();
+  /**
+   * @brief Gets the perf manager of a stream.
+   *
+   * @param stream_id The stream ID.
+   *
+   * @return Returns the perf manager, nullptr if the stream does not have one.
+   */
+  std::shared_ptr<PerfManager> GetPerfManager(const std::string& stream_id);
+  /**
+   * @brief Gets the generation of the perf managers.
+   *
+   * The generation changes whenever a perf manager is created or removed, and is unique among all pipelines, so
+   * perf managers cached by a generation are valid as long as the generation is the same.
+   *
+   * @return Returns the generation, 0 if no perf manager has ever been created.
+   */
+  uint64_t GetPerfGeneration() const { return perf_generation_.load(std::memory_order_acquire); }
   /* called by pipeline */
   /**
    * Registers a callback to be called after the frame process is done.
@@ -465,14 +504,13 @@ class Pipeline : private NonCopyable {
   void UpdateByStreamMsg(const StreamMsg& msg);
   void StreamMsgHandleFunc();
   bool ShouldTransmit(std::shared_ptr<CNFrameInfo> finfo, Module* module) const;
-  bool ShouldTransmit(uint64_t passed_modules_mask, Module* module) const;
 
  private:
 #ifdef UNIT_TEST
 
  public:
 #endif
-  void TransmitData(const std::string node_name, std::shared_ptr<CNFrameInfo> data);
+  void TransmitData(const std::string& node_name, std::shared_ptr<CNFrameInfo> data);
 
   void TaskLoop(std::string node_name, uint32_t conveyor_idx);
 
@@ -514,6 +552,7 @@ class Pipeline : private NonCopyable {
   }
 
   void PerfDeleteDataLoop();
+  void UpdatePerfGeneration();
   /**
    * The module associated information.
    */
@@ -525,6 +564,31 @@ class Pipeline : private NonCopyable {
     std::vector<std::string> output_connectors;
   };
 
+  /**
+   * A module of the graph compiled by CompileGraph. Routing a frame only goes through compiled nodes, so it takes
+   * no lookup by module name.
+   */
+  struct CompiledNode {
+    Module* module = nullptr;
+    Connector* connector = nullptr;  ///< The input connector, nullptr for source modules.
+    bool single_parent = false;      ///< Whether the module has only one upstream module.
+    std::vector<size_t> down_nodes;  ///< Module ids of the downstream modules.
+    bool fork_branches = false;      ///< Whether each downstream module gets its own fork of the frame.
+  };
+
+  /**
+   * Resolves modules, links and connectors into graph_. It is called whenever the graph changes and by Start.
+   */
+  void CompileGraph();
+  /**
+   * Whether the branches of a node can be given forks of the frame, that is, they never meet again and are entered
+   * only through the node. A branch may then replace the datas of its frame (e.g. with a copy-on-write data frame)
+   * without affecting the others.
+   */
+  bool CanForkBranches(size_t id) const;
+  void TransmitData(const CompiledNode& node, std::shared_ptr<CNFrameInfo> data);
+  void LatencyControlLoop();
+
   std::string name_;
   std::atomic<bool> running_{false};
   EventBus* event_bus_ = nullptr;
@@ -542,6 +606,7 @@ class Pipeline : private NonCopyable {
   std::unordered_map<std::string, ModuleAssociatedInfo> modules_;
   std::unordered_map<std::string, CNModuleConfig> modules_config_;
   std::unordered_map<std::string, std::vector<std::string>> connections_config_;
+  std::vector<CompiledNode> graph_;  ///< Indexed by module id.
 
   std::vector<std::string> stream_ids_;
   std::string start_node_;
@@ -554,18 +619,17 @@ class Pipeline : private NonCopyable {
   std::atomic<bool> perf_running_{false};
   uint32_t clear_data_interval_ = 10;
   RwLock perf_managers_lock_;
+  std::atomic<uint64_t> perf_generation_{0};
   std::mutex perf_calculation_lock_;
-  uint64_t all_modules_mask_ = 0;
+
+  StreamThrottles stream_throttles_;
+  std::unique_ptr<LatencyController> latency_controller_;
+  std::thread latency_control_thread_;
 };  // class Pipeline
 
 inline bool Pipeline::ShouldTransmit(std::shared_ptr<CNFrameInfo> finfo, Module* module) const {
-  uint64_t passed_modules_mask = finfo->GetModulesMask();   // identifies which modules have passed this frame
-  return ShouldTransmit(passed_modules_mask, module);
-}
-
-inline bool Pipeline::ShouldTransmit(uint64_t passed_modules_mask, Module* module) const {
-  uint64_t modules_mask = module->GetModulesMask();  // identifies upstream nodes
-  return (passed_modules_mask & modules_mask) == modules_mask;
+  // modules_mask_ identifies which modules have passed this frame, module mask identifies upstream nodes
+  return finfo->modules_mask_.Contains(module->GetModulesMask());
 }
 
 }  // namespace cnstream
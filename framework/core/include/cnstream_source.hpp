@@ -73,6 +73,13 @@ class SourceModule : public Module {
    */
   int RemoveSources(bool force = false);
 
+  /**
+   * @brief Sets the scheduling attributes of the streams whose handlers do not set their own, see
+   * SourceHandler::SetQos. It applies to the streams added afterwards.
+   */
+  void SetDefaultQos(const StreamQos &qos) { default_qos_ = qos; }
+  StreamQos GetDefaultQos() const { return default_qos_; }
+
   int Process(std::shared_ptr<CNFrameInfo> data) override {
     (void)data;
     LOGE(CORE) << "As a source module, Process() should not be invoked\n";
@@ -86,6 +93,7 @@ class SourceModule : public Module {
 
   uint32_t GetStreamIndex(const std::string &stream_id);
   void ReturnStreamIndex(const std::string &stream_id);
+  StreamThrottles *GetStreamThrottles();
   /**
    * @brief Transmit data to next stage(s) of the pipeline
    * @param
@@ -96,6 +104,7 @@ class SourceModule : public Module {
   bool SendData(std::shared_ptr<CNFrameInfo> data);
 
  private:
+  StreamQos default_qos_;
   uint64_t source_idx_ = 0;
   std::mutex mutex_;
   std::unordered_map<std::string /*stream_id*/, std::shared_ptr<SourceHandler>> source_map_;
@@ -106,6 +115,9 @@ class SourceHandler : private NonCopyable {
   explicit SourceHandler(SourceModule *module, const std::string &stream_id) : module_(module), stream_id_(stream_id) {
     if (module_) {
       stream_index_ = module_->GetStreamIndex(stream_id_);
+      throttles_ = module_->GetStreamThrottles();
+      // the index may have been used by a stream throttled before
+      if (throttles_) throttles_->Reset(stream_index_);
     }
   }
   virtual ~SourceHandler() {
@@ -120,6 +132,19 @@ class SourceHandler : private NonCopyable {
   std::string GetStreamId() const { return stream_id_; }
   void SetStreamUniqueIdx(uint64_t idx) { stream_unique_idx_ = idx; }
   uint64_t GetStreamUniqueIdx() const { return stream_unique_idx_; }
+  /**
+   * @brief Sets the priority and the latency deadline of the stream. It could be called at any time, and applies to
+   * the frames created afterwards. Streams not set use the ones of the source module.
+   *
+   * @param qos The scheduling attributes, see StreamQos.
+   */
+  void SetQos(const StreamQos &qos) { SetStreamQos(stream_id_, qos); }
+  StreamQos GetQos() const { return GetStreamQos(stream_id_); }
+  /**
+   * @brief Gets the factor by which the latency controller of the pipeline reduces the decoded frames of the stream,
+   * 1 if the stream is not throttled. It is called for every frame.
+   */
+  uint32_t GetDecodeThrottle() const { return throttles_ ? throttles_->Get(stream_index_).decode_interval : 1; }
 
  public:
   std::shared_ptr<CNFrameInfo> CreateFrameInfo(bool eos = false, std::shared_ptr<CNFrameInfo> payload = nullptr) {
@@ -141,6 +166,7 @@ class SourceHandler : private NonCopyable {
   mutable std::string stream_id_;
   uint64_t stream_unique_idx_;
   uint32_t stream_index_ = INVALID_STREAM_IDX;
+  StreamThrottles *throttles_ = nullptr;
 };
 
 }  // namespace cnstream
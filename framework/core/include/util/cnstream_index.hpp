@@ -0,0 +1,235 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_INDEX_HPP_
+#define CNSTREAM_INDEX_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace cnstream {
+
+/**
+ * @brief Allocates indexes in [0, capacity) without locks.
+ *
+ * The lowest free index is always returned. Free indexes are tracked by a two level bitmap: one bit per index, and
+ * one summary bit per 64 indexes marking the words that are full. Allocate and Release are O(1) for up to 4096
+ * indexes.
+ */
+class IndexAllocator {
+ public:
+  static constexpr uint32_t kInvalidIndex = static_cast<uint32_t>(-1);
+  static constexpr uint32_t kMaxCapacity = 64 * 64;
+
+  explicit IndexAllocator(uint32_t capacity)
+      : capacity_(capacity > kMaxCapacity ? kMaxCapacity : capacity),
+        words_(new std::atomic<uint64_t>[(capacity_ + 63) / 64]) {
+    uint32_t word_num = (capacity_ + 63) / 64;
+    for (uint32_t i = 0; i < word_num; ++i) words_[i].store(0);
+    // indexes beyond capacity are never free
+    if (capacity_ % 64) words_[word_num - 1].store(~uint64_t(0) << (capacity_ % 64));
+    full_.store(word_num == 64 ? 0 : ~uint64_t(0) << word_num);
+  }
+  IndexAllocator(const IndexAllocator&) = delete;
+  IndexAllocator& operator=(const IndexAllocator&) = delete;
+
+  /**
+   * @brief Allocates the lowest free index.
+   *
+   * @return Returns the index, or kInvalidIndex if all indexes are in use.
+   */
+  uint32_t Allocate() {
+    while (true) {
+      uint64_t full = full_.load();
+      if (~full == 0) return AllocateSlow();
+      uint32_t w = Ctz(~full);
+      uint64_t word = words_[w].load();
+      if (~word == 0) {
+        MarkFull(w);  // the summary is behind, fix it and retry
+        continue;
+      }
+      uint64_t bit = uint64_t(1) << Ctz(~word);
+      if (words_[w].compare_exchange_weak(word, word | bit)) {
+        if (~(word | bit) == 0) MarkFull(w);
+        return w * 64 + Ctz(bit);
+      }
+    }
+  }
+
+  /**
+   * @brief Returns an index allocated by Allocate. Indexes out of range are ignored.
+   */
+  void Release(uint32_t index) {
+    if (index >= capacity_) return;
+    uint32_t w = index / 64;
+    words_[w].fetch_and(~(uint64_t(1) << (index % 64)));
+    full_.fetch_and(~(uint64_t(1) << w));
+  }
+
+  uint32_t GetCapacity() const { return capacity_; }
+
+ private:
+  static uint32_t Ctz(uint64_t v) { return static_cast<uint32_t>(__builtin_ctzll(v)); }
+
+  void MarkFull(uint32_t w) {
+    full_.fetch_or(uint64_t(1) << w);
+    // an index may have been released meanwhile, the summary must not hide it
+    if (~words_[w].load() != 0) full_.fetch_and(~(uint64_t(1) << w));
+  }
+
+  // the summary says everything is in use, make sure by looking at every word
+  uint32_t AllocateSlow() {
+    uint32_t word_num = (capacity_ + 63) / 64;
+    for (uint32_t w = 0; w < word_num; ++w) {
+      uint64_t word = words_[w].load();
+      while (~word != 0) {
+        uint64_t bit = uint64_t(1) << Ctz(~word);
+        if (words_[w].compare_exchange_weak(word, word | bit)) return w * 64 + Ctz(bit);
+      }
+    }
+    return kInvalidIndex;
+  }
+
+  const uint32_t capacity_;
+  std::unique_ptr<std::atomic<uint64_t>[]> words_;
+  std::atomic<uint64_t> full_{0};
+};  // class IndexAllocator
+
+/**
+ * @brief A set of indexes stored as a bitmap, sized by the highest index set.
+ */
+class IndexMask {
+ public:
+  void Set(size_t index) {
+    if (index / 64 >= words_.size()) words_.resize(index / 64 + 1, 0);
+    words_[index / 64] |= uint64_t(1) << (index % 64);
+  }
+  void Reset(size_t index) {
+    if (index / 64 < words_.size()) words_[index / 64] &= ~(uint64_t(1) << (index % 64));
+  }
+  bool Test(size_t index) const {
+    return index / 64 < words_.size() && (words_[index / 64] >> (index % 64)) & 1;
+  }
+  void Clear() { words_.clear(); }
+  bool Empty() const {
+    for (auto word : words_) {
+      if (word) return false;
+    }
+    return true;
+  }
+  size_t GetWordNum() const { return words_.size(); }
+  uint64_t GetWord(size_t i) const { return i < words_.size() ? words_[i] : 0; }
+  bool operator==(const IndexMask& other) const {
+    size_t num = std::max(words_.size(), other.words_.size());
+    for (size_t i = 0; i < num; ++i) {
+      if (GetWord(i) != other.GetWord(i)) return false;
+    }
+    return true;
+  }
+  bool operator!=(const IndexMask& other) const { return !(*this == other); }
+
+ private:
+  std::vector<uint64_t> words_;
+};  // class IndexMask
+
+/**
+ * @brief A set of indexes in [0, capacity) that can be updated by several threads without locks.
+ *
+ * The first 64 indexes are stored inline. The words for higher indexes are only allocated when one of them is set,
+ * so the mask costs no allocation as long as indexes stay below 64.
+ */
+class AtomicIndexMask {
+ public:
+  explicit AtomicIndexMask(size_t capacity) : more_num_(capacity > 64 ? static_cast<uint32_t>((capacity - 1) / 64)
+                                                                        : 0) {}
+  ~AtomicIndexMask() { delete[] more_.load(); }
+  AtomicIndexMask(const AtomicIndexMask&) = delete;
+  AtomicIndexMask& operator=(const AtomicIndexMask&) = delete;
+
+  /**
+   * @brief Sets an index.
+   *
+   * @return Returns true if the index was not set before. Returns false if it was set, or it is out of range.
+   */
+  bool Set(size_t index) {
+    std::atomic<uint64_t>* word = GetWord(index / 64, true);
+    if (!word) return false;
+    uint64_t bit = uint64_t(1) << (index % 64);
+    return !(word->fetch_or(bit) & bit);
+  }
+
+  bool Test(size_t index) const {
+    const std::atomic<uint64_t>* word = const_cast<AtomicIndexMask*>(this)->GetWord(index / 64, false);
+    return word && (word->load() >> (index % 64)) & 1;
+  }
+
+  /**
+   * @brief Checks whether all indexes in the mask are set.
+   */
+  bool Contains(const IndexMask& mask) const {
+    for (size_t i = 0; i < mask.GetWordNum(); ++i) {
+      uint64_t bits = mask.GetWord(i);
+      if (!bits) continue;
+      const std::atomic<uint64_t>* word = const_cast<AtomicIndexMask*>(this)->GetWord(i, false);
+      if (!word || (word->load() & bits) != bits) return false;
+    }
+    return true;
+  }
+
+  /**
+   * @brief Sets all indexes set in another mask.
+   */
+  void Merge(const AtomicIndexMask& other) {
+    for (size_t w = 0; w <= other.more_num_ && w <= more_num_; ++w) {
+      const std::atomic<uint64_t>* word = const_cast<AtomicIndexMask&>(other).GetWord(w, false);
+      uint64_t bits = word ? word->load() : 0;
+      if (bits) GetWord(w, true)->fetch_or(bits);
+    }
+  }
+
+ private:
+  std::atomic<uint64_t>* GetWord(size_t w, bool create) {
+    if (w == 0) return &first_;
+    if (w > more_num_) return nullptr;
+    std::atomic<uint64_t>* more = more_.load(std::memory_order_acquire);
+    if (!more) {
+      if (!create) return nullptr;
+      std::atomic<uint64_t>* words = new std::atomic<uint64_t>[more_num_];
+      for (uint32_t i = 0; i < more_num_; ++i) words[i].store(0, std::memory_order_relaxed);
+      if (more_.compare_exchange_strong(more, words, std::memory_order_acq_rel)) {
+        more = words;
+      } else {
+        delete[] words;  // set by another thread
+      }
+    }
+    return &more[w - 1];
+  }
+
+  std::atomic<uint64_t> first_{0};
+  std::atomic<std::atomic<uint64_t>*> more_{nullptr};
+  const uint32_t more_num_;
+};  // class AtomicIndexMask
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_INDEX_HPP_
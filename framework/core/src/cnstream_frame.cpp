@@ -36,6 +36,9 @@ static std::unordered_map<std::string, std::atomic<bool>> s_stream_eos_map_;
 static SpinLock s_remove_spinlock_;
 static std::unordered_map<std::string, bool> s_stream_removed_map_;
 
+static SpinLock s_qos_spinlock_;
+static std::unordered_map<std::string, StreamQos> s_stream_qos_map_;
+
 int CNFrameInfo::flow_depth_ = 0;
 
 void SetFlowDepth(int flow_depth) { CNFrameInfo::flow_depth_ = flow_depth; }
@@ -96,6 +99,29 @@ bool IsStreamRemoved(const std::string &stream_id) {
   return false;
 }
 
+void SetStreamQos(const std::string &stream_id, const StreamQos &qos) {
+  StreamQos value = qos;
+  if (value.priority == 0) value.priority = 1;
+  SpinLockGuard guard(s_qos_spinlock_);
+  s_stream_qos_map_[stream_id] = value;
+}
+
+StreamQos GetStreamQos(const std::string &stream_id) {
+  SpinLockGuard guard(s_qos_spinlock_);
+  auto iter = s_stream_qos_map_.find(stream_id);
+  return iter == s_stream_qos_map_.end() ? StreamQos() : iter->second;
+}
+
+bool HasStreamQos(const std::string &stream_id) {
+  SpinLockGuard guard(s_qos_spinlock_);
+  return s_stream_qos_map_.find(stream_id) != s_stream_qos_map_.end();
+}
+
+void RemoveStreamQos(const std::string &stream_id) {
+  SpinLockGuard guard(s_qos_spinlock_);
+  s_stream_qos_map_.erase(stream_id);
+}
+
 std::shared_ptr<CNFrameInfo> CNFrameInfo::Create(const std::string& stream_id, bool eos,
                                                  std::shared_ptr<CNFrameInfo> payload) {
   if (stream_id == "") {
@@ -109,6 +135,8 @@ std::shared_ptr<CNFrameInfo> CNFrameInfo::Create(const std::string& stream_id, b
   }
   ptr->stream_id = stream_id;
   ptr->payload = payload;
+  ptr->qos = GetStreamQos(stream_id);
+  ptr->create_time = std::chrono::steady_clock::now();
   if (eos) {
     ptr->flags |= cnstream::CN_FRAME_FLAG_EOS;
     if (!ptr->payload) {
@@ -166,15 +194,42 @@ CNFrameInfo::~CNFrameInfo() {
   }
 }
 
-uint64_t CNFrameInfo::MarkPassed(Module* module) {
-  SpinLockGuard guard(mask_lock_);
-  modules_mask_ |= (uint64_t)1 << module->GetId();
-  return modules_mask_;
+uint32_t CNFrameInfo::MarkPassed(Module* module) {
+  if (!modules_mask_.Set(module->GetId())) return 0;
+  return passed_num_.fetch_add(1) + 1;
+}
+
+bool CNFrameInfo::MarkTransmitted(Module* down_node) {
+  return transmitted_mask_.Set(down_node->GetId());
 }
 
-uint64_t CNFrameInfo::GetModulesMask() {
-  SpinLockGuard guard(mask_lock_);
-  return modules_mask_;
+std::shared_ptr<CNFrameInfo> CNFrameInfo::Fork() {
+  if (IsEos()) return nullptr;
+  std::shared_ptr<CNFrameInfo> ptr(new (std::nothrow) CNFrameInfo());
+  if (!ptr) {
+    LOGE(CORE) << "CNFrameInfo::Fork() new CNFrameInfo failed.";
+    return nullptr;
+  }
+  ptr->stream_id = stream_id;
+  ptr->timestamp = timestamp;
+  ptr->flags = flags;
+  ptr->qos = qos;
+  ptr->create_time = create_time;
+  ptr->payload = payload;
+  ptr->channel_idx = channel_idx;
+  {
+    SpinLockGuard guard(datas_lock_);
+    ptr->datas = datas;
+  }
+  ptr->modules_mask_.Merge(modules_mask_);
+  ptr->transmitted_mask_.Merge(transmitted_mask_);
+  ptr->passed_num_.store(passed_num_.load());
+  // counted as a frame in flight, but never refused by flow_depth as the frame it comes from is already accepted
+  if (flow_depth_ > 0) {
+    SpinLockGuard guard(spinlock_);
+    stream_count_map_[stream_id]++;
+  }
+  return ptr;
 }
 
 }  // namespace cnstream
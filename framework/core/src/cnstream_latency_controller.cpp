@@ -0,0 +1,156 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnstream_latency_controller.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "cnstream_eventbus.hpp"
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+LatencyController::LatencyController(const LatencyControlParam& param, StreamThrottles* throttles,
+                                     EventBus* event_bus)
+    : param_(param), throttles_(throttles), event_bus_(event_bus) {
+  param_.max_decode_interval = std::max(param_.max_decode_interval, 1u);
+  param_.max_infer_interval = std::max(param_.max_infer_interval, 1u);
+}
+
+LatencyController::~LatencyController() {
+  for (const auto& it : streams_) throttles_->Reset(it.second.stream_idx);
+}
+
+void LatencyController::OnFrameDone(const std::shared_ptr<CNFrameInfo>& data) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (data->IsEos()) {
+    auto iter = streams_.find(data->stream_id);
+    if (iter != streams_.end()) {
+      throttles_->Reset(iter->second.stream_idx);
+      streams_.erase(iter);
+    }
+    return;
+  }
+  if (data->IsInvalid() || data->IsRemoved()) return;
+  StreamState& state = streams_[data->stream_id];
+  state.stream_idx = data->GetStreamIndex();
+  state.priority = data->qos.priority;
+  state.target_ms = data->qos.deadline_ms ? data->qos.deadline_ms : param_.target_latency_ms;
+  state.latency_sum_ms +=
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - data->create_time).count();
+  state.samples++;
+}
+
+bool LatencyController::Throttle(StreamThrottle* throttle) const {
+  if (throttle->infer_interval < param_.max_infer_interval) {
+    throttle->infer_interval = std::min(throttle->infer_interval * 2, param_.max_infer_interval);
+    return true;
+  }
+  if (throttle->decode_interval < param_.max_decode_interval) {
+    throttle->decode_interval = std::min(throttle->decode_interval * 2, param_.max_decode_interval);
+    return true;
+  }
+  return false;
+}
+
+bool LatencyController::Restore(StreamThrottle* throttle) const {
+  if (throttle->decode_interval > 1) {
+    throttle->decode_interval /= 2;
+    return true;
+  }
+  if (throttle->infer_interval > 1) {
+    throttle->infer_interval /= 2;
+    return true;
+  }
+  return false;
+}
+
+void LatencyController::Step(float queue_fill) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  bool overloaded = queue_fill >= param_.queue_high_watermark;
+  bool underloaded = queue_fill <= param_.queue_low_watermark;
+  // Streams without frames in this period (e.g. heavily throttled ones) neither block nor trigger a decision.
+  for (const auto& it : streams_) {
+    const StreamState& state = it.second;
+    if (!state.samples || !state.target_ms) continue;
+    double latency_ms = state.latency_sum_ms / state.samples;
+    if (latency_ms > state.target_ms) overloaded = true;
+    if (latency_ms >= state.target_ms * param_.relax_ratio) underloaded = false;
+  }
+
+  if (overloaded) {
+    // Throttle the lowest priority class that still can be throttled.
+    uint32_t priority = 0;
+    for (const auto& it : streams_) {
+      StreamThrottle throttle = it.second.throttle;
+      if (Throttle(&throttle) && (!priority || it.second.priority < priority)) priority = it.second.priority;
+    }
+    for (auto& it : streams_) {
+      if (it.second.priority == priority && Throttle(&it.second.throttle)) {
+        Publish(it.first, it.second, true, queue_fill);
+      }
+    }
+  } else if (underloaded) {
+    // Restore the highest priority class that is throttled.
+    uint32_t priority = 0;
+    for (const auto& it : streams_) {
+      StreamThrottle throttle = it.second.throttle;
+      if (Restore(&throttle) && it.second.priority > priority) priority = it.second.priority;
+    }
+    for (auto& it : streams_) {
+      if (it.second.priority == priority && Restore(&it.second.throttle)) {
+        Publish(it.first, it.second, false, queue_fill);
+      }
+    }
+  }
+
+  for (auto& it : streams_) {
+    it.second.latency_sum_ms = 0;
+    it.second.samples = 0;
+  }
+}
+
+void LatencyController::Publish(const std::string& stream_id, const StreamState& state, bool throttled,
+                                float queue_fill) {
+  throttles_->Set(state.stream_idx, state.throttle);
+  std::ostringstream ss;
+  ss << (throttled ? "throttled" : "restored") << ", decode interval x" << state.throttle.decode_interval
+     << ", infer interval x" << state.throttle.infer_interval << ", priority " << state.priority << ", latency "
+     << (state.samples ? state.latency_sum_ms / state.samples : 0) << "ms of " << state.target_ms
+     << "ms, queue fill " << queue_fill;
+  if (!event_bus_) {
+    LOGI(CORE) << "[LatencyController] stream " << stream_id << " " << ss.str();
+    return;
+  }
+  Event event;
+  event.type = EVENT_STREAM_THROTTLE;
+  event.stream_id = stream_id;
+  event.message = ss.str();
+  event.module_name = "LatencyController";
+  event.thread_id = std::this_thread::get_id();
+  event_bus_->PostEvent(event);
+}
+
+}  // namespace cnstream
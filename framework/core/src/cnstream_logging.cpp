@@ -16,6 +16,7 @@
 
 #if defined(linux) || defined(__linux) || defined(__linux__)
 #include <sys/syscall.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #endif
 
@@ -31,6 +32,7 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
 #include <unordered_map>
@@ -44,7 +46,6 @@
 
 #include "cnstream_logging.hpp"
 #include "cnstream_common.hpp"
-#include "util/cnstream_queue.hpp"
 #include "util/cnstream_rwlock.hpp"
 
 #define EnvToString(envname, dflt)   \
@@ -137,11 +138,6 @@ static double GetTimeStamp() {
   return now;
 }
 
-// cycle clock is retuning microseconds since the epoch.
-static size_t CycleClock_Now() {
-  return static_cast<size_t>(GetTimeStamp() * 1000000);
-}
-
 static const char* const_basename(const char* filepath) {
   const char* base = strrchr(filepath, '/');
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__)
@@ -341,28 +337,57 @@ struct LogMessage::LogMessageData {
   void operator=(const LogMessageData&) = delete;
 };  // struct LogMessageData
 
+/*
+ * Log file backend.
+ *
+ * Every thread formats its messages into its own ring buffer (single producer, single consumer), so logging never
+ * takes a lock or allocates memory after the first message of a thread. The write thread gathers everything
+ * buffered in all rings and writes it with one writev. When the ring of a thread is full, the message is dropped and
+ * counted, and the number of dropped messages is written to the log file later.
+ */
 class LogFile : public NonCopyable {
  public:
   LogFile(const char* file_name, uint64_t max_file_len);
   ~LogFile();
-  void Write(const char* msg, int msg_len, bool force_flush);
+  void Write(const char* msg, size_t msg_len);
+  // writes everything buffered before it returns, called before abort()
+  void Flush();
+  uint64_t GetDropCount() const { return drop_count_.load(std::memory_order_relaxed); }
 
  private:
+  struct ThreadBuffer;
+  ThreadBuffer* GetThreadBuffer();
   bool CreateLogFile();
-  void Flush();
+  bool Drain();
+  bool WritePending();
+  void DiscardBuffers();
+  void WriteFileLoop();
+
+  static constexpr size_t kThreadBufferSize = 256 * 1024;
+  static constexpr int kMaxIovecs = 1024;
+  static std::atomic<uint64_t> generation_counter_;
+
   std::queue<std::string> filepath_queue_;
   std::string file_dir_;
   FILE* file_;
   size_t file_len_;
   size_t max_file_len_;
-  void WriteFileLoop();
+  const uint64_t generation_;  // identifies thread buffers of this instance
+
+  std::mutex buffers_mutex_;  // only taken by a thread for its first message, and by Drain
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+  std::vector<std::shared_ptr<ThreadBuffer>> drain_list_;
+  // only used by Drain, reserved up front
+  std::vector<struct iovec> iovecs_;
+  std::vector<std::pair<ThreadBuffer*, size_t>> pending_;  // buffer and its head when gathered
+  size_t pending_bytes_ = 0;
+  char drop_msg_[128];
+  std::mutex drain_mutex_;
+  std::atomic<uint64_t> drop_count_{0};
+  uint64_t reported_drop_count_ = 0;
 
-  ThreadSafeQueue<std::string> msgq_;
   std::thread write_thread_;
   std::atomic<bool> stop_writing_{true};
-  std::atomic<bool> force_flush_{false};
-  size_t bytes_since_flush_;
-  size_t next_flush_time_;
 
   // for write thread sleep
   size_t sleep_time_ = 30 * 60;  // disk full sleep time in seconds
@@ -371,20 +396,41 @@ class LogFile : public NonCopyable {
   bool thread_exit_ = false;
 };  // LogFile
 
+struct LogFile::ThreadBuffer {
+  explicit ThreadBuffer(uint64_t gen) : generation(gen), data(new char[kThreadBufferSize]) {}
+  const uint64_t generation;
+  std::unique_ptr<char[]> data;
+  std::atomic<size_t> head{0};  // bytes written in total, moved by the owner thread
+  char padding[64];             // keeps head and tail in different cache lines
+  std::atomic<size_t> tail{0};  // bytes written to file in total, moved by the write thread
+  std::atomic<bool> closed{false};  // owner thread exited
+};
+
+// released when the thread exits, the write thread drops the buffer once it is drained
+struct ThreadBufferHolder {
+  std::shared_ptr<void> buffer;
+  std::atomic<bool>* closed = nullptr;
+  ~ThreadBufferHolder() {
+    if (closed) closed->store(true, std::memory_order_release);
+  }
+};
+static thread_local ThreadBufferHolder thread_log_buffer;
+
+std::atomic<uint64_t> LogFile::generation_counter_{0};
+
 LogFile::LogFile(const char* file_dir, size_t max_file_len)
   : file_dir_((file_dir == nullptr) ? "" : file_dir),
   file_(nullptr),
   file_len_(0),
   max_file_len_(max_file_len),
-  bytes_since_flush_(0),
-  next_flush_time_(0) {
+  generation_(++generation_counter_) {
+  iovecs_.reserve(kMaxIovecs);
+  pending_.reserve(kMaxIovecs);
   stop_writing_.store(false);
-  force_flush_.store(false);
   write_thread_ = std::thread(&LogFile::WriteFileLoop, this);
 }
 
 LogFile::~LogFile() {
-  stop_writing_.store(true);
   std::unique_lock<std::mutex> lk(sleep_mutex_);
   thread_exit_ = true;
   lk.unlock();  // ~LogFile() before fwrite disk full, prevent deadlock
@@ -392,19 +438,47 @@ LogFile::~LogFile() {
   if (write_thread_.joinable()) {
     write_thread_.join();
   }
+  stop_writing_.store(true);
 }
 
-void LogFile::Write(const char* msg, int msg_len, bool force_flush) {
-  if (force_flush) {
-    stop_writing_.store(true);
-    force_flush_.store(true);
+LogFile::ThreadBuffer* LogFile::GetThreadBuffer() {
+  ThreadBuffer* buffer = static_cast<ThreadBuffer*>(thread_log_buffer.buffer.get());
+  if (buffer && buffer->generation == generation_) return buffer;
+  // first message of this thread, or logging has been restarted
+  if (thread_log_buffer.closed) thread_log_buffer.closed->store(true, std::memory_order_release);
+  std::shared_ptr<ThreadBuffer> new_buffer = std::make_shared<ThreadBuffer>(generation_);
+  {
+    std::lock_guard<std::mutex> lk(buffers_mutex_);
+    buffers_.push_back(new_buffer);
+  }
+  thread_log_buffer.buffer = new_buffer;
+  thread_log_buffer.closed = &new_buffer->closed;
+  return new_buffer.get();
+}
+
+void LogFile::Write(const char* msg, size_t msg_len) {
+  if (stop_writing_.load(std::memory_order_relaxed)) return;
+  ThreadBuffer* buffer = GetThreadBuffer();
+  size_t head = buffer->head.load(std::memory_order_relaxed);
+  size_t tail = buffer->tail.load(std::memory_order_acquire);
+  if (msg_len > kThreadBufferSize - (head - tail)) {
+    drop_count_.fetch_add(1, std::memory_order_relaxed);
     return;
   }
-  if (!stop_writing_.load()) {
-    msgq_.Push(std::string(msg, msg_len));
+  size_t pos = head % kThreadBufferSize;
+  size_t first = std::min(msg_len, kThreadBufferSize - pos);
+  memcpy(buffer->data.get() + pos, msg, first);
+  memcpy(buffer->data.get(), msg + first, msg_len - first);
+  buffer->head.store(head + msg_len, std::memory_order_release);
+  if (head - tail <= kThreadBufferSize / 2 && head + msg_len - tail > kThreadBufferSize / 2) {
+    wake_up_cond_.notify_one();  // half full, do not wait for the next poll
   }
 }
 
+void LogFile::Flush() {
+  Drain();
+}
+
 bool LogFile::CreateLogFile() {
   std::string file_dir;
   std::string filepath;
@@ -452,11 +526,6 @@ bool LogFile::CreateLogFile() {
     return false;
   }
 
-  // update flush log time and bytes
-  bytes_since_flush_ = 0;
-  next_flush_time_ = CycleClock_Now()
-    + FLAGS_flush_log_file_secs * static_cast<size_t>(1000000);  // in usec
-
   // clean up for old logs
   if (filepath_queue_.size() >= 10) {
     unlink(filepath_queue_.front().c_str());
@@ -478,71 +547,134 @@ bool LogFile::CreateLogFile() {
   return true;
 }
 
+// Writes everything buffered by all threads. Returns false with errno set if writing fails.
+bool LogFile::Drain() {
+  std::lock_guard<std::mutex> drain_lk(drain_mutex_);
+  if (!file_) return true;
+  {
+    std::lock_guard<std::mutex> lk(buffers_mutex_);
+    drain_list_.assign(buffers_.begin(), buffers_.end());
+  }
+  iovecs_.clear();
+  pending_.clear();
+  pending_bytes_ = 0;
+  uint64_t drop_count = drop_count_.load(std::memory_order_relaxed);
+  if (drop_count != reported_drop_count_) {
+    int len = snprintf(drop_msg_, sizeof(drop_msg_), "CNSTREAM LOGGING W %llu log messages dropped, buffers full\n",
+                       static_cast<unsigned long long>(drop_count - reported_drop_count_));  // NOLINT
+    reported_drop_count_ = drop_count;
+    iovecs_.push_back({drop_msg_, static_cast<size_t>(len)});
+    pending_bytes_ += len;
+  }
+
+  bool ret = true;
+  bool has_closed = false;
+  for (const auto& buffer : drain_list_) {
+    size_t head = buffer->head.load(std::memory_order_acquire);
+    size_t tail = buffer->tail.load(std::memory_order_relaxed);
+    if (head == tail) {
+      has_closed |= buffer->closed.load(std::memory_order_acquire);
+      continue;
+    }
+    if (iovecs_.size() + 2 > static_cast<size_t>(kMaxIovecs) && !(ret = WritePending())) break;
+    size_t pos = tail % kThreadBufferSize;
+    size_t len = head - tail;
+    size_t first = std::min(len, kThreadBufferSize - pos);
+    iovecs_.push_back({buffer->data.get() + pos, first});
+    if (len > first) iovecs_.push_back({buffer->data.get(), len - first});
+    pending_.emplace_back(buffer.get(), head);
+    pending_bytes_ += len;
+  }
+  if (ret) ret = WritePending();
+  drain_list_.clear();
+
+  if (has_closed) {
+    // the threads have exited and everything they logged is written
+    std::lock_guard<std::mutex> lk(buffers_mutex_);
+    buffers_.erase(std::remove_if(buffers_.begin(), buffers_.end(),
+                                  [](const std::shared_ptr<ThreadBuffer>& buffer) {
+                                    return buffer->closed.load(std::memory_order_acquire) &&
+                                           buffer->head.load(std::memory_order_acquire) ==
+                                           buffer->tail.load(std::memory_order_relaxed);
+                                  }),
+                   buffers_.end());
+  }
+  return ret;
+}
+
+// Writes the gathered pieces with writev and hands the space back to the threads.
+bool LogFile::WritePending() {
+  if (iovecs_.empty()) return true;
+  if (file_len_ > max_file_len_) {
+    if (!CreateLogFile()) return false;
+    file_len_ = 0;
+  }
+  struct iovec* iov = iovecs_.data();
+  int iovcnt = static_cast<int>(iovecs_.size());
+  bool ret = true;
+  while (iovcnt > 0) {
+    ssize_t written = writev(fileno(file_), iov, iovcnt);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      ret = false;
+      break;
+    }
+    // skips what is written, continues after a partial write
+    while (iovcnt > 0 && static_cast<size_t>(written) >= iov->iov_len) {
+      written -= iov->iov_len;
+      ++iov;
+      --iovcnt;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+      iov->iov_len -= written;
+    }
+  }
+  // messages are released even if writing failed, the failure is handled by the caller
+  for (const auto& it : pending_) {
+    it.first->tail.store(it.second, std::memory_order_release);
+  }
+  if (ret) file_len_ += pending_bytes_;
+  iovecs_.clear();
+  pending_.clear();
+  pending_bytes_ = 0;
+  return ret;
+}
+
+// Drops everything buffered, used when the disk is full.
+void LogFile::DiscardBuffers() {
+  std::lock_guard<std::mutex> lk(buffers_mutex_);
+  for (const auto& buffer : buffers_) {
+    buffer->tail.store(buffer->head.load(std::memory_order_acquire), std::memory_order_release);
+  }
+}
+
 void LogFile::WriteFileLoop() {
   if (!CreateLogFile()) {
     stop_writing_.store(true);
     return;
   }
-  std::string msg;
-  while (!stop_writing_.load()) {
-    if (msgq_.WaitAndTryPop(msg, std::chrono::microseconds(200))) {
-      if (file_len_ > max_file_len_) {
-        if (!CreateLogFile()) {
-          stop_writing_.store(true);
-          return;
-        }
-        file_len_ = 0;
-      }
-      fwrite(msg.data(), 1, msg.size(), file_);
-      if (errno == ENOSPC) {  // disk full
-        perror("Disk is full, log stop output to the log file");
-        fprintf(stderr, "Disk is full, log stop output to the log file until %ld seconds!\n", sleep_time_);
-        stop_writing_.store(true);  // disk full, stop writing to disk, until wake up
-        std::unique_lock<std::mutex> lk(sleep_mutex_);
-        wake_up_cond_.wait_for(lk, std::chrono::seconds(sleep_time_), [this]() { return thread_exit_; });
-        if (!thread_exit_) {  // wake up by timeout, not notify
-          stop_writing_.store(false);
-          continue;
-        }
-      } else {
-        file_len_ += msg.size();
-        bytes_since_flush_ += msg.size();
-      }
-    }
-    // flush logs at least every 10^6 chars,
-    // or every "FLAGS_flush_log_file_secs" seconds.
-    if (bytes_since_flush_ >= 1000000 || CycleClock_Now() >= next_flush_time_) {
-      Flush();
+  bool exit = false;
+  while (!exit) {
+    {
+      std::unique_lock<std::mutex> lk(sleep_mutex_);
+      if (!thread_exit_) wake_up_cond_.wait_for(lk, std::chrono::milliseconds(1));
+      exit = thread_exit_;
     }
-  }
-  // flush msgq_
-  while (!force_flush_.load() && msgq_.WaitAndTryPop(msg, std::chrono::microseconds(100))) {
-    if (file_len_ > max_file_len_) {
-      if (!CreateLogFile()) {
-        return;
-      }
-      file_len_ = 0;
-    }
-    fwrite(msg.data(), 1, msg.size(), file_);
-    if (errno == ENOSPC) {  // disk full
+    if (!Drain() && errno == ENOSPC) {  // disk full
       perror("Disk is full, log stop output to the log file");
-      fprintf(stderr, "Disk is full, log stop output to the log file!\n");
-      fclose(file_);
-      return;
+      fprintf(stderr, "Disk is full, log stop output to the log file until %ld seconds!\n", sleep_time_);
+      stop_writing_.store(true);  // disk full, stop writing to disk, until wake up
+      DiscardBuffers();
+      std::unique_lock<std::mutex> lk(sleep_mutex_);
+      wake_up_cond_.wait_for(lk, std::chrono::seconds(sleep_time_), [this]() { return thread_exit_; });
+      if (thread_exit_) break;
+      stop_writing_.store(false);  // wake up by timeout, not notify
     }
-    file_len_ += msg.size();
   }
-  fflush(file_);
+  std::lock_guard<std::mutex> lk(drain_mutex_);
   fclose(file_);
-}
-
-void LogFile::Flush() {
-  if (file_ != nullptr) {
-    fflush(file_);
-    bytes_since_flush_ = 0;
-  }
-  next_flush_time_ = CycleClock_Now()
-    + FLAGS_flush_log_file_secs * static_cast<size_t>(1000000);  // in usec
+  file_ = nullptr;
 }
 // end LogFile
 
@@ -557,6 +689,7 @@ class LogDestination : public NonCopyable {
   static void LogToStderr(LogSeverity severity, const char* message, size_t message_len);
   static void LogToSinks(LogMessage::LogMessageData* data);
   static void LogToFile(const char* message, size_t message_len, bool force_flush);
+  static uint64_t GetDropCount();
 
  private:
   explicit LogDestination(const char* file_name);
@@ -565,6 +698,7 @@ class LogDestination : public NonCopyable {
 
   LogFile log_file_;
   static std::vector<LogSink*> sinks_;
+  static std::atomic<size_t> sink_num_;  // lets LogToSinks skip the lock when there is no sink
 
   static LogDestination* log_destination_;
   static size_t MAX_FILE_LEN;
@@ -572,6 +706,7 @@ class LogDestination : public NonCopyable {
 };  // class LogDestination
 
 std::vector<LogSink*> LogDestination::sinks_;
+std::atomic<size_t> LogDestination::sink_num_{0};
 size_t LogDestination::MAX_FILE_LEN = 1024 * 1024 * 1024;  // FIXME, default log file size 1G.
 
 // static LogDestination pointer, if called CreateLogDestination(), but not called DeleteLogDestination(),
@@ -608,6 +743,7 @@ inline void LogDestination::DeleteLogDestination() {
 inline void LogDestination::AddLogSink(LogSink* sink) {
   RwLockWriteGuard lk(sink_lock_);
   sinks_.push_back(sink);
+  sink_num_.store(sinks_.size());
 }
 
 inline void LogDestination::RemoveLogSink(LogSink* sink) {
@@ -616,12 +752,14 @@ inline void LogDestination::RemoveLogSink(LogSink* sink) {
     if (sinks_[i] == sink) {
       sinks_[i] = sinks_[sinks_.size() - 1];
       sinks_.pop_back();
+      sink_num_.store(sinks_.size());
       break;
     }
   }
 }
 
 inline void LogDestination::LogToSinks(LogMessage::LogMessageData* data) {
+  if (sink_num_.load(std::memory_order_relaxed) == 0) return;
   RwLockReadGuard lk(sink_lock_);
   for (int i = sinks_.size() - 1; i >= 0; i--) {
     sinks_[i]->Send(data->severity_, data->category_,
@@ -641,9 +779,20 @@ inline void LogDestination::LogToStderr(LogSeverity severity, const char* messag
 
 inline void LogDestination::LogToFile(const char* message, size_t message_len, bool force_flush) {
   if (IsInitCNStreamLogging() && FLAGS_log_to_file) {
-    GetLogDestination()->log_file_.Write(message, message_len, force_flush);
+    if (force_flush) {
+      GetLogDestination()->log_file_.Flush();
+    } else {
+      GetLogDestination()->log_file_.Write(message, message_len);
+    }
   }
 }
+
+inline uint64_t LogDestination::GetDropCount() {
+  if (IsInitCNStreamLogging() && GetLogDestination()) {
+    return GetLogDestination()->log_file_.GetDropCount();
+  }
+  return 0;
+}
 // end LogDestination
 
 static thread_local bool thread_msg_data_available = true;
@@ -767,6 +916,10 @@ void RemoveLogSink(LogSink* log_sink) {
   LogDestination::RemoveLogSink(log_sink);
 }
 
+uint64_t GetDroppedLogCount() {
+  return LogDestination::GetDropCount();
+}
+
 void ShutdownCNStreamLogging() {
   LogDestination::DeleteLogDestination();
   g_init_cnstream_logging = false;
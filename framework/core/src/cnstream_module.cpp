@@ -22,31 +22,25 @@
 #include <memory>
 #include <string>
 #include <thread>
+#include <sstream>
 #include <unordered_map>
+#include <vector>
 
 #include "cnstream_pipeline.hpp"
 
 namespace cnstream {
 
 #ifdef UNIT_TEST
-static SpinLock module_id_spinlock_;
-static uint64_t module_id_mask_ = 0;
+static IndexAllocator module_id_allocator(MAX_MODULE_NUM);
 static size_t _GetId() {
-  SpinLockGuard guard(module_id_spinlock_);
-  for (size_t i = 0; i < sizeof(module_id_mask_) * 8; i++) {
-    if (!(module_id_mask_ & ((uint64_t)1 << i))) {
-      module_id_mask_ |= (uint64_t)1 << i;
-      return i;
-    }
-  }
-  return INVALID_MODULE_ID;
+  uint32_t id = module_id_allocator.Allocate();
+  return id == IndexAllocator::kInvalidIndex ? INVALID_MODULE_ID : id;
 }
 static void _ReturnId(size_t id_) {
-  SpinLockGuard guard(module_id_spinlock_);
-  if (id_ >= sizeof(module_id_mask_) * 8) {
+  if (id_ >= MAX_MODULE_NUM) {
     return;
   }
-  module_id_mask_ &= ~(1 << id_);
+  module_id_allocator.Release(id_);
 }
 #endif
 
@@ -174,16 +168,37 @@ bool Module::TransmitData(std::shared_ptr<CNFrameInfo> data) {
   return false;
 }
 
+namespace {
+
+// Perf managers resolved by the calling thread, indexed by stream index. They are valid as long as the perf
+// generation they were resolved in is current, and the stream id matches, as stream indexes are reused.
+struct PerfHandleCache {
+  struct Handle {
+    bool resolved = false;
+    std::string stream_id;
+    std::weak_ptr<PerfManager> manager;
+  };
+  uint64_t generation = 0;
+  std::vector<Handle> handles;
+};
+
+std::string ThreadLabel() {
+  std::stringstream ss;
+  ss << std::this_thread::get_id();
+  return ss.str();
+}
+
+}  // namespace
+
 void Module::RecordTime(std::shared_ptr<CNFrameInfo> data, bool is_finished) {
-  std::shared_ptr<PerfManager> manager = GetPerfManager(data->stream_id);
-  if (!data->IsEos() && manager) {
+  if (data->IsEos()) return;
+  std::shared_ptr<PerfManager> manager = GetPerfManager(data);
+  if (manager) {
     manager->Record(is_finished, PerfManager::GetDefaultType(), GetName(), data->timestamp);
     if (!is_finished) {
-      std::stringstream ss;
-      ss << std::this_thread::get_id();
-      std::string thread_id_str = ss.str();
+      thread_local const std::string thread_label = ThreadLabel();
       manager->Record(PerfManager::GetDefaultType(), PerfManager::GetPrimaryKey(), std::to_string(data->timestamp),
-                      GetName() + PerfManager::GetThreadSuffix(), thread_id_str);
+                      perf_thread_key_, thread_label);
     }
   }
 }
@@ -191,14 +206,33 @@ void Module::RecordTime(std::shared_ptr<CNFrameInfo> data, bool is_finished) {
 std::shared_ptr<PerfManager> Module::GetPerfManager(const std::string& stream_id) {
   RwLockReadGuard guard(container_lock_);
   if (container_) {
-    auto managers = container_->GetPerfManagers();
-    if (managers.find(stream_id) != managers.end()) {
-      return managers[stream_id];
-    }
+    return container_->GetPerfManager(stream_id);
   }
   return nullptr;
 }
 
+std::shared_ptr<PerfManager> Module::GetPerfManager(const std::shared_ptr<CNFrameInfo>& data) {
+  RwLockReadGuard guard(container_lock_);
+  if (!container_) return nullptr;
+  const uint32_t stream_idx = data->GetStreamIndex();
+  if (stream_idx >= MAX_STREAM_NUM) return container_->GetPerfManager(data->stream_id);
+
+  thread_local PerfHandleCache cache;
+  const uint64_t generation = container_->GetPerfGeneration();
+  if (generation != cache.generation) {
+    cache.handles.clear();
+    cache.generation = generation;
+  }
+  if (stream_idx >= cache.handles.size()) cache.handles.resize(stream_idx + 1);
+  PerfHandleCache::Handle& handle = cache.handles[stream_idx];
+  if (!handle.resolved || handle.stream_id != data->stream_id) {
+    handle.resolved = true;
+    handle.stream_id = data->stream_id;
+    handle.manager = container_->GetPerfManager(data->stream_id);
+  }
+  return handle.manager.lock();
+}
+
 ModuleFactory* ModuleFactory::factory_ = nullptr;
 
 }  // namespace cnstream
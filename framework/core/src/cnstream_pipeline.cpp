@@ -45,10 +45,7 @@ namespace cnstream {
 
 uint32_t GetMaxStreamNumber() { return MAX_STREAM_NUM; }
 
-uint32_t GetMaxModuleNumber() {
-  /*maxModuleIdNum is sizeof(module_id_mask_) * 8  (bytes->bits)*/
-  return sizeof(uint64_t) * 8;
-}
+uint32_t GetMaxModuleNumber() { return MAX_MODULE_NUM; }
 
 uint32_t IdxManager::GetStreamIndex(const std::string& stream_id) {
   SpinLockGuard guard(id_lock);
@@ -57,14 +54,10 @@ uint32_t IdxManager::GetStreamIndex(const std::string& stream_id) {
     return search->second;
   }
 
-  for (uint32_t i = 0; i < GetMaxStreamNumber(); i++) {
-    if (!stream_bitset[i]) {
-      stream_bitset.set(i);
-      stream_idx_map[stream_id] = i;
-      return i;
-    }
-  }
-  return INVALID_STREAM_IDX;
+  uint32_t i = stream_idx_allocator_.Allocate();
+  if (i == IndexAllocator::kInvalidIndex) return INVALID_STREAM_IDX;
+  stream_idx_map[stream_id] = i;
+  return i;
 }
 
 void IdxManager::ReturnStreamIndex(const std::string& stream_id) {
@@ -77,27 +70,20 @@ void IdxManager::ReturnStreamIndex(const std::string& stream_id) {
   if (stream_idx >= GetMaxStreamNumber()) {
     return;
   }
-  stream_bitset.reset(stream_idx);
+  stream_idx_allocator_.Release(stream_idx);
   stream_idx_map.erase(search);
 }
 
 size_t IdxManager::GetModuleIdx() {
-  SpinLockGuard guard(id_lock);
-  for (size_t i = 0; i < GetMaxModuleNumber(); i++) {
-    if (!(module_id_mask_ & ((uint64_t)1 << i))) {
-      module_id_mask_ |= (uint64_t)1 << i;
-      return i;
-    }
-  }
-  return INVALID_MODULE_ID;
+  uint32_t i = module_idx_allocator_.Allocate();
+  return i == IndexAllocator::kInvalidIndex ? INVALID_MODULE_ID : i;
 }
 
 void IdxManager::ReturnModuleIdx(size_t id_) {
-  SpinLockGuard guard(id_lock);
   if (id_ >= GetMaxModuleNumber()) {
     return;
   }
-  module_id_mask_ &= ~(1 << id_);
+  module_idx_allocator_.Release(id_);
 }
 
 void Pipeline::UpdateByStreamMsg(const StreamMsg& msg) {
@@ -214,6 +200,10 @@ EventHandleFlag Pipeline::DefaultBusWatch(const Event& event) {
       ret = EVENT_HANDLE_SYNCED;
       break;
     }
+    case EventType::EVENT_STREAM_THROTTLE:
+      LOGI(CORE) << "[" << event.module_name << "]: stream " << event.stream_id << " " << event.message;
+      ret = EVENT_HANDLE_SYNCED;
+      break;
     case EventType::EVENT_INVALID:
       LOGE(CORE) << "[" << event.module_name << "]: "
                  << "Info: " << event.message;
@@ -225,11 +215,11 @@ EventHandleFlag Pipeline::DefaultBusWatch(const Event& event) {
 }
 
 bool Pipeline::ProvideData(const Module* module, std::shared_ptr<CNFrameInfo> data) {
-  std::string moduleName = module->GetName();
+  // modules added to this pipeline all have their ids
+  const size_t id = module->id_;
+  if (id >= graph_.size() || graph_[id].module != module) return false;
 
-  if (modules_map_.find(moduleName) == modules_map_.end()) return false;
-
-  TransmitData(moduleName, data);
+  TransmitData(graph_[id], data);
 
   return true;
 }
@@ -254,8 +244,7 @@ bool Pipeline::AddModule(std::shared_ptr<Module> module) {
   associated_info.connector = std::make_shared<Connector>(associated_info.parallelism);
   modules_.insert(std::make_pair(moduleName, associated_info));
   modules_map_[moduleName] = module;
-
-  all_modules_mask_ |= (uint64_t)1 << module->GetId();
+  CompileGraph();
   return true;
 }
 
@@ -265,10 +254,12 @@ bool Pipeline::SetModuleAttribute(std::shared_ptr<Module> module, uint32_t paral
   modules_[moduleName].parallelism = parallelism;
   if (parallelism && queue_capacity) {
     modules_[moduleName].connector = std::make_shared<Connector>(parallelism, queue_capacity);
+    CompileGraph();
     return static_cast<bool>(modules_[moduleName].connector);
   }
   if (!parallelism && modules_[moduleName].connector) {
     modules_[moduleName].connector.reset();
+    CompileGraph();
   }
   return true;
 }
@@ -309,9 +300,57 @@ std::string Pipeline::LinkModules(std::shared_ptr<Module> up_node, std::shared_p
   links_[link_id] = down_node_info.connector;
 
   down_node->SetParentId(up_node->GetId());
+  CompileGraph();
   return link_id;
 }
 
+void Pipeline::CompileGraph() {
+  graph_.clear();
+  for (auto& it : modules_map_) {
+    const size_t id = it.second->GetId();
+    if (id >= graph_.size()) graph_.resize(id + 1);
+  }
+  for (auto& it : modules_) {
+    Module* module = modules_map_[it.first].get();
+    CompiledNode& node = graph_[module->GetId()];
+    node.module = module;
+    node.connector = it.second.connector.get();
+    node.single_parent = module->GetParentIds().size() == 1;
+    for (auto& down_node_name : it.second.down_nodes) {
+      node.down_nodes.push_back(modules_map_[down_node_name]->GetId());
+    }
+  }
+  for (size_t id = 0; id < graph_.size(); ++id) {
+    graph_[id].fork_branches = CanForkBranches(id);
+  }
+}
+
+bool Pipeline::CanForkBranches(size_t id) const {
+  const CompiledNode& node = graph_[id];
+  if (node.down_nodes.size() < 2) return false;
+  // mark the modules reachable from each branch, no module should be reachable from two branches
+  std::vector<int> branch_of(graph_.size(), -1);
+  for (size_t branch = 0; branch < node.down_nodes.size(); ++branch) {
+    std::vector<size_t> stack(1, node.down_nodes[branch]);
+    while (!stack.empty()) {
+      size_t cur = stack.back();
+      stack.pop_back();
+      if (branch_of[cur] == static_cast<int>(branch)) continue;
+      if (branch_of[cur] != -1 || cur == id) return false;
+      branch_of[cur] = static_cast<int>(branch);
+      stack.insert(stack.end(), graph_[cur].down_nodes.begin(), graph_[cur].down_nodes.end());
+    }
+  }
+  // and no module of a branch should have an upstream module out of the branch, except the node itself
+  for (size_t cur = 0; cur < graph_.size(); ++cur) {
+    if (branch_of[cur] == -1 || !graph_[cur].module) continue;
+    for (size_t parent : graph_[cur].module->GetParentIds()) {
+      if (parent != id && branch_of[parent] != branch_of[cur]) return false;
+    }
+  }
+  return true;
+}
+
 bool Pipeline::QueryLinkStatus(LinkStatus* status, const std::string& link_id) {
   std::shared_ptr<Connector> con = links_[link_id];
   if (!con) {
@@ -325,6 +364,7 @@ bool Pipeline::QueryLinkStatus(LinkStatus* status, const std::string& link_id) {
   status->stopped = con->IsStopped();
   for (uint32_t i = 0; i < con->GetConveyorCount(); ++i) {
     status->cache_size.emplace_back(con->GetConveyorSize(i));
+    status->shed_count.emplace_back(con->GetShedCount(i));
   }
   return true;
 }
@@ -360,6 +400,8 @@ bool Pipeline::Start() {
     perf_del_data_thread_ = std::thread(&Pipeline::PerfDeleteDataLoop, this);
   }
 
+  CompileGraph();
+
   // start data transmit
   running_.store(true);
   event_bus_->Start();
@@ -393,6 +435,9 @@ bool Pipeline::Start() {
       threads_.push_back(std::thread(&Pipeline::TaskLoop, this, node_name, conveyor_idx));
     }
   }
+  if (latency_controller_) {
+    latency_control_thread_ = std::thread(&Pipeline::LatencyControlLoop, this);
+  }
   LOGI(CORE) << "Pipeline Start";
   LOGI(CORE) << "All modules, except the first module, total  threads  is: " << threads_.size();
   return true;
@@ -413,6 +458,9 @@ bool Pipeline::Stop() {
     if (it.joinable()) it.join();
   }
   threads_.clear();
+  if (latency_control_thread_.joinable()) {
+    latency_control_thread_.join();
+  }
   event_bus_->Stop();
 
   // close modules
@@ -442,6 +490,7 @@ bool Pipeline::Stop() {
   {
     RwLockWriteGuard lg(perf_managers_lock_);
     perf_managers_.clear();
+    UpdatePerfGeneration();
   }
   {
     std::lock_guard<std::mutex> lg_calc(perf_calculation_lock_);
@@ -453,29 +502,32 @@ bool Pipeline::Stop() {
   return true;
 }
 
-void Pipeline::TransmitData(std::string moduleName, std::shared_ptr<CNFrameInfo> data) {
-  LOGF_IF(CORE, modules_.find(moduleName) == modules_.end());
+void Pipeline::TransmitData(const std::string& node_name, std::shared_ptr<CNFrameInfo> data) {
+  auto iter = modules_map_.find(node_name);
+  LOGF_IF(CORE, iter == modules_map_.end());
+  TransmitData(graph_[iter->second->GetId()], data);
+}
 
-  const ModuleAssociatedInfo& module_info = modules_[moduleName];
-  Module* module = modules_map_[moduleName].get();
+void Pipeline::TransmitData(const CompiledNode& node, std::shared_ptr<CNFrameInfo> data) {
+  Module* module = node.module;
 
-  uint64_t changed_mask = data->MarkPassed(module);
+  uint32_t passed_num = data->MarkPassed(module);
 
   if (data->IsEos()) {
-    LOGI(CORE) << "[" << moduleName << "]"
+    LOGI(CORE) << "[" << module->name_ << "]"
               << " StreamId " << data->stream_id << " got eos.";
     Event e;
     e.type = EventType::EVENT_EOS;
-    e.module_name = moduleName;
+    e.module_name = module->name_;
     e.stream_id = data->stream_id;
     e.thread_id = std::this_thread::get_id();
     event_bus_->PostEvent(e);
-    if (changed_mask == all_modules_mask_) {
+    if (passed_num == modules_map_.size()) {
       // passed by all modules
       StreamMsg msg;
       msg.type = StreamMsgType::EOS_MSG;
       msg.stream_id = data->stream_id;
-      msg.module_name = moduleName;
+      msg.module_name = module->name_;
       UpdateByStreamMsg(msg);
     }
   } else {
@@ -490,7 +542,7 @@ void Pipeline::TransmitData(std::string moduleName, std::shared_ptr<CNFrameInfo>
     StreamMsg msg;
     msg.type = StreamMsgType::FRAME_ERR_MSG;
     msg.stream_id = data->stream_id;
-    msg.module_name = moduleName;
+    msg.module_name = module->name_;
     msg.pts = data->timestamp;
     UpdateByStreamMsg(msg);
     LOGW(CORE) << "[" << GetName() << "]" << " got frame error from " << module->name_ <<
@@ -498,22 +550,27 @@ void Pipeline::TransmitData(std::string moduleName, std::shared_ptr<CNFrameInfo>
     return;
   }
   module->NotifyObserver(data);
-  for (auto& down_node_name : module_info.down_nodes) {
-    ModuleAssociatedInfo& down_node_info = modules_.find(down_node_name)->second;
+  for (size_t i = 0; i < node.down_nodes.size(); ++i) {
+    const CompiledNode& down_node_info = graph_[node.down_nodes[i]];
     assert(down_node_info.connector);
-    assert(0 < down_node_info.input_connectors.size());
-    Module* down_node = modules_map_[down_node_name].get();
+    Module* down_node = down_node_info.module;
 
     // case 1: down_node has only 1 input node: current node
     // case 2: down_node has >1 input nodes, current node has brother nodes
     // the processing data frame will not be pushed into down_node Connector
     // until processed by all brother nodes, the last node responds to transmit
-    bool processed_by_all_modules = ShouldTransmit(changed_mask, down_node);
+    bool processed_by_all_modules = ShouldTransmit(data, down_node) &&
+        (down_node_info.single_parent || data->MarkTransmitted(down_node));
 
     if (processed_by_all_modules) {
-      std::shared_ptr<Connector> connector = down_node_info.connector;
+      // the last branch gets the frame itself, the others get forks made before it is handed over, so no branch
+      // sees the datas replaced by another
+      std::shared_ptr<CNFrameInfo> fork;
+      if (node.fork_branches && i + 1 < node.down_nodes.size()) fork = data->Fork();
+      const std::shared_ptr<CNFrameInfo>& branch_data = fork ? fork : data;
+      Connector* connector = down_node_info.connector;
       int conveyor_idx = data->GetStreamIndex() % connector->GetConveyorCount();
-      while (!connector->IsStopped() && connector->PushDataBufferToConveyor(conveyor_idx, data) == false) {
+      while (!connector->IsStopped() && connector->PushDataBufferToConveyor(conveyor_idx, branch_data) == false) {
         if (connector->GetFailTime(conveyor_idx) % 50 == 0) {
           // Show infomation when conveyor is full in every second
           // LOGI(CORE) << "[" << down_node->name_  << " " << conveyor_idx << "] " << "Input buffer is full";
@@ -524,11 +581,51 @@ void Pipeline::TransmitData(std::string moduleName, std::shared_ptr<CNFrameInfo>
   }
 
   // frame done
-  if (frame_done_callback_ && (0 == module_info.down_nodes.size())) {
+  if (latency_controller_ && node.down_nodes.empty()) {
+    latency_controller_->OnFrameDone(data);
+  }
+  if (frame_done_callback_ && node.down_nodes.empty()) {
     frame_done_callback_(data);
   }
 }
 
+bool Pipeline::SetLatencyControl(const LatencyControlParam& param) {
+  if (IsRunning()) {
+    LOGE(CORE) << "[" << GetName() << "] latency control should be set before the pipeline starts.";
+    return false;
+  }
+  latency_controller_.reset();
+  if (param.target_latency_ms) {
+    latency_controller_.reset(new (std::nothrow) LatencyController(param, &stream_throttles_, event_bus_));
+    LOGF_IF(CORE, nullptr == latency_controller_) << "Pipeline::SetLatencyControl() failed to alloc LatencyController";
+  }
+  return true;
+}
+
+void Pipeline::LatencyControlLoop() {
+  SetThreadName("cn-latency-ctrl", pthread_self());
+  const auto period = std::chrono::milliseconds(std::max(latency_controller_->GetParam().period_ms, 1u));
+  auto next = std::chrono::steady_clock::now() + period;
+  while (running_) {
+    if (std::chrono::steady_clock::now() < next) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      continue;
+    }
+    next += period;
+    // the fullest queue tells how far the slowest module falls behind
+    float queue_fill = 0;
+    for (const auto& it : links_) {
+      Connector* connector = it.second.get();
+      if (!connector || !connector->GetConveyorCapacity()) continue;
+      for (size_t idx = 0; idx < connector->GetConveyorCount(); ++idx) {
+        queue_fill = std::max(queue_fill, static_cast<float>(connector->GetConveyorSize(idx)) /
+                                              connector->GetConveyorCapacity());
+      }
+    }
+    latency_controller_->Step(queue_fill);
+  }
+}
+
 void Pipeline::TaskLoop(std::string node_name, uint32_t conveyor_idx) {
   LOGF_IF(CORE, modules_.find(node_name) == modules_.end());
 
@@ -613,7 +710,7 @@ CNModuleConfig Pipeline::GetModuleConfig(const std::string& module_name) {
 
 int Pipeline::BuildPipeline(const std::vector<CNModuleConfig>& configs) {
   /*TODO,check configs*/
-  uint64_t linked_id_mask = 0;
+  IndexMask linked_id_mask;
   ModuleCreatorWorker creator;
   for (auto& v : configs) {
     this->AddModuleConfig(v);
@@ -634,13 +731,13 @@ int Pipeline::BuildPipeline(const std::vector<CNModuleConfig>& configs) {
         LOGE(CORE) << "Link [" << v.first << "] with [" << name << "] failed.";
         return -1;
       }
-      linked_id_mask |= (uint64_t)1 << modules_map_[name]->GetId();
+      linked_id_mask.Set(modules_map_[name]->GetId());
     }
   }
   for (auto& v : configs) {
     if (v.className != "cnstream::DataSource" && v.className != "cnstream::TestDataSource" &&
         v.className != "cnstream::ModuleIPC" &&
-        !(((uint64_t)1 << modules_map_[v.name]->GetId()) & linked_id_mask)) {
+        !linked_id_mask.Test(modules_map_[v.name]->GetId())) {
       LOGE(CORE) << v.name << " not linked to any module.";
       return -1;
     }
@@ -700,6 +797,7 @@ bool Pipeline::CreatePerfManager(std::vector<std::string> stream_ids, std::strin
     }
     perf_managers_[stream_id] = manager;
   }
+  UpdatePerfGeneration();
 
   // Create PerfCalculators for each module and pipeline
   for (auto& module_it : modules_map_) {
@@ -926,6 +1024,7 @@ bool Pipeline::RemovePerfManager(std::string stream_id) {
       }
     }  // perf calculation lock end
     perf_managers_.erase(stream_id);
+    UpdatePerfGeneration();
   }  // perf manager write lock end
 
   std::cout << "\033[1;31m" << "\n\n%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%"
@@ -968,6 +1067,7 @@ bool Pipeline::AddPerfManager(std::string stream_id, std::string db_dir) {
     manager = PerfManager::CreateDefaultManager(db_name, module_names);
     if (manager == nullptr) { return false; }
     perf_managers_[stream_id] = manager;
+    UpdatePerfGeneration();
   }  // perf manager write lock end
   {
     std::lock_guard<std::mutex> lg_calc(perf_calculation_lock_);
@@ -1050,4 +1150,15 @@ std::unordered_map<std::string, std::shared_ptr<PerfManager>> Pipeline::GetPerfM
   return perf_managers_;
 }
 
+std::shared_ptr<PerfManager> Pipeline::GetPerfManager(const std::string& stream_id) {
+  RwLockReadGuard lg(perf_managers_lock_);
+  auto iter = perf_managers_.find(stream_id);
+  return iter == perf_managers_.end() ? nullptr : iter->second;
+}
+
+void Pipeline::UpdatePerfGeneration() {
+  static std::atomic<uint64_t> generation{0};
+  perf_generation_.store(++generation, std::memory_order_release);
+}
+
 }  // namespace cnstream
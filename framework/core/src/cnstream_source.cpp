@@ -21,7 +21,6 @@
 #include "cnstream_eventbus.hpp"
 #include "cnstream_pipeline.hpp"
 
-#include <bitset>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -34,7 +33,7 @@ namespace cnstream {
 /*default */
 static SpinLock stream_idx_lock;
 static std::unordered_map<std::string, uint32_t> stream_idx_map;
-static std::bitset<MAX_STREAM_NUM> stream_bitset(0);
+static IndexAllocator stream_idx_allocator(MAX_STREAM_NUM);
 
 static uint32_t _GetStreamIndex(const std::string &stream_id) {
   SpinLockGuard guard(stream_idx_lock);
@@ -43,14 +42,10 @@ static uint32_t _GetStreamIndex(const std::string &stream_id) {
     return search->second;
   }
 
-  for (uint32_t i = 0; i < GetMaxStreamNumber(); i++) {
-    if (!stream_bitset[i]) {
-      stream_bitset.set(i);
-      stream_idx_map[stream_id] = i;
-      return i;
-    }
-  }
-  return INVALID_STREAM_IDX;
+  uint32_t i = stream_idx_allocator.Allocate();
+  if (i == IndexAllocator::kInvalidIndex) return INVALID_STREAM_IDX;
+  stream_idx_map[stream_id] = i;
+  return i;
 }
 
 static int _ReturnStreamIndex(const std::string &stream_id) {
@@ -63,7 +58,7 @@ static int _ReturnStreamIndex(const std::string &stream_id) {
   if (stream_idx >= GetMaxStreamNumber()) {
     return -1;
   }
-  stream_bitset.reset(stream_idx);
+  stream_idx_allocator.Release(stream_idx);
   stream_idx_map.erase(search);
   return 0;
 }
@@ -78,6 +73,11 @@ uint32_t SourceModule::GetStreamIndex(const std::string &stream_id) {
   return INVALID_STREAM_IDX;
 }
 
+StreamThrottles *SourceModule::GetStreamThrottles() {
+  RwLockReadGuard guard(container_lock_);
+  return container_ ? container_->GetStreamThrottles() : nullptr;
+}
+
 void SourceModule::ReturnStreamIndex(const std::string &stream_id) {
   RwLockReadGuard guard(container_lock_);
   if (container_) container_->ReturnStreamIndex(stream_id);
@@ -107,8 +107,10 @@ int SourceModule::AddSource(std::shared_ptr<SourceHandler> handler) {
   source_idx_++;
 
   SetStreamRemoved(stream_id, false);
+  if (!HasStreamQos(stream_id)) SetStreamQos(stream_id, default_qos_);
   if (handler->Open() != true) {
     LOGE(CORE) << "source Open failed";
+    RemoveStreamQos(stream_id);
     return -1;
   }
   source_map_[stream_id] = handler;
@@ -145,6 +147,7 @@ int SourceModule::RemoveSource(const std::string &stream_id, bool force) {
   // wait for eos reached
   CheckStreamEosReached(stream_id, force);
   SetStreamRemoved(stream_id, false);
+  RemoveStreamQos(stream_id);
   {
     std::unique_lock<std::mutex> lock(mutex_);
     auto iter = source_map_.find(stream_id);
@@ -171,6 +174,7 @@ int SourceModule::RemoveSources(bool force) {
     for (auto &iter : source_map_) {
       CheckStreamEosReached(iter.first, force);
       SetStreamRemoved(iter.first, false);
+      RemoveStreamQos(iter.first);
     }
     source_map_.clear();
   }
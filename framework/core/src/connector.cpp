@@ -83,6 +83,10 @@ uint64_t Connector::GetFailTime(int conveyor_idx) const {
   return GetConveyor(conveyor_idx)->GetFailTime();
 }
 
+uint64_t Connector::GetShedCount(int conveyor_idx) const {
+  return GetConveyor(conveyor_idx)->GetShedCount();
+}
+
 bool Connector::IsStopped() {
   return stop_.load();
 }
@@ -70,6 +70,7 @@ class Connector : private NonCopyable {
   bool IsConveyorEmpty(int conveyor_idx) const;
   size_t GetConveyorSize(int conveyor_idx) const;
   uint64_t GetFailTime(int conveyor_idx) const;
+  uint64_t GetShedCount(int conveyor_idx) const;
 
   CNFrameInfoPtr PopDataBufferFromConveyor(int conveyor_idx);
   bool PushDataBufferToConveyor(int conveyor_idx, CNFrameInfoPtr data);
@@ -20,7 +20,9 @@
 
 #include "conveyor.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <deque>
 #include <memory>
 #include <thread>
 #include <vector>
@@ -29,18 +31,40 @@
 
 namespace cnstream {
 
+namespace {
+
+// Calls func with the index of each queue with frames.
+template <typename Func>
+void ForEachIndex(const IndexMask& mask, Func func) {
+  for (size_t w = 0; w < mask.GetWordNum(); ++w) {
+    for (uint64_t bits = mask.GetWord(w); bits; bits &= bits - 1) {
+      func(w * 64 + static_cast<size_t>(__builtin_ctzll(bits)));
+    }
+  }
+}
+
+}  // namespace
+
 Conveyor::Conveyor(size_t max_size) : max_size_(max_size) {
 }
 
 uint32_t Conveyor::GetBufferSize() {
   std::unique_lock<std::mutex> lk(data_mutex_);
-  return dataq_.size();
+  return size_;
 }
 
 bool Conveyor::PushDataBuffer(CNFrameInfoPtr data) {
   std::unique_lock<std::mutex> lk(data_mutex_);
-  if (dataq_.size() < max_size_) {
-    dataq_.push(data);
+  if (size_ < max_size_ || Shed(data->qos.priority)) {
+    uint32_t stream_idx = data->GetStreamIndex();
+    size_t q = stream_idx < GetMaxStreamNumber() ? stream_idx + 1 : 0;
+    if (q >= dataq_.size()) dataq_.resize(q + 1);
+    std::deque<Item>& stream_q = dataq_[q];
+    // a stream starts from the current virtual time when it has nothing queued
+    double start_tag = stream_q.empty() ? virtual_time_ : stream_q.back().finish_tag;
+    stream_q.push_back({data, start_tag + 1.0 / data->qos.priority});
+    busy_.Set(q);
+    size_++;
     notempty_cond_.notify_one();
     fail_time_ = 0;
     return true;
@@ -54,13 +78,70 @@ uint64_t Conveyor::GetFailTime() {
   return fail_time_;
 }
 
+uint64_t Conveyor::GetShedCount() {
+  std::unique_lock<std::mutex> lk(data_mutex_);
+  return shed_count_;
+}
+
+bool Conveyor::Shed(uint32_t priority) {
+  size_t victim_q = dataq_.size();
+  std::deque<Item>::iterator victim;
+  ForEachIndex(busy_, [&](size_t q) {
+    std::deque<Item>& stream_q = dataq_[q];
+    // eos frames are never shed
+    auto item = stream_q.begin();
+    while (item != stream_q.end() && item->data->IsEos()) ++item;
+    if (item == stream_q.end() || item->data->qos.priority >= priority) return;
+    if (victim_q == dataq_.size() || item->data->qos.priority < victim->data->qos.priority ||
+        (item->data->qos.priority == victim->data->qos.priority && stream_q.size() > dataq_[victim_q].size())) {
+      victim_q = q;
+      victim = item;
+    }
+  });
+  if (victim_q == dataq_.size()) return false;
+  dataq_[victim_q].erase(victim);
+  if (dataq_[victim_q].empty()) busy_.Reset(victim_q);
+  size_--;
+  shed_count_++;
+  return true;
+}
+
+size_t Conveyor::NextStream() const {
+  size_t next = dataq_.size();
+  ForEachIndex(busy_, [&](size_t q) {
+    if (next == dataq_.size()) {
+      next = q;
+      return;
+    }
+    const Item& head = dataq_[q].front();
+    const Item& next_head = dataq_[next].front();
+    if (head.data->HasDeadline() != next_head.data->HasDeadline()) {
+      if (head.data->HasDeadline()) next = q;
+    } else if (head.data->HasDeadline()) {
+      if (head.data->Deadline() < next_head.data->Deadline()) next = q;
+    } else if (head.finish_tag < next_head.finish_tag) {
+      next = q;
+    }
+  });
+  return next;
+}
+
+CNFrameInfoPtr Conveyor::PopFront(size_t q) {
+  std::deque<Item>& stream_q = dataq_[q];
+  Item& item = stream_q.front();
+  CNFrameInfoPtr data = std::move(item.data);
+  if (!data->HasDeadline()) virtual_time_ = std::max(virtual_time_, item.finish_tag);
+  stream_q.pop_front();
+  if (stream_q.empty()) busy_.Reset(q);
+  size_--;
+  return data;
+}
+
 CNFrameInfoPtr Conveyor::PopDataBuffer() {
   std::unique_lock<std::mutex> lk(data_mutex_);
   CNFrameInfoPtr data = nullptr;
-  if (notempty_cond_.wait_for(lk, rel_time_, [&] { return !dataq_.empty(); })) {
-    data = dataq_.front();
-    dataq_.pop();
-    return data;
+  if (notempty_cond_.wait_for(lk, rel_time_, [&] { return size_ > 0; })) {
+    return PopFront(NextStream());
   }
   return data;
 }
@@ -68,11 +149,8 @@ CNFrameInfoPtr Conveyor::PopDataBuffer() {
 std::vector<CNFrameInfoPtr> Conveyor::PopAllDataBuffer() {
   std::unique_lock<std::mutex> lk(data_mutex_);
   std::vector<CNFrameInfoPtr> vec_data;
-  CNFrameInfoPtr data = nullptr;
-  while (!dataq_.empty()) {
-    data = dataq_.front();
-    dataq_.pop();
-    vec_data.push_back(data);
+  while (size_ > 0) {
+    vec_data.push_back(PopFront(NextStream()));
   }
   return vec_data;
 }
@@ -21,12 +21,13 @@
 #ifndef MODULES_CORE_INCLUDE_CONVEYOR_HPP_
 #define MODULES_CORE_INCLUDE_CONVEYOR_HPP_
 
+#include <condition_variable>
+#include <deque>
 #include <memory>
 #include <vector>
-#include <queue>
-#include <condition_variable>
 
 #include "cnstream_frame.hpp"
+#include "util/cnstream_index.hpp"
 
 namespace cnstream {
 
@@ -46,6 +47,11 @@ class Connector;
  * The capacity of buffer queue could be set in configuration json file (see README for more information of
  * configuration json file). If there is no element in buffer queue, the downstream node will wait to pop and
  * be blocked. On contrary, if the queue is full, the upstream node will wait to push and be blocked.
+ *
+ * Frames are queued by stream and popped in the order of each stream. Among streams, frames with a deadline are popped
+ * earliest deadline first, and the others by weighted fair queuing, each stream weighted by its priority (see
+ * StreamQos). When the queue is full, a frame replaces the oldest frame of the stream of the lowest priority if that is
+ * lower than its own, and the replaced frame is dropped (shed).
  */
 class Conveyor : private NonCopyable {
  public:
@@ -56,6 +62,7 @@ class Conveyor : private NonCopyable {
   std::vector<CNFrameInfoPtr> PopAllDataBuffer();
   uint32_t GetBufferSize();
   uint64_t GetFailTime();
+  uint64_t GetShedCount();
 
  private:
 #ifdef UNIT_TEST
@@ -63,9 +70,26 @@ class Conveyor : private NonCopyable {
 #endif
 
  private:
-  std::queue<CNFrameInfoPtr> dataq_;
+  struct Item {
+    CNFrameInfoPtr data;
+    double finish_tag;  ///< Virtual finish time in weighted fair queuing.
+  };
+  // Drops the oldest frame of the stream of the lowest priority below priority, returns false if there is none.
+  bool Shed(uint32_t priority);
+  // The queue of the stream whose head frame is popped next.
+  size_t NextStream() const;
+  // Pops the head frame of a queue.
+  CNFrameInfoPtr PopFront(size_t q);
+
+  // Queues by stream index, frames without a stream index share the first one. Queues are kept when they run empty.
+  std::vector<std::deque<Item>> dataq_;
+  // The queues with frames.
+  IndexMask busy_;
+  size_t size_ = 0;
+  double virtual_time_ = 0;
   size_t max_size_;
   uint64_t fail_time_ = 0;
+  uint64_t shed_count_ = 0;
   std::mutex data_mutex_;
   std::condition_variable notempty_cond_;
   const std::chrono::milliseconds rel_time_{20};
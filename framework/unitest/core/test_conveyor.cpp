@@ -23,6 +23,7 @@
 #include <chrono>
 #include <ctime>
 #include <memory>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -163,4 +164,113 @@ TEST(CoreConveyor, PopAllData) {
   delete conveyor;
 }
 
+static void SetQos(const std::string& stream_id, uint32_t priority, uint32_t deadline_ms) {
+  StreamQos qos;
+  qos.priority = priority;
+  qos.deadline_ms = deadline_ms;
+  SetStreamQos(stream_id, qos);
+}
+
+// frames are queued by stream index
+static CNFrameInfoPtr CreateFrame(const std::string& stream_id, uint32_t stream_idx, bool eos = false) {
+  auto data = CNFrameInfo::Create(stream_id, eos);
+  data->SetStreamIndex(stream_idx);
+  return data;
+}
+
+TEST(CoreConveyor, QueueByStreamIndex) {
+  Conveyor conveyor(20);
+  const uint32_t last_idx = GetMaxStreamNumber() - 1;
+  std::vector<CNFrameInfoPtr> sdata;
+  for (int n = 0; n < 2; ++n) {
+    // streams are drained and refilled, frames without a stream index are queued as well
+    for (int i = 0; i < 3; ++i) {
+      sdata.push_back(CreateFrame("index_last", last_idx));
+      sdata.push_back(CreateFrame("index_64", 64));
+      sdata.push_back(CNFrameInfo::Create("index_none"));
+    }
+    for (auto& data : sdata) ASSERT_TRUE(conveyor.PushDataBuffer(data));
+    auto rdata = conveyor.PopAllDataBuffer();
+    ASSERT_EQ(sdata.size(), rdata.size());
+    EXPECT_EQ(0u, conveyor.GetBufferSize());
+    EXPECT_TRUE(conveyor.PopDataBuffer() == nullptr);
+    // the order of each stream is kept
+    for (const std::string& stream_id : {"index_last", "index_64", "index_none"}) {
+      std::vector<CNFrameInfoPtr> sent, received;
+      for (auto& data : sdata) {
+        if (data->stream_id == stream_id) sent.push_back(data);
+      }
+      for (auto& data : rdata) {
+        if (data->stream_id == stream_id) received.push_back(data);
+      }
+      EXPECT_EQ(sent, received);
+    }
+    sdata.clear();
+  }
+}
+
+TEST(CoreConveyor, WeightedFairQueuing) {
+  SetQos("wfq_low", 1, 0);
+  SetQos("wfq_high", 3, 0);
+  Conveyor conveyor(20);
+  for (int i = 0; i < 8; ++i) {
+    ASSERT_TRUE(conveyor.PushDataBuffer(CreateFrame("wfq_low", 0)));
+    ASSERT_TRUE(conveyor.PushDataBuffer(CreateFrame("wfq_high", 1)));
+  }
+  // the high priority stream gets three times the share while both are backlogged
+  int high = 0;
+  for (int i = 0; i < 8; ++i) {
+    if (conveyor.PopDataBuffer()->stream_id == "wfq_high") high++;
+  }
+  EXPECT_EQ(6, high);
+  RemoveStreamQos("wfq_low");
+  RemoveStreamQos("wfq_high");
+}
+
+TEST(CoreConveyor, EarliestDeadlineFirst) {
+  SetQos("edf_late", 1, 1000);
+  SetQos("edf_early", 1, 10);
+  Conveyor conveyor(20);
+  auto no_deadline = CreateFrame("edf_none", 0);
+  auto late = CreateFrame("edf_late", 1);
+  auto early = CreateFrame("edf_early", 2);
+  ASSERT_TRUE(conveyor.PushDataBuffer(no_deadline));
+  ASSERT_TRUE(conveyor.PushDataBuffer(late));
+  ASSERT_TRUE(conveyor.PushDataBuffer(early));
+  EXPECT_EQ(early, conveyor.PopDataBuffer());
+  EXPECT_EQ(late, conveyor.PopDataBuffer());
+  EXPECT_EQ(no_deadline, conveyor.PopDataBuffer());
+  RemoveStreamQos("edf_late");
+  RemoveStreamQos("edf_early");
+}
+
+TEST(CoreConveyor, ShedLowPriority) {
+  SetQos("shed_low", 1, 0);
+  SetQos("shed_high", 2, 0);
+  Conveyor conveyor(2);
+  auto low0 = CreateFrame("shed_low", 0);
+  auto low1 = CreateFrame("shed_low", 0);
+  ASSERT_TRUE(conveyor.PushDataBuffer(low0));
+  ASSERT_TRUE(conveyor.PushDataBuffer(low1));
+  // full, a frame of the same priority waits
+  EXPECT_FALSE(conveyor.PushDataBuffer(CreateFrame("shed_low", 0)));
+  // the oldest low priority frame is dropped
+  auto high = CreateFrame("shed_high", 1);
+  EXPECT_TRUE(conveyor.PushDataBuffer(high));
+  EXPECT_EQ(1u, conveyor.GetShedCount());
+  EXPECT_EQ(2u, conveyor.GetBufferSize());
+  // eos frames are never dropped
+  auto low_eos = CreateFrame("shed_low", 0, true);
+  conveyor.PopAllDataBuffer();
+  ASSERT_TRUE(conveyor.PushDataBuffer(low1));
+  ASSERT_TRUE(conveyor.PushDataBuffer(low_eos));
+  EXPECT_TRUE(conveyor.PushDataBuffer(CreateFrame("shed_high", 1)));
+  EXPECT_EQ(2u, conveyor.GetShedCount());
+  auto rest = conveyor.PopAllDataBuffer();
+  ASSERT_EQ(2u, rest.size());
+  EXPECT_TRUE(rest[0] == low_eos || rest[1] == low_eos);
+  RemoveStreamQos("shed_low");
+  RemoveStreamQos("shed_high");
+}
+
 }  // namespace cnstream
@@ -0,0 +1,168 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "cnstream_pipeline.hpp"
+#include "util/cnstream_index.hpp"
+
+namespace cnstream {
+
+TEST(CoreIndex, AllocateLowestFirst) {
+  IndexAllocator allocator(130);
+  EXPECT_EQ(allocator.GetCapacity(), 130u);
+  for (uint32_t i = 0; i < 130; ++i) {
+    EXPECT_EQ(allocator.Allocate(), i);
+  }
+  EXPECT_EQ(allocator.Allocate(), INVALID_STREAM_IDX);
+  allocator.Release(100);
+  allocator.Release(3);
+  allocator.Release(200);  // out of range, ignored
+  EXPECT_EQ(allocator.Allocate(), 3u);
+  EXPECT_EQ(allocator.Allocate(), 100u);
+  EXPECT_EQ(allocator.Allocate(), INVALID_STREAM_IDX);
+
+  IndexAllocator max_allocator(IndexAllocator::kMaxCapacity + 1);
+  EXPECT_EQ(max_allocator.GetCapacity(), static_cast<uint32_t>(IndexAllocator::kMaxCapacity));
+  for (uint32_t i = 0; i < IndexAllocator::kMaxCapacity; ++i) max_allocator.Allocate();
+  EXPECT_EQ(max_allocator.Allocate(), INVALID_STREAM_IDX);
+}
+
+TEST(CoreIndex, AllocateConcurrently) {
+  const uint32_t capacity = 512;
+  const int thread_num = 8;
+  IndexAllocator allocator(capacity);
+  std::vector<std::atomic<int>> owners(capacity);
+  for (auto& owner : owners) owner.store(0);
+  std::atomic<int> conflicts{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num; ++t) {
+    threads.emplace_back([&]() {
+      std::vector<uint32_t> held;
+      for (int n = 0; n < 20000; ++n) {
+        if (held.size() < capacity / thread_num) {
+          uint32_t idx = allocator.Allocate();
+          ASSERT_NE(idx, INVALID_STREAM_IDX);
+          if (owners[idx].fetch_add(1) != 0) ++conflicts;
+          held.push_back(idx);
+        } else {
+          for (auto idx : held) {
+            owners[idx].fetch_sub(1);
+            allocator.Release(idx);
+          }
+          held.clear();
+        }
+      }
+      for (auto idx : held) {
+        owners[idx].fetch_sub(1);
+        allocator.Release(idx);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(conflicts.load(), 0);
+  // everything is free again
+  for (uint32_t i = 0; i < capacity; ++i) EXPECT_EQ(allocator.Allocate(), i);
+}
+
+TEST(CoreIndex, Masks) {
+  IndexMask mask;
+  EXPECT_TRUE(mask.Empty());
+  mask.Set(3);
+  mask.Set(700);
+  EXPECT_TRUE(mask.Test(3));
+  EXPECT_TRUE(mask.Test(700));
+  EXPECT_FALSE(mask.Test(64));
+  EXPECT_FALSE(mask.Test(5000));
+  IndexMask other;
+  other.Set(700);
+  other.Set(3);
+  EXPECT_EQ(mask, other);
+  other.Reset(700);
+  other.Reset(5000);
+  EXPECT_FALSE(other.Test(700));
+  EXPECT_TRUE(other.Test(3));
+  EXPECT_NE(mask, other);
+
+  AtomicIndexMask passed(MAX_MODULE_NUM);
+  EXPECT_FALSE(passed.Contains(mask));
+  EXPECT_TRUE(passed.Set(3));
+  EXPECT_FALSE(passed.Set(3));
+  EXPECT_FALSE(passed.Contains(mask));
+  EXPECT_TRUE(passed.Set(700));
+  EXPECT_TRUE(passed.Contains(mask));
+  EXPECT_TRUE(passed.Test(700));
+  EXPECT_FALSE(passed.Test(701));
+  EXPECT_FALSE(passed.Set(MAX_MODULE_NUM));
+  EXPECT_TRUE(passed.Contains(IndexMask()));
+}
+
+TEST(CoreIndex, AtomicMaskSetOnce) {
+  AtomicIndexMask mask(MAX_MODULE_NUM);
+  std::atomic<int> first_set{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&]() {
+      for (size_t i = 0; i < MAX_MODULE_NUM; ++i) {
+        if (mask.Set(i)) ++first_set;
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(first_set.load(), static_cast<int>(MAX_MODULE_NUM));
+}
+
+TEST(CoreIndex, AtomicMaskMerge) {
+  AtomicIndexMask mask(MAX_MODULE_NUM);
+  mask.Set(1);
+  mask.Set(700);
+  AtomicIndexMask merged(MAX_MODULE_NUM);
+  merged.Set(2);
+  merged.Merge(mask);
+  EXPECT_TRUE(merged.Test(1));
+  EXPECT_TRUE(merged.Test(2));
+  EXPECT_TRUE(merged.Test(700));
+  EXPECT_FALSE(merged.Test(3));
+  EXPECT_FALSE(mask.Test(2));
+}
+
+TEST(CoreIndex, PipelineStreamIndex) {
+  IdxManager manager;
+  std::set<uint32_t> indexes;
+  const uint32_t stream_num = 300;
+  for (uint32_t i = 0; i < stream_num; ++i) {
+    indexes.insert(manager.GetStreamIndex(std::to_string(i)));
+  }
+  EXPECT_EQ(indexes.size(), stream_num);
+  EXPECT_EQ(*indexes.rbegin(), stream_num - 1);
+  EXPECT_EQ(manager.GetStreamIndex("10"), 10u);
+  manager.ReturnStreamIndex("10");
+  EXPECT_EQ(manager.GetStreamIndex("new"), 10u);
+  for (uint32_t i = 0; i < 100; ++i) {
+    EXPECT_EQ(manager.GetModuleIdx(), i);
+  }
+}
+
+}  // namespace cnstream
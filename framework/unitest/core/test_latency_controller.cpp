@@ -0,0 +1,138 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "cnstream_frame.hpp"
+#include "cnstream_latency_controller.hpp"
+
+namespace cnstream {
+
+static StreamThrottles throttles;
+// streams are throttled by stream index
+static const std::unordered_map<std::string, uint32_t> stream_idxs = {{"lc_low", 0}, {"lc_high", 1}, {"lc_deadline", 2}};
+
+static std::shared_ptr<CNFrameInfo> CreateFrame(const std::string& stream_id, bool eos = false) {
+  auto data = CNFrameInfo::Create(stream_id, eos);
+  data->SetStreamIndex(stream_idxs.at(stream_id));
+  return data;
+}
+
+static void FrameDone(LatencyController* controller, const std::string& stream_id, uint32_t priority,
+                      uint32_t deadline_ms, int latency_ms) {
+  auto data = CreateFrame(stream_id);
+  data->qos.priority = priority;
+  data->qos.deadline_ms = deadline_ms;
+  data->create_time = std::chrono::steady_clock::now() - std::chrono::milliseconds(latency_ms);
+  controller->OnFrameDone(data);
+}
+
+static void ExpectThrottle(const std::string& stream_id, uint32_t decode_interval, uint32_t infer_interval) {
+  StreamThrottle throttle = throttles.Get(stream_idxs.at(stream_id));
+  EXPECT_EQ(decode_interval, throttle.decode_interval) << stream_id;
+  EXPECT_EQ(infer_interval, throttle.infer_interval) << stream_id;
+}
+
+TEST(CoreLatencyController, ThrottleAndRestoreByPriority) {
+  LatencyControlParam param;
+  param.target_latency_ms = 50;
+  param.max_decode_interval = 4;
+  param.max_infer_interval = 2;
+  LatencyController controller(param, &throttles);
+  FrameDone(&controller, "lc_low", 1, 0, 100);
+  FrameDone(&controller, "lc_high", 2, 0, 100);
+
+  // late, the low priority stream is throttled infer first, then decode
+  controller.Step(0);
+  ExpectThrottle("lc_low", 1, 2);
+  ExpectThrottle("lc_high", 1, 1);
+  controller.Step(1.0f);
+  ExpectThrottle("lc_low", 2, 2);
+  controller.Step(1.0f);
+  ExpectThrottle("lc_low", 4, 2);
+  ExpectThrottle("lc_high", 1, 1);
+  // the low priority stream can not be throttled anymore
+  controller.Step(1.0f);
+  ExpectThrottle("lc_low", 4, 2);
+  ExpectThrottle("lc_high", 1, 2);
+
+  // neither late nor underloaded, nothing changes
+  controller.Step(0.7f);
+  ExpectThrottle("lc_low", 4, 2);
+  ExpectThrottle("lc_high", 1, 2);
+
+  // caught up, the high priority stream is restored first, decode first
+  FrameDone(&controller, "lc_low", 1, 0, 10);
+  FrameDone(&controller, "lc_high", 2, 0, 10);
+  controller.Step(0.1f);
+  ExpectThrottle("lc_low", 4, 2);
+  ExpectThrottle("lc_high", 1, 1);
+  controller.Step(0.1f);
+  ExpectThrottle("lc_low", 2, 2);
+  controller.Step(0.1f);
+  controller.Step(0.1f);
+  ExpectThrottle("lc_low", 1, 1);
+
+  // eos removes the throttle of the stream
+  controller.Step(1.0f);
+  ExpectThrottle("lc_low", 1, 2);
+  controller.OnFrameDone(CreateFrame("lc_low", true));
+  ExpectThrottle("lc_low", 1, 1);
+  controller.OnFrameDone(CreateFrame("lc_high", true));
+}
+
+TEST(CoreLatencyController, StreamThrottles) {
+  StreamThrottles stream_throttles;
+  StreamThrottle throttle;
+  throttle.decode_interval = 4;
+  throttle.infer_interval = 2;
+  stream_throttles.Set(GetMaxStreamNumber() - 1, throttle);
+  EXPECT_EQ(4u, stream_throttles.Get(GetMaxStreamNumber() - 1).decode_interval);
+  EXPECT_EQ(2u, stream_throttles.Get(GetMaxStreamNumber() - 1).infer_interval);
+  // streams not throttled and indexes out of range read factors of 1
+  EXPECT_EQ(1u, stream_throttles.Get(0).decode_interval);
+  stream_throttles.Set(INVALID_STREAM_IDX, throttle);
+  EXPECT_EQ(1u, stream_throttles.Get(INVALID_STREAM_IDX).infer_interval);
+  stream_throttles.Reset(GetMaxStreamNumber() - 1);
+  EXPECT_EQ(1u, stream_throttles.Get(GetMaxStreamNumber() - 1).decode_interval);
+  EXPECT_EQ(1u, stream_throttles.Get(GetMaxStreamNumber() - 1).infer_interval);
+}
+
+TEST(CoreLatencyController, DeadlineAsTarget) {
+  LatencyControlParam param;
+  param.target_latency_ms = 50;
+  LatencyController controller(param, &throttles);
+  // in time by the deadline of the stream though later than target_latency_ms
+  FrameDone(&controller, "lc_deadline", 1, 200, 100);
+  controller.Step(0);
+  ExpectThrottle("lc_deadline", 1, 1);
+  FrameDone(&controller, "lc_deadline", 1, 200, 300);
+  controller.Step(0);
+  ExpectThrottle("lc_deadline", 1, 2);
+  controller.OnFrameDone(CreateFrame("lc_deadline", true));
+  ExpectThrottle("lc_deadline", 1, 1);
+}
+
+}  // namespace cnstream
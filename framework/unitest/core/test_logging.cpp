@@ -0,0 +1,189 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+#include "gtest/gtest.h"
+
+#include "util/cnstream_queue.hpp"
+
+namespace cnstream {
+
+// The log file backend before per-thread buffers: every message is copied into a std::string and pushed into a
+// locked queue, a thread pops and fwrites them one by one.
+class QueueFileSink : public LogSink {
+ public:
+  explicit QueueFileSink(const std::string& path) {
+    file_ = fopen(path.c_str(), "w");
+    thread_ = std::thread([this]() {
+      std::string msg;
+      while (running_.load() || msgq_.Size()) {
+        if (msgq_.WaitAndTryPop(msg, std::chrono::microseconds(200))) fwrite(msg.data(), 1, msg.size(), file_);
+      }
+    });
+  }
+  ~QueueFileSink() {
+    running_.store(false);
+    thread_.join();
+    fclose(file_);
+  }
+  void Send(LogSeverity severity, const char* category, const char* filename, int line, const struct ::tm* tm_time,
+            int32_t usecs, const char* message, size_t message_len) override {
+    msgq_.Push(std::string(message, message_len) + '\n');
+  }
+
+ private:
+  FILE* file_ = nullptr;
+  ThreadSafeQueue<std::string> msgq_;
+  std::atomic<bool> running_{true};
+  std::thread thread_;
+};
+
+// Returns logging calls per second.
+static double LogFromThreads(int thread_num, int msg_num) {
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < thread_num; ++t) {
+    threads.emplace_back([t, msg_num]() {
+      for (int i = 0; i < msg_num; ++i) {
+        LOGI(COREUNITEST) << "logging benchmark thread " << t << " message " << i;
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  std::chrono::duration<double> dura = std::chrono::steady_clock::now() - start;
+  return thread_num * msg_num / dura.count();
+}
+
+static size_t CountLines(const std::string& path, const std::string& pattern) {
+  std::ifstream ifs(path);
+  std::string line;
+  size_t num = 0;
+  while (std::getline(ifs, line)) {
+    if (line.find(pattern) != std::string::npos) ++num;
+  }
+  return num;
+}
+
+static std::string FindLogFile(const std::string& dir) {
+  std::string path;
+  DIR* d = opendir(dir.c_str());
+  if (!d) return path;
+  while (struct dirent* entry = readdir(d)) {
+    if (strncmp(entry->d_name, "cnstream_", 9) == 0) path = dir + "/" + entry->d_name;
+  }
+  closedir(d);
+  return path;
+}
+
+static void RemoveDir(const std::string& dir) {
+  DIR* d = opendir(dir.c_str());
+  if (!d) return;
+  while (struct dirent* entry = readdir(d)) {
+    if (entry->d_name[0] != '.') unlink((dir + "/" + entry->d_name).c_str());
+  }
+  closedir(d);
+  rmdir(dir.c_str());
+}
+
+TEST(CoreLogging, LogFileThroughput) {
+  char dir_template[] = "/tmp/cnstream_logging_XXXXXX";
+  ASSERT_NE(mkdtemp(dir_template), nullptr);
+  const std::string dir = dir_template;
+  const bool log_to_stderr = FLAGS_log_to_stderr;
+  const bool log_to_file = FLAGS_log_to_file;
+  FLAGS_log_to_stderr = false;
+  const int thread_num = 4;
+  const int msg_num = 100000;
+
+  // current backend: per-thread buffers and writev
+  ShutdownCNStreamLogging();
+  FLAGS_log_to_file = true;
+  InitCNStreamLogging(dir.c_str());
+  double buffered = LogFromThreads(thread_num, msg_num);
+  uint64_t dropped = GetDroppedLogCount();
+  ShutdownCNStreamLogging();  // writes everything left
+  std::string log_file = FindLogFile(dir);
+  ASSERT_FALSE(log_file.empty());
+  size_t written = CountLines(log_file, "logging benchmark thread");
+  // every message is either in the file or counted
+  EXPECT_EQ(written + dropped, static_cast<uint64_t>(thread_num) * msg_num);
+  if (dropped) {
+    EXPECT_GT(CountLines(log_file, "log messages dropped"), 0u);
+  }
+
+  // emulated old backend, fed by the same formatting path through a sink
+  FLAGS_log_to_file = false;
+  InitCNStreamLogging(dir.c_str());
+  double queued;
+  {
+    QueueFileSink sink(dir + "/queue_backend.log");
+    AddLogSink(&sink);
+    queued = LogFromThreads(thread_num, msg_num);
+    RemoveLogSink(&sink);
+  }
+  ShutdownCNStreamLogging();
+  EXPECT_EQ(CountLines(dir + "/queue_backend.log", "logging benchmark thread"),
+            static_cast<size_t>(thread_num) * msg_num);
+
+  std::cout << "[CoreLogging] " << thread_num << " threads, per-thread buffers: " << buffered << " msgs/s, "
+            << dropped << " dropped; locked queue: " << queued << " msgs/s" << std::endl;
+
+  RemoveDir(dir);
+  FLAGS_log_to_stderr = log_to_stderr;
+  FLAGS_log_to_file = log_to_file;
+  InitCNStreamLogging(nullptr);
+}
+
+TEST(CoreLogging, LogFileAfterThreadExit) {
+  char dir_template[] = "/tmp/cnstream_logging_XXXXXX";
+  ASSERT_NE(mkdtemp(dir_template), nullptr);
+  const std::string dir = dir_template;
+  const bool log_to_stderr = FLAGS_log_to_stderr;
+  FLAGS_log_to_stderr = false;
+  ShutdownCNStreamLogging();
+  InitCNStreamLogging(dir.c_str());
+  // short-lived threads, their buffers are kept until written
+  for (int i = 0; i < 20; ++i) {
+    std::thread([i]() { LOGI(COREUNITEST) << "short-lived thread " << i; }).join();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  LOGI(COREUNITEST) << "short-lived thread main";
+  ShutdownCNStreamLogging();
+  EXPECT_EQ(CountLines(FindLogFile(dir), "short-lived thread"), 21u);
+  RemoveDir(dir);
+  FLAGS_log_to_stderr = log_to_stderr;
+  InitCNStreamLogging(nullptr);
+}
+
+}  // namespace cnstream
@@ -70,7 +70,7 @@ TEST(CoreModule, ModuleMask) {
   uint32_t seed = (uint32_t)time(0);
   const uint32_t mask_len = 32;
   TestModuleBase module;
-  uint64_t mask = 0;
+  IndexMask mask;
 
   ModuleParamSet params;
   ASSERT_TRUE(module.Open(params));
@@ -80,7 +80,7 @@ TEST(CoreModule, ModuleMask) {
   }
   std::vector<size_t> p_ids = module.GetParentIds();
   for (auto &id : p_ids) {
-    mask |= (uint64_t)1 << id;
+    mask.Set(id);
   }
   EXPECT_EQ(module.GetModulesMask(), mask);
   module.Close();
@@ -105,6 +105,40 @@ TEST(CoreModule, postevent) {
   pipe.Stop();
 }
 
+TEST(CoreModule, GetPerfManagerByFrame) {
+  Pipeline pipe("pipe");
+  std::shared_ptr<TestModuleBase> ptr(new (TestModuleBase));
+  ASSERT_TRUE(pipe.AddModule(ptr));
+  auto frame0 = CNFrameInfo::Create("0");
+  auto frame1 = CNFrameInfo::Create("1");
+  frame0->SetStreamIndex(0);
+  frame1->SetStreamIndex(1);
+  EXPECT_TRUE(ptr->GetPerfManager(frame0) == nullptr);
+
+  ASSERT_TRUE(pipe.CreatePerfManager({"0", "1"}, gTestPerfDir));
+  EXPECT_TRUE(ptr->GetPerfManager(frame0) != nullptr);
+  EXPECT_EQ(ptr->GetPerfManager(frame0), pipe.GetPerfManager("0"));
+  EXPECT_EQ(ptr->GetPerfManager(frame1), pipe.GetPerfManager("1"));
+  // the stream index is reused by another stream
+  auto frame2 = CNFrameInfo::Create("2");
+  frame2->SetStreamIndex(1);
+  EXPECT_TRUE(ptr->GetPerfManager(frame2) == nullptr);
+  EXPECT_EQ(ptr->GetPerfManager(frame1), pipe.GetPerfManager("1"));
+  // frames without a stream index
+  auto frame3 = CNFrameInfo::Create("0");
+  EXPECT_EQ(ptr->GetPerfManager(frame3), pipe.GetPerfManager("0"));
+
+  uint64_t generation = pipe.GetPerfGeneration();
+  EXPECT_TRUE(pipe.RemovePerfManager("1"));
+  EXPECT_NE(generation, pipe.GetPerfGeneration());
+  EXPECT_TRUE(ptr->GetPerfManager(frame1) == nullptr);
+  EXPECT_TRUE(ptr->GetPerfManager(frame0) != nullptr);
+  EXPECT_TRUE(pipe.AddPerfManager("1", gTestPerfDir));
+  EXPECT_EQ(ptr->GetPerfManager(frame1), pipe.GetPerfManager("1"));
+  EXPECT_TRUE(ptr->GetPerfManager(frame1) != nullptr);
+  pipe.Stop();
+}
+
 #if 0
 TEST(CoreModule, SetAndGetPerfManager) {
   Pipeline pipe("pipe");
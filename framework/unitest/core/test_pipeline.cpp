@@ -31,6 +31,7 @@
 #include <random>
 #include <set>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -627,6 +628,32 @@ TEST(CorePipeline, ProvideDataFailed) {
   EXPECT_FALSE(pipeline.ProvideData(module.get(), data));
 }
 
+TEST(CorePipeline, ProvideDataToDownNodes) {
+  Pipeline pipeline("test pipeline");
+  auto up_node = std::make_shared<TestModule>("up_node");
+  auto down_node = std::make_shared<TestModule>("down_node");
+  EXPECT_TRUE(pipeline.AddModule(up_node));
+  EXPECT_TRUE(pipeline.AddModule(down_node));
+  pipeline.SetModuleAttribute(up_node, 0);
+  // the graph is compiled again when the connector of down_node is replaced
+  pipeline.SetModuleAttribute(down_node, 2, 10);
+  std::string link_id = pipeline.LinkModules(up_node, down_node);
+  for (uint32_t i = 0; i < 3; i++) {
+    auto data = CNFrameInfo::Create(std::to_string(i));
+    data->SetStreamIndex(i);
+    EXPECT_TRUE(pipeline.ProvideData(up_node.get(), data));
+  }
+  LinkStatus status;
+  ASSERT_TRUE(pipeline.QueryLinkStatus(&status, link_id));
+  ASSERT_EQ(status.cache_size.size(), 2u);
+  EXPECT_EQ(status.cache_size[0], 2u);
+  EXPECT_EQ(status.cache_size[1], 1u);
+  // the last module transmits nothing
+  auto data = CNFrameInfo::Create("0");
+  data->SetStreamIndex(0);
+  EXPECT_TRUE(pipeline.ProvideData(down_node.get(), data));
+}
+
 TEST(CorePipeline, AddModule) {
   Pipeline pipeline("test pipeline");
 
@@ -885,6 +912,123 @@ TEST(CorePipeline, TransmitDataEosFrame) {
   EXPECT_NO_THROW(pipeline.TransmitData("up_node", data));
 }
 
+static constexpr int kBranchKey = 100;
+
+class TestBranchRecorder : public Module {
+ public:
+  explicit TestBranchRecorder(const std::string& name) : Module(name) {}
+  bool Open(ModuleParamSet param_set) override { return true; }
+  void Close() override {}
+  int Process(std::shared_ptr<CNFrameInfo> data) override {
+    {
+      SpinLockGuard guard(data->datas_lock_);
+      data->datas[kBranchKey] = GetName();
+    }
+    std::lock_guard<std::mutex> lk(mutex_);
+    frames_.push_back(data);
+    return 0;
+  }
+  std::vector<std::shared_ptr<CNFrameInfo>> GetFrames() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return frames_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<CNFrameInfo>> frames_;
+};  // class TestBranchRecorder
+
+static void ProvideBranchFrames(Pipeline* pipeline, Module* source, const std::vector<TestBranchRecorder*>& recorders,
+                                int frame_num) {
+  for (int i = 0; i < frame_num; ++i) {
+    auto data = CNFrameInfo::Create("branch_stream");
+    data->SetStreamIndex(0);
+    data->timestamp = i;
+    EXPECT_TRUE(pipeline->ProvideData(source, data));
+  }
+  for (int wait_ms = 0; wait_ms < 5000; wait_ms += 10) {
+    bool done = true;
+    for (auto recorder : recorders) done = done && static_cast<int>(recorder->GetFrames().size()) == frame_num;
+    if (done) break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+}
+
+TEST(CorePipeline, ForkFramesToBranches) {
+  /*
+    source ---- up_node ---- branch1
+                   |
+                    -------- branch2
+   */
+  Pipeline pipeline("test pipeline");
+  auto source = std::make_shared<TestModule>("source");
+  auto up_node = std::make_shared<TestModule>("up_node");
+  auto branch1 = std::make_shared<TestBranchRecorder>("branch1");
+  auto branch2 = std::make_shared<TestBranchRecorder>("branch2");
+  for (auto module : std::vector<std::shared_ptr<Module>>{source, up_node, branch1, branch2}) {
+    EXPECT_TRUE(pipeline.AddModule(module));
+    pipeline.SetModuleAttribute(module, module == source ? 0 : 1);
+  }
+  pipeline.LinkModules(source, up_node);
+  pipeline.LinkModules(up_node, branch1);
+  pipeline.LinkModules(up_node, branch2);
+  ASSERT_TRUE(pipeline.Start());
+  const int frame_num = 10;
+  ProvideBranchFrames(&pipeline, source.get(), {branch1.get(), branch2.get()}, frame_num);
+  pipeline.Stop();
+
+  auto frames1 = branch1->GetFrames();
+  auto frames2 = branch2->GetFrames();
+  ASSERT_EQ(frame_num, static_cast<int>(frames1.size()));
+  ASSERT_EQ(frame_num, static_cast<int>(frames2.size()));
+  for (int i = 0; i < frame_num; ++i) {
+    // each branch gets a fork, and does not see the datas replaced by the other
+    EXPECT_NE(frames1[i].get(), frames2[i].get());
+    EXPECT_EQ(frames1[i]->timestamp, frames2[i]->timestamp);
+    EXPECT_EQ("branch1", any_cast<std::string>(frames1[i]->datas[kBranchKey]));
+    EXPECT_EQ("branch2", any_cast<std::string>(frames2[i]->datas[kBranchKey]));
+  }
+}
+
+TEST(CorePipeline, ShareFramesWithJoinedBranches) {
+  /*
+    source ---- up_node ---- branch1 ----
+                   |                     |---- join_node
+                    -------- branch2 ----
+   */
+  Pipeline pipeline("test pipeline");
+  auto source = std::make_shared<TestModule>("source");
+  auto up_node = std::make_shared<TestModule>("up_node");
+  auto branch1 = std::make_shared<TestBranchRecorder>("branch1");
+  auto branch2 = std::make_shared<TestBranchRecorder>("branch2");
+  auto join_node = std::make_shared<TestBranchRecorder>("join_node");
+  for (auto module : std::vector<std::shared_ptr<Module>>{source, up_node, branch1, branch2, join_node}) {
+    EXPECT_TRUE(pipeline.AddModule(module));
+    pipeline.SetModuleAttribute(module, module == source ? 0 : 1);
+  }
+  pipeline.LinkModules(source, up_node);
+  pipeline.LinkModules(up_node, branch1);
+  pipeline.LinkModules(up_node, branch2);
+  pipeline.LinkModules(branch1, join_node);
+  pipeline.LinkModules(branch2, join_node);
+  ASSERT_TRUE(pipeline.Start());
+  const int frame_num = 10;
+  ProvideBranchFrames(&pipeline, source.get(), {join_node.get()}, frame_num);
+  pipeline.Stop();
+
+  auto frames1 = branch1->GetFrames();
+  auto frames2 = branch2->GetFrames();
+  auto joined = join_node->GetFrames();
+  ASSERT_EQ(frame_num, static_cast<int>(frames1.size()));
+  ASSERT_EQ(frame_num, static_cast<int>(frames2.size()));
+  ASSERT_EQ(frame_num, static_cast<int>(joined.size()));
+  for (int i = 0; i < frame_num; ++i) {
+    // branches meeting again share the frame
+    EXPECT_EQ(frames1[i].get(), frames2[i].get());
+    EXPECT_EQ(frames1[i].get(), joined[i].get());
+  }
+}
+
 TEST(CorePipelineDeathTest, TransmitDataFailed) {
   Pipeline pipeline("test pipeline");
   auto module = std::make_shared<TestModule>("test_module");
@@ -124,6 +124,48 @@ cv::Mat* CNDataFrame::ImageBGR() {
 }
 #endif
 
+std::shared_ptr<CNDataFrame> CNDataFrame::Fork(const std::shared_ptr<CNDataFrame>& frame) {
+  std::shared_ptr<CNDataFrame> fork = std::make_shared<CNDataFrame>();
+  fork->frame_id = frame->frame_id;
+  fork->fmt = frame->fmt;
+  fork->width = frame->width;
+  fork->height = frame->height;
+  fork->ctx = frame->ctx;
+  fork->dst_device_id = frame->dst_device_id;
+  for (int i = 0; i < CN_MAX_PLANES; ++i) {
+    fork->stride[i] = frame->stride[i];
+    fork->ptr_mlu[i] = frame->ptr_mlu[i];
+    fork->ptr_cpu[i] = frame->ptr_cpu[i];
+    fork->data[i] = frame->data[i];
+  }
+  fork->cpu_data = frame->cpu_data;
+  fork->mlu_data = frame->mlu_data;
+  fork->origin_ = frame->origin_ ? frame->origin_ : frame;
+#ifdef HAVE_OPENCV
+  std::lock_guard<std::mutex> lk(frame->mtx);
+  if (frame->bgr_mat) {
+    fork->bgr_mat = new (std::nothrow) cv::Mat(frame->bgr_mat->clone());
+    LOGF_IF(FRAME, nullptr == fork->bgr_mat) << "CNDataFrame::Fork() failed to alloc cv::Mat";
+  }
+#endif
+  return fork;
+}
+
+CNSyncedMemory* CNDataFrame::MutablePlane(int plane_idx) {
+  if (plane_idx < 0 || plane_idx >= CN_MAX_PLANES || !data[plane_idx]) return nullptr;
+  std::shared_ptr<CNSyncedMemory>& plane = data[plane_idx];
+  long owners = plane.use_count();  // NOLINT
+  // the origin holds the plane as well, but nobody else can reach it if it is held only by this frame
+  if (origin_ && origin_.use_count() == 1 && origin_->data[plane_idx] == plane) --owners;
+  if (owners > 1) {
+    std::shared_ptr<CNSyncedMemory> copy =
+        std::make_shared<CNSyncedMemory>(plane->GetSize(), plane->GetMluDevId(), plane->GetMluDdrChnId());
+    if (plane->GetSize()) memcpy(copy->GetMutableCpuData(), plane->GetCpuData(), plane->GetSize());
+    plane = copy;
+  }
+  return plane.get();
+}
+
 size_t CNDataFrame::GetPlaneBytes(int plane_idx) const {
   if (plane_idx < 0 || plane_idx >= GetPlanes()) return 0;
   switch (fmt) {
@@ -521,6 +563,11 @@ CNInferAttr CNInferObject::GetAttribute(const std::string& key) {
   return CNInferAttr();
 }
 
+std::vector<std::pair<std::string, CNInferAttr>> CNInferObject::GetAttributes() {
+  std::lock_guard<std::mutex> lk(attribute_mutex_);
+  return std::vector<std::pair<std::string, CNInferAttr>>(attributes_.begin(), attributes_.end());
+}
+
 bool CNInferObject::AddExtraAttribute(const std::string& key, const std::string& value) {
   std::lock_guard<std::mutex> lk(attribute_mutex_);
   if (extra_attributes_.find(key) != extra_attributes_.end()) return false;
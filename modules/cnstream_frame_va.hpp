@@ -219,7 +219,32 @@ class CNDataFrame : public NonCopyable {
  public:
   std::shared_ptr<void> cpu_data = nullptr;  ///< CPU data pointer.
   std::shared_ptr<void> mlu_data = nullptr;  ///< A pointer to the MLU data.
-  std::unique_ptr<CNSyncedMemory> data[CN_MAX_PLANES];  ///< Synchronizes data helper.
+  std::shared_ptr<CNSyncedMemory> data[CN_MAX_PLANES];  ///< Synchronizes data helper, may be shared by forks.
+
+  /**
+   * @brief Makes a frame sharing the planes of another one, see GetMutableCNDataFramePtr().
+   *
+   * The description (format, size, strides and device context) is copied and the planes are shared until written
+   * through MutablePlane(). The BGR image, if converted, is copied. The new frame keeps the original one alive, as the
+   * planes may point to memory it owns, e.g. decoder buffers.
+   *
+   * @param frame The frame to fork.
+   *
+   * @return Returns the new frame.
+   */
+  static std::shared_ptr<CNDataFrame> Fork(const std::shared_ptr<CNDataFrame>& frame);
+
+  /**
+   * @brief Gets a plane to write, copy-on-write.
+   *
+   * If the plane is shared with another frame, it is replaced by a copy owned by this frame first. The copy is made
+   * through the CPU, and the device context of the plane is kept.
+   *
+   * @param plane_idx The index of the plane.
+   *
+   * @return Returns the plane, nullptr if it does not exist.
+   */
+  CNSyncedMemory* MutablePlane(int plane_idx);
 
 #ifdef HAVE_OPENCV
   /**
@@ -280,6 +305,12 @@ class CNDataFrame : public NonCopyable {
    */
   void ReleaseSharedMem(MemMapType type, std::string stream_id);
 
+  /**
+   * @brief Checks whether the frame data is mapped from shared memory by MmapSharedMem().
+   * @return Returns true if the shared memory is mapped.
+   */
+  bool IsSharedMemMapped() const { return map_mem_ptr != nullptr; }
+
   void* mlu_mem_handle = nullptr;  ///< The MLU memory handle for MLU data.
 
  private:
@@ -288,6 +319,7 @@ class CNDataFrame : public NonCopyable {
   int shared_mem_fd = -1;          ///< A pointer to the shared memory file descriptor for CPU shared memory.
   int map_mem_fd = -1;             ///< A pointer to the mapped memory file descriptor for CPU mapped memory.
   std::mutex mtx;
+  std::shared_ptr<CNDataFrame> origin_ = nullptr;  ///< The frame the planes are forked from, kept alive by forks.
 };                                 // struct CNDataFrame
 
 /**
@@ -373,6 +405,15 @@ struct CNInferObject {
    */
   CNInferAttr GetAttribute(const std::string& key);
 
+  /**
+   * Gets all attributes of an object.
+   *
+   * @return Returns all attributes.
+   *
+   * @note This is a thread-safe function.
+   */
+  std::vector<std::pair<std::string, CNInferAttr>> GetAttributes();
+
   /**
    * Adds the key of the extended attribute to a specified object.
    *
@@ -523,6 +564,24 @@ CNDataFramePtr GetCNDataFramePtr(std::shared_ptr<CNFrameInfo> frameInfo) {
   return cnstream::any_cast<CNDataFramePtr>(frameInfo->datas[CNDataFramePtrKey]);
 }
 
+/**
+ * @brief Gets the data frame of a frame to write pixels to.
+ *
+ * If the data frame is shared with another frame, e.g. the frame of another branch of the pipeline, it is replaced by
+ * a fork first (see CNDataFrame::Fork()), so drawing on the BGR image does not affect the others. Write the planes
+ * through CNDataFrame::MutablePlane(), which copies a plane only if it is still shared.
+ */
+static inline
+CNDataFramePtr GetMutableCNDataFramePtr(std::shared_ptr<CNFrameInfo> frameInfo) {
+  CNDataFramePtr frame = GetCNDataFramePtr(frameInfo);
+  // owned by the datas and this copy only
+  if (!frame || frame.use_count() <= 2) return frame;
+  frame = CNDataFrame::Fork(frame);
+  SpinLockGuard guard(frameInfo->datas_lock_);
+  frameInfo->datas[CNDataFramePtrKey] = frame;
+  return frame;
+}
+
 static inline
 CNInferObjsPtr GetCNInferObjsPtr(std::shared_ptr<CNFrameInfo> frameInfo) {
   SpinLockGuard guard(frameInfo->datas_lock_);
@@ -0,0 +1,225 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnstream_object_table.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+constexpr int CNObjectTable::kNoTrackId;
+constexpr int CNObjectTable::kNone;
+
+void CNObjectTable::Clear() {
+  labels_.clear();
+  track_ids_.clear();
+  scores_.clear();
+  bboxes_.clear();
+  attr_heads_.clear();
+  extra_heads_.clear();
+  feature_heads_.clear();
+  attrs_.clear();
+  extras_.clear();
+  features_.clear();
+  chars_.clear();
+  floats_.clear();
+}
+
+void CNObjectTable::Reserve(size_t n) {
+  labels_.reserve(n);
+  track_ids_.reserve(n);
+  scores_.reserve(n);
+  bboxes_.reserve(n);
+  attr_heads_.reserve(n);
+  extra_heads_.reserve(n);
+  feature_heads_.reserve(n);
+}
+
+size_t CNObjectTable::Add(int label, float score, const CNInferBoundingBox& bbox, int track_id) {
+  labels_.push_back(label);
+  track_ids_.push_back(track_id);
+  scores_.push_back(score);
+  bboxes_.push_back(bbox);
+  attr_heads_.push_back(kNone);
+  extra_heads_.push_back(kNone);
+  feature_heads_.push_back(kNone);
+  return labels_.size() - 1;
+}
+
+int CNObjectTable::InternKey(const std::string& key) {
+  auto iter = key_indices_.find(key);
+  if (iter != key_indices_.end()) return iter->second;
+  keys_.push_back(key);
+  key_indices_.emplace(key, static_cast<int>(keys_.size() - 1));
+  return static_cast<int>(keys_.size() - 1);
+}
+
+int CNObjectTable::FindKey(const std::string& key) const {
+  auto iter = key_indices_.find(key);
+  return iter == key_indices_.end() ? kNone : iter->second;
+}
+
+int CNObjectTable::FindEntry(const std::vector<Entry>& entries, int head, int key) const {
+  for (int e = head; e != kNone; e = entries[e].next) {
+    if (entries[e].key == key) return e;
+  }
+  return kNone;
+}
+
+std::vector<int> CNObjectTable::Chain(const std::vector<Entry>& entries, int head) const {
+  std::vector<int> chain;
+  for (int e = head; e != kNone; e = entries[e].next) chain.push_back(e);
+  std::reverse(chain.begin(), chain.end());
+  return chain;
+}
+
+bool CNObjectTable::AddEntry(std::vector<Entry>* entries, std::vector<int>* heads, size_t i, int key, Entry* entry) {
+  int& head = (*heads)[i];
+  if (FindEntry(*entries, head, key) != kNone) return false;
+  entry->key = key;
+  entry->next = head;
+  entries->push_back(*entry);
+  head = static_cast<int>(entries->size() - 1);
+  return true;
+}
+
+bool CNObjectTable::AddAttribute(size_t i, const std::string& key, const CNInferAttr& value) {
+  Entry entry;
+  entry.attr = value;
+  entry.offset = entry.size = 0;
+  return AddEntry(&attrs_, &attr_heads_, i, InternKey(key), &entry);
+}
+
+CNInferAttr CNObjectTable::GetAttribute(size_t i, const std::string& key) const {
+  int e = FindEntry(attrs_, attr_heads_[i], FindKey(key));
+  return e == kNone ? CNInferAttr() : attrs_[e].attr;
+}
+
+std::vector<std::pair<std::string, CNInferAttr>> CNObjectTable::GetAttributes(size_t i) const {
+  std::vector<std::pair<std::string, CNInferAttr>> attributes;
+  for (int e : Chain(attrs_, attr_heads_[i])) attributes.emplace_back(keys_[attrs_[e].key], attrs_[e].attr);
+  return attributes;
+}
+
+bool CNObjectTable::AddExtraAttribute(size_t i, const std::string& key, const std::string& value) {
+  Entry entry;
+  entry.offset = chars_.size();
+  entry.size = value.size();
+  if (!AddEntry(&extras_, &extra_heads_, i, InternKey(key), &entry)) return false;
+  chars_.insert(chars_.end(), value.begin(), value.end());
+  return true;
+}
+
+std::string CNObjectTable::GetExtraAttribute(size_t i, const std::string& key) const {
+  int e = FindEntry(extras_, extra_heads_[i], FindKey(key));
+  if (e == kNone) return "";
+  return std::string(chars_.data() + extras_[e].offset, extras_[e].size);
+}
+
+StringPairs CNObjectTable::GetExtraAttributes(size_t i) const {
+  StringPairs attributes;
+  for (int e : Chain(extras_, extra_heads_[i])) {
+    attributes.emplace_back(keys_[extras_[e].key], std::string(chars_.data() + extras_[e].offset, extras_[e].size));
+  }
+  return attributes;
+}
+
+bool CNObjectTable::AddFeature(size_t i, const std::string& key, const float* data, size_t size) {
+  Entry entry;
+  entry.offset = floats_.size();
+  entry.size = size;
+  if (!AddEntry(&features_, &feature_heads_, i, InternKey(key), &entry)) return false;
+  floats_.insert(floats_.end(), data, data + size);
+  return true;
+}
+
+const float* CNObjectTable::GetFeature(size_t i, const std::string& key, size_t* size) const {
+  int e = FindEntry(features_, feature_heads_[i], FindKey(key));
+  if (e == kNone) {
+    *size = 0;
+    return nullptr;
+  }
+  *size = features_[e].size;
+  return floats_.data() + features_[e].offset;
+}
+
+CNInferFeatures CNObjectTable::GetFeatures(size_t i) const {
+  CNInferFeatures features;
+  for (int e : Chain(features_, feature_heads_[i])) {
+    const float* data = floats_.data() + features_[e].offset;
+    features.emplace_back(keys_[features_[e].key], CNInferFeature(data, data + features_[e].size));
+  }
+  return features;
+}
+
+void CNObjectTable::ToInferObjs(CNInferObjs* objs_holder) const {
+  std::vector<std::shared_ptr<CNInferObject>> objs;
+  objs.reserve(Size());
+  for (size_t i = 0; i < Size(); ++i) {
+    auto obj = std::make_shared<CNInferObject>();
+    obj->id = std::to_string(labels_[i]);
+    if (track_ids_[i] != kNoTrackId) obj->track_id = std::to_string(track_ids_[i]);
+    obj->score = scores_[i];
+    obj->bbox = bboxes_[i];
+    for (int e : Chain(attrs_, attr_heads_[i])) obj->AddAttribute(keys_[attrs_[e].key], attrs_[e].attr);
+    for (int e : Chain(extras_, extra_heads_[i])) {
+      obj->AddExtraAttribute(keys_[extras_[e].key], std::string(chars_.data() + extras_[e].offset, extras_[e].size));
+    }
+    for (int e : Chain(features_, feature_heads_[i])) {
+      const float* data = floats_.data() + features_[e].offset;
+      obj->AddFeature(keys_[features_[e].key], CNInferFeature(data, data + features_[e].size));
+    }
+    objs.push_back(std::move(obj));
+  }
+  std::lock_guard<std::mutex> lk(objs_holder->mutex_);
+  objs_holder->objs_.insert(objs_holder->objs_.end(), objs.begin(), objs.end());
+}
+
+static int ParseId(const std::string& id, int invalid) {
+  if (id.empty()) return invalid;
+  char* end = nullptr;
+  errno = 0;
+  long value = std::strtol(id.c_str(), &end, 10);  // NOLINT
+  if (*end != '\0' || errno == ERANGE || value < INT_MIN || value > INT_MAX) return invalid;
+  return static_cast<int>(value);
+}
+
+void CNObjectTable::FromInferObjs(CNInferObjs* objs_holder) {
+  std::lock_guard<std::mutex> lk(objs_holder->mutex_);
+  Reserve(Size() + objs_holder->objs_.size());
+  for (const auto& obj : objs_holder->objs_) {
+    size_t i = Add(ParseId(obj->id, -1), obj->score, obj->bbox, ParseId(obj->track_id, kNoTrackId));
+    for (const auto& attribute : obj->GetAttributes()) AddAttribute(i, attribute.first, attribute.second);
+    for (const auto& attribute : obj->GetExtraAttributes()) AddExtraAttribute(i, attribute.first, attribute.second);
+    for (const auto& feature : obj->GetFeatures()) {
+      AddFeature(i, feature.first, feature.second.data(), feature.second.size());
+    }
+  }
+}
+
+}  // namespace cnstream
@@ -0,0 +1,211 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNSTREAM_OBJECT_TABLE_HPP_
+#define CNSTREAM_OBJECT_TABLE_HPP_
+
+/**
+ *  \file cnstream_object_table.hpp
+ *
+ *  This file contains a declaration of CNObjectTable, a compact storage of the objects of a frame.
+ */
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief The objects of a frame stored column by column.
+ *
+ * Labels and track ids are integers, bounding boxes and scores are contiguous arrays, and attributes, extra
+ * attributes and features of all objects live in shared arenas, keyed by interned strings. Nothing is allocated per
+ * object, and Clear keeps all capacity, so a table reused across frames stops allocating.
+ *
+ * A frame may carry a table besides (or instead of) CNInferObjs, see CNObjectTablePtrKey. ToInferObjs and
+ * FromInferObjs convert between the two for modules working on CNInferObjs.
+ *
+ * @note Unlike CNInferObject, the methods are not thread-safe. Lock mutex_ if the table is shared by threads.
+ */
+class CNObjectTable : public NonCopyable {
+ public:
+  static constexpr int kNoTrackId = -1;
+
+  size_t Size() const { return labels_.size(); }
+  bool Empty() const { return labels_.empty(); }
+  /**
+   * @brief Removes all objects, keeping the capacity and the interned keys.
+   */
+  void Clear();
+  void Reserve(size_t n);
+
+  /**
+   * @brief Adds an object.
+   *
+   * @return Returns the index of the object.
+   */
+  size_t Add(int label, float score, const CNInferBoundingBox& bbox, int track_id = kNoTrackId);
+
+  int Label(size_t i) const { return labels_[i]; }
+  int TrackId(size_t i) const { return track_ids_[i]; }
+  float Score(size_t i) const { return scores_[i]; }
+  const CNInferBoundingBox& BBox(size_t i) const { return bboxes_[i]; }
+  void SetTrackId(size_t i, int track_id) { track_ids_[i] = track_id; }
+  void SetScore(size_t i, float score) { scores_[i] = score; }
+  void SetBBox(size_t i, const CNInferBoundingBox& bbox) { bboxes_[i] = bbox; }
+
+  /**
+   * @brief Columns of all objects, Size() elements each.
+   */
+  const int* Labels() const { return labels_.data(); }
+  const int* TrackIds() const { return track_ids_.data(); }
+  const float* Scores() const { return scores_.data(); }
+  const CNInferBoundingBox* BBoxes() const { return bboxes_.data(); }
+
+  /**
+   * @brief Adds an attribute to object i.
+   *
+   * @return Returns false if object i already has an attribute of the key.
+   */
+  bool AddAttribute(size_t i, const std::string& key, const CNInferAttr& value);
+  /**
+   * @brief Gets an attribute of object i. CNInferAttr::id is -1 if it does not exist.
+   */
+  CNInferAttr GetAttribute(size_t i, const std::string& key) const;
+  /**
+   * @brief Gets all attributes of object i, in the order they were added.
+   */
+  std::vector<std::pair<std::string, CNInferAttr>> GetAttributes(size_t i) const;
+
+  /**
+   * @brief Adds an extra attribute to object i.
+   *
+   * @return Returns false if object i already has an extra attribute of the key.
+   */
+  bool AddExtraAttribute(size_t i, const std::string& key, const std::string& value);
+  /**
+   * @brief Gets an extra attribute of object i, empty if it does not exist.
+   */
+  std::string GetExtraAttribute(size_t i, const std::string& key) const;
+  /**
+   * @brief Gets all extra attributes of object i, in the order they were added.
+   */
+  StringPairs GetExtraAttributes(size_t i) const;
+
+  /**
+   * @brief Adds a feature to object i, copying it into the arena.
+   *
+   * @return Returns false if object i already has a feature of the key.
+   */
+  bool AddFeature(size_t i, const std::string& key, const float* data, size_t size);
+  /**
+   * @brief Gets a feature of object i without copying it.
+   *
+   * @param i The object index.
+   * @param key The key of the feature.
+   * @param size Output size of the feature, 0 if it does not exist.
+   *
+   * @return Returns the feature in the arena, nullptr if it does not exist. It is valid until the next AddFeature or
+   *         Clear.
+   */
+  const float* GetFeature(size_t i, const std::string& key, size_t* size) const;
+  /**
+   * @brief Gets all features of object i, in the order they were added.
+   */
+  CNInferFeatures GetFeatures(size_t i) const;
+
+  /**
+   * @brief Appends all objects to objs_holder as CNInferObjects.
+   *
+   * The id of a CNInferObject is the label, its track_id is the track id, or empty if the object is not tracked.
+   */
+  void ToInferObjs(CNInferObjs* objs_holder) const;
+  /**
+   * @brief Appends the CNInferObjects of objs_holder.
+   *
+   * Ids and track ids that are not integers become -1 and kNoTrackId. User defined datas are not kept.
+   */
+  void FromInferObjs(CNInferObjs* objs_holder);
+
+  std::mutex mutex_;
+
+ private:
+  static constexpr int kNone = -1;
+
+  // An entry of an arena, entries of one object are chained from the newest to the oldest.
+  struct Entry {
+    int key;
+    int next;
+    CNInferAttr attr;  ///< Attributes only.
+    size_t offset;     ///< Extra attributes and features, the position in the arena.
+    size_t size;
+  };
+
+  int InternKey(const std::string& key);
+  int FindKey(const std::string& key) const;
+  // Index of the entry of key in a chain, kNone if not found.
+  int FindEntry(const std::vector<Entry>& entries, int head, int key) const;
+  // Entries of a chain in the order they were added.
+  std::vector<int> Chain(const std::vector<Entry>& entries, int head) const;
+  bool AddEntry(std::vector<Entry>* entries, std::vector<int>* heads, size_t i, int key, Entry* entry);
+
+  std::vector<int> labels_;
+  std::vector<int> track_ids_;
+  std::vector<float> scores_;
+  std::vector<CNInferBoundingBox> bboxes_;
+
+  std::vector<int> attr_heads_;
+  std::vector<int> extra_heads_;
+  std::vector<int> feature_heads_;
+  std::vector<Entry> attrs_;
+  std::vector<Entry> extras_;
+  std::vector<Entry> features_;
+  std::vector<char> chars_;
+  std::vector<float> floats_;
+
+  std::vector<std::string> keys_;
+  std::unordered_map<std::string, int> key_indices_;
+};  // class CNObjectTable
+
+static constexpr int CNObjectTablePtrKey = 3;
+using CNObjectTablePtr = std::shared_ptr<CNObjectTable>;
+
+/**
+ * @brief Gets the object table of a frame.
+ *
+ * @return Returns the table, nullptr if the frame does not have one.
+ */
+static inline
+CNObjectTablePtr GetCNObjectTablePtr(std::shared_ptr<CNFrameInfo> frameInfo) {
+  SpinLockGuard guard(frameInfo->datas_lock_);
+  auto iter = frameInfo->datas.find(CNObjectTablePtrKey);
+  if (iter == frameInfo->datas.end()) return nullptr;
+  return cnstream::any_cast<CNObjectTablePtr>(iter->second);
+}
+
+}  // namespace cnstream
+
+#endif  // CNSTREAM_OBJECT_TABLE_HPP_
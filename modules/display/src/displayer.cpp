@@ -91,7 +91,7 @@ int Displayer::Process(CNFrameInfoPtr data) {
     ud.chn_idx = data->GetStreamIndex();
     ud.stream_id = data->stream_id;
     ud.pts = data->timestamp;
-    ud.perf_manager = GetPerfManager(data->stream_id);
+    ud.perf_manager = GetPerfManager(data);
     player_->FeedData(ud);
   }
   return 0;
@@ -145,7 +145,7 @@ bool Displayer::CheckParamSet(const ModuleParamSet &paramSet) const {
 }
 
 void Displayer::RecordTime(std::shared_ptr<CNFrameInfo> data, bool is_finished) {
-  std::shared_ptr<PerfManager> manager = GetPerfManager(data->stream_id);
+  std::shared_ptr<PerfManager> manager = GetPerfManager(data);
   if (data->IsEos() || !manager) {
     return;
   }
@@ -208,7 +208,7 @@ EncodeContext *Encode::GetEncodeContext(CNFrameInfoPtr data) {
   if (param_->encoder_type == "cpu") {
     ctx->dst_image = cv::Mat(param_->dst_height, param_->dst_width, CV_8UC3);
   }
-  std::shared_ptr<PerfManager> manager = GetPerfManager(data->stream_id);
+  std::shared_ptr<PerfManager> manager = GetPerfManager(data);
   ctx->cnencode->SetPerfManager(manager);
   ctx->cnencode->SetModuleName(GetName());
   ctxs_[data->stream_id] = ctx;
@@ -535,7 +535,7 @@ bool Encode::CheckParamSet(const ModuleParamSet &paramSet) const {
 }
 
 void Encode::RecordTime(std::shared_ptr<CNFrameInfo> data, bool is_finished) {
-  std::shared_ptr<PerfManager> manager = GetPerfManager(data->stream_id);
+  std::shared_ptr<PerfManager> manager = GetPerfManager(data);
   if (!data->IsEos() && manager && !is_finished) {
     std::stringstream ss;
     ss << std::this_thread::get_id();
@@ -0,0 +1,157 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_INFERENCE_INCLUDE_DETECTION_POSTPROC_HPP_
+#define MODULES_INFERENCE_INCLUDE_DETECTION_POSTPROC_HPP_
+
+/**
+ *  \file detection_postproc.hpp
+ *
+ *  This file contains building blocks of detection postprocessing: decoding, score filtering and NMS.
+ */
+
+#include <cstddef>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+#include "cnstream_object_table.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief Detection boxes stored as a struct of arrays.
+ *
+ * Coordinates are normalized to [0, 1] of the model input. Boxes are decoded, filtered and suppressed in this form,
+ * and only the survivors are turned into CNInferObjects by AppendObjects. The arrays keep their capacity after
+ * Clear, so a buffer reused across frames stops allocating.
+ */
+struct DetectionBoxes {
+  std::vector<float> x1;
+  std::vector<float> y1;
+  std::vector<float> x2;
+  std::vector<float> y2;
+  std::vector<float> score;
+  std::vector<int> label;
+
+  size_t Size() const { return score.size(); }
+  void Clear();
+  void Reserve(size_t n);
+  void Add(float left, float top, float right, float bottom, float box_score, int box_label);
+  /**
+   * @brief Keeps the boxes at the given indices, in the given order.
+   */
+  void Keep(const std::vector<int>& indices);
+};
+
+/**
+ * @brief Computes the logistic function of n values, src and dst may be the same.
+ */
+void Sigmoid(const float* src, float* dst, size_t n);
+
+/**
+ * @brief Collects the indices of the values not less than threshold.
+ *
+ * @param values The values.
+ * @param n The number of values.
+ * @param threshold The threshold.
+ * @param indices Output indices, at least n elements.
+ *
+ * @return Returns the number of indices written.
+ */
+size_t CompactByThreshold(const float* values, size_t n, float threshold, int* indices);
+
+/**
+ * @brief Describes one output layer of a YOLOv3 like model.
+ *
+ * The layer data is NCHW, each anchor owning 5 + class_num planes of grid_h * grid_w values:
+ * x, y, w, h, objectness and class logits.
+ */
+struct YoloLayerParams {
+  int grid_w = 0;
+  int grid_h = 0;
+  int class_num = 0;
+  int input_w = 0;             ///< Width of the model input, the unit of the anchors.
+  int input_h = 0;             ///< Height of the model input, the unit of the anchors.
+  std::vector<float> anchors;  ///< Width and height of each anchor.
+};
+
+/**
+ * @brief Decodes the boxes of a YOLO layer whose score (objectness * class probability) is not less than threshold.
+ *
+ * Objectness of all cells is computed at once, and only cells passing the threshold are decoded further.
+ *
+ * @return Returns false if the layer parameters are invalid.
+ */
+bool DecodeYoloLayer(const float* data, const YoloLayerParams& layer, float threshold, DetectionBoxes* boxes);
+
+/**
+ * @brief Decodes the box list output by detection models with on-chip postprocessing (SSD, YOLOv3).
+ *
+ * data[0] holds the box number, boxes start from data[64] with 7 values each:
+ * batch index, label, score, left, top, right and bottom.
+ *
+ * @param data The model output.
+ * @param threshold Boxes with a lower score are dropped.
+ * @param label_offset Added to the labels, boxes with a negative label after it are dropped. Use -1 for SSD models
+ *                     whose label 0 is the background.
+ * @param boxes Output boxes, appended to.
+ */
+void DecodeBoxList(const float* data, float threshold, int label_offset, DetectionBoxes* boxes);
+
+/**
+ * @brief Greedy NMS. Boxes of different labels never suppress each other.
+ *
+ * Survivors are left in descending score order.
+ *
+ * @param boxes The boxes.
+ * @param iou_threshold Boxes overlapping a better box of the same label by more than this IoU are removed.
+ * @param max_output Keeps at most this number of boxes, no limit if not positive.
+ */
+void Nms(DetectionBoxes* boxes, float iou_threshold, int max_output = 0);
+
+/**
+ * @brief Matrix NMS, as in SOLOv2. Boxes of different labels never suppress each other.
+ *
+ * Instead of removing overlapped boxes one by one, the score of every box is decayed at once by its overlaps with
+ * better boxes, using a gaussian kernel if sigma is positive and a linear kernel otherwise. Survivors are left in
+ * descending score order, with decayed scores.
+ *
+ * @param boxes The boxes.
+ * @param sigma Sigma of the gaussian kernel.
+ * @param score_threshold Boxes whose decayed score is less than this are removed.
+ * @param max_output Keeps at most this number of boxes, no limit if not positive.
+ */
+void MatrixNms(DetectionBoxes* boxes, float sigma, float score_threshold, int max_output = 0);
+
+/**
+ * @brief Appends boxes to the objects of a frame, clipped to [0, 1]. Empty boxes are skipped.
+ *
+ * The object id is the label.
+ */
+void AppendObjects(const DetectionBoxes& boxes, CNInferObjs* objs_holder);
+
+/**
+ * @brief Appends boxes to the object table of a frame, the same way as above without creating CNInferObjects.
+ */
+void AppendObjects(const DetectionBoxes& boxes, CNObjectTable* table);
+
+}  // namespace cnstream
+
+#endif  // MODULES_INFERENCE_INCLUDE_DETECTION_POSTPROC_HPP_
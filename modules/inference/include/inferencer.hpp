@@ -55,6 +55,33 @@ class InferParamManager;
  */
 using CNFrameInfoPtr = std::shared_ptr<CNFrameInfo>;
 
+/**
+ * @brief Occupancy of an inference stage, summed up over the inference engines of an Inferencer.
+ *
+ * A task of a stage is pending from being submitted until it owns its io buffers, and running until it is done.
+ */
+struct InferStageOccupancy {
+  std::string stage;         ///< preprocess, resize_convert, h2d, infer, d2h or postprocess.
+  uint32_t pending = 0;      ///< Tasks waiting for their io buffers.
+  uint32_t running = 0;      ///< Tasks owning their io buffers.
+  uint32_t max_running = 0;  ///< The maximum of running ever reached by one engine.
+  uint64_t finished = 0;     ///< Tasks done.
+};
+
+/**
+ * @brief Frames of a stream not inferred by an Inferencer.
+ */
+struct InferSkipStats {
+  std::string stream_id;
+  uint64_t frames = 0;            ///< Frames received, the eos frame excluded.
+  uint64_t interval_skipped = 0;  ///< Frames skipped by infer_interval.
+  uint64_t motion_skipped = 0;    ///< Frames skipped by motion_threshold.
+  /**
+   * @brief Returns the fraction of the frames not inferred.
+   */
+  double SkipRatio() const { return frames ? static_cast<double>(interval_skipped + motion_skipped) / frames : 0; }
+};
+
 /**
  * @brief Inferencer is a module for running offline model inference.
  *
@@ -107,7 +134,22 @@ class Inferencer : public Module, public ModuleCreator<Inferencer> {
    *   batching_timeout: Optional. The batching timeout. The default value is 3000.0[ms]. type[float]. unit[ms].
    *   data_order: Optional. Data format. The default format is NHWC.
    *   threshold: Optional. The threshold of the confidence. By default it is 0.
-   *   infer_interval: Optional. Process one frame for every ``infer_interval`` frames.
+   *   infer_interval: Optional. Process one frame for every ``infer_interval`` frames of each stream. It is
+                       multiplied by the infer interval of the stream throttle (see LatencyController).
+   *   propagate_objects: Optional. Whether to carry the objects of the latest inferred frame onto the frames skipped
+                          by ``infer_interval``, moved by the velocity estimated from the latest two inferred frames.
+                          Not valid when object_infer is true. False by default.
+   *   motion_threshold: Optional. A frame is not inferred if less than this fraction of the regions of interest
+                         has changed since the latest inferred frame of the stream, compared on a downscaled luma
+                         image of NV12, NV21, BGR24 or RGB24 frames. Such frames are handled like the frames skipped
+                         by ``infer_interval``. Not valid when object_infer is true. 0 by default, all frames are
+                         inferred.
+   *   motion_max_skip: Optional. The maximum number of frames skipped in a row by ``motion_threshold``. 25 by
+                        default.
+   *   roi: Optional. A JSON object mapping stream ids to regions of interest, each an array of polygons of normalized
+            [x, y] points. Streams not listed use the regions of "*". Only the changes inside the regions count for
+            ``motion_threshold``, and inferred objects whose center is outside are dropped. Not valid when
+            object_infer is true. e.g., {"*": [[[0, 0.5], [1, 0.5], [1, 1], [0, 1]]]}.
    *   show_stats: Optional. Whether show inferencer performance statistics. It will not be shown by default.
    *   stats_db_name: Required when show_stats is set to ``true``. The directory to store the db file.
                       e.g., ``dir1/dir2/detect.db``.
@@ -122,6 +164,9 @@ class Inferencer : public Module, public ModuleCreator<Inferencer> {
    *   mem_on_mlu_for_postproc: Optional. Pass a batch mlu pointer directly to post-processing function without
                                 making d2h copies. see `Postproc` for details.
    *   saving_infer_input: Optional. Save the data close to inferencing.
+   *   io_depth: Optional. The number of io buffers of each kind (cpu input, mlu input, mlu output and cpu output).
+                 With more than one buffer, the next batch is preprocessed while the former ones are being copied,
+                 run or postprocessed. 1 by default.
    * 
    * @endverbatim
    *
@@ -153,6 +198,23 @@ class Inferencer : public Module, public ModuleCreator<Inferencer> {
    */
   bool CheckParamSet(const ModuleParamSet &param_set) const override;
 
+  /**
+   * @brief Gets the occupancy of each inference stage. With io_depth greater than 1, several batches may be running
+   * in different stages at the same time.
+   *
+   * @return Returns the stages in processing order. It is empty if the inferencer is not opened or has not received
+   *         any frame.
+   */
+  std::vector<InferStageOccupancy> GetStageOccupancy() const;
+
+  /**
+   * @brief Gets the number of frames skipped by infer_interval and motion_threshold of each stream. The statistics of
+   * a stream are logged and dropped when its eos frame arrives.
+   *
+   * @return Returns the statistics of the streams received and not ended yet.
+   */
+  std::vector<InferSkipStats> GetSkipStats() const;
+
  private:
   InferParamManager *param_manager_ = nullptr;
   DECLARE_PRIVATE(d_ptr_, Inferencer);
@@ -29,6 +29,7 @@
 
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -62,6 +63,15 @@ class Preproc : virtual public ReflexObjectEx<Preproc> {
    */
   static Preproc* Create(const std::string& proc_name);
 
+  /**
+   * @brief Initialize preprocessing parameters
+   *
+   * @param params: parameters set by custom_preproc_params of the inferencer
+   *
+   * @return return 0 if succeed
+   */
+  virtual int Init(const std::unordered_map<std::string, std::string>& params) { return 0; }
+
   /**
    * @brief Execute preproc on neural network inputs
    *
@@ -93,6 +103,15 @@ class ObjPreproc : virtual public ReflexObjectEx<ObjPreproc> {
    */
   static ObjPreproc* Create(const std::string& proc_name);
 
+  /**
+   * @brief Initialize preprocessing parameters
+   *
+   * @param params: parameters set by custom_preproc_params of the inferencer
+   *
+   * @return return 0 if succeed
+   */
+  virtual int Init(const std::unordered_map<std::string, std::string>& params) { return 0; }
+
   /**
    * @brief Execute preproc on neural network inputs
    *
@@ -105,6 +124,22 @@ class ObjPreproc : virtual public ReflexObjectEx<ObjPreproc> {
    */
   virtual int Execute(const std::vector<float*>& net_inputs, const std::shared_ptr<edk::ModelLoader>& model,
                       const CNFrameInfoPtr& finfo, const std::shared_ptr<CNInferObject>& pobj) = 0;
+
+  /**
+   * @brief Execute preproc on neural network inputs of several objects of one frame
+   *
+   * @param net_inputs: neural network inputs of each object
+   * @param model: model information(you can get input shape and output shape from model)
+   * @param finfo: smart pointer of struct to store origin frame data
+   * @param objs: object infomations
+   *
+   * @return return 0 if succeed
+   *
+   * @note Calls Execute for each object by default. Override it to process the objects together.
+   */
+  virtual int ExecuteBatch(const std::vector<std::vector<float*>>& net_inputs,
+                           const std::shared_ptr<edk::ModelLoader>& model, const CNFrameInfoPtr& finfo,
+                           const std::vector<std::shared_ptr<CNInferObject>>& objs);
 };  // class ObjPreproc
 
 }  // namespace cnstream
@@ -35,6 +35,7 @@
 #include "infer_task.hpp"
 #include "postproc.hpp"
 #include "queuing_server.hpp"
+#include "stage_occupancy.hpp"
 
 #include "batching_done_stage.hpp"
 #include "cnstream_frame_va.hpp"
@@ -45,20 +46,21 @@ namespace cnstream {
 std::vector<std::shared_ptr<InferTask>> H2DBatchingDoneStage::BatchingDone(const BatchingDoneInput& finfos) {
   std::vector<InferTaskSptr> tasks;
   InferTaskSptr task;
-  QueuingTicket cpu_input_res_ticket = cpu_input_res_->PickUpNewTicket();
-  QueuingTicket mlu_input_res_ticket = mlu_input_res_->PickUpNewTicket();
+  IOResTicket cpu_input_res_ticket = cpu_input_res_->PickUpNewTicket();
+  IOResTicket mlu_input_res_ticket = mlu_input_res_->PickUpNewTicket();
   task = std::make_shared<InferTask>([cpu_input_res_ticket, mlu_input_res_ticket, this, finfos]() -> int {
-    QueuingTicket cir_ticket = cpu_input_res_ticket;
-    QueuingTicket mir_ticket = mlu_input_res_ticket;
+    IOResTicket cir_ticket = cpu_input_res_ticket;
+    IOResTicket mir_ticket = mlu_input_res_ticket;
     IOResValue cpu_value = this->cpu_input_res_->WaitResourceByTicket(&cir_ticket);
     IOResValue mlu_value = this->mlu_input_res_->WaitResourceByTicket(&mir_ticket);
+    StageOccupancy::Running running(this->occupancy_.get());
     edk::MluMemoryOp mem_op;
     mem_op.SetLoader(this->model_);
 
     mem_op.MemcpyInputH2D(mlu_value.ptrs, cpu_value.ptrs);
 
-    this->cpu_input_res_->DeallingDone();
-    this->mlu_input_res_->DeallingDone();
+    this->cpu_input_res_->DeallingDone(cir_ticket);
+    this->mlu_input_res_->DeallingDone(mir_ticket);
     return 0;
   });
   tasks.push_back(task);
@@ -69,12 +71,13 @@ std::vector<std::shared_ptr<InferTask>> ResizeConvertBatchingDoneStage::Batching
   std::vector<InferTaskSptr> tasks;
   InferTaskSptr task;
   QueuingTicket rcop_res_ticket = rcop_res_->PickUpNewTicket();
-  QueuingTicket mlu_input_res_ticket = mlu_input_res_->PickUpNewTicket();
+  IOResTicket mlu_input_res_ticket = mlu_input_res_->PickUpNewTicket();
   task = std::make_shared<InferTask>([rcop_res_ticket, mlu_input_res_ticket, this, finfos]() -> int {
     QueuingTicket rcopr_ticket = rcop_res_ticket;
-    QueuingTicket mir_tickett = mlu_input_res_ticket;
+    IOResTicket mir_tickett = mlu_input_res_ticket;
     std::shared_ptr<RCOpValue> rcop_value = this->rcop_res_->WaitResourceByTicket(&rcopr_ticket);
     IOResValue mlu_value = this->mlu_input_res_->WaitResourceByTicket(&mir_tickett);
+    StageOccupancy::Running running(this->occupancy_.get());
     CHECK_EQ(mlu_value.datas.size(), 1) << "Internal error, maybe model input num not 1";
 
     std::shared_ptr<CNFrameInfo> info = nullptr;
@@ -84,7 +87,7 @@ std::vector<std::shared_ptr<InferTask>> ResizeConvertBatchingDoneStage::Batching
       info = finfos.back().first;
       if (!info->IsEos()) {
         CNDataFramePtr frame = cnstream::GetCNDataFramePtr(info);;
-        pts_str = std::to_string(frame->frame_id * 100 + info->GetStreamIndex());
+        pts_str = std::to_string(frame->frame_id * GetMaxStreamNumber() + info->GetStreamIndex());
         perf_manager_->Record(perf_type_, PerfManager::GetPrimaryKey(), pts_str, "resize_start_time");
         perf_manager_->Record(perf_type_, PerfManager::GetPrimaryKey(), pts_str, "resize_cnt",
                               std::to_string(finfos.size()));
@@ -100,7 +103,7 @@ std::vector<std::shared_ptr<InferTask>> ResizeConvertBatchingDoneStage::Batching
     }
 
     this->rcop_res_->DeallingDone();
-    this->mlu_input_res_->DeallingDone();
+    this->mlu_input_res_->DeallingDone(mir_tickett);
 
     if (!ret) {
       throw CnstreamError("resize convert failed.");
@@ -133,13 +136,14 @@ std::shared_ptr<edk::MluTaskQueue> InferBatchingDoneStage::SharedMluQueue() cons
 std::vector<std::shared_ptr<InferTask>> InferBatchingDoneStage::BatchingDone(const BatchingDoneInput& finfos) {
   std::vector<InferTaskSptr> tasks;
   InferTaskSptr task;
-  QueuingTicket mlu_input_res_ticket = mlu_input_res_->PickUpNewTicket();
-  QueuingTicket mlu_output_res_ticket = mlu_output_res_->PickUpNewTicket();
+  IOResTicket mlu_input_res_ticket = mlu_input_res_->PickUpNewTicket();
+  IOResTicket mlu_output_res_ticket = mlu_output_res_->PickUpNewTicket();
   task = std::make_shared<InferTask>([mlu_input_res_ticket, mlu_output_res_ticket, this, finfos]() -> int {
-    QueuingTicket mir_ticket = mlu_input_res_ticket;
-    QueuingTicket mor_ticket = mlu_output_res_ticket;
+    IOResTicket mir_ticket = mlu_input_res_ticket;
+    IOResTicket mor_ticket = mlu_output_res_ticket;
     IOResValue mlu_input_value = this->mlu_input_res_->WaitResourceByTicket(&mir_ticket);
     IOResValue mlu_output_value = this->mlu_output_res_->WaitResourceByTicket(&mor_ticket);
+    StageOccupancy::Running running(this->occupancy_.get());
 
     std::shared_ptr<CNFrameInfo> info = nullptr;
     std::string pts_str;
@@ -147,7 +151,7 @@ std::vector<std::shared_ptr<InferTask>> InferBatchingDoneStage::BatchingDone(con
       info = finfos.back().first;
       if (!info->IsEos()) {
         CNDataFramePtr frame = cnstream::GetCNDataFramePtr(info);
-        pts_str = std::to_string(frame->frame_id * 100 + info->GetStreamIndex());
+        pts_str = std::to_string(frame->frame_id * GetMaxStreamNumber() + info->GetStreamIndex());
         perf_manager_->Record(perf_type_, PerfManager::GetPrimaryKey(), pts_str, "infer_start_time");
         perf_manager_->Record(perf_type_, PerfManager::GetPrimaryKey(), pts_str, "infer_cnt",
                               std::to_string(finfos.size()));
@@ -209,7 +213,10 @@ std::vector<std::shared_ptr<InferTask>> InferBatchingDoneStage::BatchingDone(con
         }
       }
     }
-    this->easyinfer_->Run(mlu_input_value.ptrs, mlu_output_value.ptrs);
+    {
+      std::lock_guard<std::mutex> lk(run_mtx_);
+      this->easyinfer_->Run(mlu_input_value.ptrs, mlu_output_value.ptrs);
+    }
 
     if (saving_infer_input_) {
       int frame_num = finfos.size();
@@ -263,8 +270,8 @@ std::vector<std::shared_ptr<InferTask>> InferBatchingDoneStage::BatchingDone(con
       perf_manager_->Record(perf_type_, PerfManager::GetPrimaryKey(), pts_str, "infer_end_time");
     }
 
-    this->mlu_input_res_->DeallingDone();
-    this->mlu_output_res_->DeallingDone();
+    this->mlu_input_res_->DeallingDone(mir_ticket);
+    this->mlu_output_res_->DeallingDone(mor_ticket);
 
     return 0;
   });
@@ -275,13 +282,14 @@ std::vector<std::shared_ptr<InferTask>> InferBatchingDoneStage::BatchingDone(con
 std::vector<std::shared_ptr<InferTask>> D2HBatchingDoneStage::BatchingDone(const BatchingDoneInput& finfos) {
   std::vector<InferTaskSptr> tasks;
   InferTaskSptr task;
-  QueuingTicket mlu_output_res_ticket = mlu_output_res_->PickUpNewTicket();
-  QueuingTicket cpu_output_res_ticket = cpu_output_res_->PickUpNewTicket();
+  IOResTicket mlu_output_res_ticket = mlu_output_res_->PickUpNewTicket();
+  IOResTicket cpu_output_res_ticket = cpu_output_res_->PickUpNewTicket();
   task = std::make_shared<InferTask>([mlu_output_res_ticket, cpu_output_res_ticket, this]() -> int {
-    QueuingTicket mor_ticket = mlu_output_res_ticket;
-    QueuingTicket cor_ticket = cpu_output_res_ticket;
+    IOResTicket mor_ticket = mlu_output_res_ticket;
+    IOResTicket cor_ticket = cpu_output_res_ticket;
     IOResValue mlu_output_value = this->mlu_output_res_->WaitResourceByTicket(&mor_ticket);
     IOResValue cpu_output_value = this->cpu_output_res_->WaitResourceByTicket(&cor_ticket);
+    StageOccupancy::Running running(this->occupancy_.get());
     edk::MluMemoryOp mem_op;
     mem_op.SetLoader(this->model_);
 #if defined(CNS_MLU270) || defined(CNS_MLU220_SOC)
@@ -289,8 +297,8 @@ std::vector<std::shared_ptr<InferTask>> D2HBatchingDoneStage::BatchingDone(const
 #else
     #error "Platform not supported yet";
 #endif
-    this->mlu_output_res_->DeallingDone();
-    this->cpu_output_res_->DeallingDone();
+    this->mlu_output_res_->DeallingDone(mor_ticket);
+    this->cpu_output_res_->DeallingDone(cor_ticket);
     return 0;
   });
   tasks.push_back(task);
@@ -315,7 +323,7 @@ std::vector<std::shared_ptr<InferTask>> PostprocessingBatchingDoneStage::Batchin
   std::vector<InferTaskSptr> tasks;
   for (int bidx = 0; bidx < static_cast<int>(finfos.size()); ++bidx) {
     auto finfo = finfos[bidx];
-    QueuingTicket cpu_output_res_ticket;
+    IOResTicket cpu_output_res_ticket;
     if (0 == bidx) {
       cpu_output_res_ticket = cpu_output_res->PickUpNewTicket(true);
     } else {
@@ -326,8 +334,9 @@ std::vector<std::shared_ptr<InferTask>> PostprocessingBatchingDoneStage::Batchin
                                                       this,
                                                       finfo,
                                                       bidx]() -> int {
-      QueuingTicket cor_ticket = cpu_output_res_ticket;
+      IOResTicket cor_ticket = cpu_output_res_ticket;
       IOResValue cpu_output_value = cpu_output_res->WaitResourceByTicket(&cor_ticket);
+      StageOccupancy::Running running(this->occupancy_.get());
       std::vector<float*> net_outputs;
       for (size_t output_idx = 0; output_idx < cpu_output_value.datas.size(); ++output_idx) {
         net_outputs.push_back(reinterpret_cast<float*>(cpu_output_value.datas[output_idx].Offset(bidx)));
@@ -335,7 +344,7 @@ std::vector<std::shared_ptr<InferTask>> PostprocessingBatchingDoneStage::Batchin
       if (!cnstream::IsStreamRemoved(finfo.first->stream_id)) {
         this->postprocessor_->Execute(net_outputs, this->model_, finfo.first);
       }
-      cpu_output_res->DeallingDone();
+      cpu_output_res->DeallingDone(cor_ticket);
       return 0;
     });
     tasks.push_back(task);
@@ -346,15 +355,16 @@ std::vector<std::shared_ptr<InferTask>> PostprocessingBatchingDoneStage::Batchin
 std::vector<std::shared_ptr<InferTask>> PostprocessingBatchingDoneStage::BatchingDone(
     const BatchingDoneInput& finfos,
     const std::shared_ptr<MluOutputResource> &mlu_output_res) {
-  QueuingTicket mlu_output_res_ticket = mlu_output_res->PickUpNewTicket(false);
+  IOResTicket mlu_output_res_ticket = mlu_output_res->PickUpNewTicket(false);
 
   std::vector<InferTaskSptr> tasks;
   InferTaskSptr task = std::make_shared<InferTask>([mlu_output_res_ticket,
                                                     mlu_output_res,
                                                     this,
                                                     finfos]() -> int {
-    QueuingTicket mor_ticket = mlu_output_res_ticket;
+    IOResTicket mor_ticket = mlu_output_res_ticket;
     IOResValue mlu_output_value = mlu_output_res->WaitResourceByTicket(&mor_ticket);
+    StageOccupancy::Running running(this->occupancy_.get());
     std::vector<void*> net_outputs;
     for (size_t output_idx = 0; output_idx < mlu_output_value.datas.size(); ++output_idx) {
       net_outputs.push_back(mlu_output_value.datas[output_idx].ptr);
@@ -364,7 +374,7 @@ std::vector<std::shared_ptr<InferTask>> PostprocessingBatchingDoneStage::Batchin
     for (const auto &it : finfos) batched_finfos.push_back(it.first);
 
     this->postprocessor_->Execute(net_outputs, this->model_, batched_finfos);
-    mlu_output_res->DeallingDone();
+    mlu_output_res->DeallingDone(mor_ticket);
     return 0;
   });
   tasks.push_back(task);
@@ -392,7 +402,7 @@ std::vector<std::shared_ptr<InferTask>> ObjPostprocessingBatchingDoneStage::ObjB
   for (int bidx = 0; bidx < static_cast<int>(finfos.size()); ++bidx) {
     auto finfo = finfos[bidx];
     auto obj = objs[bidx];
-    QueuingTicket cpu_output_res_ticket;
+    IOResTicket cpu_output_res_ticket;
     if (0 == bidx) {
       cpu_output_res_ticket = cpu_output_res_->PickUpNewTicket(true);
     } else {
@@ -404,8 +414,9 @@ std::vector<std::shared_ptr<InferTask>> ObjPostprocessingBatchingDoneStage::ObjB
                                                       finfo,
                                                       obj,
                                                       bidx]() -> int {
-      QueuingTicket cor_ticket = cpu_output_res_ticket;
+      IOResTicket cor_ticket = cpu_output_res_ticket;
       IOResValue cpu_output_value = cpu_output_res->WaitResourceByTicket(&cor_ticket);
+      StageOccupancy::Running running(this->occupancy_.get());
       std::vector<float*> net_outputs;
       for (size_t output_idx = 0; output_idx < cpu_output_value.datas.size(); ++output_idx) {
         net_outputs.push_back(reinterpret_cast<float*>(cpu_output_value.datas[output_idx].Offset(bidx)));
@@ -413,7 +424,7 @@ std::vector<std::shared_ptr<InferTask>> ObjPostprocessingBatchingDoneStage::ObjB
       if (!cnstream::IsStreamRemoved(finfo.first->stream_id)) {
         this->postprocessor_->Execute(net_outputs, this->model_, finfo.first, obj);
       }
-      cpu_output_res->DeallingDone();
+      cpu_output_res->DeallingDone(cor_ticket);
       return 0;
     });
     tasks.push_back(task);
@@ -426,14 +437,15 @@ std::vector<std::shared_ptr<InferTask>> ObjPostprocessingBatchingDoneStage::ObjB
     const std::vector<std::shared_ptr<CNInferObject>>& objs,
     const std::shared_ptr<MluOutputResource> &mlu_output_res) {
   std::vector<InferTaskSptr> tasks;
-  QueuingTicket mlu_output_res_ticket = mlu_output_res_->PickUpNewTicket(false);
+  IOResTicket mlu_output_res_ticket = mlu_output_res_->PickUpNewTicket(false);
   InferTaskSptr task = std::make_shared<InferTask>([mlu_output_res_ticket,
                                                     mlu_output_res,
                                                     this,
                                                     finfos,
                                                     objs]() -> int {
-    QueuingTicket mor_ticket = mlu_output_res_ticket;
+    IOResTicket mor_ticket = mlu_output_res_ticket;
     IOResValue mlu_output_value = mlu_output_res->WaitResourceByTicket(&mor_ticket);
+    StageOccupancy::Running running(this->occupancy_.get());
     std::vector<void*> net_outputs;
     for (size_t output_idx = 0; output_idx < mlu_output_value.datas.size(); ++output_idx) {
       net_outputs.push_back(mlu_output_value.datas[output_idx].ptr);
@@ -447,7 +459,7 @@ std::vector<std::shared_ptr<InferTask>> ObjPostprocessingBatchingDoneStage::ObjB
     }
 
     this->postprocessor_->Execute(net_outputs, this->model_, batched_objs);
-    mlu_output_res->DeallingDone();
+    mlu_output_res->DeallingDone(mor_ticket);
     return 0;
   });
   tasks.push_back(task);
@@ -23,6 +23,7 @@
 
 #include <future>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -48,6 +49,7 @@ class CNFrameInfo;
 struct CNInferObject;
 class FrameInfoResource;
 class PerfManager;
+class StageOccupancy;
 
 struct AutoSetDone {
   explicit AutoSetDone(const std::shared_ptr<std::promise<void>>& p) : p_(p) {}
@@ -78,6 +80,9 @@ class BatchingDoneStage {
     module_name_ = module_name;
   }
 
+  void SetOccupancy(std::shared_ptr<StageOccupancy> occupancy) { occupancy_ = occupancy; }
+  std::shared_ptr<StageOccupancy> Occupancy() const { return occupancy_; }
+
  protected:
   std::shared_ptr<edk::ModelLoader> model_;
   uint32_t batchsize_ = 0;
@@ -87,6 +92,7 @@ class BatchingDoneStage {
   std::shared_ptr<PerfManager> perf_manager_ = nullptr;
   std::string perf_type_;
   std::string module_name_ = "";
+  std::shared_ptr<StageOccupancy> occupancy_ = nullptr;
 };  // class BatchingDoneStage
 
 class H2DBatchingDoneStage : public BatchingDoneStage {
@@ -134,6 +140,8 @@ class InferBatchingDoneStage : public BatchingDoneStage {
   std::shared_ptr<MluInputResource> mlu_input_res_;
   std::shared_ptr<MluOutputResource> mlu_output_res_;
   std::shared_ptr<edk::EasyInfer> easyinfer_;
+  // batches on different io slots may be ready at the same time, they share one easyinfer.
+  std::mutex run_mtx_;
 };  // class InferBatchingDoneStage
 
 class D2HBatchingDoneStage : public BatchingDoneStage {
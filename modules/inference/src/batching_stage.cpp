@@ -29,6 +29,7 @@
 #include "infer_resource.hpp"
 #include "infer_task.hpp"
 #include "preproc.hpp"
+#include "stage_occupancy.hpp"
 
 namespace cnstream {
 
@@ -41,13 +42,14 @@ std::shared_ptr<InferTask> IOBatchingStage::Batching(std::shared_ptr<CNFrameInfo
     // in one batch, reserve resource ticket to parallel.
     reserve_ticket = true;
   }
-  QueuingTicket ticket = output_res_->PickUpTicket(reserve_ticket);
+  IOResTicket ticket = output_res_->PickUpTicket(reserve_ticket);
   auto bidx = batch_idx_;
   std::shared_ptr<InferTask> task = std::make_shared<InferTask>([this, ticket, finfo, bidx]() -> int {
-    QueuingTicket t = ticket;
+    IOResTicket t = ticket;
     IOResValue value = this->output_res_->WaitResourceByTicket(&t);
+    StageOccupancy::Running running(this->occupancy_.get());
     this->ProcessOneFrame(finfo, bidx, value);
-    this->output_res_->DeallingDone();
+    this->output_res_->DeallingDone(t);
     return 0;
   });
   task->task_msg = "infer task.";
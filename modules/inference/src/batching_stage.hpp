@@ -37,6 +37,7 @@ class MluInputResource;
 class CpuInputResource;
 class RCOpResource;
 class Preproc;
+class StageOccupancy;
 
 class BatchingStage {
  public:
@@ -44,10 +45,12 @@ class BatchingStage {
   virtual ~BatchingStage() {}
   virtual std::shared_ptr<InferTask> Batching(std::shared_ptr<CNFrameInfo> finfo) = 0;
   virtual void Reset() {}
+  void SetOccupancy(std::shared_ptr<StageOccupancy> occupancy) { occupancy_ = occupancy; }
 
  protected:
   std::shared_ptr<edk::ModelLoader> model_;
   uint32_t batchsize_ = 0;
+  std::shared_ptr<StageOccupancy> occupancy_ = nullptr;
 };  // class BatchingStage
 
 class IOBatchingStage : public BatchingStage {
@@ -0,0 +1,444 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "detection_postproc.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define POSTPROC_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define POSTPROC_NEON
+#endif
+
+namespace cnstream {
+
+void DetectionBoxes::Clear() {
+  x1.clear();
+  y1.clear();
+  x2.clear();
+  y2.clear();
+  score.clear();
+  label.clear();
+}
+
+void DetectionBoxes::Reserve(size_t n) {
+  x1.reserve(n);
+  y1.reserve(n);
+  x2.reserve(n);
+  y2.reserve(n);
+  score.reserve(n);
+  label.reserve(n);
+}
+
+void DetectionBoxes::Add(float left, float top, float right, float bottom, float box_score, int box_label) {
+  x1.push_back(left);
+  y1.push_back(top);
+  x2.push_back(right);
+  y2.push_back(bottom);
+  score.push_back(box_score);
+  label.push_back(box_label);
+}
+
+template <typename T>
+static void Gather(const std::vector<int>& indices, std::vector<T>* values) {
+  thread_local std::vector<T> gathered;
+  gathered.resize(indices.size());
+  for (size_t i = 0; i < indices.size(); ++i) gathered[i] = (*values)[indices[i]];
+  values->swap(gathered);
+}
+
+void DetectionBoxes::Keep(const std::vector<int>& indices) {
+  Gather(indices, &x1);
+  Gather(indices, &y1);
+  Gather(indices, &x2);
+  Gather(indices, &y2);
+  Gather(indices, &score);
+  Gather(indices, &label);
+}
+
+namespace {
+
+// exp() by range reduction and a polynomial (cephes expf), the same on every path, relative error about 1e-7.
+constexpr float kExpHi = 88.3762626647949f;
+constexpr float kExpLo = -88.3762626647949f;
+constexpr float kLog2e = 1.44269504088896341f;
+constexpr float kLn2Hi = 0.693359375f;
+constexpr float kLn2Lo = -2.12194440e-4f;
+constexpr float kExpP0 = 1.9875691500e-4f;
+constexpr float kExpP1 = 1.3981999507e-3f;
+constexpr float kExpP2 = 8.3334519073e-3f;
+constexpr float kExpP3 = 4.1665795894e-2f;
+constexpr float kExpP4 = 1.6666665459e-1f;
+constexpr float kExpP5 = 5.0000001201e-1f;
+
+inline float FastExp(float x) {
+  x = std::min(std::max(x, kExpLo), kExpHi);
+  float fx = std::floor(x * kLog2e + 0.5f);
+  x -= fx * kLn2Hi;
+  x -= fx * kLn2Lo;
+  float y = kExpP0;
+  y = y * x + kExpP1;
+  y = y * x + kExpP2;
+  y = y * x + kExpP3;
+  y = y * x + kExpP4;
+  y = y * x + kExpP5;
+  y = y * x * x + x + 1.f;
+  int32_t bits = (static_cast<int32_t>(fx) + 127) << 23;
+  float pow2n;
+  std::memcpy(&pow2n, &bits, sizeof(pow2n));
+  return y * pow2n;
+}
+
+inline float FastSigmoid(float x) { return 1.f / (1.f + FastExp(-x)); }
+
+#if defined(POSTPROC_SSE2)
+inline __m128 FastExp(__m128 x) {
+  x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(kExpLo)), _mm_set1_ps(kExpHi));
+  __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(kLog2e)), _mm_set1_ps(0.5f));
+  // floor, cvttps truncates towards zero
+  __m128 tmp = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+  fx = _mm_sub_ps(tmp, _mm_and_ps(_mm_cmpgt_ps(tmp, fx), _mm_set1_ps(1.f)));
+  x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(kLn2Hi)));
+  x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(kLn2Lo)));
+  __m128 y = _mm_set1_ps(kExpP0);
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(kExpP1));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(kExpP2));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(kExpP3));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(kExpP4));
+  y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(kExpP5));
+  y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(y, x), x), x), _mm_set1_ps(1.f));
+  __m128i bits = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(fx), _mm_set1_epi32(127)), 23);
+  return _mm_mul_ps(y, _mm_castsi128_ps(bits));
+}
+#elif defined(POSTPROC_NEON)
+inline float32x4_t FastExp(float32x4_t x) {
+  x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(kExpLo)), vdupq_n_f32(kExpHi));
+  float32x4_t fx = vmlaq_f32(vdupq_n_f32(0.5f), x, vdupq_n_f32(kLog2e));
+  // floor, vcvtq truncates towards zero
+  float32x4_t tmp = vcvtq_f32_s32(vcvtq_s32_f32(fx));
+  uint32x4_t mask = vandq_u32(vcgtq_f32(tmp, fx), vreinterpretq_u32_f32(vdupq_n_f32(1.f)));
+  fx = vsubq_f32(tmp, vreinterpretq_f32_u32(mask));
+  x = vmlsq_f32(x, fx, vdupq_n_f32(kLn2Hi));
+  x = vmlsq_f32(x, fx, vdupq_n_f32(kLn2Lo));
+  float32x4_t y = vdupq_n_f32(kExpP0);
+  y = vmlaq_f32(vdupq_n_f32(kExpP1), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kExpP2), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kExpP3), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kExpP4), y, x);
+  y = vmlaq_f32(vdupq_n_f32(kExpP5), y, x);
+  y = vaddq_f32(vmlaq_f32(x, vmulq_f32(y, x), x), vdupq_n_f32(1.f));
+  int32x4_t bits = vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(fx), vdupq_n_s32(127)), 23);
+  return vmulq_f32(y, vreinterpretq_f32_s32(bits));
+}
+
+inline float32x4_t Divide(float32x4_t a, float32x4_t b) {
+#if defined(__aarch64__)
+  return vdivq_f32(a, b);
+#else
+  float32x4_t r = vrecpeq_f32(b);
+  r = vmulq_f32(vrecpsq_f32(b, r), r);
+  r = vmulq_f32(vrecpsq_f32(b, r), r);
+  return vmulq_f32(a, r);
+#endif
+}
+#endif
+
+// IoU of box a with boxes [0, n), zero for boxes of other labels.
+void IouRow(const float* box, int box_label, const float* x1, const float* y1, const float* x2, const float* y2,
+            const float* area, const int* label, size_t n, float* iou) {
+  const float ax1 = box[0], ay1 = box[1], ax2 = box[2], ay2 = box[3];
+  const float a_area = (ax2 - ax1) * (ay2 - ay1);
+  size_t j = 0;
+#if defined(POSTPROC_SSE2)
+  const __m128 vx1 = _mm_set1_ps(ax1), vy1 = _mm_set1_ps(ay1), vx2 = _mm_set1_ps(ax2), vy2 = _mm_set1_ps(ay2);
+  const __m128 varea = _mm_set1_ps(a_area), zero = _mm_setzero_ps(), eps = _mm_set1_ps(1e-12f);
+  const __m128i vlabel = _mm_set1_epi32(box_label);
+  for (; j + 4 <= n; j += 4) {
+    __m128 w = _mm_sub_ps(_mm_min_ps(vx2, _mm_loadu_ps(x2 + j)), _mm_max_ps(vx1, _mm_loadu_ps(x1 + j)));
+    __m128 h = _mm_sub_ps(_mm_min_ps(vy2, _mm_loadu_ps(y2 + j)), _mm_max_ps(vy1, _mm_loadu_ps(y1 + j)));
+    __m128 inter = _mm_mul_ps(_mm_max_ps(w, zero), _mm_max_ps(h, zero));
+    __m128 uni = _mm_max_ps(_mm_sub_ps(_mm_add_ps(varea, _mm_loadu_ps(area + j)), inter), eps);
+    __m128 same = _mm_castsi128_ps(
+        _mm_cmpeq_epi32(vlabel, _mm_loadu_si128(reinterpret_cast<const __m128i*>(label + j))));
+    _mm_storeu_ps(iou + j, _mm_and_ps(_mm_div_ps(inter, uni), same));
+  }
+#elif defined(POSTPROC_NEON)
+  const float32x4_t vx1 = vdupq_n_f32(ax1), vy1 = vdupq_n_f32(ay1), vx2 = vdupq_n_f32(ax2), vy2 = vdupq_n_f32(ay2);
+  const float32x4_t varea = vdupq_n_f32(a_area), zero = vdupq_n_f32(0.f), eps = vdupq_n_f32(1e-12f);
+  const int32x4_t vlabel = vdupq_n_s32(box_label);
+  for (; j + 4 <= n; j += 4) {
+    float32x4_t w = vsubq_f32(vminq_f32(vx2, vld1q_f32(x2 + j)), vmaxq_f32(vx1, vld1q_f32(x1 + j)));
+    float32x4_t h = vsubq_f32(vminq_f32(vy2, vld1q_f32(y2 + j)), vmaxq_f32(vy1, vld1q_f32(y1 + j)));
+    float32x4_t inter = vmulq_f32(vmaxq_f32(w, zero), vmaxq_f32(h, zero));
+    float32x4_t uni = vmaxq_f32(vsubq_f32(vaddq_f32(varea, vld1q_f32(area + j)), inter), eps);
+    uint32x4_t same = vceqq_s32(vlabel, vld1q_s32(label + j));
+    float32x4_t value = Divide(inter, uni);
+    vst1q_f32(iou + j, vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(value), same)));
+  }
+#endif
+  for (; j < n; ++j) {
+    float w = std::max(std::min(ax2, x2[j]) - std::max(ax1, x1[j]), 0.f);
+    float h = std::max(std::min(ay2, y2[j]) - std::max(ay1, y1[j]), 0.f);
+    float inter = w * h;
+    float uni = std::max(a_area + area[j] - inter, 1e-12f);
+    iou[j] = label[j] == box_label ? inter / uni : 0.f;
+  }
+}
+
+// Boxes sorted by descending score, laid out contiguously for IouRow.
+struct SortedBoxes {
+  std::vector<int> order;
+  std::vector<float> x1, y1, x2, y2, area;
+  std::vector<int> label;
+  std::vector<float> iou;
+
+  void Sort(const DetectionBoxes& boxes) {
+    const size_t n = boxes.Size();
+    order.resize(n);
+    for (size_t i = 0; i < n; ++i) order[i] = static_cast<int>(i);
+    const float* score = boxes.score.data();
+    std::stable_sort(order.begin(), order.end(), [score](int a, int b) { return score[a] > score[b]; });
+    x1.resize(n);
+    y1.resize(n);
+    x2.resize(n);
+    y2.resize(n);
+    area.resize(n);
+    label.resize(n);
+    iou.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+      const int k = order[i];
+      x1[i] = boxes.x1[k];
+      y1[i] = boxes.y1[k];
+      x2[i] = boxes.x2[k];
+      y2[i] = boxes.y2[k];
+      area[i] = (x2[i] - x1[i]) * (y2[i] - y1[i]);
+      label[i] = boxes.label[k];
+    }
+  }
+
+  // IoU of box i with boxes (i, n), written to iou[i + 1, n).
+  void IouAfter(size_t i) {
+    const float box[4] = {x1[i], y1[i], x2[i], y2[i]};
+    const size_t b = i + 1;
+    IouRow(box, label[i], x1.data() + b, y1.data() + b, x2.data() + b, y2.data() + b, area.data() + b,
+           label.data() + b, order.size() - b, iou.data() + b);
+  }
+};
+
+}  // namespace
+
+void Sigmoid(const float* src, float* dst, size_t n) {
+  size_t i = 0;
+#if defined(POSTPROC_SSE2)
+  const __m128 one = _mm_set1_ps(1.f), zero = _mm_setzero_ps();
+  for (; i + 4 <= n; i += 4) {
+    __m128 e = FastExp(_mm_sub_ps(zero, _mm_loadu_ps(src + i)));
+    _mm_storeu_ps(dst + i, _mm_div_ps(one, _mm_add_ps(one, e)));
+  }
+#elif defined(POSTPROC_NEON)
+  const float32x4_t one = vdupq_n_f32(1.f);
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t e = FastExp(vnegq_f32(vld1q_f32(src + i)));
+    vst1q_f32(dst + i, Divide(one, vaddq_f32(one, e)));
+  }
+#endif
+  for (; i < n; ++i) dst[i] = FastSigmoid(src[i]);
+}
+
+size_t CompactByThreshold(const float* values, size_t n, float threshold, int* indices) {
+  size_t num = 0;
+  size_t i = 0;
+#if defined(POSTPROC_SSE2)
+  // most values are under the threshold, skip them four at a time
+  const __m128 vthreshold = _mm_set1_ps(threshold);
+  for (; i + 4 <= n; i += 4) {
+    int mask = _mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(values + i), vthreshold));
+    while (mask) {
+      int bit = __builtin_ctz(mask);
+      indices[num++] = static_cast<int>(i) + bit;
+      mask &= mask - 1;
+    }
+  }
+#endif
+  for (; i < n; ++i) {
+    indices[num] = static_cast<int>(i);
+    num += values[i] >= threshold;
+  }
+  return num;
+}
+
+bool DecodeYoloLayer(const float* data, const YoloLayerParams& layer, float threshold, DetectionBoxes* boxes) {
+  if (!data || !boxes || layer.grid_w <= 0 || layer.grid_h <= 0 || layer.class_num <= 0 || layer.input_w <= 0 ||
+      layer.input_h <= 0 || layer.anchors.empty() || layer.anchors.size() % 2) {
+    LOGE(INFERENCER) << "[DecodeYoloLayer] Invalid yolo layer parameters.";
+    return false;
+  }
+  const size_t plane = static_cast<size_t>(layer.grid_w) * layer.grid_h;
+  const size_t anchor_step = plane * (5 + layer.class_num);
+  thread_local std::vector<float> objectness;
+  thread_local std::vector<int> cells;
+  objectness.resize(plane);
+  cells.resize(plane);
+  for (size_t a = 0; a < layer.anchors.size() / 2; ++a) {
+    const float* anchor_data = data + a * anchor_step;
+    Sigmoid(anchor_data + 4 * plane, objectness.data(), plane);
+    // class probabilities are not greater than 1, so the score can only pass if the objectness does
+    const size_t num = CompactByThreshold(objectness.data(), plane, threshold, cells.data());
+    for (size_t k = 0; k < num; ++k) {
+      const int cell = cells[k];
+      const float* logit = anchor_data + 5 * plane + cell;
+      int best = 0;
+      for (int c = 1; c < layer.class_num; ++c) {
+        if (logit[c * plane] > logit[best * plane]) best = c;
+      }
+      const float score = objectness[cell] * FastSigmoid(logit[best * plane]);
+      if (score < threshold) continue;
+      const float cx = (cell % layer.grid_w + FastSigmoid(anchor_data[cell])) / layer.grid_w;
+      const float cy = (cell / layer.grid_w + FastSigmoid(anchor_data[plane + cell])) / layer.grid_h;
+      const float w = layer.anchors[2 * a] * FastExp(anchor_data[2 * plane + cell]) / layer.input_w;
+      const float h = layer.anchors[2 * a + 1] * FastExp(anchor_data[3 * plane + cell]) / layer.input_h;
+      boxes->Add(cx - w / 2, cy - h / 2, cx + w / 2, cy + h / 2, score, best);
+    }
+  }
+  return true;
+}
+
+void DecodeBoxList(const float* data, float threshold, int label_offset, DetectionBoxes* boxes) {
+  const int box_num = static_cast<int>(data[0]);
+  const float* box = data + 64;
+  boxes->Reserve(boxes->Size() + box_num);
+  for (int i = 0; i < box_num; ++i, box += 7) {
+    const int label = static_cast<int>(box[1]) + label_offset;
+    if (label < 0 || box[2] < threshold) continue;
+    boxes->Add(box[3], box[4], box[5], box[6], box[2], label);
+  }
+}
+
+void Nms(DetectionBoxes* boxes, float iou_threshold, int max_output) {
+  const size_t n = boxes->Size();
+  if (n == 0) return;
+  thread_local SortedBoxes sorted;
+  thread_local std::vector<uint8_t> removed;
+  thread_local std::vector<int> keep;
+  sorted.Sort(*boxes);
+  removed.assign(n, 0);
+  keep.clear();
+  for (size_t i = 0; i < n; ++i) {
+    if (removed[i]) continue;
+    keep.push_back(sorted.order[i]);
+    if (max_output > 0 && keep.size() == static_cast<size_t>(max_output)) break;
+    sorted.IouAfter(i);
+    for (size_t j = i + 1; j < n; ++j) {
+      removed[j] |= sorted.iou[j] > iou_threshold;
+    }
+  }
+  boxes->Keep(keep);
+}
+
+void MatrixNms(DetectionBoxes* boxes, float sigma, float score_threshold, int max_output) {
+  const size_t n = boxes->Size();
+  if (n == 0) return;
+  thread_local SortedBoxes sorted;
+  // max IoU of each box with the better ones, and the decay of each box
+  thread_local std::vector<float> max_iou;
+  thread_local std::vector<float> decay;
+  thread_local std::vector<int> keep;
+  sorted.Sort(*boxes);
+  max_iou.assign(n, 0.f);
+  decay.assign(n, 1.f);
+  // row i only needs the IoUs of boxes before i, which are complete when row i is reached
+  for (size_t i = 0; i + 1 < n; ++i) {
+    sorted.IouAfter(i);
+    const float compensate = max_iou[i];
+    for (size_t j = i + 1; j < n; ++j) {
+      const float iou = sorted.iou[j];
+      float value;
+      if (sigma > 0) {
+        value = FastExp(-sigma * (iou * iou - compensate * compensate));
+      } else {
+        value = (1.f - iou) / std::max(1.f - compensate, 1e-6f);
+      }
+      decay[j] = std::min(decay[j], value);
+      max_iou[j] = std::max(max_iou[j], iou);
+    }
+  }
+  keep.clear();
+  for (size_t i = 0; i < n; ++i) {
+    float& score = boxes->score[sorted.order[i]];
+    score *= decay[i];
+    if (score >= score_threshold) keep.push_back(sorted.order[i]);
+  }
+  const float* score = boxes->score.data();
+  std::stable_sort(keep.begin(), keep.end(), [score](int a, int b) { return score[a] > score[b]; });
+  if (max_output > 0 && keep.size() > static_cast<size_t>(max_output)) keep.resize(max_output);
+  boxes->Keep(keep);
+}
+
+// Clips a box to [0, 1], returns false if nothing is left.
+static bool ClipBox(const DetectionBoxes& boxes, size_t i, CNInferBoundingBox* bbox) {
+  auto clip = [](float value) { return std::max(0.f, std::min(1.f, value)); };
+  const float left = clip(boxes.x1[i]), top = clip(boxes.y1[i]);
+  const float right = clip(boxes.x2[i]), bottom = clip(boxes.y2[i]);
+  if (right <= left || bottom <= top) return false;
+  bbox->x = left;
+  bbox->y = top;
+  bbox->w = right - left;
+  bbox->h = bottom - top;
+  return true;
+}
+
+void AppendObjects(const DetectionBoxes& boxes, CNInferObjs* objs_holder) {
+  std::vector<std::shared_ptr<CNInferObject>> objs;
+  objs.reserve(boxes.Size());
+  CNInferBoundingBox bbox;
+  for (size_t i = 0; i < boxes.Size(); ++i) {
+    if (!ClipBox(boxes, i, &bbox)) continue;
+    auto obj = std::make_shared<CNInferObject>();
+    obj->id = std::to_string(boxes.label[i]);
+    obj->score = boxes.score[i];
+    obj->bbox = bbox;
+    objs.push_back(std::move(obj));
+  }
+  std::lock_guard<std::mutex> lk(objs_holder->mutex_);
+  objs_holder->objs_.insert(objs_holder->objs_.end(), objs.begin(), objs.end());
+}
+
+void AppendObjects(const DetectionBoxes& boxes, CNObjectTable* table) {
+  std::lock_guard<std::mutex> lk(table->mutex_);
+  table->Reserve(table->Size() + boxes.Size());
+  CNInferBoundingBox bbox;
+  for (size_t i = 0; i < boxes.Size(); ++i) {
+    if (ClipBox(boxes, i, &bbox)) table->Add(boxes.label[i], boxes.score[i], bbox);
+  }
+}
+
+}  // namespace cnstream
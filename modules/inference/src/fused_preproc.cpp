@@ -0,0 +1,516 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "fused_preproc.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+#include "easyinfer/model_loader.h"
+#include "easyinfer/shape.h"
+
+namespace cnstream {
+
+namespace {
+
+// Source positions of one output coordinate, the same as cv::resize with INTER_LINEAR.
+struct LinearTap {
+  int p0;
+  int p1;
+  float w;
+};
+
+inline LinearTap ComputeTap(int d, double scale, int src_offset, int src_len) {
+  float f = static_cast<float>((d + 0.5) * scale - 0.5);
+  int s = static_cast<int>(std::floor(f));
+  f -= s;
+  if (s < 0) {
+    s = 0;
+    f = 0;
+  }
+  if (s >= src_len - 1) {
+    s = src_len - 1;
+    f = 0;
+  }
+  LinearTap tap;
+  tap.p0 = src_offset + s;
+  tap.p1 = src_offset + std::min(s + 1, src_len - 1);
+  tap.w = f;
+  return tap;
+}
+
+// Output row of dst_w pixels. Channel k of pixel x is at data[x * pix_step + k * chn_step].
+struct RowWriter {
+  float* data;
+  int pix_step;
+  int chn_step;
+  int dst_c;
+  float scale[3];
+  float bias[3];
+
+  inline void Put(int x, float c0, float c1, float c2) const {
+    float* p = data + x * pix_step;
+    p[0] = c0 * scale[0] + bias[0];
+    p[chn_step] = c1 * scale[1] + bias[1];
+    p[2 * chn_step] = c2 * scale[2] + bias[2];
+    if (dst_c == 4) p[3 * chn_step] = 0.f;
+  }
+
+  void Fill(int x_begin, int x_end, const float* value) const {
+    for (int x = x_begin; x < x_end; ++x) {
+      float* p = data + x * pix_step;
+      for (int k = 0; k < dst_c; ++k) p[k * chn_step] = value[k];
+    }
+  }
+};
+
+inline int Saturate(int v) { return v < 0 ? 0 : (v > 255 ? 255 : v); }
+
+// BT.601 video range, the fixed point coefficients of cv::cvtColor.
+inline void Yuv2Bgr(int y, int u, int v, int* b, int* g, int* r) {
+  const int yy = std::max(y - 16, 0) * 1220542 + (1 << 19);
+  u -= 128;
+  v -= 128;
+  *b = Saturate((yy + 2116026 * u) >> 20);
+  *g = Saturate((yy - 852492 * v - 409993 * u) >> 20);
+  *r = Saturate((yy + 1673527 * v) >> 20);
+}
+
+// Resamples one source row horizontally, 3 channels per pixel in BGR order (RGB for RGB24 images).
+void ResampleRow(const PreprocImage& src, int row, const LinearTap* tx, int width, float* dst) {
+  if (src.fmt == CN_PIXEL_FORMAT_YUV420_NV12 || src.fmt == CN_PIXEL_FORMAT_YUV420_NV21) {
+    const uint8_t* y_row = src.planes[0] + static_cast<size_t>(row) * src.strides[0];
+    const uint8_t* uv_row = src.planes[1] + static_cast<size_t>(row >> 1) * src.strides[1];
+    const int u_idx = src.fmt == CN_PIXEL_FORMAT_YUV420_NV21 ? 1 : 0;
+    const int v_idx = 1 - u_idx;
+    for (int x = 0; x < width; ++x, dst += 3) {
+      const int x0 = tx[x].p0, x1 = tx[x].p1;
+      const int c0 = x0 & ~1, c1 = x1 & ~1;
+      // converts the taps before blending them, the same as cvtColor followed by resize
+      int b0, g0, r0, b1, g1, r1;
+      Yuv2Bgr(y_row[x0], uv_row[c0 + u_idx], uv_row[c0 + v_idx], &b0, &g0, &r0);
+      Yuv2Bgr(y_row[x1], uv_row[c1 + u_idx], uv_row[c1 + v_idx], &b1, &g1, &r1);
+      const float w1 = tx[x].w, w0 = 1.f - tx[x].w;
+      dst[0] = w0 * b0 + w1 * b1;
+      dst[1] = w0 * g0 + w1 * g1;
+      dst[2] = w0 * r0 + w1 * r1;
+    }
+  } else {
+    const uint8_t* s = src.planes[0] + static_cast<size_t>(row) * src.strides[0];
+    for (int x = 0; x < width; ++x, dst += 3) {
+      const int x0 = tx[x].p0 * 3, x1 = tx[x].p1 * 3;
+      const float w1 = tx[x].w, w0 = 1.f - tx[x].w;
+      dst[0] = w0 * s[x0] + w1 * s[x1];
+      dst[1] = w0 * s[x0 + 1] + w1 * s[x1 + 1];
+      dst[2] = w0 * s[x0 + 2] + w1 * s[x1 + 2];
+    }
+  }
+}
+
+bool ParseFloats(std::string value, std::vector<float>* ret) {
+  ret->clear();
+  for (auto& c : value) {
+    if (c == '[' || c == ']' || c == ',') c = ' ';
+  }
+  const char* p = value.c_str();
+  while (true) {
+    char* end = nullptr;
+    float v = std::strtof(p, &end);
+    if (end == p) break;
+    ret->push_back(v);
+    p = end;
+  }
+  for (; *p; ++p) {
+    if (*p != ' ' && *p != '\t') return false;
+  }
+  return !ret->empty();
+}
+
+}  // namespace
+
+static bool CheckArgs(const PreprocImage& src, const PreprocRoi& roi, const FusedPreprocParams& params,
+                      const float* dst) {
+  const bool yuv = src.fmt == CN_PIXEL_FORMAT_YUV420_NV12 || src.fmt == CN_PIXEL_FORMAT_YUV420_NV21;
+  const bool packed = src.fmt == CN_PIXEL_FORMAT_BGR24 || src.fmt == CN_PIXEL_FORMAT_RGB24;
+  if (!yuv && !packed) {
+    LOGE(INFERENCER) << "[FusedPreprocess] Unsupported pixel format: " << src.fmt;
+    return false;
+  }
+  if (!dst || !src.planes[0] || (yuv && !src.planes[1]) || params.dst_w <= 0 || params.dst_h <= 0 ||
+      (params.dst_c != 3 && params.dst_c != 4)) {
+    LOGE(INFERENCER) << "[FusedPreprocess] Invalid parameters.";
+    return false;
+  }
+  if (roi.w <= 0 || roi.h <= 0 || roi.x < 0 || roi.y < 0 || roi.x + roi.w > src.width ||
+      roi.y + roi.h > src.height) {
+    LOGE(INFERENCER) << "[FusedPreprocess] Roi (" << roi.x << ", " << roi.y << ", " << roi.w << ", " << roi.h
+                     << ") is out of image " << src.width << "x" << src.height;
+    return false;
+  }
+  return true;
+}
+
+// Produces output rows [row_begin, row_end) of one region, arguments are checked by CheckArgs.
+static void PreprocessRows(const PreprocImage& src, const PreprocRoi& roi, const FusedPreprocParams& params,
+                           float* dst, int row_begin, int row_end) {
+  const int dst_w = params.dst_w, dst_h = params.dst_h;
+  int content_w = dst_w, content_h = dst_h;
+  if (params.keep_aspect_ratio) {
+    const double scale = std::min(static_cast<double>(dst_w) / roi.w, static_cast<double>(dst_h) / roi.h);
+    content_w = std::max(1, std::min(dst_w, static_cast<int>(std::lround(roi.w * scale))));
+    content_h = std::max(1, std::min(dst_h, static_cast<int>(std::lround(roi.h * scale))));
+  }
+  const int offset_x = (dst_w - content_w) / 2;
+  const int offset_y = (dst_h - content_h) / 2;
+
+  // column taps and the last two resampled source rows, kept per thread so repeated calls do not allocate
+  thread_local std::vector<LinearTap> x_taps;
+  thread_local std::vector<float> row_buffer;
+  if (x_taps.size() < static_cast<size_t>(content_w)) x_taps.resize(content_w);
+  if (row_buffer.size() < static_cast<size_t>(content_w) * 6) row_buffer.resize(content_w * 6);
+  const double x_scale = static_cast<double>(roi.w) / content_w;
+  for (int dx = 0; dx < content_w; ++dx) x_taps[dx] = ComputeTap(dx, x_scale, roi.x, roi.w);
+  float* rows[2] = {row_buffer.data(), row_buffer.data() + content_w * 3};
+  int cached_rows[2] = {-1, -1};
+  // output rows share source rows when upscaling, each source row is resampled once
+  auto resampled_row = [&](int row, int keep) -> const float* {
+    for (int i = 0; i < 2; ++i) {
+      if (cached_rows[i] == row) return rows[i];
+    }
+    const int slot = cached_rows[0] == keep ? 1 : 0;
+    ResampleRow(src, row, x_taps.data(), content_w, rows[slot]);
+    cached_rows[slot] = row;
+    return rows[slot];
+  };
+
+  RowWriter out;
+  out.dst_c = params.dst_c;
+  out.pix_step = params.dst_nchw ? 1 : params.dst_c;
+  out.chn_step = params.dst_nchw ? dst_w * dst_h : 1;
+  float pad[4] = {0, 0, 0, 0};
+  for (int k = 0; k < 3; ++k) {
+    out.scale[k] = 1.f / params.std[k];
+    out.bias[k] = -params.mean[k] / params.std[k];
+    pad[k] = params.pad_value * out.scale[k] + out.bias[k];
+  }
+  const size_t row_step = static_cast<size_t>(params.dst_nchw ? dst_w : dst_w * params.dst_c);
+  const bool swap_rb = (src.fmt == CN_PIXEL_FORMAT_RGB24) != params.dst_rgb;
+
+  const double y_scale = static_cast<double>(roi.h) / content_h;
+  for (int dy = row_begin; dy < row_end; ++dy) {
+    out.data = dst + dy * row_step;
+    const int cy = dy - offset_y;
+    if (cy < 0 || cy >= content_h) {
+      out.Fill(0, dst_w, pad);
+      continue;
+    }
+    out.Fill(0, offset_x, pad);
+    out.Fill(offset_x + content_w, dst_w, pad);
+    const LinearTap ty = ComputeTap(cy, y_scale, roi.y, roi.h);
+    const float* row0 = resampled_row(ty.p0, ty.p1);
+    const float* row1 = resampled_row(ty.p1, ty.p0);
+    const float w1 = ty.w, w0 = 1.f - ty.w;
+    for (int x = 0; x < content_w; ++x) {
+      const float c0 = w0 * row0[x * 3] + w1 * row1[x * 3];
+      const float c1 = w0 * row0[x * 3 + 1] + w1 * row1[x * 3 + 1];
+      const float c2 = w0 * row0[x * 3 + 2] + w1 * row1[x * 3 + 2];
+      if (swap_rb) {
+        out.Put(offset_x + x, c2, c1, c0);
+      } else {
+        out.Put(offset_x + x, c0, c1, c2);
+      }
+    }
+  }
+}
+
+bool FusedPreprocess(const PreprocImage& src, const PreprocRoi& roi, const FusedPreprocParams& params, float* dst) {
+  if (!CheckArgs(src, roi, params, dst)) return false;
+  PreprocessRows(src, roi, params, dst, 0, params.dst_h);
+  return true;
+}
+
+PreprocWorkers::PreprocWorkers(int thread_num) {
+  for (int i = 0; i < thread_num; ++i) threads_.emplace_back(&PreprocWorkers::Loop, this);
+}
+
+PreprocWorkers::~PreprocWorkers() {
+  std::unique_lock<std::mutex> lk(mtx_);
+  running_ = false;
+  lk.unlock();
+  job_cond_.notify_all();
+  for (auto& thread : threads_) thread.join();
+}
+
+void PreprocWorkers::Run(const std::function<void()>& job, int helper_num) {
+  helper_num = std::min(helper_num, Size());
+  if (helper_num <= 0) {
+    job();
+    return;
+  }
+  auto pjob = std::make_shared<Job>();
+  pjob->func = job;
+  std::unique_lock<std::mutex> lk(mtx_);
+  for (int i = 0; i < helper_num; ++i) jobs_.push(pjob);
+  lk.unlock();
+  if (helper_num == Size()) {
+    job_cond_.notify_all();
+  } else {
+    for (int i = 0; i < helper_num; ++i) job_cond_.notify_one();
+  }
+  job();
+  lk.lock();
+  // entries not taken yet are dropped by the threads
+  pjob->finished = true;
+  done_cond_.wait(lk, [&pjob]() { return pjob->running == 0; });
+}
+
+void PreprocWorkers::Loop() {
+  std::unique_lock<std::mutex> lk(mtx_);
+  while (true) {
+    job_cond_.wait(lk, [this]() { return !jobs_.empty() || !running_; });
+    if (!running_) return;
+    std::shared_ptr<Job> job = std::move(jobs_.front());
+    jobs_.pop();
+    if (job->finished) continue;
+    ++job->running;
+    lk.unlock();
+    job->func();
+    lk.lock();
+    if (--job->running == 0 && job->finished) done_cond_.notify_all();
+  }
+}
+
+bool FusedPreprocessBatch(const PreprocImage& src, const std::vector<PreprocRoi>& rois,
+                          const FusedPreprocParams& params, const std::vector<float*>& dsts,
+                          PreprocWorkers* workers) {
+  if (rois.size() != dsts.size()) {
+    LOGE(INFERENCER) << "[FusedPreprocess] " << rois.size() << " rois but " << dsts.size() << " outputs.";
+    return false;
+  }
+  for (size_t i = 0; i < rois.size(); ++i) {
+    if (!CheckArgs(src, rois[i], params, dsts[i])) return false;
+  }
+  // rows of all regions are split into bands, which are taken by the workers in turn
+  static constexpr int kBandRows = 16;
+  const int bands_per_roi = (params.dst_h + kBandRows - 1) / kBandRows;
+  const int band_num = bands_per_roi * static_cast<int>(rois.size());
+  std::atomic<int> next_band{0};
+  auto worker = [&]() {
+    for (int band = next_band++; band < band_num; band = next_band++) {
+      const int idx = band / bands_per_roi;
+      const int row_begin = band % bands_per_roi * kBandRows;
+      PreprocessRows(src, rois[idx], params, dsts[idx], row_begin, std::min(row_begin + kBandRows, params.dst_h));
+    }
+  };
+  if (!workers) {
+    worker();
+    return true;
+  }
+  // small batches are not worth waking up threads for
+  static constexpr int kMinBandsPerThread = 4;
+  workers->Run(worker, band_num / kMinBandsPerThread - 1);
+  return true;
+}
+
+PreprocRoi ObjectRoi(const CNInferBoundingBox& bbox, int width, int height) {
+  PreprocRoi roi;
+  roi.x = std::min(std::max(static_cast<int>(bbox.x * width), 0), width - 1);
+  roi.y = std::min(std::max(static_cast<int>(bbox.y * height), 0), height - 1);
+  roi.w = std::min(std::max(static_cast<int>(bbox.w * width), 1), width - roi.x);
+  roi.h = std::min(std::max(static_cast<int>(bbox.h * height), 1), height - roi.y);
+  return roi;
+}
+
+bool MakePreprocImage(CNDataFrame* frame, PreprocImage* image) {
+  if (!frame || !image) return false;
+  image->fmt = frame->fmt;
+  image->width = frame->width;
+  image->height = frame->height;
+  switch (frame->fmt) {
+    case CN_PIXEL_FORMAT_BGR24:
+    case CN_PIXEL_FORMAT_RGB24:
+      image->planes[0] = static_cast<const uint8_t*>(frame->data[0]->GetCpuData());
+      image->strides[0] = frame->stride[0] * 3;
+      image->planes[1] = nullptr;
+      image->strides[1] = 0;
+      return image->planes[0] != nullptr;
+    case CN_PIXEL_FORMAT_YUV420_NV12:
+    case CN_PIXEL_FORMAT_YUV420_NV21:
+      for (int i = 0; i < 2; ++i) {
+        image->planes[i] = static_cast<const uint8_t*>(frame->data[i]->GetCpuData());
+        image->strides[i] = frame->stride[i];
+      }
+      return image->planes[0] != nullptr && image->planes[1] != nullptr;
+    default:
+      return false;
+  }
+}
+
+bool ParseFusedPreprocParams(const std::unordered_map<std::string, std::string>& custom_params,
+                             FusedPreprocParams* params) {
+  for (const auto& it : custom_params) {
+    const std::string& key = it.first;
+    const std::string& value = it.second;
+    if (key == "mean" || key == "std") {
+      std::vector<float> values;
+      if (!ParseFloats(value, &values) || (values.size() != 1 && values.size() != 3)) {
+        LOGE(INFERENCER) << "[FusedPreprocCpu] " << key << " should be 1 or 3 numbers, but got: " << value;
+        return false;
+      }
+      float* dst = key == "mean" ? params->mean : params->std;
+      for (int k = 0; k < 3; ++k) dst[k] = values[values.size() == 3 ? k : 0];
+      if (key == "std" && (dst[0] == 0 || dst[1] == 0 || dst[2] == 0)) {
+        LOGE(INFERENCER) << "[FusedPreprocCpu] std can not be zero.";
+        return false;
+      }
+    } else if (key == "color_order") {
+      if (value != "BGR" && value != "RGB") {
+        LOGE(INFERENCER) << "[FusedPreprocCpu] color_order should be BGR or RGB, but got: " << value;
+        return false;
+      }
+      params->dst_rgb = value == "RGB";
+    } else if (key == "data_order") {
+      if (value != "NHWC" && value != "NCHW") {
+        LOGE(INFERENCER) << "[FusedPreprocCpu] data_order should be NHWC or NCHW, but got: " << value;
+        return false;
+      }
+      params->dst_nchw = value == "NCHW";
+    } else if (key == "keep_aspect_ratio") {
+      if (value != "true" && value != "false") {
+        LOGE(INFERENCER) << "[FusedPreprocCpu] keep_aspect_ratio should be true or false, but got: " << value;
+        return false;
+      }
+      params->keep_aspect_ratio = value == "true";
+    } else if (key == "pad_value") {
+      std::vector<float> values;
+      if (!ParseFloats(value, &values) || values.size() != 1) {
+        LOGE(INFERENCER) << "[FusedPreprocCpu] pad_value should be a number, but got: " << value;
+        return false;
+      }
+      params->pad_value = values[0];
+    } else {
+      LOGE(INFERENCER) << "[FusedPreprocCpu] Unknown parameter: " << key;
+      return false;
+    }
+  }
+  return true;
+}
+
+IMPLEMENT_REFLEX_OBJECT_EX(FusedPreprocCpu, Preproc)
+
+int FusedPreprocCpu::Init(const std::unordered_map<std::string, std::string>& params) {
+  params_ = FusedPreprocParams();
+  return ParseFusedPreprocParams(params, &params_) ? 0 : -1;
+}
+
+int FusedPreprocCpu::Execute(const std::vector<float*>& net_inputs, const std::shared_ptr<edk::ModelLoader>& model,
+                             const CNFrameInfoPtr& package) {
+  const auto& input_shapes = model->InputShapes();
+  if (net_inputs.size() != 1 || (input_shapes[0].c != 3 && input_shapes[0].c != 4)) {
+    LOGE(INFERENCER) << "[FusedPreprocCpu] model input shape not supported, net_input.size = " << net_inputs.size()
+                     << ", input_shapes[0].c = " << input_shapes[0].c;
+    return -1;
+  }
+  CNDataFramePtr frame = GetCNDataFramePtr(package);
+  PreprocImage image;
+  if (!MakePreprocImage(frame.get(), &image)) {
+    LOGE(INFERENCER) << "[FusedPreprocCpu] Unsupported pixel format: " << frame->fmt;
+    return -1;
+  }
+  FusedPreprocParams params = params_;
+  params.dst_w = input_shapes[0].w;
+  params.dst_h = input_shapes[0].h;
+  params.dst_c = input_shapes[0].c;
+  PreprocRoi roi;
+  roi.w = frame->width;
+  roi.h = frame->height;
+  return FusedPreprocess(image, roi, params, net_inputs[0]) ? 0 : -1;
+}
+
+IMPLEMENT_REFLEX_OBJECT_EX(FusedObjPreprocCpu, ObjPreproc)
+
+int FusedObjPreprocCpu::Init(const std::unordered_map<std::string, std::string>& params) {
+  std::unordered_map<std::string, std::string> preproc_params = params;
+  int thread_num = 4;
+  auto iter = preproc_params.find("thread_num");
+  if (iter != preproc_params.end()) {
+    char* end = nullptr;
+    long value = std::strtol(iter->second.c_str(), &end, 10);  // NOLINT
+    if (end == iter->second.c_str() || *end != '\0' || value <= 0) {
+      LOGE(INFERENCER) << "[FusedObjPreprocCpu] thread_num should be a positive integer, but got: " << iter->second;
+      return -1;
+    }
+    thread_num = static_cast<int>(value);
+    preproc_params.erase(iter);
+  }
+  params_ = FusedPreprocParams();
+  if (!ParseFusedPreprocParams(preproc_params, &params_)) return -1;
+  workers_.reset(thread_num > 1 ? new PreprocWorkers(thread_num - 1) : nullptr);
+  return 0;
+}
+
+int FusedObjPreprocCpu::Execute(const std::vector<float*>& net_inputs, const std::shared_ptr<edk::ModelLoader>& model,
+                                const CNFrameInfoPtr& finfo, const std::shared_ptr<CNInferObject>& pobj) {
+  return ExecuteBatch({net_inputs}, model, finfo, {pobj});
+}
+
+int FusedObjPreprocCpu::ExecuteBatch(const std::vector<std::vector<float*>>& net_inputs,
+                                     const std::shared_ptr<edk::ModelLoader>& model, const CNFrameInfoPtr& finfo,
+                                     const std::vector<std::shared_ptr<CNInferObject>>& objs) {
+  const auto& input_shapes = model->InputShapes();
+  if (input_shapes.size() != 1 || (input_shapes[0].c != 3 && input_shapes[0].c != 4)) {
+    LOGE(INFERENCER) << "[FusedObjPreprocCpu] model input shape not supported, input number = "
+                     << input_shapes.size();
+    return -1;
+  }
+  CNDataFramePtr frame = GetCNDataFramePtr(finfo);
+  PreprocImage image;
+  if (!MakePreprocImage(frame.get(), &image)) {
+    LOGE(INFERENCER) << "[FusedObjPreprocCpu] Unsupported pixel format: " << frame->fmt;
+    return -1;
+  }
+  FusedPreprocParams params = params_;
+  params.dst_w = input_shapes[0].w;
+  params.dst_h = input_shapes[0].h;
+  params.dst_c = input_shapes[0].c;
+  std::vector<PreprocRoi> rois;
+  std::vector<float*> dsts;
+  rois.reserve(objs.size());
+  dsts.reserve(objs.size());
+  for (size_t i = 0; i < objs.size() && i < net_inputs.size(); ++i) {
+    if (net_inputs[i].size() != 1) {
+      LOGE(INFERENCER) << "[FusedObjPreprocCpu] model input number not supported: " << net_inputs[i].size();
+      return -1;
+    }
+    rois.push_back(ObjectRoi(objs[i]->bbox, frame->width, frame->height));
+    dsts.push_back(net_inputs[i][0]);
+  }
+  return FusedPreprocessBatch(image, rois, params, dsts, workers_.get()) ? 0 : -1;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,220 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_INFERENCE_SRC_FUSED_PREPROC_HPP_
+#define MODULES_INFERENCE_SRC_FUSED_PREPROC_HPP_
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+#include "preproc.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief Describes the network input produced by FusedPreprocess.
+ */
+struct FusedPreprocParams {
+  int dst_w = 0;
+  int dst_h = 0;
+  int dst_c = 3;                    ///< 3, or 4 to append a zero channel (BGRA/RGBA inputs).
+  bool dst_rgb = false;             ///< Channel order of the output, BGR by default.
+  bool dst_nchw = false;            ///< Data order of the output, NHWC by default.
+  bool keep_aspect_ratio = false;   ///< Letterbox the image into the center of the output.
+  float pad_value = 0;              ///< Pixel value of the letterbox border, before normalization.
+  float mean[3] = {0, 0, 0};        ///< Per channel mean, in the output channel order.
+  float std[3] = {1, 1, 1};         ///< Per channel std, in the output channel order.
+};
+
+/**
+ * @brief A CPU image, planes may have any stride.
+ */
+struct PreprocImage {
+  CNDataFormat fmt = CN_INVALID;
+  int width = 0;
+  int height = 0;
+  const uint8_t* planes[2] = {nullptr, nullptr};
+  int strides[2] = {0, 0};  ///< In bytes.
+};
+
+/**
+ * @brief Region of the source image to be preprocessed, in pixels.
+ */
+struct PreprocRoi {
+  int x = 0;
+  int y = 0;
+  int w = 0;
+  int h = 0;
+};
+
+/**
+ * @brief Converts a NV12/NV21/BGR24/RGB24 image region to a normalized float network input.
+ *
+ * Color conversion (BT.601), bilinear resizing, letterboxing, normalization and layout conversion are done in one
+ * pass over the output rows, reading the source planes in place. The result matches cvtColor + resize + convertTo
+ * of OpenCV up to rounding. It is thread-safe.
+ *
+ * @param src The source image.
+ * @param roi The region of the source image. It must lie inside the image.
+ * @param params The output description.
+ * @param dst The output buffer, dst_w * dst_h * dst_c floats.
+ *
+ * @return Returns false if the image format is not supported or the parameters are invalid.
+ */
+bool FusedPreprocess(const PreprocImage& src, const PreprocRoi& roi, const FusedPreprocParams& params, float* dst);
+
+/**
+ * @brief Persistent threads helping callers of FusedPreprocessBatch.
+ *
+ * The threads are started once and wait for work between batches. It is thread-safe, batches run at the same time
+ * share the threads.
+ */
+class PreprocWorkers {
+ public:
+  /**
+   * @brief Starts thread_num threads.
+   */
+  explicit PreprocWorkers(int thread_num);
+  /**
+   * @brief Stops the threads, no Run may be in progress.
+   */
+  ~PreprocWorkers();
+
+  PreprocWorkers(const PreprocWorkers&) = delete;
+  PreprocWorkers& operator=(const PreprocWorkers&) = delete;
+
+  /**
+   * @brief Gets the number of threads.
+   */
+  int Size() const { return static_cast<int>(threads_.size()); }
+
+  /**
+   * @brief Runs job on the calling thread and on up to helper_num threads at the same time.
+   *
+   * Returns once the calling thread and every thread which has started the job are done. Threads busy with other
+   * batches by then do not run it at all, so job must leave nothing undone when it returns on the calling thread.
+   */
+  void Run(const std::function<void()>& job, int helper_num);
+
+ private:
+  struct Job {
+    std::function<void()> func;
+    int running = 0;
+    bool finished = false;
+  };
+  void Loop();
+
+  std::vector<std::thread> threads_;
+  std::queue<std::shared_ptr<Job>> jobs_;
+  std::mutex mtx_;
+  std::condition_variable job_cond_;
+  std::condition_variable done_cond_;
+  bool running_ = true;
+};  // class PreprocWorkers
+
+/**
+ * @brief Runs FusedPreprocess on several regions of one image.
+ *
+ * The output rows of all regions are split into bands and shared by the calling thread and the workers.
+ *
+ * @param src The source image.
+ * @param rois The regions of the source image.
+ * @param params The output description, the same for all regions.
+ * @param dsts The output buffer of each region.
+ * @param workers The threads helping the calling thread, nullptr to run on the calling thread only.
+ *
+ * @return Returns false if any region or the parameters are invalid, nothing is written then.
+ */
+bool FusedPreprocessBatch(const PreprocImage& src, const std::vector<PreprocRoi>& rois,
+                          const FusedPreprocParams& params, const std::vector<float*>& dsts,
+                          PreprocWorkers* workers = nullptr);
+
+/**
+ * @brief Converts the normalized bounding box of an object to a region of the image, clipped to the image.
+ */
+PreprocRoi ObjectRoi(const CNInferBoundingBox& bbox, int width, int height);
+
+/**
+ * @brief Builds a PreprocImage referencing the CPU planes of a frame.
+ */
+bool MakePreprocImage(CNDataFrame* frame, PreprocImage* image);
+
+/**
+ * @brief Parses FusedPreprocParams (except the output size) from custom_preproc_params.
+ *
+ * Supported keys: mean and std (3 numbers, in the output channel order), color_order (BGR/RGB),
+ * data_order (NHWC/NCHW), keep_aspect_ratio (true/false) and pad_value.
+ */
+bool ParseFusedPreprocParams(const std::unordered_map<std::string, std::string>& custom_params,
+                             FusedPreprocParams* params);
+
+/**
+ * @brief Frame preprocessing on CPU by FusedPreprocess, set preproc_name to FusedPreprocCpu to use it.
+ *
+ * The output size comes from the first input of the model, whose channel number must be 3 or 4.
+ */
+class FusedPreprocCpu : public Preproc {
+ public:
+  int Init(const std::unordered_map<std::string, std::string>& params) override;
+
+  int Execute(const std::vector<float*>& net_inputs, const std::shared_ptr<edk::ModelLoader>& model,
+              const CNFrameInfoPtr& package) override;
+
+ private:
+  FusedPreprocParams params_;
+
+  DECLARE_REFLEX_OBJECT_EX(FusedPreprocCpu, Preproc);
+};  // class FusedPreprocCpu
+
+/**
+ * @brief Object preprocessing on CPU by FusedPreprocess, set preproc_name to FusedObjPreprocCpu to use it.
+ *
+ * Objects are cropped from the source planes directly. All objects batched together are processed in one
+ * multithreaded pass, the number of threads is set by the thread_num key of custom_preproc_params (4 by default).
+ * The calling thread is one of them, the others are started by Init and kept until destruction.
+ */
+class FusedObjPreprocCpu : public ObjPreproc {
+ public:
+  int Init(const std::unordered_map<std::string, std::string>& params) override;
+
+  int Execute(const std::vector<float*>& net_inputs, const std::shared_ptr<edk::ModelLoader>& model,
+              const CNFrameInfoPtr& finfo, const std::shared_ptr<CNInferObject>& pobj) override;
+
+  int ExecuteBatch(const std::vector<std::vector<float*>>& net_inputs, const std::shared_ptr<edk::ModelLoader>& model,
+                   const CNFrameInfoPtr& finfo, const std::vector<std::shared_ptr<CNInferObject>>& objs) override;
+
+ private:
+  FusedPreprocParams params_;
+  std::unique_ptr<PreprocWorkers> workers_;
+
+  DECLARE_REFLEX_OBJECT_EX(FusedObjPreprocCpu, ObjPreproc);
+};  // class FusedObjPreprocCpu
+
+}  // namespace cnstream
+
+#endif  // MODULES_INFERENCE_SRC_FUSED_PREPROC_HPP_
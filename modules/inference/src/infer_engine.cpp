@@ -22,6 +22,7 @@
 #include <cxxutil/exception.h>
 #include <device/mlu_context.h>
 #include <easyinfer/model_loader.h>
+#include <algorithm>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -34,6 +35,7 @@
 #include "infer_thread_pool.hpp"
 #include "obj_batching_stage.hpp"
 #include "obj_filter.hpp"
+#include "stage_occupancy.hpp"
 
 namespace cnstream {
 
@@ -50,7 +52,8 @@ InferEngine::InferEngine(int dev_id, std::shared_ptr<edk::ModelLoader> model, st
                          CNDataFormat model_input_pixel_format,
                          bool mem_on_mlu_for_postproc,
                          bool saving_infer_input,
-                         std::string module_name)
+                         std::string module_name,
+                         uint32_t io_depth)
      :model_(model),
       preprocessor_(preprocessor),
       postprocessor_(postprocessor),
@@ -69,21 +72,23 @@ InferEngine::InferEngine(int dev_id, std::shared_ptr<edk::ModelLoader> model, st
       model_input_fmt_(model_input_pixel_format),
       mem_on_mlu_for_postproc_(mem_on_mlu_for_postproc),
       saving_infer_input_(saving_infer_input),
-      module_name_(module_name) {
+      module_name_(module_name),
+      io_depth_(io_depth) {
   try {
     edk::MluContext mlu_ctx;
     mlu_ctx.SetDeviceId(dev_id);
     mlu_ctx.BindDevice();
     tp_ = std::make_shared<InferThreadPool>();
     tp_->SetErrorHandleFunc(error_func);
-    tp_->Init(dev_id, batchsize * 3 + 4);
-    cpu_input_res_ = std::make_shared<CpuInputResource>(model, batchsize);
+    // each batch in flight needs its own threads to go through the stages.
+    tp_->Init(dev_id, (batchsize * 3 + 4) * io_depth_);
+    cpu_input_res_ = std::make_shared<CpuInputResource>(model, batchsize, io_depth_);
     if (!mem_on_mlu_for_postproc_) {
-      cpu_output_res_ = std::make_shared<CpuOutputResource>(model, batchsize);
+      cpu_output_res_ = std::make_shared<CpuOutputResource>(model, batchsize, io_depth_);
       cpu_output_res_->Init();
     }
-    mlu_input_res_ = std::make_shared<MluInputResource>(model, batchsize);
-    mlu_output_res_ = std::make_shared<MluOutputResource>(model, batchsize);
+    mlu_input_res_ = std::make_shared<MluInputResource>(model, batchsize, io_depth_);
+    mlu_output_res_ = std::make_shared<MluOutputResource>(model, batchsize, io_depth_);
     if (mlu_ctx.GetCoreVersion() == edk::CoreVersion::MLU270) {
       use_scaler_ = false;
     }
@@ -158,27 +163,39 @@ InferEngine::ResultWaitingCard InferEngine::FeedData(std::shared_ptr<CNFrameInfo
       return card;
     }
     CNInferObjsPtr objs_holder = cnstream::GetCNInferObjsPtr(finfo);
-    CNObjsVec &objs = objs_holder->objs_;
-    for (size_t idx = 0; idx < objs.size(); ++idx) {
-      auto& obj = objs[idx];
+    CNObjsVec objs;
+    for (auto& obj : objs_holder->objs_) {
       if (obj_filter_) {
         if (!obj_filter_->Filter(finfo, obj)) continue;
       }
+      objs.push_back(obj);
+    }
+    const bool batching_objs = obj_batching_stage_->SupportBatchingObjs();
+    for (size_t idx = 0; idx < objs.size();) {
+      // objects of this frame that fit in the current batch are preprocessed together when the stage supports it
+      size_t num = batching_objs ? std::min(objs.size() - idx, batchsize_ - batched_finfos_.size()) : 1;
+      CNObjsVec batch_objs(objs.begin() + idx, objs.begin() + idx + num);
+      idx += num;
       try {
-        InferTaskSptr task = obj_batching_stage_->Batching(finfo, obj);
+        InferTaskSptr task = batching_objs ? obj_batching_stage_->BatchingObjs(finfo, batch_objs)
+                                           : obj_batching_stage_->Batching(finfo, batch_objs[0]);
+        if (task) batching_occupancy_->Submit();
         tp_->SubmitTask(task);
       } catch (edk::MluResizeConvertOpError& e) {
         LOGE(INFERENCER) << std::string(e.what());
         continue;
       }
-      batched_finfos_.push_back(std::make_pair(finfo, auto_set_done));
-      batched_objs_.push_back(obj);
+      AddDeadline(finfo);
+      for (auto& obj : batch_objs) {
+        batched_finfos_.push_back(std::make_pair(finfo, auto_set_done));
+        batched_objs_.push_back(obj);
+      }
 
       if (batched_finfos_.size() == batchsize_) {
         BatchingDone();
         timeout_helper_.Reset(NULL);
       } else {
-        timeout_helper_.Reset([this]() -> void { BatchingDone(); });
+        ResetBatchingTimeout();
       }
     }
     if (cached_frame_cnt_ >= batchsize_) {
@@ -188,19 +205,21 @@ InferEngine::ResultWaitingCard InferEngine::FeedData(std::shared_ptr<CNFrameInfo
   } else {
     try {
       InferTaskSptr task = batching_stage_->Batching(finfo);
+      if (task) batching_occupancy_->Submit();
       tp_->SubmitTask(task);
     } catch (edk::MluResizeConvertOpError& e) {
       LOGE(INFERENCER) << std::string(e.what());
       timeout_helper_.UnlockOperator();
       return card;
     }
+    AddDeadline(finfo);
     batched_finfos_.push_back(std::make_pair(finfo, auto_set_done));
 
     if (batched_finfos_.size() == batchsize_) {
       BatchingDone();
       timeout_helper_.Reset(NULL);
     } else {
-      timeout_helper_.Reset([this]() -> void { BatchingDone(); });
+      ResetBatchingTimeout();
     }
   }
   timeout_helper_.UnlockOperator();
@@ -222,6 +241,8 @@ static bool CheckModel(const std::shared_ptr<edk::ModelLoader>& model) {
 }
 
 void InferEngine::StageAssemble() {
+  // tasks of mlu preprocessing by resize convert are counted by the resize_convert stage.
+  batching_occupancy_ = AddOccupancy("preprocess");
   bool cpu_preprocessing = (!batching_by_obj_ && preprocessor_.get()) || (batching_by_obj_ && obj_preprocessor_.get());
   if (cpu_preprocessing) {
     // 1. cpu preprocessing
@@ -234,6 +255,7 @@ void InferEngine::StageAssemble() {
     }
     std::shared_ptr<BatchingDoneStage> h2d_stage =
         std::make_shared<H2DBatchingDoneStage>(model_, batchsize_, dev_id_, cpu_input_res_, mlu_input_res_);
+    h2d_stage->SetOccupancy(AddOccupancy("h2d"));
     batching_done_stages_.push_back(h2d_stage);
   } else {
     // 2. mlu preprocessing
@@ -256,9 +278,16 @@ void InferEngine::StageAssemble() {
       std::shared_ptr<BatchingDoneStage> rc_done_stage =
           std::make_shared<ResizeConvertBatchingDoneStage>(model_, batchsize_, dev_id_, rcop_res_, mlu_input_res_);
       rc_done_stage->SetPerfContext(infer_perf_manager_, infer_thread_id_);
+      rc_done_stage->SetOccupancy(AddOccupancy("resize_convert"));
       batching_done_stages_.push_back(rc_done_stage);
     }
   }
+  if (batching_by_obj_) {
+    obj_batching_stage_->SetOccupancy(batching_occupancy_);
+  } else {
+    batching_stage_->SetOccupancy(batching_occupancy_);
+  }
+
   std::shared_ptr<BatchingDoneStage> infer_stage =
       std::make_shared<InferBatchingDoneStage>(model_, model_input_fmt_,
                                                batchsize_, dev_id_, mlu_input_res_, mlu_output_res_);
@@ -266,10 +295,12 @@ void InferEngine::StageAssemble() {
   infer_stage->SetPerfContext(infer_perf_manager_, infer_thread_id_);
   infer_stage->SetDumpResizedImageDir(dump_resized_image_dir_);
   infer_stage->SetSavingInputData(saving_infer_input_, module_name_);
+  infer_stage->SetOccupancy(AddOccupancy("infer"));
 
   if (!mem_on_mlu_for_postproc_) {
     std::shared_ptr<BatchingDoneStage> d2h_stage =
         std::make_shared<D2HBatchingDoneStage>(model_, batchsize_, dev_id_, mlu_output_res_, cpu_output_res_);
+    d2h_stage->SetOccupancy(AddOccupancy("d2h"));
     batching_done_stages_.push_back(d2h_stage);
   }
 
@@ -281,23 +312,43 @@ void InferEngine::StageAssemble() {
       obj_postproc_stage_ = std::make_shared<ObjPostprocessingBatchingDoneStage>(model_, batchsize_, dev_id_,
                                                                                  obj_postprocessor_, cpu_output_res_);
     }
+    obj_postproc_stage_->SetOccupancy(AddOccupancy("postprocess"));
   } else {
     if (mem_on_mlu_for_postproc_) {
       std::shared_ptr<BatchingDoneStage> postproc_stage =
           std::make_shared<PostprocessingBatchingDoneStage>(model_, batchsize_, dev_id_,
                                                             postprocessor_, mlu_output_res_);
+      postproc_stage->SetOccupancy(AddOccupancy("postprocess"));
       batching_done_stages_.push_back(postproc_stage);
     } else {
       std::shared_ptr<BatchingDoneStage> postproc_stage =
           std::make_shared<PostprocessingBatchingDoneStage>(model_, batchsize_, dev_id_,
                                                             postprocessor_, cpu_output_res_);
+      postproc_stage->SetOccupancy(AddOccupancy("postprocess"));
       batching_done_stages_.push_back(postproc_stage);
     }
   }
 }
 
+void InferEngine::AddDeadline(const std::shared_ptr<CNFrameInfo>& finfo) {
+  if (!finfo->HasDeadline()) return;
+  if (!batch_has_deadline_ || finfo->Deadline() < batch_deadline_) batch_deadline_ = finfo->Deadline();
+  batch_has_deadline_ = true;
+}
+
+void InferEngine::ResetBatchingTimeout() {
+  if (!batch_has_deadline_) {
+    timeout_helper_.Reset([this]() -> void { BatchingDone(); });
+    return;
+  }
+  // the other half is left for inference and the downstream modules
+  float left = std::chrono::duration<float, std::milli>(batch_deadline_ - std::chrono::steady_clock::now()).count();
+  timeout_helper_.Reset([this]() -> void { BatchingDone(); }, left / 2);
+}
+
 void InferEngine::BatchingDone() {
   cached_frame_cnt_ = 0;
+  batch_has_deadline_ = false;
   if (batching_by_obj_) {
     obj_batching_stage_->Reset();
   } else {
@@ -306,15 +357,34 @@ void InferEngine::BatchingDone() {
   if (!batched_finfos_.empty()) {
     for (auto& it : batching_done_stages_) {
       auto tasks = it->BatchingDone(batched_finfos_);
+      it->Occupancy()->Submit(tasks.size());
       tp_->SubmitTask(tasks);
     }
     if (batching_by_obj_) {
       auto tasks = obj_postproc_stage_->ObjBatchingDone(batched_finfos_, batched_objs_);
+      obj_postproc_stage_->Occupancy()->Submit(tasks.size());
       tp_->SubmitTask(tasks);
       batched_objs_.clear();
     }
     batched_finfos_.clear();
+    // the next batch goes to the next io buffers.
+    cpu_input_res_->NextSlot();
+    mlu_input_res_->NextSlot();
+    mlu_output_res_->NextSlot();
+    if (cpu_output_res_) cpu_output_res_->NextSlot();
   }
 }
 
+std::shared_ptr<StageOccupancy> InferEngine::AddOccupancy(const std::string& stage) {
+  auto occupancy = std::make_shared<StageOccupancy>();
+  occupancies_.push_back(std::make_pair(stage, occupancy));
+  return occupancy;
+}
+
+std::vector<InferStageOccupancy> InferEngine::GetStageOccupancy() const {
+  std::vector<InferStageOccupancy> ret;
+  for (const auto& it : occupancies_) ret.push_back(it.second->Get(it.first));
+  return ret;
+}
+
 }  // namespace cnstream
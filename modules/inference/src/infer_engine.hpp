@@ -21,6 +21,7 @@
 #ifndef MODULES_INFERENCE_SRC_INFER_ENGINE_HPP_
 #define MODULES_INFERENCE_SRC_INFER_ENGINE_HPP_
 
+#include <chrono>
 #include <functional>
 #include <future>
 #include <memory>
@@ -32,6 +33,7 @@
 #include "batching_done_stage.hpp"
 #include "cnstream_core.hpp"
 #include "cnstream_frame_va.hpp"
+#include "inferencer.hpp"
 #include "timeout_helper.hpp"
 
 namespace edk {
@@ -54,6 +56,7 @@ class ObjPostproc;
 class InferThreadPool;
 class CNFrameInfo;
 class PerfManager;
+class StageOccupancy;
 
 class InferEngine {
  public:
@@ -76,7 +79,8 @@ class InferEngine {
               CNDataFormat model_input_pixel_format = CN_PIXEL_FORMAT_RGBA32,
               bool mem_on_mlu_for_postproc = false,
               bool saving_infer_input = false,
-              std::string module_name = "");
+              std::string module_name = "",
+              uint32_t io_depth = 1);
   ~InferEngine();
   ResultWaitingCard FeedData(std::shared_ptr<CNFrameInfo> finfo);
 
@@ -84,9 +88,19 @@ class InferEngine {
     BatchingDone();
   }
 
+  /**
+   * Occupancy of the stages, in processing order.
+   */
+  std::vector<InferStageOccupancy> GetStageOccupancy() const;
+
  private:
   void StageAssemble();
   void BatchingDone();
+  /* keeps the earliest deadline of the frames in the batch */
+  void AddDeadline(const std::shared_ptr<CNFrameInfo>& finfo);
+  /* calls BatchingDone after batching_timeout, or earlier if the batch has frames with a deadline */
+  void ResetBatchingTimeout();
+  std::shared_ptr<StageOccupancy> AddOccupancy(const std::string& stage);
   std::shared_ptr<edk::ModelLoader> model_;
   std::shared_ptr<Preproc> preprocessor_;
   std::shared_ptr<Postproc> postprocessor_;
@@ -102,6 +116,9 @@ class InferEngine {
   std::shared_ptr<MluInputResource> mlu_input_res_;
   std::shared_ptr<MluOutputResource> mlu_output_res_;
   std::shared_ptr<RCOpResource> rcop_res_;
+  /* stage name and occupancy, in processing order */
+  std::vector<std::pair<std::string, std::shared_ptr<StageOccupancy>>> occupancies_;
+  std::shared_ptr<StageOccupancy> batching_occupancy_ = nullptr;
 
   TimeoutHelper timeout_helper_;
   std::shared_ptr<InferThreadPool> tp_;
@@ -121,9 +138,12 @@ class InferEngine {
   std::string dump_resized_image_dir_ = "";
   CNDataFormat model_input_fmt_ = CN_PIXEL_FORMAT_RGBA32;
   uint32_t cached_frame_cnt_ = 0;
+  bool batch_has_deadline_ = false;
+  std::chrono::steady_clock::time_point batch_deadline_;
   bool mem_on_mlu_for_postproc_ = false;
   bool saving_infer_input_ = false;
   std::string module_name_ = "";
+  uint32_t io_depth_ = 1;
 };  // class InferEngine
 
 }  // namespace cnstream
@@ -24,8 +24,13 @@
 #include <limits>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "infer_params.hpp"
+#include "rapidjson/document.h"
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
 #define ASSERT(value) {                                 \
   bool __attribute__((unused)) ret = (value);           \
   assert(ret);                                          \
@@ -127,6 +132,34 @@ void InferParamManager::RegisterAll(ParamRegister *pregister) {
   };
   ASSERT(RegisterParam(pregister, param));
 
+  param.name = "custom_preproc_params";
+  param.desc_str = "Optional. A JSON object of parameters passed to the Init function of the custom preprocessing "
+                   "specified by preproc_name. Values that are not strings are passed as JSON text.";
+  param.default_value = "";
+  param.type = "json object";
+  param.parser = [] (const std::string &value, InferParams *param_set) -> bool {
+    param_set->custom_preproc_params.clear();
+    if (value.empty()) return true;
+    rapidjson::Document doc;
+    if (doc.Parse<rapidjson::kParseCommentsFlag>(value.c_str()).HasParseError() || !doc.IsObject()) {
+      return false;
+    }
+    for (auto iter = doc.MemberBegin(); iter != doc.MemberEnd(); ++iter) {
+      std::string item;
+      if (iter->value.IsString()) {
+        item = iter->value.GetString();
+      } else {
+        rapidjson::StringBuffer sbuf;
+        rapidjson::Writer<rapidjson::StringBuffer> jwriter(sbuf);
+        iter->value.Accept(jwriter);
+        item = sbuf.GetString();
+      }
+      param_set->custom_preproc_params[iter->name.GetString()] = item;
+    }
+    return true;
+  };
+  ASSERT(RegisterParam(pregister, param));
+
   param.name = "use_scaler";
   param.desc_str = "Optional. Use scaler to do preprocessing when this parameter set to true and "
                    "preproc_name not set. 1/true/TRUE/True/0/false/FALSE/False these values are accepted.";
@@ -189,6 +222,74 @@ void InferParamManager::RegisterAll(ParamRegister *pregister) {
   };
   ASSERT(RegisterParam(pregister, param));
 
+  param.name = "propagate_objects";
+  param.desc_str = "Optional. Whether to carry the objects of the latest inferred frame onto the frames skipped by "
+                   "[infer_interval], moved by the velocity estimated from the latest two inferred frames. "
+                   "Not valid when object_infer is true. "
+                   "1/true/TRUE/True/0/false/FALSE/False these values are accepted.";
+  param.default_value = "false";
+  param.type = "bool";
+  param.parser = [] (const std::string &value, InferParams *param_set) -> bool {
+    return STR2BOOL(value, &param_set->propagate_objects);
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "motion_threshold";
+  param.desc_str = "Optional. A frame is not inferred if less than this fraction of the regions of interest has "
+                   "changed since the latest inferred frame of the stream, checked on a downscaled luma image. Skipped "
+                   "frames are handled like the frames skipped by [infer_interval]. Frames whose data is not on the CPU, "
+                   "such as frames decoded on the MLU, are always inferred. 0 means all frames are inferred. "
+                   "Not valid when object_infer is true.";
+  param.default_value = "0";
+  param.type = "float";
+  param.parser = [] (const std::string &value, InferParams *param_set) -> bool {
+    return STR2FLOAT(value, &param_set->motion_threshold) && param_set->motion_threshold >= 0 &&
+           param_set->motion_threshold <= 1;
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "motion_max_skip";
+  param.desc_str = "Optional. The maximum number of frames skipped in a row by [motion_threshold].";
+  param.default_value = "25";
+  param.type = "uint32";
+  param.parser = [] (const std::string &value, InferParams *param_set) -> bool {
+    return STR2U32(value, &param_set->motion_max_skip);
+  };
+  ASSERT(RegisterParam(pregister, param));
+
+  param.name = "roi";
+  param.desc_str = "Optional. A JSON object mapping stream ids to regions of interest, each an array of polygons of "
+                   "normalized [x, y] points, e.g. {\"*\": [[[0, 0.5], [1, 0.5], [1, 1], [0, 1]]]}. Streams not "
+                   "listed use the regions of \"*\". Only the changes inside the regions count for "
+                   "[motion_threshold], and objects whose center is outside are dropped. "
+                   "Not valid when object_infer is true.";
+  param.default_value = "";
+  param.type = "json object";
+  param.parser = [] (const std::string &value, InferParams *param_set) -> bool {
+    param_set->roi.clear();
+    if (value.empty()) return true;
+    rapidjson::Document doc;
+    if (doc.Parse<rapidjson::kParseCommentsFlag>(value.c_str()).HasParseError() || !doc.IsObject()) {
+      return false;
+    }
+    for (auto iter = doc.MemberBegin(); iter != doc.MemberEnd(); ++iter) {
+      if (!iter->value.IsArray()) return false;
+      std::vector<RoiPolygon> polygons;
+      for (const auto& jpolygon : iter->value.GetArray()) {
+        if (!jpolygon.IsArray() || jpolygon.Size() < 3) return false;
+        RoiPolygon polygon;
+        for (const auto& jpoint : jpolygon.GetArray()) {
+          if (!jpoint.IsArray() || jpoint.Size() != 2 || !jpoint[0].IsNumber() || !jpoint[1].IsNumber()) return false;
+          polygon.emplace_back(jpoint[0].GetFloat(), jpoint[1].GetFloat());
+        }
+        polygons.push_back(std::move(polygon));
+      }
+      param_set->roi[iter->name.GetString()] = std::move(polygons);
+    }
+    return true;
+  };
+  ASSERT(RegisterParam(pregister, param));
+
   param.name = "show_stats";
   param.desc_str = "Optional. Whether show inferencer performance statistics. "
                    "1/true/TRUE/True/0/false/FALSE/False these values are accepted.";
@@ -285,6 +386,16 @@ void InferParamManager::RegisterAll(ParamRegister *pregister) {
     return STR2BOOL(value, &param_set->saving_infer_input);
   };
   ASSERT(RegisterParam(pregister, param));
+
+  param.name = "io_depth";
+  param.desc_str = "Optional. The number of io buffers of each kind. With more than one buffer, the next batch is "
+                   "preprocessed while the former ones are being copied, run or postprocessed.";
+  param.default_value = "1";
+  param.type = "uint32";
+  param.parser = [](const std::string &value, InferParams *param_set) -> bool {
+    return STR2U32(value, &param_set->io_depth) && param_set->io_depth > 0;
+  };
+  ASSERT(RegisterParam(pregister, param));
 }
 
 bool InferParamManager::RegisterParam(ParamRegister *pregister, const InferParamDesc &param_desc) {
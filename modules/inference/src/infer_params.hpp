@@ -24,10 +24,12 @@
 #include <functional>
 #include <set>
 #include <string>
+#include <unordered_map>
 
 #include "cnstream_config.hpp"
 #include "cnstream_frame_va.hpp"
 #include "easyinfer/model_loader.h"
+#include "motion_gate.hpp"
 
 namespace cnstream {
 
@@ -38,6 +40,10 @@ struct InferParams {
   bool use_scaler = false;
   bool show_stats = false;
   uint32_t infer_interval = 1;
+  bool propagate_objects = false;  // carry objects of inferred frames onto the frames skipped by infer_interval.
+  float motion_threshold = 0;  // fraction of the roi that must change for a frame to be inferred, see MotionGate.
+  uint32_t motion_max_skip = 25;  // maximum number of frames skipped by motion_threshold in a row.
+  RoiPolygons roi;  // regions of interest of each stream.
   uint32_t batching_timeout = 3000;  // ms
   bool keep_aspect_ratio = false;  // mlu preprocessing, keep aspect ratio
   CNDataFormat model_input_pixel_format = CN_PIXEL_FORMAT_RGBA32;
@@ -46,11 +52,13 @@ struct InferParams {
   std::string func_name;
   std::string model_path;
   std::string preproc_name;
+  std::unordered_map<std::string, std::string> custom_preproc_params;
   std::string postproc_name;
   std::string stats_db_name;
   std::string obj_filter_name;
   std::string dump_resized_image_dir = "";  // debug option, dump images(offline-model's input) before infer.
   bool saving_infer_input = false;
+  uint32_t io_depth = 1;  // number of io buffers of each kind, batches in different stages overlap if more than 1.
 };  // struct InferParams
 
 struct InferParamDesc {
@@ -30,13 +30,51 @@
 
 namespace cnstream {
 
-IOResource::IOResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize)
-    : InferResource<IOResValue>(model, batchsize) {}
+IOResource::IOResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, uint32_t depth)
+    : model_(model), batchsize_(batchsize) {
+  if (depth == 0) throw IOResourceError("The depth of io resource should be greater than 0.");
+  for (uint32_t i = 0; i < depth; ++i) slots_.emplace_back(new Slot);
+}
 
 IOResource::~IOResource() {}
 
-CpuInputResource::CpuInputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize)
-    : IOResource(model, batchsize) {}
+void IOResource::Init() {
+  for (auto& slot : slots_) slot->value = Allocate(model_, batchsize_);
+}
+
+void IOResource::Destroy() {
+  for (auto& slot : slots_) {
+    Deallocate(model_, batchsize_, slot->value);
+    slot->value = IOResValue();
+  }
+}
+
+IOResTicket IOResource::PickUpTicket(bool reserve) {
+  IOResTicket ticket;
+  ticket.slot = current_slot_.load();
+  ticket.ticket = slots_[ticket.slot]->server.PickUpTicket(reserve);
+  return ticket;
+}
+
+IOResTicket IOResource::PickUpNewTicket(bool reserve) {
+  IOResTicket ticket;
+  ticket.slot = current_slot_.load();
+  ticket.ticket = slots_[ticket.slot]->server.PickUpNewTicket(reserve);
+  return ticket;
+}
+
+IOResValue IOResource::WaitResourceByTicket(IOResTicket* pticket) {
+  Slot* slot = slots_[pticket->slot].get();
+  slot->server.WaitByTicket(&pticket->ticket);
+  return slot->value;
+}
+
+void IOResource::DeallingDone(const IOResTicket& ticket) { slots_[ticket.slot]->server.DeallingDone(); }
+
+void IOResource::NextSlot() { current_slot_.store((current_slot_.load() + 1) % Depth()); }
+
+CpuInputResource::CpuInputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, uint32_t depth)
+    : IOResource(model, batchsize, depth) {}
 
 CpuInputResource::~CpuInputResource() {}
 
@@ -63,8 +101,8 @@ void CpuInputResource::Deallocate(std::shared_ptr<edk::ModelLoader> model, uint3
   if (value.ptrs) mem_op.FreeCpuInput(value.ptrs);
 }
 
-CpuOutputResource::CpuOutputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize)
-    : IOResource(model, batchsize) {}
+CpuOutputResource::CpuOutputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, uint32_t depth)
+    : IOResource(model, batchsize, depth) {}
 
 CpuOutputResource::~CpuOutputResource() {}
 
@@ -92,8 +130,8 @@ void CpuOutputResource::Deallocate(std::shared_ptr<edk::ModelLoader> model, uint
   if (value.ptrs) mem_op.FreeCpuOutput(value.ptrs);
 }
 
-MluInputResource::MluInputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize)
-    : IOResource(model, batchsize) {}
+MluInputResource::MluInputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, uint32_t depth)
+    : IOResource(model, batchsize, depth) {}
 
 MluInputResource::~MluInputResource() {}
 
@@ -121,8 +159,8 @@ void MluInputResource::Deallocate(std::shared_ptr<edk::ModelLoader> model, uint3
   if (value.ptrs) mem_op.FreeArrayMlu(value.ptrs, input_num);
 }
 
-MluOutputResource::MluOutputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize)
-    : IOResource(model, batchsize) {}
+MluOutputResource::MluOutputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, uint32_t depth)
+    : IOResource(model, batchsize, depth) {}
 
 MluOutputResource::~MluOutputResource() {}
 
@@ -25,6 +25,7 @@
 #include <easyinfer/mlu_memory_op.h>
 #include <easyinfer/model_loader.h>
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -67,24 +68,59 @@ struct IOResValue {
   std::vector<OneData> datas;
 };  // struct IOResValue
 
+/**
+ * A ticket of an IOResource. The ticket owns the buffer of its slot once it is called.
+ */
+struct IOResTicket {
+  QueuingTicket ticket;
+  uint32_t slot = 0;
+};  // struct IOResTicket
+
 CNSTREAM_REGISTER_EXCEPTION(IOResource);
-class IOResource : public InferResource<IOResValue> {
+/**
+ * IO buffers of a model, organized as a ring of `depth` buffers (slots). Each slot is served by its own queuing
+ * server, so tickets of different slots never wait for each other. Tickets are picked up on the current slot, and
+ * InferEngine moves all IO resources to the next slot once a batch is done. Thus all stages of a batch use the same
+ * slot, and the next batch can be preprocessed while the former ones are still being copied or run.
+ */
+class IOResource {
  public:
-  IOResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize);
+  IOResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, uint32_t depth = 1);
   virtual ~IOResource();
 
-  void Init() override { value_ = Allocate(model_, batchsize_); }
+  void Init();
+  void Destroy();
 
-  void Destroy() override { Deallocate(model_, batchsize_, value_); }
+  uint32_t Depth() const { return static_cast<uint32_t>(slots_.size()); }
+  IOResTicket PickUpTicket(bool reserve = false);
+  IOResTicket PickUpNewTicket(bool reserve = false);
+  IOResValue WaitResourceByTicket(IOResTicket* pticket);
+  void DeallingDone(const IOResTicket& ticket);
+  /**
+   * Tickets picked up after this are served by the next slot.
+   */
+  void NextSlot();
+  IOResValue GetDataDirectly() const { return slots_[0]->value; }
 
  protected:
   virtual IOResValue Allocate(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize) = 0;
   virtual void Deallocate(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, const IOResValue& value) = 0;
+
+  const std::shared_ptr<edk::ModelLoader> model_;
+  const uint32_t batchsize_ = 0;
+
+ private:
+  struct Slot {
+    QueuingServer server;
+    IOResValue value;
+  };
+  std::vector<std::unique_ptr<Slot>> slots_;
+  std::atomic<uint32_t> current_slot_{0};
 };  // class IOResource
 
 class CpuInputResource : public IOResource {
  public:
-  CpuInputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize);
+  CpuInputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, uint32_t depth = 1);
   ~CpuInputResource();
 
  protected:
@@ -94,7 +130,7 @@ class CpuInputResource : public IOResource {
 
 class CpuOutputResource : public IOResource {
  public:
-  CpuOutputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize);
+  CpuOutputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, uint32_t depth = 1);
   ~CpuOutputResource();
 
  protected:
@@ -104,7 +140,7 @@ class CpuOutputResource : public IOResource {
 
 class MluInputResource : public IOResource {
  public:
-  MluInputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize);
+  MluInputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, uint32_t depth = 1);
   ~MluInputResource();
 
  protected:
@@ -114,7 +150,7 @@ class MluInputResource : public IOResource {
 
 class MluOutputResource : public IOResource {
  public:
-  MluOutputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize);
+  MluOutputResource(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, uint32_t depth = 1);
   ~MluOutputResource();
 
  protected:
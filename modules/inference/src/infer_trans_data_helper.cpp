@@ -31,7 +31,10 @@
 
 namespace cnstream {
 
-InferTransDataHelper::InferTransDataHelper(Inferencer* infer, int batchsize) : infer_(infer), batchsize_(batchsize) {
+InferTransDataHelper::InferTransDataHelper(Inferencer* infer, int batchsize, bool propagate_objects,
+                                           std::shared_ptr<MotionGate> motion_gate)
+    : infer_(infer), batchsize_(batchsize), motion_gate_(motion_gate) {
+  if (propagate_objects) propagator_.reset(new ObjectPropagator);
   running_.store(true);
   th_ = std::thread(&InferTransDataHelper::Loop, this);
 }
@@ -46,11 +49,11 @@ InferTransDataHelper::~InferTransDataHelper() {
 }
 
 void InferTransDataHelper::SubmitData(
-    const std::pair<std::shared_ptr<CNFrameInfo>, InferEngine::ResultWaitingCard>& data) {
+    const std::pair<std::shared_ptr<CNFrameInfo>, InferEngine::ResultWaitingCard>& data, bool inferred) {
   std::unique_lock<std::mutex> lk(mtx_);
   cond_not_full_.wait(lk, [this] () { return !running_.load() || queue_.size() < size_t(3 * batchsize_); });
   if (!running_.load()) return;
-  queue_.push(data);
+  queue_.push({data.first, data.second, inferred});
   lk.unlock();
   cond_not_empty_.notify_one();
 }
@@ -65,17 +68,31 @@ void InferTransDataHelper::Loop() {
     lk.unlock();
     cond_not_full_.notify_one();
 
-    if (cnstream::IsStreamRemoved(data.first->stream_id)) {
-      if (!data.first->IsEos()) {
+    if (cnstream::IsStreamRemoved(data.finfo->stream_id)) {
+      if (!data.finfo->IsEos()) {
         // discard packet if stream has been removed
         continue;
       }
     }
 
-    auto finfo = data.first;
-    auto card = data.second;
+    auto finfo = data.finfo;
+    auto card = data.card;
     card.WaitForCall();
 
+    if (motion_gate_ && data.inferred && !finfo->IsEos()) {
+      motion_gate_->Filter(finfo);
+    }
+
+    if (propagator_) {
+      if (finfo->IsEos()) {
+        propagator_->Eos(finfo->stream_id);
+      } else if (data.inferred) {
+        propagator_->Inferred(finfo);
+      } else {
+        propagator_->Skipped(finfo);
+      }
+    }
+
     if (infer_) {
       infer_->TransmitData(finfo);
     }
@@ -30,6 +30,8 @@
 #include <thread>
 #include <utility>
 #include "infer_engine.hpp"
+#include "motion_gate.hpp"
+#include "object_propagator.hpp"
 
 namespace cnstream {
 
@@ -38,21 +40,37 @@ class CNFrameInfo;
 
 class InferTransDataHelper {
  public:
-  explicit InferTransDataHelper(Inferencer* infer, int batchsize);
+  /**
+   * @param propagate_objects Whether to carry the objects of inferred frames onto skipped frames, see ObjectPropagator.
+   * @param motion_gate Drops the objects of inferred frames outside the regions of interest if set.
+   */
+  InferTransDataHelper(Inferencer* infer, int batchsize, bool propagate_objects = false,
+                       std::shared_ptr<MotionGate> motion_gate = nullptr);
   ~InferTransDataHelper();
 
-  void SubmitData(const std::pair<std::shared_ptr<CNFrameInfo>, InferEngine::ResultWaitingCard>& data);
+  /**
+   * @param inferred False if the frame is skipped by infer_interval or motion_threshold.
+   */
+  void SubmitData(const std::pair<std::shared_ptr<CNFrameInfo>, InferEngine::ResultWaitingCard>& data,
+                  bool inferred = true);
 
  private:
+  struct TransData {
+    std::shared_ptr<CNFrameInfo> finfo;
+    InferEngine::ResultWaitingCard card;
+    bool inferred;
+  };
   void Loop();
   std::mutex mtx_;
   std::condition_variable cond_not_full_;
   std::condition_variable cond_not_empty_;
-  std::queue<std::pair<std::shared_ptr<CNFrameInfo>, InferEngine::ResultWaitingCard>> queue_;
+  std::queue<TransData> queue_;
   Inferencer* infer_ = nullptr;
   std::thread th_;
   std::atomic<bool> running_;
   int batchsize_ = 1;
+  std::unique_ptr<ObjectPropagator> propagator_;
+  std::shared_ptr<MotionGate> motion_gate_;
 };  // class InferTransDataHelper
 
 }  // namespace cnstream
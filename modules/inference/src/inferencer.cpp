@@ -21,8 +21,10 @@
 #include <device/mlu_context.h>
 #include <easyinfer/model_loader.h>
 
+#include <algorithm>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <unordered_map>
@@ -31,6 +33,7 @@
 
 #include "infer_engine.hpp"
 #include "infer_trans_data_helper.hpp"
+#include "motion_gate.hpp"
 #include "obj_filter.hpp"
 #include "postproc.hpp"
 #include "preproc.hpp"
@@ -49,7 +52,10 @@ struct PerfStats;
 struct InferContext {
   std::shared_ptr<InferEngine> engine;
   std::shared_ptr<InferTransDataHelper> trans_data_helper;
-  int drop_count = 0;
+  std::shared_ptr<MotionGate> motion_gate;
+  std::unordered_map<std::string, uint64_t> drop_counts;  ///< Frames seen of each stream, for infer_interval.
+  std::unordered_map<std::string, InferSkipStats> skip_stats;
+  std::mutex stats_mtx;
 };  // struct InferContext
 
 using InferContextSptr = std::shared_ptr<InferContext>;
@@ -76,6 +82,8 @@ class InferencerPrivate {
 
   std::map<std::thread::id, InferContextSptr> ctxs_;
   std::mutex ctx_mtx_;
+  // set by the latency controller of the pipeline, nullptr if the module is not in a pipeline
+  StreamThrottles* throttles_ = nullptr;
 
   void InferEngineErrorHnadleFunc(const std::string& err_msg) {
     LOGE(INFERENCER) << err_msg;
@@ -110,6 +118,9 @@ class InferencerPrivate {
 
     if (params.object_infer) {
       LOGI(INFERENCER) << "[" << q_ptr_->GetName() << "] inference mode: inference with objects.";
+      if (params.motion_threshold > 0 || !params.roi.empty()) {
+        LOGW(INFERENCER) << "[" << q_ptr_->GetName() << "] motion_threshold and roi are ignored with object_infer.";
+      }
       if (!params.obj_filter_name.empty()) {
         obj_filter_ = std::shared_ptr<ObjFilter>(ObjFilter::Create(params.obj_filter_name));
         if (obj_filter_) {
@@ -129,12 +140,20 @@ class InferencerPrivate {
           LOGE(INFERENCER) << "Can not find ObjPreproc implemention by name: " << params.preproc_name;
           return false;
         }
+        if (obj_preproc_->Init(params.custom_preproc_params) != 0) {
+          LOGE(INFERENCER) << "ObjPreproc [" << params.preproc_name << "] init failed.";
+          return false;
+        }
       } else {
         preproc_ = std::shared_ptr<Preproc>(Preproc::Create(params.preproc_name));
         if (!preproc_) {
           LOGE(INFERENCER) << "Can not find Preproc implemention by name: " << params.preproc_name;
           return false;
         }
+        if (preproc_->Init(params.custom_preproc_params) != 0) {
+          LOGE(INFERENCER) << "Preproc [" << params.preproc_name << "] init failed.";
+          return false;
+        }
       }
     }
 
@@ -242,8 +261,13 @@ class InferencerPrivate {
           params_.model_input_pixel_format,
           params_.mem_on_mlu_for_postproc,
           params_.saving_infer_input,
-          module_name_);
-      ctx->trans_data_helper = std::make_shared<InferTransDataHelper>(q_ptr_, bsize_);
+          module_name_,
+          params_.io_depth);
+      if (!params_.object_infer && (params_.motion_threshold > 0 || !params_.roi.empty())) {
+        ctx->motion_gate = std::make_shared<MotionGate>(params_.motion_threshold, params_.motion_max_skip, params_.roi);
+      }
+      ctx->trans_data_helper = std::make_shared<InferTransDataHelper>(
+          q_ptr_, bsize_, params_.propagate_objects && !params_.object_infer, ctx->motion_gate);
       ctxs_[tid] = ctx;
       if (infer_perf_manager_) {
         infer_perf_manager_->RegisterPerfType(
@@ -392,6 +416,7 @@ bool Inferencer::Open(ModuleParamSet raw_params) {
   if (container_ == nullptr) {
     LOGI(INFERENCER) << name_ << " has not been added into pipeline.";
   } else {
+    d_ptr_->throttles_ = container_->GetStreamThrottles();
   }
 
   return true;
@@ -415,7 +440,10 @@ void Inferencer::Close() {
 int Inferencer::Process(CNFrameInfoPtr data) {
   std::shared_ptr<InferContext> pctx = d_ptr_->GetInferContext();
   bool eos = data->IsEos();
-  bool drop_data = d_ptr_->params_.infer_interval > 0 && pctx->drop_count++ % d_ptr_->params_.infer_interval != 0;
+  // infer_interval is scaled by the throttle set by the latency controller of the pipeline
+  uint32_t interval = std::max(d_ptr_->params_.infer_interval, 1u) *
+                      (d_ptr_->throttles_ ? d_ptr_->throttles_->Get(data->GetStreamIndex()).infer_interval : 1);
+  bool drop_data = !eos && interval > 1 && pctx->drop_counts[data->stream_id]++ % interval != 0;
 
   if (!eos) {
     if (data->IsRemoved()) {
@@ -433,16 +461,37 @@ int Inferencer::Process(CNFrameInfoPtr data) {
     }
   }
 
-  if (eos || drop_data) {
+  bool motion_skip = !eos && !drop_data && pctx->motion_gate && pctx->motion_gate->Skip(data);
+  if (eos) {
+    if (pctx->motion_gate) pctx->motion_gate->Eos(data->stream_id);
+    pctx->drop_counts.erase(data->stream_id);
+    std::lock_guard<std::mutex> lk(pctx->stats_mtx);
+    auto iter = pctx->skip_stats.find(data->stream_id);
+    if (iter != pctx->skip_stats.end()) {
+      LOGI(INFERENCER) << "[" << GetName() << "] stream " << data->stream_id << " skip ratio: "
+                       << iter->second.SkipRatio() << " (" << iter->second.interval_skipped << " by infer_interval, "
+                       << iter->second.motion_skipped << " by motion_threshold, " << iter->second.frames
+                       << " frames).";
+      pctx->skip_stats.erase(iter);
+    }
+  } else {
+    std::lock_guard<std::mutex> lk(pctx->stats_mtx);
+    InferSkipStats& stats = pctx->skip_stats[data->stream_id];
+    stats.stream_id = data->stream_id;
+    stats.frames++;
+    if (drop_data) stats.interval_skipped++;
+    if (motion_skip) stats.motion_skipped++;
+  }
+
+  if (eos || drop_data || motion_skip) {
     if (eos && IsStreamRemoved(data->stream_id)) {
       // minimize batch_timeout delay
       pctx->engine->ForceBatchingDone();
     }
-    if (drop_data) pctx->drop_count %= d_ptr_->params_.infer_interval;
     std::shared_ptr<std::promise<void>> promise = std::make_shared<std::promise<void>>();
     promise->set_value();
     InferEngine::ResultWaitingCard card(promise);
-    pctx->trans_data_helper->SubmitData(std::make_pair(data, card));
+    pctx->trans_data_helper->SubmitData(std::make_pair(data, card), false);
   } else {
     InferEngine::ResultWaitingCard card = pctx->engine->FeedData(data);
     pctx->trans_data_helper->SubmitData(std::make_pair(data, card));
@@ -456,4 +505,35 @@ bool Inferencer::CheckParamSet(const ModuleParamSet &param_set) const {
   return param_manager_->ParseBy(param_set, &params);
 }
 
+std::vector<InferStageOccupancy> Inferencer::GetStageOccupancy() const {
+  std::vector<InferStageOccupancy> ret;
+  if (!d_ptr_) return ret;
+  std::lock_guard<std::mutex> lk(d_ptr_->ctx_mtx_);
+  for (const auto& ctx : d_ptr_->ctxs_) {
+    std::vector<InferStageOccupancy> engine_occupancy = ctx.second->engine->GetStageOccupancy();
+    if (ret.empty()) {
+      ret = engine_occupancy;
+      continue;
+    }
+    for (size_t i = 0; i < ret.size() && i < engine_occupancy.size(); ++i) {
+      ret[i].pending += engine_occupancy[i].pending;
+      ret[i].running += engine_occupancy[i].running;
+      ret[i].max_running = std::max(ret[i].max_running, engine_occupancy[i].max_running);
+      ret[i].finished += engine_occupancy[i].finished;
+    }
+  }
+  return ret;
+}
+
+std::vector<InferSkipStats> Inferencer::GetSkipStats() const {
+  std::vector<InferSkipStats> ret;
+  if (!d_ptr_) return ret;
+  std::lock_guard<std::mutex> lk(d_ptr_->ctx_mtx_);
+  for (const auto& ctx : d_ptr_->ctxs_) {
+    std::lock_guard<std::mutex> stats_lk(ctx.second->stats_mtx);
+    for (const auto& stats : ctx.second->skip_stats) ret.push_back(stats.second);
+  }
+  return ret;
+}
+
 }  // namespace cnstream
@@ -0,0 +1,175 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "motion_gate.hpp"
+
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+constexpr int MotionGate::kGridW;
+constexpr int MotionGate::kGridH;
+constexpr int MotionGate::kLumaDiff;
+
+MotionGate::MotionGate(float threshold, uint32_t max_skip, const RoiPolygons& roi)
+    : threshold_(threshold), max_skip_(max_skip), roi_(roi) {}
+
+bool MotionGate::InPolygon(const RoiPolygon& polygon, float x, float y) {
+  // even-odd rule
+  bool inside = false;
+  for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+    const auto& a = polygon[i];
+    const auto& b = polygon[j];
+    if ((a.second > y) == (b.second > y)) continue;
+    if (x < (b.first - a.first) * (y - a.second) / (b.second - a.second) + a.first) inside = !inside;
+  }
+  return inside;
+}
+
+const std::vector<RoiPolygon>* MotionGate::FindRoi(const std::string& stream_id) const {
+  auto iter = roi_.find(stream_id);
+  if (iter == roi_.end()) iter = roi_.find("*");
+  return iter == roi_.end() ? nullptr : &iter->second;
+}
+
+bool MotionGate::InRoi(const std::vector<RoiPolygon>* polygons, float x, float y) const {
+  if (!polygons) return true;
+  for (const auto& polygon : *polygons) {
+    if (InPolygon(polygon, x, y)) return true;
+  }
+  return false;
+}
+
+bool MotionGate::Gated(const CNDataFrame* frame) {
+  switch (frame->fmt) {
+    case CN_PIXEL_FORMAT_YUV420_NV12:
+    case CN_PIXEL_FORMAT_YUV420_NV21:
+    case CN_PIXEL_FORMAT_BGR24:
+    case CN_PIXEL_FORMAT_RGB24:
+      break;
+    default:
+      return false;
+  }
+  if (!frame->data[0] || frame->width <= 0 || frame->height <= 0) return false;
+  // reading a frame held by the MLU would copy it to the host
+  CNSyncedMemory::SyncedHead head = frame->data[0]->GetHead();
+  return head == CNSyncedMemory::HEAD_AT_CPU || head == CNSyncedMemory::SYNCED;
+}
+
+void MotionGate::Shrink(CNDataFrame* frame, StreamState* state) {
+  const bool packed = frame->fmt == CN_PIXEL_FORMAT_BGR24 || frame->fmt == CN_PIXEL_FORMAT_RGB24;
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(frame->data[0]->GetCpuData());
+
+  // every other pixel of every other row is sampled
+  const int width = frame->width, height = frame->height;
+  const size_t row_bytes = packed ? frame->stride[0] * 3 : frame->stride[0];
+  if (state->col_width != width) {
+    state->col_cells.resize((width + 1) / 2);
+    for (int x = 0; x < width; x += 2) state->col_cells[x / 2] = x * kGridW / width;
+    state->col_width = width;
+  }
+  const int* col_cells = state->col_cells.data();
+  state->sums.assign(kGridW * kGridH, 0);
+  state->counts.assign(kGridW * kGridH, 0);
+  for (int y = 0; y < height; y += 2) {
+    const uint8_t* row = data + y * row_bytes;
+    uint32_t* row_sums = state->sums.data() + y * kGridH / height * kGridW;
+    uint32_t* row_counts = state->counts.data() + y * kGridH / height * kGridW;
+    for (int x = 0; x < width; x += 2) {
+      // (b + 2g + r) / 4 is close enough to luma to tell changes
+      uint32_t luma = packed ? (row[x * 3] + 2 * row[x * 3 + 1] + row[x * 3 + 2]) >> 2 : row[x];
+      row_sums[col_cells[x / 2]] += luma;
+      row_counts[col_cells[x / 2]]++;
+    }
+  }
+  state->grid.resize(kGridW * kGridH);
+  for (size_t i = 0; i < state->grid.size(); ++i) {
+    state->grid[i] = state->counts[i] ? state->sums[i] / state->counts[i] : 0;
+  }
+}
+
+bool MotionGate::Skip(const std::shared_ptr<CNFrameInfo>& finfo) {
+  if (threshold_ <= 0) return false;
+  CNDataFrame* frame = GetCNDataFramePtr(finfo).get();
+  if (!frame || !Gated(frame)) return false;
+
+  auto iter = streams_.find(finfo->stream_id);
+  if (iter == streams_.end()) {
+    StreamState state;
+    const std::vector<RoiPolygon>* polygons = FindRoi(finfo->stream_id);
+    for (int i = 0; i < kGridW * kGridH; ++i) {
+      if (InRoi(polygons, (i % kGridW + 0.5f) / kGridW, (i / kGridW + 0.5f) / kGridH)) state.cells.push_back(i);
+    }
+    if (state.cells.empty()) {
+      LOGW(INFERENCER) << "[MotionGate] Regions of interest of stream " << finfo->stream_id
+                       << " are too small to detect motion, the whole frame is used.";
+      for (int i = 0; i < kGridW * kGridH; ++i) state.cells.push_back(i);
+    }
+    iter = streams_.emplace(finfo->stream_id, std::move(state)).first;
+  }
+  StreamState& state = iter->second;
+  Shrink(frame, &state);
+
+  if (!state.reference.empty() && state.skipped < max_skip_) {
+    size_t changed = 0;
+    for (int i : state.cells) {
+      if (std::abs(static_cast<int>(state.grid[i]) - static_cast<int>(state.reference[i])) > kLumaDiff) ++changed;
+    }
+    if (changed < threshold_ * state.cells.size()) {
+      ++state.skipped;
+      return true;
+    }
+  }
+  state.reference.swap(state.grid);
+  state.skipped = 0;
+  return false;
+}
+
+void MotionGate::Filter(const std::shared_ptr<CNFrameInfo>& finfo) const {
+  const std::vector<RoiPolygon>* polygons = FindRoi(finfo->stream_id);
+  if (!polygons) return;
+  CNInferObjsPtr objs_holder;
+  {
+    SpinLockGuard guard(finfo->datas_lock_);
+    auto iter = finfo->datas.find(CNInferObjsPtrKey);
+    if (iter == finfo->datas.end()) return;
+    objs_holder = cnstream::any_cast<CNInferObjsPtr>(iter->second);
+  }
+  std::lock_guard<std::mutex> lk(objs_holder->mutex_);
+  auto& objs = objs_holder->objs_;
+  size_t kept = 0;
+  for (size_t i = 0; i < objs.size(); ++i) {
+    const CNInferBoundingBox& bbox = objs[i]->bbox;
+    if (InRoi(polygons, bbox.x + bbox.w / 2, bbox.y + bbox.h / 2)) objs[kept++] = objs[i];
+  }
+  objs.resize(kept);
+}
+
+void MotionGate::Eos(const std::string& stream_id) {
+  streams_.erase(stream_id);
+}
+
+}  // namespace cnstream
@@ -0,0 +1,111 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_INFERENCE_SRC_MOTION_GATE_HPP_
+#define MODULES_INFERENCE_SRC_MOTION_GATE_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+
+namespace cnstream {
+
+/**
+ * A polygon of normalized (x, y) points.
+ */
+using RoiPolygon = std::vector<std::pair<float, float>>;
+/**
+ * Polygons of each stream, the polygons keyed by "*" are used by streams not listed.
+ */
+using RoiPolygons = std::unordered_map<std::string, std::vector<RoiPolygon>>;
+
+/**
+ * Decides whether a frame is worth inferring, and drops the objects inferred outside the regions of interest.
+ *
+ * A frame is shrunk into a grid of kGridW x kGridH mean luma values, and compared with the grid of the latest
+ * inferred frame of the stream. A cell has changed if its luma differs by more than kLumaDiff. The frame is skipped if
+ * the changed cells are less than threshold of the cells inside the regions of interest, and at most max_skip frames
+ * in a row are skipped, so that slow changes are caught up with. Only NV12, NV21, BGR24 and RGB24 frames whose data
+ * is already on the CPU are gated, others are always inferred, since copying a frame from the MLU costs more than
+ * inferring it.
+ *
+ * Skip and Eos are not thread-safe, frames of one stream must be passed in order. Filter only reads the regions
+ * and may be called by another thread.
+ */
+class MotionGate {
+ public:
+  static constexpr int kGridW = 64;
+  static constexpr int kGridH = 36;
+  static constexpr int kLumaDiff = 12;
+
+  /**
+   * @param threshold The fraction of changed cells below which a frame is skipped, 0 never skips.
+   * @param max_skip The maximum number of frames skipped in a row.
+   * @param roi The regions of interest, the whole frame if a stream has none.
+   */
+  MotionGate(float threshold, uint32_t max_skip, const RoiPolygons& roi = RoiPolygons());
+
+  /**
+   * Returns true if the frame has not changed enough since the latest inferred frame of the stream.
+   */
+  bool Skip(const std::shared_ptr<CNFrameInfo>& finfo);
+  /**
+   * Removes the objects whose center is outside the regions of interest of the stream.
+   */
+  void Filter(const std::shared_ptr<CNFrameInfo>& finfo) const;
+  /**
+   * Forgets the latest inferred frame of the stream.
+   */
+  void Eos(const std::string& stream_id);
+
+  bool HasRoi() const { return !roi_.empty(); }
+  static bool InPolygon(const RoiPolygon& polygon, float x, float y);
+
+ private:
+  const std::vector<RoiPolygon>* FindRoi(const std::string& stream_id) const;
+  bool InRoi(const std::vector<RoiPolygon>* polygons, float x, float y) const;
+
+  struct StreamState {
+    std::vector<uint8_t> reference;  ///< Grid of the latest inferred frame.
+    std::vector<int> cells;          ///< Indices of the cells inside the regions of interest.
+    uint32_t skipped = 0;            ///< Frames skipped since the latest inferred frame.
+    // scratch buffers of Shrink, kept to avoid allocating them for every frame
+    std::vector<uint8_t> grid;       ///< Grid of the current frame.
+    std::vector<int> col_cells;      ///< Grid column of every sampled pixel column.
+    int col_width = 0;               ///< Frame width col_cells is computed for.
+    std::vector<uint32_t> sums, counts;
+  };
+  static bool Gated(const CNDataFrame* frame);
+  static void Shrink(CNDataFrame* frame, StreamState* state);
+
+  float threshold_ = 0;
+  uint32_t max_skip_ = 0;
+  RoiPolygons roi_;
+  std::unordered_map<std::string, StreamState> streams_;
+};  // class MotionGate
+
+}  // namespace cnstream
+
+#endif  // MODULES_INFERENCE_SRC_MOTION_GATE_HPP_
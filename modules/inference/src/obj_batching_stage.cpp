@@ -29,6 +29,7 @@
 #include "infer_resource.hpp"
 #include "infer_task.hpp"
 #include "preproc.hpp"
+#include "stage_occupancy.hpp"
 
 namespace cnstream {
 
@@ -42,13 +43,14 @@ std::shared_ptr<InferTask> IOObjBatchingStage::Batching(std::shared_ptr<CNFrameI
     // in one batch, reserve resource ticket to parallel.
     reserve_ticket = true;
   }
-  QueuingTicket ticket = output_res_->PickUpTicket(reserve_ticket);
+  IOResTicket ticket = output_res_->PickUpTicket(reserve_ticket);
   auto bidx = batch_idx_;
   std::shared_ptr<InferTask> task = std::make_shared<InferTask>([this, ticket, finfo, obj, bidx]() -> int {
-    QueuingTicket t = ticket;
+    IOResTicket t = ticket;
     IOResValue value = this->output_res_->WaitResourceByTicket(&t);
+    StageOccupancy::Running running(this->occupancy_.get());
     this->ProcessOneObject(finfo, obj, bidx, value);
-    this->output_res_->DeallingDone();
+    this->output_res_->DeallingDone(t);
     return 0;
   });
   task->task_msg = "infer task.";
@@ -56,6 +58,34 @@ std::shared_ptr<InferTask> IOObjBatchingStage::Batching(std::shared_ptr<CNFrameI
   return task;
 }
 
+std::shared_ptr<InferTask> IOObjBatchingStage::BatchingObjs(std::shared_ptr<CNFrameInfo> finfo,
+                                                            const std::vector<std::shared_ptr<CNInferObject>>& objs) {
+  if (objs.empty()) return NULL;
+  // one ticket for all objects, reserved unless they fill up the batch.
+  bool reserve_ticket = batch_idx_ + objs.size() != batchsize_;
+  IOResTicket ticket = output_res_->PickUpTicket(reserve_ticket);
+  auto bidx = batch_idx_;
+  std::shared_ptr<InferTask> task = std::make_shared<InferTask>([this, ticket, finfo, objs, bidx]() -> int {
+    IOResTicket t = ticket;
+    IOResValue value = this->output_res_->WaitResourceByTicket(&t);
+    StageOccupancy::Running running(this->occupancy_.get());
+    this->ProcessObjects(finfo, objs, bidx, value);
+    this->output_res_->DeallingDone(t);
+    return 0;
+  });
+  task->task_msg = "infer task.";
+  batch_idx_ = (batch_idx_ + objs.size()) % batchsize_;
+  return task;
+}
+
+void IOObjBatchingStage::ProcessObjects(std::shared_ptr<CNFrameInfo> finfo,
+                                        const std::vector<std::shared_ptr<CNInferObject>>& objs, uint32_t batch_idx,
+                                        const IOResValue& value) {
+  for (size_t i = 0; i < objs.size(); ++i) {
+    ProcessOneObject(finfo, objs[i], batch_idx + i, value);
+  }
+}
+
 CpuPreprocessingObjBatchingStage::CpuPreprocessingObjBatchingStage(std::shared_ptr<edk::ModelLoader> model,
                                                                    uint32_t batchsize,
                                                                    std::shared_ptr<ObjPreproc> preprocessor,
@@ -74,6 +104,18 @@ void CpuPreprocessingObjBatchingStage::ProcessOneObject(std::shared_ptr<CNFrameI
   preprocessor_->Execute(net_inputs, model_, finfo, obj);
 }
 
+void CpuPreprocessingObjBatchingStage::ProcessObjects(std::shared_ptr<CNFrameInfo> finfo,
+                                                      const std::vector<std::shared_ptr<CNInferObject>>& objs,
+                                                      uint32_t batch_idx, const IOResValue& value) {
+  std::vector<std::vector<float*>> net_inputs(objs.size());
+  for (size_t i = 0; i < objs.size(); ++i) {
+    for (auto it : value.datas) {
+      net_inputs[i].push_back(reinterpret_cast<float*>(it.Offset(batch_idx + i)));
+    }
+  }
+  preprocessor_->ExecuteBatch(net_inputs, model_, finfo, objs);
+}
+
 ResizeConvertObjBatchingStage::ResizeConvertObjBatchingStage(std::shared_ptr<edk::ModelLoader> model,
                                                              uint32_t batchsize, int dev_id,
                                                              std::shared_ptr<RCOpResource> rcop_res)
@@ -22,6 +22,7 @@
 #define MODULES_INFERENCE_SRC_OBJ_BATCHING_STAGE_HPP_
 
 #include <memory>
+#include <vector>
 
 namespace edk {
 class ModelLoader;
@@ -38,6 +39,7 @@ class MluInputResource;
 class CpuInputResource;
 class RCOpResource;
 class ObjPreproc;
+class StageOccupancy;
 
 class ObjBatchingStage {
  public:
@@ -46,11 +48,23 @@ class ObjBatchingStage {
   virtual ~ObjBatchingStage() {}
   virtual std::shared_ptr<InferTask> Batching(std::shared_ptr<CNFrameInfo> finfo,
                                               std::shared_ptr<CNInferObject> obj) = 0;
+  /**
+   * @brief Batches several objects of one frame into consecutive slots of the current batch with a single task.
+   *
+   * Only called when SupportBatchingObjs returns true. The objects must fit in the current batch.
+   */
+  virtual std::shared_ptr<InferTask> BatchingObjs(std::shared_ptr<CNFrameInfo> finfo,
+                                                  const std::vector<std::shared_ptr<CNInferObject>>& objs) {
+    return nullptr;
+  }
+  virtual bool SupportBatchingObjs() const { return false; }
   virtual void Reset() {}
+  void SetOccupancy(std::shared_ptr<StageOccupancy> occupancy) { occupancy_ = occupancy; }
 
  protected:
   std::shared_ptr<edk::ModelLoader> model_;
   uint32_t batchsize_ = 0;
+  std::shared_ptr<StageOccupancy> occupancy_ = nullptr;
 };  // class ObjBatchingStage
 
 class IOObjBatchingStage : public ObjBatchingStage {
@@ -60,11 +74,20 @@ class IOObjBatchingStage : public ObjBatchingStage {
       : ObjBatchingStage(model, batchsize), output_res_(output_res) {}
   virtual ~IOObjBatchingStage() {}
   std::shared_ptr<InferTask> Batching(std::shared_ptr<CNFrameInfo> finfo, std::shared_ptr<CNInferObject> obj) override;
+  std::shared_ptr<InferTask> BatchingObjs(std::shared_ptr<CNFrameInfo> finfo,
+                                          const std::vector<std::shared_ptr<CNInferObject>>& objs) override;
+  bool SupportBatchingObjs() const override { return true; }
   void Reset() override { batch_idx_ = 0; }
 
  protected:
   virtual void ProcessOneObject(std::shared_ptr<CNFrameInfo> finfo, std::shared_ptr<CNInferObject> obj,
                                 uint32_t batch_idx, const IOResValue& value) = 0;
+  /**
+   * @brief Processes objects stored from batch_idx on, one by one by default.
+   */
+  virtual void ProcessObjects(std::shared_ptr<CNFrameInfo> finfo,
+                              const std::vector<std::shared_ptr<CNInferObject>>& objs, uint32_t batch_idx,
+                              const IOResValue& value);
 
  private:
   using ObjBatchingStage::batchsize_;
@@ -82,6 +105,8 @@ class CpuPreprocessingObjBatchingStage : public IOObjBatchingStage {
  private:
   void ProcessOneObject(std::shared_ptr<CNFrameInfo> finfo, std::shared_ptr<CNInferObject> obj, uint32_t batch_idx,
                         const IOResValue& value) override;
+  void ProcessObjects(std::shared_ptr<CNFrameInfo> finfo, const std::vector<std::shared_ptr<CNInferObject>>& objs,
+                      uint32_t batch_idx, const IOResValue& value) override;
   std::shared_ptr<ObjPreproc> preprocessor_;
 };  // class CpuPreprocessingObjBatchingStage
 
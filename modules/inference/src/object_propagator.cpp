@@ -0,0 +1,145 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "object_propagator.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+// objects overlapping less than this are not the same object.
+static constexpr float kMinMatchIou = 0.3f;
+
+static float Iou(const CNInferBoundingBox& a, const CNInferBoundingBox& b) {
+  float w = std::min(a.x + a.w, b.x + b.w) - std::max(a.x, b.x);
+  float h = std::min(a.y + a.h, b.y + b.h) - std::max(a.y, b.y);
+  if (w <= 0 || h <= 0) return 0;
+  float inter = w * h;
+  return inter / (a.w * a.h + b.w * b.h - inter);
+}
+
+static CNInferObjsPtr GetOrCreateObjs(const std::shared_ptr<CNFrameInfo>& finfo) {
+  SpinLockGuard guard(finfo->datas_lock_);
+  auto iter = finfo->datas.find(CNInferObjsPtrKey);
+  if (iter != finfo->datas.end()) return cnstream::any_cast<CNInferObjsPtr>(iter->second);
+  CNInferObjsPtr objs_holder = std::make_shared<CNInferObjs>();
+  finfo->datas[CNInferObjsPtrKey] = objs_holder;
+  return objs_holder;
+}
+
+static bool GetFrameId(const std::shared_ptr<CNFrameInfo>& finfo, uint64_t* frame_id) {
+  SpinLockGuard guard(finfo->datas_lock_);
+  auto iter = finfo->datas.find(CNDataFramePtrKey);
+  if (iter == finfo->datas.end()) return false;
+  *frame_id = cnstream::any_cast<CNDataFramePtr>(iter->second)->frame_id;
+  return true;
+}
+
+void ObjectPropagator::Inferred(const std::shared_ptr<CNFrameInfo>& finfo) {
+  uint64_t frame_id = 0;
+  if (!GetFrameId(finfo, &frame_id)) return;
+  std::vector<std::shared_ptr<CNInferObject>> objs;
+  {
+    CNInferObjsPtr objs_holder = GetOrCreateObjs(finfo);
+    std::lock_guard<std::mutex> lk(objs_holder->mutex_);
+    objs = objs_holder->objs_;
+  }
+
+  StreamState& state = streams_[finfo->stream_id];
+  float gap = frame_id > state.frame_id ? static_cast<float>(frame_id - state.frame_id) : 0.f;
+  std::vector<Track> tracks;
+  tracks.reserve(objs.size());
+  for (const auto& obj : objs) {
+    Track track;
+    track.id = obj->id;
+    track.track_id = obj->track_id;
+    track.score = obj->score;
+    track.bbox = obj->bbox;
+    track.attributes = obj->GetAttributes();
+    track.extra_attributes = obj->GetExtraAttributes();
+    track.features = obj->GetFeatures();
+    track.velocity = {0, 0, 0, 0};
+    const Track* matched = nullptr;
+    float best_iou = kMinMatchIou;
+    for (const auto& former : state.tracks) {
+      if (!track.track_id.empty() && track.track_id == former.track_id) {
+        matched = &former;
+        break;
+      }
+      if (track.id != former.id) continue;
+      float iou = Iou(track.bbox, former.bbox);
+      if (iou >= best_iou) {
+        best_iou = iou;
+        matched = &former;
+      }
+    }
+    if (matched && gap > 0) {
+      const CNInferBoundingBox& from = matched->bbox;
+      track.velocity = {(track.bbox.x - from.x) / gap, (track.bbox.y - from.y) / gap, (track.bbox.w - from.w) / gap,
+                        (track.bbox.h - from.h) / gap};
+    }
+    tracks.push_back(std::move(track));
+  }
+  state.frame_id = frame_id;
+  state.tracks = std::move(tracks);
+}
+
+void ObjectPropagator::Skipped(const std::shared_ptr<CNFrameInfo>& finfo) {
+  auto iter = streams_.find(finfo->stream_id);
+  if (iter == streams_.end()) return;
+  uint64_t frame_id = 0;
+  if (!GetFrameId(finfo, &frame_id)) return;
+  const StreamState& state = iter->second;
+  float gap = frame_id > state.frame_id ? static_cast<float>(frame_id - state.frame_id) : 0.f;
+
+  std::vector<std::shared_ptr<CNInferObject>> objs;
+  objs.reserve(state.tracks.size());
+  for (const auto& track : state.tracks) {
+    const CNInferBoundingBox& bbox = track.bbox;
+    float x1 = std::max(bbox.x + track.velocity.x * gap, 0.f);
+    float y1 = std::max(bbox.y + track.velocity.y * gap, 0.f);
+    float x2 = std::min(bbox.x + bbox.w + (track.velocity.x + track.velocity.w) * gap, 1.f);
+    float y2 = std::min(bbox.y + bbox.h + (track.velocity.y + track.velocity.h) * gap, 1.f);
+    // moved out of the image
+    if (x2 <= x1 || y2 <= y1) continue;
+    auto obj = std::make_shared<CNInferObject>();
+    obj->id = track.id;
+    obj->track_id = track.track_id;
+    obj->score = track.score;
+    obj->bbox = {x1, y1, x2 - x1, y2 - y1};
+    for (const auto& attribute : track.attributes) obj->AddAttribute(attribute);
+    for (const auto& attribute : track.extra_attributes) obj->AddExtraAttribute(attribute.first, attribute.second);
+    for (const auto& feature : track.features) obj->AddFeature(feature.first, feature.second);
+    objs.push_back(std::move(obj));
+  }
+
+  CNInferObjsPtr objs_holder = GetOrCreateObjs(finfo);
+  std::lock_guard<std::mutex> lk(objs_holder->mutex_);
+  objs_holder->objs_.insert(objs_holder->objs_.end(), objs.begin(), objs.end());
+}
+
+void ObjectPropagator::Eos(const std::string& stream_id) { streams_.erase(stream_id); }
+
+}  // namespace cnstream
@@ -0,0 +1,82 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_INFERENCE_SRC_OBJECT_PROPAGATOR_HPP_
+#define MODULES_INFERENCE_SRC_OBJECT_PROPAGATOR_HPP_
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+
+namespace cnstream {
+
+/**
+ * Carries the objects of inferred frames onto the frames skipped by infer_interval, so that downstream modules do not
+ * see objects flicker between inferred frames.
+ *
+ * Each object of an inferred frame is matched with an object of the former inferred frame of the stream: the one with
+ * the same track id, or else the one with the same label and the largest IoU. A matched object moves at a constant
+ * velocity estimated from the two frames, unmatched ones stand still. An object put onto a skipped frame is moved by
+ * its velocity times the number of frames since the latest inferred frame, and clipped to the image.
+ *
+ * Not thread-safe. Frames of one stream must be passed in order.
+ */
+class ObjectPropagator {
+ public:
+  /**
+   * Records the objects of an inferred frame. Called before the frame is transmitted, the objects are copied.
+   */
+  void Inferred(const std::shared_ptr<CNFrameInfo>& finfo);
+  /**
+   * Puts the objects of the latest inferred frame of the stream onto a skipped frame.
+   */
+  void Skipped(const std::shared_ptr<CNFrameInfo>& finfo);
+  /**
+   * Forgets the stream.
+   */
+  void Eos(const std::string& stream_id);
+
+ private:
+  // A copy of an object of an inferred frame. The object itself goes on downstream with the frame, where other
+  // modules (e.g. the tracker) change it concurrently.
+  struct Track {
+    std::string id;
+    std::string track_id;
+    float score = 0;
+    CNInferBoundingBox bbox;
+    std::vector<std::pair<std::string, CNInferAttr>> attributes;
+    StringPairs extra_attributes;
+    CNInferFeatures features;
+    CNInferBoundingBox velocity;  ///< Change of the bounding box per frame.
+  };
+  struct StreamState {
+    uint64_t frame_id = 0;
+    std::vector<Track> tracks;
+  };
+  std::unordered_map<std::string, StreamState> streams_;
+};  // class ObjectPropagator
+
+}  // namespace cnstream
+
+#endif  // MODULES_INFERENCE_SRC_OBJECT_PROPAGATOR_HPP_
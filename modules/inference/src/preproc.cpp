@@ -22,6 +22,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "reflex_object.h"
 
@@ -33,4 +34,14 @@ ObjPreproc* ObjPreproc::Create(const std::string& proc_name) {
   return ReflexObjectEx<ObjPreproc>::CreateObject(proc_name);
 }
 
+int ObjPreproc::ExecuteBatch(const std::vector<std::vector<float*>>& net_inputs,
+                             const std::shared_ptr<edk::ModelLoader>& model, const CNFrameInfoPtr& finfo,
+                             const std::vector<std::shared_ptr<CNInferObject>>& objs) {
+  int ret = 0;
+  for (size_t i = 0; i < objs.size() && i < net_inputs.size(); ++i) {
+    if (Execute(net_inputs[i], model, finfo, objs[i]) != 0) ret = -1;
+  }
+  return ret;
+}
+
 }  // namespace cnstream
@@ -28,10 +28,14 @@
 
 namespace cnstream {
 
-static std::map<std::string, ClassInfo<ReflexObject>> sg_obj_map;
+// constructed on first use, objects may be registered by static initializers of other translation units
+static std::map<std::string, ClassInfo<ReflexObject>>& ObjectMap() {
+  static std::map<std::string, ClassInfo<ReflexObject>> obj_map;
+  return obj_map;
+}
 
 ReflexObject* ReflexObject::CreateObject(const std::string& name) {
-  const auto& obj_map = sg_obj_map;
+  const auto& obj_map = ObjectMap();
   auto info_iter = obj_map.find(name);
 
   if (obj_map.end() == info_iter) return nullptr;
@@ -41,7 +45,7 @@ ReflexObject* ReflexObject::CreateObject(const std::string& name) {
 }
 
 bool ReflexObject::Register(const ClassInfo<ReflexObject>& info) {
-  auto& obj_map = sg_obj_map;
+  auto& obj_map = ObjectMap();
   if (obj_map.find(info.name()) != obj_map.end()) {
     std::cout << "Register object named [" << info.name() << "] failed!!!"
               << "Object name has been registered." << std::endl;
@@ -58,7 +62,7 @@ ReflexObject::~ReflexObject() {}
 
 #ifdef UNIT_TEST
 void ReflexObject::Remove(const std::string& name) {
-  auto& obj_map = sg_obj_map;
+  auto& obj_map = ObjectMap();
   auto info_iter = obj_map.find(name);
 
   if (obj_map.end() != info_iter) {
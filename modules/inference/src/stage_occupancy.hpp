@@ -0,0 +1,83 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_INFERENCE_SRC_STAGE_OCCUPANCY_HPP_
+#define MODULES_INFERENCE_SRC_STAGE_OCCUPANCY_HPP_
+
+#include <atomic>
+#include <string>
+
+#include "inferencer.hpp"
+
+namespace cnstream {
+
+/**
+ * Occupancy counters of an inference stage. InferEngine counts the submitted tasks, and a task counts itself as
+ * running from owning its io buffers until it is done, see StageOccupancy::Running.
+ */
+class StageOccupancy {
+ public:
+  class Running {
+   public:
+    explicit Running(StageOccupancy* occupancy) : occupancy_(occupancy) {
+      if (occupancy_) occupancy_->Start();
+    }
+    ~Running() {
+      if (occupancy_) occupancy_->Finish();
+    }
+
+   private:
+    StageOccupancy* occupancy_;
+  };  // class Running
+
+  void Submit(uint32_t num = 1) { pending_ += num; }
+
+  InferStageOccupancy Get(const std::string& stage) const {
+    InferStageOccupancy ret;
+    ret.stage = stage;
+    ret.pending = pending_.load();
+    ret.running = running_.load();
+    ret.max_running = max_running_.load();
+    ret.finished = finished_.load();
+    return ret;
+  }
+
+ private:
+  void Start() {
+    --pending_;
+    uint32_t running = ++running_;
+    uint32_t max_running = max_running_.load();
+    while (running > max_running && !max_running_.compare_exchange_weak(max_running, running)) {
+    }
+  }
+  void Finish() {
+    --running_;
+    ++finished_;
+  }
+
+  std::atomic<uint32_t> pending_{0};
+  std::atomic<uint32_t> running_{0};
+  std::atomic<uint32_t> max_running_{0};
+  std::atomic<uint64_t> finished_{0};
+};  // class StageOccupancy
+
+}  // namespace cnstream
+
+#endif  // MODULES_INFERENCE_SRC_STAGE_OCCUPANCY_HPP_
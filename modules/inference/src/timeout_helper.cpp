@@ -18,6 +18,7 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <algorithm>
 #include <condition_variable>
 #include <functional>
 #include <mutex>
@@ -48,7 +49,14 @@ int TimeoutHelper::SetTimeout(float timeout) {
   }
 }
 
+int TimeoutHelper::Reset(const std::function<void()>& func, float timeout) {
+  int ret = Reset(func);
+  reset_timeout_ = std::min(std::max(timeout, 0.0f), timeout_);
+  return ret;
+}
+
 int TimeoutHelper::Reset(const std::function<void()>& func) {
+  reset_timeout_ = -1;
   if (STATE_EXIT == state_) {
     LOGW(INFERENCER) << "Timeout Operator has been exit.";
     return 1;
@@ -74,7 +82,8 @@ void TimeoutHelper::HandleFunc() {
   while (state_ != STATE_EXIT) {
     cond_.wait(lk, [this]() -> bool { return state_ == STATE_EXIT || state_ != STATE_NO_FUNC; });
 
-    auto wait_time = std::chrono::nanoseconds(static_cast<uint64_t>(timeout_ * 1e6));
+    float timeout = reset_timeout_ < 0 ? timeout_ : reset_timeout_;
+    auto wait_time = std::chrono::nanoseconds(static_cast<uint64_t>(timeout * 1e6));
     cond_.wait_for(lk, wait_time, [this]() -> bool {
       return state_ == STATE_EXIT || state_ == STATE_NO_FUNC || state_ == STATE_RESET;
     });
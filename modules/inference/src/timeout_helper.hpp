@@ -44,6 +44,10 @@ class TimeoutHelper {
   int SetTimeout(float timeout);
 
   int Reset(const std::function<void()>& func);
+  /**
+   * Same as above, but func is called after at most timeout ms instead of the timeout set by SetTimeout.
+   */
+  int Reset(const std::function<void()>& func, float timeout);
 
  private:
   enum State { STATE_NO_FUNC = 0, STATE_RESET, STATE_DO, STATE_EXIT } state_ = STATE_NO_FUNC;
@@ -54,6 +58,7 @@ class TimeoutHelper {
   std::function<void()> func_;
   std::thread handle_th_;
   float timeout_ = 0;
+  float reset_timeout_ = -1;  // timeout of the current func, negative to use timeout_.
   uint32_t timeout_print_cnt_ = 0;
 };  // class TimeoutHelper
 
@@ -26,8 +26,11 @@
  */
 
 #include <semaphore.h>
+#include <chrono>
 #include <cmath>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
@@ -39,8 +42,6 @@
 
 namespace cnstream {
 
-#define SOCK_BUFSIZE 512  // buffer size
-
 /**
  * An enumerated type that is used to identify the frame info package type transmitting between processores.
  */
@@ -70,9 +71,12 @@ typedef struct {
   DevContext ctx;                            ///< The device context of this frame.
   MemMapType mem_map_type;                   ///< memory map/shared type.
   void* mlu_mem_handle;                      ///< The MLU memory handle for mlu data.
+  int shm_slot = -1;                         ///< The slot in the frame ring of this stream, -1 if not in a ring.
+  CNInferObjsPtr objs = nullptr;             ///< The inference objects of the frame, nullptr if it has none.
 } FrameInfoPackage;
 
 class ModuleIPC;
+class ShmFrameRing;
 
 /**
  * @brief for IPCHandler, base class definition
@@ -132,13 +136,14 @@ class IPCHandler {
    *  @brief  Prepare FrameInfoPackage to send_buf or send_package queue.
    *  @return Void.
    */
-  void PreparePackageToSend(const PkgType& type, const std::shared_ptr<CNFrameInfo> data);
+  void PreparePackageToSend(const PkgType& type, const std::shared_ptr<CNFrameInfo> data, int shm_slot = -1);
 
   /**
    *  @brief  Trans data from FrameInfoPackage to CNFrameInfo data.
-   *  @return Void.
+   *  @return Return false if the frame data is not available, e.g. its frame ring slot could not be mapped. The frame
+   *          should be dropped then.
    */
-  void PackageToCNData(const FrameInfoPackage& pkg, std::shared_ptr<CNFrameInfo> data);
+  bool PackageToCNData(const FrameInfoPackage& pkg, std::shared_ptr<CNFrameInfo> data);
 
   /**
    *  @brief  Get IPCHandler type.
@@ -158,6 +163,12 @@ class IPCHandler {
    */
   inline void SetMaxCachedFrameSize(const uint32_t size) { max_cachedframe_size_ = size; }
 
+  /**
+   *  @brief  Set slot number of the shared memory frame ring of each stream, 0 disables frame rings.
+   *  @return Void.
+   */
+  inline void SetFrameRingSize(const uint32_t size) { frame_ring_size_ = size; }
+
   /**
    *  @brief  Set communication socket address.
    *  @return Void.
@@ -204,37 +215,55 @@ class IPCHandler {
    */
   bool WaitSemphore();
 
- protected:
-#ifdef UNIT_TEST
- public:  // NOLINT
-#endif
   /**
-   *  @brief  Parse string to FrameInfoPackage.
-   *  @return Return true if parse successfully, otherwise, return false.
+   *  @brief  Get the shared memory frame ring of a stream. The client creates it, the server maps it.
+   *          After a failure, the ring is tried again once kFrameRingRetryInterval has passed.
+   *  @param  stream_idx : stream index.
+   *  @param  frame_bytes : bytes of a frame, used as slot size when the ring is created.
+   *  @return Return the frame ring, or nullptr if failed.
    */
-  bool ParseStringToPackage(const std::string& str, FrameInfoPackage* pkg);
+  std::shared_ptr<ShmFrameRing> GetFrameRing(uint32_t stream_idx, size_t frame_bytes);
 
   /**
-   *  @brief  Serialize package to string.
-   *  @return Return true if serialize package successfully, otherwise, return false.
+   *  @brief  Release all frame rings held by this handler.
+   *  @return Void.
+   */
+  void ClearFrameRings();
+
+  /**
+   *  @brief  Pop packages queued to send, and append them to a buffer as binary messages.
+   *  @param  buf : the buffer.
+   *  @param  max_num : max number of packages to pop.
+   *  @return Return the number of packages appended.
    */
-  bool SerializeToString(const FrameInfoPackage& pkg, std::string* str);
+  size_t PopPackagesToSend(std::string* buf, size_t max_num = 64);
 
  protected:
   IPCType ipc_type_ = IPC_INVALID;               // type of this ipc handler
   ModuleIPC* ipc_module_ = nullptr;              // ipc module
   std::string socket_address_;                   // communication socket adress
   MemMapType memmap_type_ = MEMMAP_CPU;          // memory map type, with cpu by default
-  char recv_buf_[SOCK_BUFSIZE];                  // receive buffer
-  char send_buf_[SOCK_BUFSIZE];                  // send buffer
   ThreadSafeQueue<FrameInfoPackage> send_pkgq_;  // queue for package to send
   uint32_t max_cachedframe_size_ = 40;           // max size for cached processed frame map
+  uint32_t frame_ring_size_ = 16;                // slot number of the frame ring of each stream
   DevContext dev_ctx_;                           // device context info for server.
 
  private:
-  sem_t* sem_id_ = nullptr;   // semaphore id
-  bool sem_created_ = false;  // identify if semaphore is created in this instance
-  std::mutex mem_map_mutex_;  // mutex to memory map
+  /**
+   *  @brief  Use a slot of the frame ring as frame data.
+   *  @return Return true if succeed, otherwise, return false.
+   */
+  bool MapFrameRingSlot(const FrameInfoPackage& pkg, CNDataFrame* frame);
+
+ private:
+  sem_t* sem_id_ = nullptr;       // semaphore id
+  bool sem_created_ = false;      // identify if semaphore is created in this instance
+  std::mutex mem_map_mutex_;      // mutex to memory map
+  std::mutex frame_rings_mutex_;  // mutex to frame rings map, slots themselves are acquired lock-free
+  std::map<uint32_t, std::shared_ptr<ShmFrameRing>> frame_rings_;  // frame rings by stream index
+  // when the frame rings failed to be created or mapped may be tried again, by stream index
+  std::map<uint32_t, std::chrono::steady_clock::time_point> frame_ring_retry_time_;
+  static constexpr std::chrono::milliseconds kFrameRingRetryInterval{100};
 };
 
 }  //  namespace cnstream
@@ -18,6 +18,7 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
@@ -26,6 +27,7 @@
 #include "cnstream_frame.hpp"
 #include "device/mlu_context.h"
 #include "module_ipc.hpp"
+#include "shm_frame_ring.hpp"
 
 namespace cnstream {
 
@@ -75,6 +77,7 @@ void IPCClientHandler::Close() {
   }
 
   client_handle_.Close();
+  ClearFrameRings();
 
   // clear all cached processed data, and free all shared memory
   if (processed_frames_map_.size() > 0) {
@@ -91,7 +94,10 @@ void IPCClientHandler::Shutdown() { client_handle_.Shutdown(); }
 void IPCClientHandler::RecvPackageLoop() {
   std::string recv_err_msg;
   while (is_running_.load()) {
-    if (client_handle_.RecvData(recv_buf_, sizeof(recv_buf_)) != sizeof(recv_buf_)) {
+    size_t buf_size = 0;
+    char* buf = recv_reader_.GetWriteBuffer(&buf_size);
+    int recv_size = client_handle_.RecvData(buf, static_cast<int>(buf_size));
+    if (recv_size <= 0) {
       recv_err_msg = "client receive message error";
       LOGE(IPC) << recv_err_msg;
       client_handle_.Close();
@@ -99,42 +105,54 @@ void IPCClientHandler::RecvPackageLoop() {
       ipc_module_->PostEvent(EventType::EVENT_ERROR, recv_err_msg);
       break;
     }
+    recv_reader_.Commit(recv_size);
+
+    int ret;
     FrameInfoPackage recv_pkg;
-    std::string recv_str(recv_buf_);
-    memset(recv_buf_, 0, sizeof(recv_buf_));
-    if (!ParseStringToPackage(recv_str, &recv_pkg)) {
-      LOGW(IPC) << "client parse error.";
+    while ((ret = recv_reader_.Next(&recv_pkg)) > 0) {
+      switch (recv_pkg.pkg_type) {
+        case PkgType::PKG_DATA:
+          break;
+
+        case PkgType::PKG_ERROR:
+          server_closed_.store(true);
+          recv_err_msg =
+              "Client receive error info from communicate process, process id: " + std::to_string(getpid());
+          ipc_module_->PostEvent(EventType::EVENT_ERROR, recv_err_msg);
+          return;
+
+        case PkgType::PKG_EXIT:
+          server_closed_.store(true);
+          return;
+
+        case PkgType::PKG_RELEASE_MEM:
+          if (recv_pkg.stream_id.empty()) break;
+          recv_releaseq_.Push(recv_pkg);
+          break;
+
+        default:
+          break;
+      }
     }
-
-    switch (recv_pkg.pkg_type) {
-      case PkgType::PKG_DATA:
-        break;
-
-      case PkgType::PKG_ERROR:
-        server_closed_.store(true);
-        recv_err_msg = "Client receive error info from communicate process, process id: " + std::to_string(getpid());
-        ipc_module_->PostEvent(EventType::EVENT_ERROR, recv_err_msg);
-        return;
-
-      case PkgType::PKG_EXIT:
-        server_closed_.store(true);
-        return;
-
-      case PkgType::PKG_RELEASE_MEM:
-        if (recv_pkg.stream_id.empty()) break;
-        recv_releaseq_.Push(recv_pkg);
-        break;
-
-      default:
-        break;
+    if (ret < 0) {
+      recv_err_msg = "client receive invalid message";
+      LOGE(IPC) << recv_err_msg;
+      client_handle_.Close();
+      is_connected_.store(false);
+      ipc_module_->PostEvent(EventType::EVENT_ERROR, recv_err_msg);
+      break;
     }
   }
 }
 
 bool IPCClientHandler::Send() {
+  // packages queued by all threads meanwhile are sent together by whoever gets the lock
+  std::lock_guard<std::mutex> lock(send_mutex_);
+  send_buf_.clear();
+  if (PopPackagesToSend(&send_buf_, SIZE_MAX) == 0) return true;
   if (is_connected_.load()) {
-    if (client_handle_.SendData(send_buf_, sizeof(send_buf_)) != sizeof(send_buf_)) {
-      LOGW() << " client send message to server failed.";
+    if (!client_handle_.SendAll(send_buf_.data(), send_buf_.size())) {
+      LOGW(IPC) << " client send message to server failed.";
       return false;
     }
   }
@@ -178,4 +196,27 @@ bool IPCClientHandler::CacheProcessedData(std::shared_ptr<CNFrameInfo> data) {
   return false;
 }
 
+int IPCClientHandler::CopyToFrameRing(std::shared_ptr<CNFrameInfo> data) {
+  if (memmap_type_ != MEMMAP_CPU || frame_ring_size_ == 0) return -1;
+  CNDataFramePtr frame = cnstream::GetCNDataFramePtr(data);
+  size_t bytes = frame->GetBytes();
+  if (!bytes) return -1;
+  std::shared_ptr<ShmFrameRing> ring = GetFrameRing(data->GetStreamIndex(), bytes);
+  // e.g. resolution of the stream grows, such frames go through their own shared memory
+  if (!ring || ring->GetSlotSize() < bytes) return -1;
+
+  int slot = -1;
+  while ((slot = ring->Acquire()) < 0) {
+    if (!is_running_.load() || !is_connected_.load()) return -1;
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+  }
+  uint8_t* dst = ring->GetSlot(slot);
+  for (int i = 0; i < frame->GetPlanes(); i++) {
+    size_t plane_size = frame->GetPlaneBytes(i);
+    memcpy(dst, frame->data[i]->GetCpuData(), plane_size);
+    dst += plane_size;
+  }
+  return slot;
+}
+
 }  //  namespace cnstream
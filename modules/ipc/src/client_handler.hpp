@@ -28,6 +28,7 @@
 
 #include "cnsocket.hpp"
 #include "ipc_handler.hpp"
+#include "ipc_protocol.hpp"
 
 namespace cnstream {
 
@@ -91,6 +92,12 @@ class IPCClientHandler : public IPCHandler {
    */
   bool CacheProcessedData(std::shared_ptr<CNFrameInfo> data);
 
+  /**
+   *  @brief  Copy frame data into a free slot of the frame ring of its stream, waits while the ring is full.
+   *  @return Return the slot index, or -1 if frame ring is not used for this frame.
+   */
+  int CopyToFrameRing(std::shared_ptr<CNFrameInfo> data);
+
 #ifdef UNIT_TEST
   /**
    *  @brief  Get communicate server state.
@@ -118,6 +125,9 @@ class IPCClientHandler : public IPCHandler {
   std::map<std::string, std::shared_ptr<CNFrameInfo>>
       processed_frames_map_;                     // frames which is processed, and wait to release memory
   std::condition_variable framesmap_full_cond_;  // condition variable for processed frames map size
+  IPCMessageReader recv_reader_;                 // splits received bytes into packages
+  std::mutex send_mutex_;                        // mutex for sending, packages are sent in batches
+  std::string send_buf_;                         // binary messages to send
 };
 
 }  //  namespace cnstream
@@ -53,6 +53,21 @@ int CNSocket::SendData(char* send_buf, int buf_size) {
   return -1;
 }
 
+bool CNSocket::SendAll(const char* send_buf, size_t size) {
+  if (nullptr == send_buf) return false;
+  while (size > 0) {
+    // MSG_NOSIGNAL: a closed peer is reported by return value instead of SIGPIPE
+    ssize_t ret = send(socket_fd_, send_buf, size, MSG_NOSIGNAL);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    send_buf += ret;
+    size -= ret;
+  }
+  return true;
+}
+
 bool CNServer::Open(const std::string& socket_address) {
   listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
   if (-1 == listen_fd_) {
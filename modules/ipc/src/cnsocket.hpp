@@ -65,6 +65,12 @@ class CNSocket {
    */
   int SendData(char* buf, int buf_size);
 
+  /**
+   *  @brief  Send all data to socket fd, continues after partial sends.
+   *  @return Return true if all data is sent, otherwise, return false.
+   */
+  bool SendAll(const char* buf, size_t size);
+
   std::string socket_addr_;  // communicate socket address
   int socket_fd_ = -1;       // socket fd to read and write
 };
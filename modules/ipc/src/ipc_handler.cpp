@@ -18,18 +18,19 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <cnrt.h>
 #include <fcntl.h>
-#include <rapidjson/document.h>
-#include <rapidjson/rapidjson.h>
-#include <rapidjson/stringbuffer.h>
-#include <rapidjson/writer.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <cstring>
 #include <memory>
 #include <string>
 
+#include "cnstream_allocator.hpp"
 #include "ipc_handler.hpp"
+#include "ipc_protocol.hpp"
+#include "shm_frame_ring.hpp"
 
 namespace cnstream {
 
@@ -78,211 +79,7 @@ bool IPCHandler::WaitSemphore() {
   return false;
 }
 
-bool IPCHandler::ParseStringToPackage(const std::string& str, FrameInfoPackage* pkg) {
-  if (!pkg) return false;
-
-  rapidjson::Document doc;
-  if (doc.Parse<rapidjson::kParseCommentsFlag>(str.c_str()).HasParseError()) {
-    LOGE(IPC) << "SerializeFromString failed. Error code [" << std::to_string(doc.GetParseError()) << "]"
-               << " Offset [" << std::to_string(doc.GetErrorOffset()) << "]. JSON:" << str;
-    return false;
-  }
-
-  // get members
-  const auto end = doc.MemberEnd();
-
-  // pkg_type
-  if (end == doc.FindMember("pkg_type") || !doc["pkg_type"].IsInt()) {
-    return false;
-  } else {
-    pkg->pkg_type = PkgType(doc["pkg_type"].GetInt());
-  }
-
-  if (PKG_RELEASE_MEM == pkg->pkg_type || PKG_DATA == pkg->pkg_type) {
-    if (end == doc.FindMember("stream_id") || !doc["stream_id"].IsString()) {
-      LOGW(IPC) << "parse stream_id error.";
-      return false;
-    } else {
-      pkg->stream_id = doc["stream_id"].GetString();
-    }
-
-    if (end == doc.FindMember("stream_idx") || !doc["stream_idx"].IsUint()) {
-      LOGW(IPC) << "parse stream_idx error.";
-      return false;
-    } else {
-      pkg->stream_idx = doc["stream_idx"].GetUint();
-    }
-
-    if (end == doc.FindMember("frame_id") || !doc["frame_id"].IsInt64()) {
-      LOGW(IPC) << "parse frame_id error.";
-      return false;
-    } else {
-      pkg->frame_id = doc["frame_id"].GetInt64();
-    }
-  }
-
-  if (PKG_DATA == pkg->pkg_type) {
-    if (end == doc.FindMember("flags") || !doc["flags"].IsUint()) {
-      LOGW(IPC) << "parse flags error.";
-      return false;
-    } else {
-      pkg->flags = doc["flags"].GetUint();
-    }
-
-    if (end == doc.FindMember("timestamp") || !doc["timestamp"].IsInt64()) {
-      LOGW(IPC) << "parse timestamp error.";
-      return false;
-    } else {
-      pkg->timestamp = doc["timestamp"].GetInt64();
-    }
-
-    if (end == doc.FindMember("data_fmt") || !doc["data_fmt"].IsInt()) {
-      LOGW(IPC) << "parse data fmt error.";
-      return false;
-    } else {
-      pkg->fmt = CNDataFormat(doc["data_fmt"].GetInt());
-    }
-
-    if (end == doc.FindMember("width") || !doc["width"].IsInt()) {
-      LOGW(IPC) << "parse width error.";
-      return false;
-    } else {
-      pkg->width = doc["width"].GetInt();
-    }
-
-    if (end == doc.FindMember("height") || !doc["height"].IsInt()) {
-      LOGW(IPC) << "parse height error.";
-      return false;
-    } else {
-      pkg->height = doc["height"].GetInt();
-    }
-
-    if (end == doc.FindMember("strides") || !doc["strides"].IsArray()) {
-      LOGW(IPC) << "parse strides error.";
-      return false;
-    } else {
-      auto values = doc["strides"].GetArray();
-      int i = 0;
-      for (auto iter = values.begin(); iter != values.end(); ++iter) {
-        if (!iter->IsInt()) {
-          LOGW(IPC) << "parse strides type error.";
-          return false;
-        }
-        pkg->stride[i] = iter->GetInt();
-        i++;
-      }
-    }
-
-    if (end == doc.FindMember("dev_type") || !doc["dev_type"].IsInt()) {
-      LOGW(IPC) << "parse dev_type error.";
-      return false;
-    } else {
-      pkg->ctx.dev_type = DevContext::DevType(doc["dev_type"].GetInt());
-    }
-
-    if (end == doc.FindMember("dev_id") || !doc["dev_id"].IsInt()) {
-      LOGW(IPC) << "parse dev_id error.";
-      return false;
-    } else {
-      pkg->ctx.dev_id = doc["dev_id"].GetInt();
-    }
-
-    if (end == doc.FindMember("ddr_channel") || !doc["ddr_channel"].IsInt()) {
-      LOGW(IPC) << "parse ddr_channel error.";
-      return false;
-    } else {
-      pkg->ctx.ddr_channel = doc["ddr_channel"].GetInt();
-    }
-
-    if (end == doc.FindMember("mem_map_type") || !doc["mem_map_type"].IsInt()) {
-      LOGW(IPC) << "parse mem_map_type error.";
-      return false;
-    } else {
-      pkg->mem_map_type = MemMapType(doc["mem_map_type"].GetInt());
-    }
-
-    if (end == doc.FindMember("mlu_mem_handle") || !doc["mlu_mem_handle"].IsString()) {
-      LOGW(IPC) << "parse mlu_mem_handle error.";
-      return false;
-    } else {
-      try {
-        intptr_t tmp = std::stoll(doc["mlu_mem_handle"].GetString());
-        pkg->mlu_mem_handle = reinterpret_cast<void*>(tmp);
-      } catch (const std::invalid_argument& e) {
-        LOGW(IPC) << "mlu_mem_handle is invalid.";
-        return false;
-      }
-    }
-  }
-  return true;
-}
-
-bool IPCHandler::SerializeToString(const FrameInfoPackage& pkg, std::string* str) {
-  if (!str) return false;
-  rapidjson::StringBuffer strBuf;
-  rapidjson::Writer<rapidjson::StringBuffer> writer(strBuf);
-  writer.StartObject();
-
-  writer.Key("pkg_type");
-  writer.Int(static_cast<int>(pkg.pkg_type));
-
-  if (PKG_DATA == pkg.pkg_type || PKG_RELEASE_MEM == pkg.pkg_type) {
-    writer.Key("stream_idx");
-    writer.Uint(pkg.stream_idx);
-
-    writer.Key("stream_id");
-    writer.String(pkg.stream_id.c_str());
-
-    writer.Key("frame_id");
-    writer.Int64(pkg.frame_id);
-  }
-
-  if (PKG_DATA == pkg.pkg_type) {
-    writer.Key("flags");
-    writer.Uint(pkg.flags);
-
-    writer.Key("timestamp");
-    writer.Int64(pkg.timestamp);
-
-    writer.Key("data_fmt");
-    writer.Int(static_cast<int>(pkg.fmt));
-
-    writer.Key("width");
-    writer.Int(pkg.width);
-
-    writer.Key("height");
-    writer.Int(pkg.height);
-
-    writer.Key("strides");
-    writer.StartArray();
-    for (int i = 0; i < CN_MAX_PLANES; i++) {
-      writer.Int(pkg.stride[i]);
-    }
-    writer.EndArray();
-
-    writer.Key("dev_type");
-    writer.Int(static_cast<int>(pkg.ctx.dev_type));
-
-    writer.Key("dev_id");
-    writer.Int(pkg.ctx.dev_id);
-
-    writer.Key("ddr_channel");
-    writer.Int(pkg.ctx.ddr_channel);
-
-    writer.Key("mem_map_type");
-    writer.Int(static_cast<int>(pkg.mem_map_type));
-
-    writer.Key("mlu_mem_handle");
-    intptr_t ptmp = reinterpret_cast<intptr_t>(pkg.mlu_mem_handle);
-    writer.String(std::to_string(ptmp).c_str());
-  }
-  writer.EndObject();
-
-  *str = strBuf.GetString();
-  return true;
-}
-
-void IPCHandler::PreparePackageToSend(const PkgType& type, const std::shared_ptr<CNFrameInfo> data) {
+void IPCHandler::PreparePackageToSend(const PkgType& type, const std::shared_ptr<CNFrameInfo> data, int shm_slot) {
   FrameInfoPackage send_pkg;
   switch (type) {
     case PkgType::PKG_DATA: {
@@ -297,6 +94,7 @@ void IPCHandler::PreparePackageToSend(const PkgType& type, const std::shared_ptr
       send_pkg.flags = data->flags;
       send_pkg.timestamp = data->timestamp;
       send_pkg.mem_map_type = memmap_type_;
+      send_pkg.shm_slot = shm_slot;
       if (!data->IsEos()) {
         CNDataFramePtr frame = cnstream::GetCNDataFramePtr(data);
         send_pkg.frame_id = frame->frame_id;
@@ -311,6 +109,14 @@ void IPCHandler::PreparePackageToSend(const PkgType& type, const std::shared_ptr
         send_pkg.ctx.dev_type = frame->ctx.dev_type;
         send_pkg.ctx.dev_id = frame->ctx.dev_id;
         send_pkg.ctx.ddr_channel = frame->ctx.ddr_channel;
+
+        bool has_objs = false;
+        {
+          SpinLockGuard guard(data->datas_lock_);
+          has_objs = data->datas.find(CNInferObjsPtrKey) != data->datas.end();
+        }
+        // shared with the frame, objects are serialized when the package is sent
+        if (has_objs) send_pkg.objs = cnstream::GetCNInferObjsPtr(data);
       }
     } break;
     case PkgType::PKG_RELEASE_MEM: {
@@ -338,26 +144,29 @@ void IPCHandler::PreparePackageToSend(const PkgType& type, const std::shared_ptr
       return;
   }
 
-  if (IPC_CLIENT == ipc_type_) {
-    std::string send_str;
-    SerializeToString(send_pkg, &send_str);
-    memset(send_buf_, 0, sizeof(send_buf_));
-    memcpy(send_buf_, send_str.c_str(), send_str.length());
-  } else if (IPC_SERVER == ipc_type_) {
-    send_pkgq_.Push(send_pkg);
+  send_pkgq_.Push(send_pkg);
+}
+
+size_t IPCHandler::PopPackagesToSend(std::string* buf, size_t max_num) {
+  size_t num = 0;
+  FrameInfoPackage pkg;
+  while (num < max_num && send_pkgq_.TryPop(pkg)) {
+    SerializeToBinary(pkg, buf);
+    num++;
   }
+  return num;
 }
 
-void IPCHandler::PackageToCNData(const FrameInfoPackage& recv_pkg, std::shared_ptr<CNFrameInfo> data) {
+bool IPCHandler::PackageToCNData(const FrameInfoPackage& recv_pkg, std::shared_ptr<CNFrameInfo> data) {
   if (!data) {
     LOGW(IPC) << "frame data for trans message pack is nullptr, pack message frame id: " << recv_pkg.frame_id
                  << std::endl;
-    return;
+    return false;
   }
 
   std::shared_ptr<CNDataFrame> dataframe(new (std::nothrow) CNDataFrame());
   if (!dataframe) {
-    return;
+    return false;
   }
   data->flags = recv_pkg.flags;
   data->SetStreamIndex(recv_pkg.stream_idx);
@@ -365,7 +174,7 @@ void IPCHandler::PackageToCNData(const FrameInfoPackage& recv_pkg, std::shared_p
   data->timestamp = recv_pkg.timestamp;
   // sync shared memory for frame data
   if (data->IsEos()) {
-    return;
+    return true;
   }
 
   dataframe->frame_id = recv_pkg.frame_id;
@@ -390,13 +199,99 @@ void IPCHandler::PackageToCNData(const FrameInfoPackage& recv_pkg, std::shared_p
   }
 
   // sync shared memory for frame data
-  if (!data->IsEos()) {
+  if (recv_pkg.shm_slot >= 0) {
+    // e.g. the client restarted and the ring is not created yet, the frame is only in the ring
+    if (!MapFrameRingSlot(recv_pkg, dataframe.get())) {
+      LOGE(IPC) << "map frame ring slot failed, drop frame, stream_idx: " << recv_pkg.stream_idx
+                << ", slot: " << recv_pkg.shm_slot << ", frame id: " << recv_pkg.frame_id;
+      return false;
+    }
+  } else {
     std::lock_guard<std::mutex> lock(mem_map_mutex_);
     dataframe->MmapSharedMem(memmap_type_, data->stream_id);
   }
 
   data->datas[CNDataFramePtrKey] = dataframe;
-  return;
+  if (recv_pkg.objs) data->datas[CNInferObjsPtrKey] = recv_pkg.objs;
+  return true;
+}
+
+constexpr std::chrono::milliseconds IPCHandler::kFrameRingRetryInterval;
+
+std::shared_ptr<ShmFrameRing> IPCHandler::GetFrameRing(uint32_t stream_idx, size_t frame_bytes) {
+  std::lock_guard<std::mutex> lock(frame_rings_mutex_);
+  auto iter = frame_rings_.find(stream_idx);
+  if (iter != frame_rings_.end()) return iter->second;
+  auto now = std::chrono::steady_clock::now();
+  auto retry_iter = frame_ring_retry_time_.find(stream_idx);
+  if (retry_iter != frame_ring_retry_time_.end() && now < retry_iter->second) return nullptr;
+
+  // created once per stream and kept until close, a failed attempt is retried after a while
+  const std::string name = ShmFrameRing::GetName(socket_address_, stream_idx);
+  std::shared_ptr<ShmFrameRing> ring;
+  if (IPC_CLIENT == ipc_type_) {
+    ring = ShmFrameRing::Create(name, frame_ring_size_, frame_bytes);
+  } else {
+    ring = ShmFrameRing::Open(name);
+  }
+  if (!ring) {
+    frame_ring_retry_time_[stream_idx] = now + kFrameRingRetryInterval;
+    return nullptr;
+  }
+  frame_ring_retry_time_.erase(stream_idx);
+  frame_rings_[stream_idx] = ring;
+  return ring;
+}
+
+void IPCHandler::ClearFrameRings() {
+  std::lock_guard<std::mutex> lock(frame_rings_mutex_);
+  frame_rings_.clear();
+  frame_ring_retry_time_.clear();
+}
+
+bool IPCHandler::MapFrameRingSlot(const FrameInfoPackage& pkg, CNDataFrame* frame) {
+  std::shared_ptr<ShmFrameRing> ring = GetFrameRing(pkg.stream_idx, 0);
+  if (!ring) return false;
+  uint8_t* slot_data = ring->GetSlot(pkg.shm_slot);
+  size_t bytes = frame->GetBytes();
+  if (!slot_data) return false;
+  if (bytes > ring->GetSlotSize()) {
+    ring->Release(pkg.shm_slot);
+    return false;
+  }
+
+  // the slot goes back to the client once nothing refers to it any more
+  int slot = pkg.shm_slot;
+  std::shared_ptr<void> slot_ref(slot_data, [ring, slot](void*) { ring->Release(slot); });
+  if (frame->ctx.dev_type == DevContext::CPU) {
+    // used in place, no copy
+    frame->cpu_data = slot_ref;
+    uint8_t* ptmp = slot_data;
+    for (int i = 0; i < frame->GetPlanes(); i++) {
+      size_t plane_size = frame->GetPlaneBytes(i);
+      frame->data[i].reset(new (std::nothrow) CNSyncedMemory(plane_size));
+      frame->data[i]->SetCpuData(ptmp);
+      ptmp += plane_size;
+    }
+  } else if (frame->ctx.dev_type == DevContext::MLU) {
+    frame->mlu_data = cnMluMemAlloc(ROUND_UP(bytes, 64 * 1024), frame->ctx.dev_id);
+    if (nullptr == frame->mlu_data) return false;
+    auto dst = reinterpret_cast<uint8_t*>(frame->mlu_data.get());
+    cnrtRet_t ret = cnrtMemcpy(dst, slot_data, bytes, CNRT_MEM_TRANS_DIR_HOST2DEV);
+    if (ret != CNRT_RET_SUCCESS) {
+      LOGE(IPC) << "MapFrameRingSlot: failed to cnrtMemcpy, ret = " << ret;
+      return false;
+    }
+    for (int i = 0; i < frame->GetPlanes(); i++) {
+      size_t plane_size = frame->GetPlaneBytes(i);
+      frame->data[i].reset(new (std::nothrow) CNSyncedMemory(plane_size, frame->ctx.dev_id, frame->ctx.ddr_channel));
+      frame->data[i]->SetMluData(dst);
+      dst += plane_size;
+    }
+  } else {
+    return false;
+  }
+  return true;
 }
 
 }  //  namespace cnstream
@@ -0,0 +1,362 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "ipc_protocol.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cnstream {
+
+/*
+ * Fixed part of a frame. Append new fields at the end only.
+ */
+struct IPCFrameRecord {
+  uint64_t frame_id;
+  int64_t timestamp;
+  uint64_t flags;
+  uint64_t mlu_mem_handle;
+  uint32_t stream_idx;
+  int32_t fmt;
+  int32_t width;
+  int32_t height;
+  int32_t stride[CN_MAX_PLANES];
+  int32_t dev_type;
+  int32_t dev_id;
+  int32_t ddr_channel;
+  int32_t mem_map_type;
+  int32_t shm_slot;
+  int32_t reserved;
+};
+
+struct IPCSectionHeader {
+  uint16_t tag;
+  uint16_t reserved;
+  uint32_t size;
+};
+
+namespace {
+
+class BinaryWriter {
+ public:
+  explicit BinaryWriter(std::string* buf) : buf_(buf) {}
+  template <typename T>
+  void Put(const T& value) {
+    buf_->append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+  void PutString(const std::string& str) {
+    Put(static_cast<uint32_t>(str.size()));
+    buf_->append(str);
+  }
+  void PutFloats(const std::vector<float>& values) {
+    Put(static_cast<uint32_t>(values.size()));
+    buf_->append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(float));
+  }
+  // reserves a placeholder, returns its offset for Patch
+  template <typename T>
+  size_t Reserve() {
+    size_t offset = buf_->size();
+    buf_->append(sizeof(T), '\0');
+    return offset;
+  }
+  template <typename T>
+  void Patch(size_t offset, const T& value) {
+    memcpy(&(*buf_)[offset], &value, sizeof(T));
+  }
+  size_t Size() const { return buf_->size(); }
+
+ private:
+  std::string* buf_;
+};
+
+class BinaryReader {
+ public:
+  BinaryReader(const char* data, size_t size) : cur_(data), end_(data + size) {}
+  template <typename T>
+  bool Get(T* value) {
+    if (Remain() < sizeof(T)) return Fail();
+    memcpy(value, cur_, sizeof(T));
+    cur_ += sizeof(T);
+    return true;
+  }
+  bool GetString(std::string* str) {
+    uint32_t len;
+    if (!Get(&len) || Remain() < len) return Fail();
+    str->assign(cur_, len);
+    cur_ += len;
+    return true;
+  }
+  bool GetFloats(std::vector<float>* values) {
+    uint32_t len;
+    if (!Get(&len) || Remain() / sizeof(float) < len) return Fail();
+    values->resize(len);
+    memcpy(values->data(), cur_, len * sizeof(float));
+    cur_ += len * sizeof(float);
+    return true;
+  }
+  // a record shorter than T leaves the missing tail zero-filled, a longer one has its unknown tail ignored
+  template <typename T>
+  bool GetRecord(T* record, size_t size) {
+    if (Remain() < size) return Fail();
+    memset(record, 0, sizeof(T));
+    memcpy(record, cur_, std::min(size, sizeof(T)));
+    cur_ += size;
+    return true;
+  }
+  bool Skip(size_t size) {
+    if (Remain() < size) return Fail();
+    cur_ += size;
+    return true;
+  }
+  const char* Current() const { return cur_; }
+  size_t Remain() const { return end_ - cur_; }
+  bool Ok() const { return ok_; }
+
+ private:
+  bool Fail() {
+    ok_ = false;
+    return false;
+  }
+  const char* cur_;
+  const char* end_;
+  bool ok_ = true;
+};
+
+void SerializeObject(const std::shared_ptr<CNInferObject>& obj, BinaryWriter* writer) {
+  size_t size_offset = writer->Reserve<uint32_t>();
+  writer->PutString(obj->id);
+  writer->PutString(obj->track_id);
+  writer->Put(obj->score);
+  writer->Put(obj->bbox);
+
+  auto attributes = obj->GetAttributes();
+  writer->Put(static_cast<uint32_t>(attributes.size()));
+  for (const auto& attr : attributes) {
+    writer->PutString(attr.first);
+    writer->Put(static_cast<int32_t>(attr.second.id));
+    writer->Put(static_cast<int32_t>(attr.second.value));
+    writer->Put(attr.second.score);
+  }
+  auto extra_attributes = obj->GetExtraAttributes();
+  writer->Put(static_cast<uint32_t>(extra_attributes.size()));
+  for (const auto& attr : extra_attributes) {
+    writer->PutString(attr.first);
+    writer->PutString(attr.second);
+  }
+  auto features = obj->GetFeatures();
+  writer->Put(static_cast<uint32_t>(features.size()));
+  for (const auto& feature : features) {
+    writer->PutString(feature.first);
+    writer->PutFloats(feature.second);
+  }
+  writer->Patch(size_offset, static_cast<uint32_t>(writer->Size() - size_offset - sizeof(uint32_t)));
+}
+
+bool ParseObject(BinaryReader* reader, std::shared_ptr<CNInferObject> obj) {
+  uint32_t size;
+  if (!reader->Get(&size) || reader->Remain() < size) return false;
+  BinaryReader record(reader->Current(), size);
+  reader->Skip(size);
+
+  record.GetString(&obj->id);
+  record.GetString(&obj->track_id);
+  record.Get(&obj->score);
+  record.Get(&obj->bbox);
+  uint32_t num = 0;
+  record.Get(&num);
+  for (uint32_t i = 0; i < num && record.Ok(); ++i) {
+    std::string key;
+    int32_t id, value;
+    CNInferAttr attr;
+    if (record.GetString(&key) && record.Get(&id) && record.Get(&value) && record.Get(&attr.score)) {
+      attr.id = id;
+      attr.value = value;
+      obj->AddAttribute(key, attr);
+    }
+  }
+  num = 0;
+  record.Get(&num);
+  for (uint32_t i = 0; i < num && record.Ok(); ++i) {
+    std::string key, value;
+    if (record.GetString(&key) && record.GetString(&value)) obj->AddExtraAttribute(key, value);
+  }
+  num = 0;
+  record.Get(&num);
+  for (uint32_t i = 0; i < num && record.Ok(); ++i) {
+    std::string key;
+    CNInferFeature feature;
+    if (record.GetString(&key) && record.GetFloats(&feature)) obj->AddFeature(key, feature);
+  }
+  // fields appended by a newer writer are left in the record and ignored
+  return record.Ok();
+}
+
+void BeginSection(IPCSectionTag tag, BinaryWriter* writer, size_t* offset) {
+  *offset = writer->Reserve<IPCSectionHeader>();
+  IPCSectionHeader header;
+  header.tag = tag;
+  header.reserved = 0;
+  header.size = 0;
+  writer->Patch(*offset, header);
+}
+
+void EndSection(size_t offset, BinaryWriter* writer) {
+  uint32_t size = static_cast<uint32_t>(writer->Size() - offset - sizeof(IPCSectionHeader));
+  writer->Patch(offset + offsetof(IPCSectionHeader, size), size);
+}
+
+}  // namespace
+
+void SerializeToBinary(const FrameInfoPackage& pkg, std::string* buf) {
+  if (!buf) return;
+  BinaryWriter writer(buf);
+  size_t begin = writer.Reserve<IPCMessageHeader>();
+  size_t section;
+
+  if (PKG_DATA == pkg.pkg_type || PKG_RELEASE_MEM == pkg.pkg_type) {
+    IPCFrameRecord record;
+    memset(&record, 0, sizeof(record));
+    record.stream_idx = pkg.stream_idx;
+    record.frame_id = pkg.frame_id;
+    if (PKG_DATA == pkg.pkg_type) {
+      record.timestamp = pkg.timestamp;
+      record.flags = pkg.flags;
+      record.mlu_mem_handle = reinterpret_cast<uintptr_t>(pkg.mlu_mem_handle);
+      record.fmt = pkg.fmt;
+      record.width = pkg.width;
+      record.height = pkg.height;
+      for (int i = 0; i < CN_MAX_PLANES; i++) record.stride[i] = pkg.stride[i];
+      record.dev_type = pkg.ctx.dev_type;
+      record.dev_id = pkg.ctx.dev_id;
+      record.ddr_channel = pkg.ctx.ddr_channel;
+      record.mem_map_type = pkg.mem_map_type;
+      record.shm_slot = pkg.shm_slot;
+    }
+    BeginSection(IPC_SECTION_FRAME, &writer, &section);
+    writer.Put(record);
+    EndSection(section, &writer);
+
+    BeginSection(IPC_SECTION_STREAM_ID, &writer, &section);
+    buf->append(pkg.stream_id);
+    EndSection(section, &writer);
+  }
+
+  if (PKG_DATA == pkg.pkg_type && pkg.objs) {
+    BeginSection(IPC_SECTION_OBJECTS, &writer, &section);
+    std::lock_guard<std::mutex> lk(pkg.objs->mutex_);
+    writer.Put(static_cast<uint32_t>(pkg.objs->objs_.size()));
+    for (const auto& obj : pkg.objs->objs_) SerializeObject(obj, &writer);
+    EndSection(section, &writer);
+  }
+
+  IPCMessageHeader header;
+  header.magic = IPC_PROTOCOL_MAGIC;
+  header.version = IPC_PROTOCOL_VERSION;
+  header.header_size = sizeof(IPCMessageHeader);
+  header.pkg_type = static_cast<int32_t>(pkg.pkg_type);
+  header.payload_size = static_cast<uint32_t>(writer.Size() - begin - sizeof(IPCMessageHeader));
+  writer.Patch(begin, header);
+}
+
+int ParseBinaryToPackage(const char* data, size_t size, FrameInfoPackage* pkg) {
+  if (!data || !pkg) return -1;
+  IPCMessageHeader header;
+  if (size < sizeof(header)) return 0;
+  memcpy(&header, data, sizeof(header));
+  if (header.magic != IPC_PROTOCOL_MAGIC || header.header_size < sizeof(header)) return -1;
+  size_t message_size = static_cast<size_t>(header.header_size) + header.payload_size;
+  if (message_size > IPC_MAX_MESSAGE_SIZE) return -1;
+  if (size < message_size) return 0;
+
+  *pkg = FrameInfoPackage();
+  pkg->pkg_type = PkgType(header.pkg_type);
+  BinaryReader reader(data + header.header_size, header.payload_size);
+  while (reader.Remain() > 0) {
+    IPCSectionHeader section;
+    if (!reader.Get(&section) || reader.Remain() < section.size) return -1;
+    BinaryReader content(reader.Current(), section.size);
+    reader.Skip(section.size);
+    switch (section.tag) {
+      case IPC_SECTION_FRAME: {
+        IPCFrameRecord record;
+        content.GetRecord(&record, section.size);
+        pkg->stream_idx = record.stream_idx;
+        pkg->frame_id = record.frame_id;
+        pkg->timestamp = record.timestamp;
+        pkg->flags = record.flags;
+        pkg->mlu_mem_handle = reinterpret_cast<void*>(static_cast<uintptr_t>(record.mlu_mem_handle));
+        pkg->fmt = CNDataFormat(record.fmt);
+        pkg->width = record.width;
+        pkg->height = record.height;
+        for (int i = 0; i < CN_MAX_PLANES; i++) pkg->stride[i] = record.stride[i];
+        pkg->ctx.dev_type = DevContext::DevType(record.dev_type);
+        pkg->ctx.dev_id = record.dev_id;
+        pkg->ctx.ddr_channel = record.ddr_channel;
+        pkg->mem_map_type = MemMapType(record.mem_map_type);
+        pkg->shm_slot = record.shm_slot;
+        break;
+      }
+      case IPC_SECTION_STREAM_ID:
+        pkg->stream_id.assign(content.Current(), section.size);
+        break;
+      case IPC_SECTION_OBJECTS: {
+        uint32_t num;
+        if (!content.Get(&num)) return -1;
+        pkg->objs = std::make_shared<CNInferObjs>();
+        for (uint32_t i = 0; i < num; ++i) {
+          std::shared_ptr<CNInferObject> obj = std::make_shared<CNInferObject>();
+          if (!ParseObject(&content, obj)) return -1;
+          pkg->objs->objs_.push_back(obj);
+        }
+        break;
+      }
+      default:
+        break;  // written by a newer version
+    }
+  }
+  return static_cast<int>(message_size);
+}
+
+char* IPCMessageReader::GetWriteBuffer(size_t* size) {
+  // move the incomplete message to the front, and grow only if it does not fit
+  if (begin_ > 0) {
+    memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+    end_ -= begin_;
+    begin_ = 0;
+  }
+  if (end_ == buffer_.size()) buffer_.resize(buffer_.size() * 2);
+  *size = buffer_.size() - end_;
+  return buffer_.data() + end_;
+}
+
+int IPCMessageReader::Next(FrameInfoPackage* pkg) {
+  int ret = ParseBinaryToPackage(buffer_.data() + begin_, end_ - begin_, pkg);
+  if (ret <= 0) return ret;
+  begin_ += ret;
+  return 1;
+}
+
+}  // namespace cnstream
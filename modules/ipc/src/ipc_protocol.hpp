@@ -0,0 +1,111 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_IPC_IPC_PROTOCOL_HPP_
+#define MODULES_IPC_IPC_PROTOCOL_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ipc_handler.hpp"
+
+namespace cnstream {
+
+/*
+ * Binary messages exchanged by a ModuleIPC pair over the unix socket.
+ *
+ * A message is a fixed header followed by tagged sections:
+ *
+ *   IPCMessageHeader | tag, size, data | tag, size, data | ...
+ *
+ * Readers skip sections with unknown tags, and fixed-size section records or object records that are shorter or
+ * longer than expected are zero-filled or truncated. New fields are appended to a record or put in a new section,
+ * so both sides keep working when only one of them is upgraded. Both processes run on the same host, so values are
+ * in host byte order.
+ */
+#define IPC_PROTOCOL_MAGIC 0x50494e43     // "CNIP"
+#define IPC_PROTOCOL_VERSION 1
+#define IPC_MAX_MESSAGE_SIZE (64 << 20)  // guards against a corrupted stream
+
+struct IPCMessageHeader {
+  uint32_t magic;         ///< IPC_PROTOCOL_MAGIC.
+  uint16_t version;       ///< version of the writer.
+  uint16_t header_size;   ///< size of the header, sections start right after it.
+  int32_t pkg_type;       ///< PkgType.
+  uint32_t payload_size;  ///< size of all sections.
+};
+
+enum IPCSectionTag : uint16_t {
+  IPC_SECTION_FRAME = 1,      ///< IPCFrameRecord.
+  IPC_SECTION_STREAM_ID = 2,  ///< stream id string.
+  IPC_SECTION_OBJECTS = 3,    ///< inference objects, see SerializeObject in ipc_protocol.cpp.
+};
+
+/**
+ * @brief Appends one package to a buffer as a binary message.
+ * @param pkg : the package.
+ * @param buf : the buffer. Messages appended one after another are sent with one syscall.
+ * @return Void.
+ */
+void SerializeToBinary(const FrameInfoPackage& pkg, std::string* buf);
+
+/**
+ * @brief Parses the first message in a buffer.
+ * @param data : received bytes.
+ * @param size : number of received bytes.
+ * @param pkg : the parsed package.
+ * @return Return the size of the message, 0 if the message is not complete yet, or -1 if data is not a valid message.
+ */
+int ParseBinaryToPackage(const char* data, size_t size, FrameInfoPackage* pkg);
+
+/**
+ * @brief Splits the byte stream of a socket into packages.
+ */
+class IPCMessageReader {
+ public:
+  /**
+   *  @brief  Get a buffer to receive data into.
+   *  @param  size : returns the free size of the buffer.
+   *  @return Return the write position.
+   */
+  char* GetWriteBuffer(size_t* size);
+
+  /**
+   *  @brief  Commit bytes received into the buffer returned by GetWriteBuffer.
+   *  @return Void.
+   */
+  void Commit(size_t size) { end_ += size; }
+
+  /**
+   *  @brief  Get next received package.
+   *  @return Return 1 if a package is got, 0 if more data is needed, or -1 if the stream is corrupted.
+   */
+  int Next(FrameInfoPackage* pkg);
+
+ private:
+  std::vector<char> buffer_ = std::vector<char>(64 * 1024);
+  size_t begin_ = 0;
+  size_t end_ = 0;
+};  // class IPCMessageReader
+
+}  // namespace cnstream
+
+#endif  // MODULES_IPC_IPC_PROTOCOL_HPP_
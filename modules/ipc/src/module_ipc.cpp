@@ -53,6 +53,9 @@ ModuleIPC::ModuleIPC(const std::string& name) : Module(name) {
   param_register_.Register("device_id", "Identify device id for server processor.");
   param_register_.Register("max_cachedframe_size",
                            "Identify max size of cached processed frame with shared memory for client.");
+  param_register_.Register("frame_ring_size",
+                           "Identify slot number of the shared memory frame ring for each stream when memmap_type is"
+                           " cpu, 0 means each frame uses its own shared memory. 16 by default. Only used by client.");
 }
 
 bool ModuleIPC::Open(ModuleParamSet paramSet) {
@@ -80,6 +83,9 @@ bool ModuleIPC::Open(ModuleParamSet paramSet) {
   if (type == IPC_CLIENT && paramSet.find("max_cachedframe_size") != paramSet.end()) {
     ipc_handler_->SetMaxCachedFrameSize(std::stoi(paramSet["max_cachedframe_size"]));
   }
+  if (type == IPC_CLIENT && paramSet.find("frame_ring_size") != paramSet.end()) {
+    ipc_handler_->SetFrameRingSize(std::stoi(paramSet["frame_ring_size"]));
+  }
   if (paramSet.find("device_id") != paramSet.end()) {
     ipc_handler_->SetDeviceId(std::stoi(paramSet["device_id"]));
   }
@@ -121,13 +127,17 @@ int ModuleIPC::Process(std::shared_ptr<CNFrameInfo> data) {
   if (ipc_handler_->GetType() != IPC_CLIENT) return -1;
 
   auto handler = std::dynamic_pointer_cast<IPCClientHandler>(ipc_handler_);
+  int shm_slot = -1;
   if (!data->IsEos()) {
-    CNDataFramePtr frame = cnstream::GetCNDataFramePtr(data);
-    frame->CopyToSharedMem(handler->GetMemMapType(), data->stream_id);
-    handler->CacheProcessedData(data);
+    shm_slot = handler->CopyToFrameRing(data);
+    if (shm_slot < 0) {
+      CNDataFramePtr frame = cnstream::GetCNDataFramePtr(data);
+      frame->CopyToSharedMem(handler->GetMemMapType(), data->stream_id);
+      handler->CacheProcessedData(data);
+    }
   }
 
-  handler->PreparePackageToSend(PkgType::PKG_DATA, data);
+  handler->PreparePackageToSend(PkgType::PKG_DATA, data, shm_slot);
   handler->Send();
   this->TransmitData(data);
   return 0;
@@ -164,7 +174,7 @@ bool ModuleIPC::CheckParamSet(const ModuleParamSet& paramSet) const {
   }
 
   std::string err_msg;
-  if (!checker.IsNum({"device_id", "max_cachedframe_size"}, paramSet, err_msg)) {
+  if (!checker.IsNum({"device_id", "max_cachedframe_size", "frame_ring_size"}, paramSet, err_msg)) {
     LOGE(IPC) << err_msg;
     ret = false;
   }
@@ -185,6 +195,8 @@ void ModuleIPC::PostFrameToReleaseMem(std::shared_ptr<CNFrameInfo> data) {
   // post frame info to communicate process(client), to release shared memory
   if (IPC_SERVER == ipc_handler_->GetType() && !data->IsEos()) {
     CNDataFramePtr frame = cnstream::GetCNDataFramePtr(data);
+    // frames from a frame ring give their slot back when they are destroyed
+    if (!frame->IsSharedMemMapped()) return;
     frame->UnMapSharedMem(ipc_handler_->GetMemMapType());
     ipc_handler_->PreparePackageToSend(PkgType::PKG_RELEASE_MEM, data);
   }
@@ -79,6 +79,7 @@ void IPCServerHandler::Close() {
   }
 
   server_handle_.Close();
+  ClearFrameRings();
 }
 
 void IPCServerHandler::Shutdown() { server_handle_.Shutdown(); }
@@ -87,7 +88,10 @@ void IPCServerHandler::RecvPackageLoop() {
   std::string recv_err_msg;
   size_t eos_chn_cnt = 0;
   while (is_running_.load()) {
-    if (server_handle_.RecvData(recv_buf_, sizeof(recv_buf_)) != sizeof(recv_buf_)) {
+    size_t buf_size = 0;
+    char* buf = recv_reader_.GetWriteBuffer(&buf_size);
+    int recv_size = server_handle_.RecvData(buf, static_cast<int>(buf_size));
+    if (recv_size <= 0) {
       recv_err_msg = "server receive message error";
       LOGE(IPC) << recv_err_msg;
       server_handle_.Close();
@@ -95,60 +99,68 @@ void IPCServerHandler::RecvPackageLoop() {
       ipc_module_->PostEvent(EventType::EVENT_ERROR, recv_err_msg);
       break;
     }
-    FrameInfoPackage recv_pkg;
-    std::string recv_str(recv_buf_);
-    memset(recv_buf_, 0, sizeof(recv_buf_));
-    if (!ParseStringToPackage(recv_str, &recv_pkg)) {
-      LOGW(IPC) << "server receive parse error";
-      continue;
-    }
+    recv_reader_.Commit(recv_size);
 
-    switch (recv_pkg.pkg_type) {
-      case PKG_DATA:
-        if (recv_pkg.stream_id.empty()) {
-          break;
-        }
+    int ret;
+    FrameInfoPackage recv_pkg;
+    while ((ret = recv_reader_.Next(&recv_pkg)) > 0) {
+      switch (recv_pkg.pkg_type) {
+        case PKG_DATA:
+          if (recv_pkg.stream_id.empty()) {
+            break;
+          }
 
 #ifdef UNIT_TEST
-        if (unit_test) {
-          recv_pkg_.Push(recv_pkg);
-          unit_test = false;
-        }
+          if (unit_test) {
+            recv_pkg_.Push(recv_pkg);
+            unit_test = false;
+          }
 #endif
-        vec_recv_dataq_[recv_pkg.stream_idx % SEND_THREAD_NUM]->Push(recv_pkg);
-        if (recv_pkg.flags & CN_FRAME_FLAG_EOS) {
-          eos_chn_cnt++;
-          if (eos_chn_cnt == ipc_module_->GetStreamCount()) {
-            LOGI(IPC) << "Server received all eos.";
-            return;
+          vec_recv_dataq_[recv_pkg.stream_idx % SEND_THREAD_NUM]->Push(recv_pkg);
+          if (recv_pkg.flags & CN_FRAME_FLAG_EOS) {
+            eos_chn_cnt++;
+            if (eos_chn_cnt == ipc_module_->GetStreamCount()) {
+              LOGI(IPC) << "Server received all eos.";
+              return;
+            }
           }
-        }
-        break;
+          break;
 
-      case PKG_ERROR:
-        recv_err_msg = "Server receive error info from communicate process, process id: " + std::to_string(getpid());
-        ipc_module_->PostEvent(EventType::EVENT_ERROR, recv_err_msg);
-        return;
+        case PKG_ERROR:
+          recv_err_msg =
+              "Server receive error info from communicate process, process id: " + std::to_string(getpid());
+          ipc_module_->PostEvent(EventType::EVENT_ERROR, recv_err_msg);
+          return;
 
-      default:
-        LOGW(IPC) << "server receive message type error!";
-        break;
+        default:
+          LOGW(IPC) << "server receive message type error!";
+          break;
+      }
+    }
+    if (ret < 0) {
+      LOGW(IPC) << "server receive invalid message";
+      recv_err_msg = "server receive invalid message";
+      server_handle_.Close();
+      is_connected_.store(false);
+      ipc_module_->PostEvent(EventType::EVENT_ERROR, recv_err_msg);
+      break;
     }
   }
 }
 
 void IPCServerHandler::SendPackageLoop() {
+  std::string send_buf;
   while (is_running_.load() && is_connected_.load()) {
     FrameInfoPackage send_pkg;
     if (!send_pkgq_.WaitAndTryPop(send_pkg, std::chrono::milliseconds(10))) {
       continue;
     }
 
-    std::string send_str;
-    SerializeToString(send_pkg, &send_str);
-    memset(send_buf_, 0, sizeof(send_buf_));
-    memcpy(send_buf_, send_str.c_str(), send_str.length());
-    if (server_handle_.SendData(send_buf_, sizeof(send_buf_)) != sizeof(send_buf_)) {
+    // everything queued meanwhile goes out with the same syscall
+    send_buf.clear();
+    SerializeToBinary(send_pkg, &send_buf);
+    PopPackagesToSend(&send_buf);
+    if (!server_handle_.SendAll(send_buf.data(), send_buf.size())) {
       LOGW(IPC) << " server send message to client failed.";
     }
   }
@@ -196,7 +208,7 @@ void IPCServerHandler::ProcessFrameInfoPackage(size_t thread_idx) {
       std::this_thread::sleep_for(std::chrono::milliseconds(5));
     }
 
-    this->PackageToCNData(recv_pkg, data);
+    if (!this->PackageToCNData(recv_pkg, data)) continue;
 
     auto perf_manager_ = ipc_module_->GetPerfManager(recv_pkg.stream_id);
     if (!data->IsEos() && (nullptr != perf_manager_)) {
@@ -29,6 +29,7 @@
 
 #include "cnsocket.hpp"
 #include "ipc_handler.hpp"
+#include "ipc_protocol.hpp"
 
 namespace cnstream {
 
@@ -116,6 +117,7 @@ class IPCServerHandler : public IPCHandler {
   std::atomic<bool> is_connected_{false};        // flag to identify connection state
   std::vector<CNPackageQueue> vec_recv_dataq_;   // queues to storage revceived data
   std::vector<std::thread> vec_process_thread_;  // threads for processing received data
+  IPCMessageReader recv_reader_;                 // splits received bytes into packages
 #ifdef UNIT_TEST
   ThreadSafeQueue<FrameInfoPackage> recv_pkg_;  // received pkg queue for unit_test
   bool unit_test = true;
@@ -0,0 +1,189 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "shm_frame_ring.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <memory>
+#include <new>
+#include <string>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+// the state words are shared between processes, which is only valid for address-free (lock-free) atomics
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "ShmFrameRing requires lock-free 32-bit atomics.");
+
+static constexpr uint32_t kRingMagic = 0x434e5352;  // "CNSR"
+static constexpr uint32_t kRingVersion = 1;
+static constexpr size_t kSlotAlignment = 64 * 1024;
+
+enum SlotState : uint32_t { SLOT_FREE = 0, SLOT_BUSY = 1 };
+
+/*
+ * Shared memory layout: Header | slot states | padding | slot 0 | slot 1 | ...
+ * Slots start at slots_offset and are kSlotAlignment aligned.
+ */
+struct ShmFrameRing::Header {
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+  uint32_t slot_num;
+  uint32_t reserved;
+  uint64_t slot_size;
+  uint64_t slots_offset;
+  std::atomic<uint32_t> cursor;
+};
+
+static size_t RoundUp(size_t value, size_t boundary) { return (value + boundary - 1) / boundary * boundary; }
+
+std::string ShmFrameRing::GetName(const std::string& socket_address, uint32_t stream_idx) {
+  std::string address = socket_address;
+  std::replace(address.begin(), address.end(), '/', '_');
+  return "/cnstream_ipc" + address + "_" + std::to_string(stream_idx);
+}
+
+std::shared_ptr<ShmFrameRing> ShmFrameRing::Create(const std::string& name, uint32_t slot_num, size_t slot_size) {
+  if (slot_num == 0 || slot_size == 0) {
+    LOGE(IPC) << "[ShmFrameRing] Invalid slot num " << slot_num << " or slot size " << slot_size;
+    return nullptr;
+  }
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+  if (fd < 0 && errno == EEXIST) {
+    // left by a process which did not exit normally
+    LOGW(IPC) << "[ShmFrameRing] " << name << " exists, unlink it.";
+    shm_unlink(name.c_str());
+    fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+  }
+  if (fd < 0) {
+    LOGE(IPC) << "[ShmFrameRing] Create " << name << " failed, errno: " << errno;
+    return nullptr;
+  }
+
+  std::shared_ptr<ShmFrameRing> ring(new ShmFrameRing);
+  ring->name_ = name;
+  ring->owner_ = true;
+  size_t slots_offset = RoundUp(sizeof(Header) + sizeof(std::atomic<uint32_t>) * slot_num, kSlotAlignment);
+  slot_size = RoundUp(slot_size, kSlotAlignment);
+  size_t size = slots_offset + slot_size * slot_num;
+  if (ftruncate(fd, size) == -1 || !ring->Map(fd, size)) {
+    LOGE(IPC) << "[ShmFrameRing] Allocate " << size << " bytes for " << name << " failed, errno: " << errno;
+    close(fd);
+    return nullptr;  // unlinked by the destructor of ring
+  }
+  close(fd);
+
+  Header* header = new (ring->mem_) Header;
+  header->version = kRingVersion;
+  header->slot_num = slot_num;
+  header->reserved = 0;
+  header->slot_size = slot_size;
+  header->slots_offset = slots_offset;
+  header->cursor.store(0, std::memory_order_relaxed);
+  auto states = reinterpret_cast<std::atomic<uint32_t>*>(header + 1);
+  for (uint32_t i = 0; i < slot_num; ++i) {
+    new (&states[i]) std::atomic<uint32_t>(SLOT_FREE);
+  }
+  header->magic.store(kRingMagic, std::memory_order_release);
+
+  ring->header_ = header;
+  ring->states_ = states;
+  ring->slots_ = reinterpret_cast<uint8_t*>(ring->mem_) + slots_offset;
+  ring->slot_num_ = slot_num;
+  ring->slot_size_ = slot_size;
+  return ring;
+}
+
+std::shared_ptr<ShmFrameRing> ShmFrameRing::Open(const std::string& name) {
+  int fd = shm_open(name.c_str(), O_RDWR, S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    LOGE(IPC) << "[ShmFrameRing] Open " << name << " failed, errno: " << errno;
+    return nullptr;
+  }
+  struct stat st;
+  std::shared_ptr<ShmFrameRing> ring(new ShmFrameRing);
+  ring->name_ = name;
+  if (fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) < sizeof(Header) ||
+      !ring->Map(fd, static_cast<size_t>(st.st_size))) {
+    LOGE(IPC) << "[ShmFrameRing] Map " << name << " failed, errno: " << errno;
+    close(fd);
+    return nullptr;
+  }
+  close(fd);
+
+  Header* header = reinterpret_cast<Header*>(ring->mem_);
+  if (header->magic.load(std::memory_order_acquire) != kRingMagic || header->version != kRingVersion ||
+      header->slots_offset + header->slot_size * header->slot_num > ring->mem_size_) {
+    LOGE(IPC) << "[ShmFrameRing] " << name << " is not a valid frame ring.";
+    return nullptr;
+  }
+  ring->header_ = header;
+  ring->states_ = reinterpret_cast<std::atomic<uint32_t>*>(header + 1);
+  ring->slots_ = reinterpret_cast<uint8_t*>(ring->mem_) + header->slots_offset;
+  ring->slot_num_ = header->slot_num;
+  ring->slot_size_ = header->slot_size;
+  return ring;
+}
+
+bool ShmFrameRing::Map(int fd, size_t size) {
+  void* mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mem == MAP_FAILED) return false;
+  mem_ = mem;
+  mem_size_ = size;
+  return true;
+}
+
+ShmFrameRing::~ShmFrameRing() {
+  if (mem_) munmap(mem_, mem_size_);
+  // the peer keeps its own mapping, unlinking only removes the name
+  if (owner_) shm_unlink(name_.c_str());
+}
+
+int ShmFrameRing::Acquire() {
+  uint32_t start = header_->cursor.fetch_add(1, std::memory_order_relaxed);
+  for (uint32_t i = 0; i < slot_num_; ++i) {
+    uint32_t slot = (start + i) % slot_num_;
+    uint32_t expected = SLOT_FREE;
+    if (states_[slot].compare_exchange_strong(expected, SLOT_BUSY, std::memory_order_acquire,
+                                              std::memory_order_relaxed)) {
+      return static_cast<int>(slot);
+    }
+  }
+  return -1;
+}
+
+void ShmFrameRing::Release(int slot) {
+  if (slot < 0 || static_cast<uint32_t>(slot) >= slot_num_) return;
+  // release ordering publishes every read of the slot before it is reused by the producer
+  states_[slot].store(SLOT_FREE, std::memory_order_release);
+}
+
+uint8_t* ShmFrameRing::GetSlot(int slot) const {
+  if (slot < 0 || static_cast<uint32_t>(slot) >= slot_num_) return nullptr;
+  return slots_ + slot_size_ * slot;
+}
+
+}  // namespace cnstream
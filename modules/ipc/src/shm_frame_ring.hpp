@@ -0,0 +1,111 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_IPC_SHM_FRAME_RING_HPP_
+#define MODULES_IPC_SHM_FRAME_RING_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace cnstream {
+
+/**
+ * @brief A ring of frame slots in POSIX shared memory, shared by the two processes of a ModuleIPC pair.
+ *
+ * The client creates one ring per stream and copies each frame into a free slot. The server maps the ring once and
+ * uses the slot in place. Slots are acquired and released through atomic state words living in the shared memory
+ * itself, so no syscall and no message is needed per frame.
+ */
+class ShmFrameRing {
+ public:
+  /**
+   *  @brief  Create a ring and its shared memory object.
+   *  @param  name : name of the shared memory object.
+   *  @param  slot_num : number of slots.
+   *  @param  slot_size : minimum size of each slot in bytes.
+   *  @return Return the ring, or nullptr if failed.
+   */
+  static std::shared_ptr<ShmFrameRing> Create(const std::string& name, uint32_t slot_num, size_t slot_size);
+
+  /**
+   *  @brief  Map a ring created by another process.
+   *  @param  name : name of the shared memory object.
+   *  @return Return the ring, or nullptr if failed.
+   */
+  static std::shared_ptr<ShmFrameRing> Open(const std::string& name);
+
+  /**
+   *  @brief  Get the name of the ring used for a stream of a ModuleIPC pair.
+   *  @param  socket_address : socket address of the ModuleIPC pair.
+   *  @param  stream_idx : stream index.
+   *  @return Return the name of the shared memory object.
+   */
+  static std::string GetName(const std::string& socket_address, uint32_t stream_idx);
+
+  /**
+   *  @brief  Unmap the ring. The shared memory object is unlinked if it is created by this instance.
+   */
+  ~ShmFrameRing();
+
+  /**
+   *  @brief  Acquire a free slot.
+   *  @return Return the slot index, or -1 if all slots are in use.
+   */
+  int Acquire();
+
+  /**
+   *  @brief  Return a slot to the ring.
+   *  @param  slot : slot index returned by Acquire.
+   *  @return Void.
+   */
+  void Release(int slot);
+
+  /**
+   *  @brief  Get address of a slot.
+   *  @return Return the address of the slot, or nullptr if slot is out of range.
+   */
+  uint8_t* GetSlot(int slot) const;
+
+  inline uint32_t GetSlotNum() const { return slot_num_; }
+  inline size_t GetSlotSize() const { return slot_size_; }
+
+ private:
+  struct Header;
+  ShmFrameRing() = default;
+  ShmFrameRing(const ShmFrameRing&) = delete;
+  ShmFrameRing& operator=(const ShmFrameRing&) = delete;
+  bool Map(int fd, size_t size);
+
+  std::string name_;
+  bool owner_ = false;
+  void* mem_ = nullptr;
+  size_t mem_size_ = 0;
+  Header* header_ = nullptr;
+  std::atomic<uint32_t>* states_ = nullptr;
+  uint8_t* slots_ = nullptr;
+  uint32_t slot_num_ = 0;
+  size_t slot_size_ = 0;
+};  // class ShmFrameRing
+
+}  // namespace cnstream
+
+#endif  // MODULES_IPC_SHM_FRAME_RING_HPP_
@@ -201,7 +201,8 @@ int Osd::Process(std::shared_ptr<CNFrameInfo> data) {
     return -1;
   }
 
-  CNDataFramePtr frame = cnstream::GetCNDataFramePtr(data);
+  // draws on a data frame of its own if the frame is shared with other branches
+  CNDataFramePtr frame = cnstream::GetMutableCNDataFramePtr(data);
   if (frame->width < 0 || frame->height < 0) {
     LOGE(OSD) << "OSD module processed illegal frame: width or height may < 0.";
     return -1;
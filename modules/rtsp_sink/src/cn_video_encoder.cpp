@@ -27,6 +27,8 @@
 #include <string>
 
 #define OUTPUT_BUFFER_SIZE 0x200000
+// encoded packets hold codec output buffers until sent, leave some for the codec
+#define OUTPUT_QUEUED_PACKETS 4
 
 namespace cnstream {
 
@@ -43,23 +45,23 @@ CNVideoEncoder::CNVideoFrame::CNVideoFrame(CNVideoEncoder *encoder) : encoder_(e
     frame_->n_planes = 2;
     frame_->strides[0] = frame_->width;
     frame_->strides[1] = frame_->width;
-    uint8_t *ptr = new uint8_t[frame_->frame_size];
-    frame_->ptrs[0] = reinterpret_cast<void *>(ptr);
-    frame_->ptrs[1] = reinterpret_cast<void *>(ptr + frame_->width * frame_->height);
+    buffer_ = new uint8_t[frame_->frame_size];
+    frame_->ptrs[0] = reinterpret_cast<void *>(buffer_);
+    frame_->ptrs[1] = reinterpret_cast<void *>(buffer_ + frame_->width * frame_->height);
     frame_->n_planes = 2;
   } else {
     frame_->frame_size = frame_->width * frame_->height * 3;
     frame_->n_planes = 1;
     frame_->strides[0] = frame_->width;
-    frame_->ptrs[0] = reinterpret_cast<void *>(new uint8_t[frame_->frame_size]);
+    buffer_ = new uint8_t[frame_->frame_size];
+    frame_->ptrs[0] = reinterpret_cast<void *>(buffer_);
     frame_->n_planes = 1;
   }
 }
 
 CNVideoEncoder::CNVideoFrame::~CNVideoFrame() {
   if (frame_) {
-    uint8_t *ptr = reinterpret_cast<uint8_t *>(frame_->ptrs[0]);
-    delete[] ptr;
+    delete[] buffer_;
     delete frame_;
     frame_ = nullptr;
   }
@@ -69,13 +71,59 @@ void CNVideoEncoder::CNVideoFrame::Fill(uint8_t *data, int64_t timestamp) {
   if (frame_ == nullptr) return;
   frame_->pts = timestamp;
   if (frame_->pformat == edk::PixelFmt::NV21 || frame_->pformat == edk::PixelFmt::NV12) {
-    memcpy(frame_->ptrs[0], data, frame_->frame_size);
+    // SendDataCPU() copies the planes to device, so the caller data can be used in place
+    frame_->ptrs[0] = reinterpret_cast<void *>(data);
+    frame_->ptrs[1] = reinterpret_cast<void *>(data + frame_->width * frame_->height);
   } else {
     LOGI(RTSP) << "Unsupport Pixel Format: " << static_cast<int>(frame_->pformat) << std::endl;
   }
 }
 
-CNVideoEncoder::CNVideoEncoder(const RtspParam &rtsp_param) : VideoEncoder(OUTPUT_BUFFER_SIZE) {
+static inline uint8_t ClampToUint8(int value) {
+  return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+void CNVideoEncoder::CNVideoFrame::FillBGR(const uint8_t *bgr, int stride, int64_t timestamp) {
+  if (frame_ == nullptr) return;
+  frame_->pts = timestamp;
+  if (frame_->pformat != edk::PixelFmt::NV21 && frame_->pformat != edk::PixelFmt::NV12) {
+    LOGI(RTSP) << "Unsupport Pixel Format: " << static_cast<int>(frame_->pformat) << std::endl;
+    return;
+  }
+  uint32_t width = frame_->width, height = frame_->height;
+  uint8_t *dst_y = buffer_;
+  uint8_t *dst_uv = buffer_ + width * height;
+  frame_->ptrs[0] = reinterpret_cast<void *>(dst_y);
+  frame_->ptrs[1] = reinterpret_cast<void *>(dst_uv);
+  int u_offset = frame_->pformat == edk::PixelFmt::NV12 ? 0 : 1;
+
+  // BT.601 studio swing, each 2x2 block writes four luma and one chroma pair in a single pass
+  for (uint32_t i = 0; i < height; i += 2) {
+    const uint8_t *row0 = bgr + i * stride;
+    const uint8_t *row1 = (i + 1 < height) ? row0 + stride : row0;
+    uint8_t *y0 = dst_y + i * width;
+    uint8_t *y1 = (i + 1 < height) ? y0 + width : y0;
+    uint8_t *uv = dst_uv + i / 2 * width;
+    for (uint32_t j = 0; j < width; j += 2) {
+      int sum_b = 0, sum_g = 0, sum_r = 0;
+      for (uint32_t k = j; k < j + 2 && k < width; ++k) {
+        const uint8_t *p0 = row0 + k * 3;
+        const uint8_t *p1 = row1 + k * 3;
+        y0[k] = ClampToUint8(((66 * p0[2] + 129 * p0[1] + 25 * p0[0] + 128) >> 8) + 16);
+        y1[k] = ClampToUint8(((66 * p1[2] + 129 * p1[1] + 25 * p1[0] + 128) >> 8) + 16);
+        sum_b += p0[0] + p1[0];
+        sum_g += p0[1] + p1[1];
+        sum_r += p0[2] + p1[2];
+      }
+      int b = sum_b >> 2, g = sum_g >> 2, r = sum_r >> 2;
+      uv[j + u_offset] = ClampToUint8(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+      uv[j + 1 - u_offset] = ClampToUint8(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+  }
+}
+
+CNVideoEncoder::CNVideoEncoder(const RtspParam &rtsp_param)
+    : VideoEncoder(OUTPUT_BUFFER_SIZE, OUTPUT_QUEUED_PACKETS) {
   rtsp_param_ = rtsp_param;
   switch (rtsp_param.color_format) {
     case NV21:
@@ -269,12 +317,23 @@ void CNVideoEncoder::PacketCallback(const edk::CnPacket &packet) {
   uint32_t length = packet.length;
   uint8_t *packet_data = reinterpret_cast<uint8_t *>(packet.data);
   uint32_t offset = GetOffset(packet_data);
-  PushOutputBuffer(packet_data + offset, length - offset, frame_count_, packet.pts);
-  encoder_->ReleaseBuffer(packet.buf_id);
+  // the codec buffer is held until the rtsp server takes the packet, see ReleasePacket()
+  PushOutputPacket(packet_data + offset, length - offset, frame_count_, packet.pts,
+                   reinterpret_cast<void *>(packet.buf_id + 1));
   frame_count_++;
   Callback(NEW_FRAME);
 }
 
+void CNVideoEncoder::ReleasePacket(void *opaque) {
+  // opaque is the codec buffer id plus one, so that buffer 0 is not mistaken for an empty packet
+  uint64_t buf_id = reinterpret_cast<uint64_t>(opaque);
+  if (!buf_id || !encoder_) return;
+  edk::MluContext context;
+  context.SetDeviceId(rtsp_param_.device_id);
+  context.ConfigureForThisThread();
+  encoder_->ReleaseBuffer(buf_id - 1);
+}
+
 void CNVideoEncoder::EosCallback() {
   edk::MluContext context;
   context.SetDeviceId(rtsp_param_.device_id);
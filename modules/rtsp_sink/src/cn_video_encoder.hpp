@@ -45,15 +45,19 @@ class CNVideoEncoder : public VideoEncoder {
     explicit CNVideoFrame(CNVideoEncoder *encoder);
     ~CNVideoFrame();
     void Fill(uint8_t *data, int64_t timestamp) override;
+    void FillBGR(const uint8_t *bgr, int stride, int64_t timestamp) override;
     edk::CnFrame *Get() { return frame_; }
 
    private:
     CNVideoEncoder *encoder_ = nullptr;
     edk::CnFrame *frame_ = nullptr;
+    // pixels written by FillBGR(), Fill() only references the caller data
+    uint8_t *buffer_ = nullptr;
   };
 
   virtual VideoFrame *NewFrame();
   virtual void EncodeFrame(VideoFrame *frame);
+  void ReleasePacket(void *opaque) override;
   // virtual void EncodeFrame(void *y, void *uv, int64_t timestamp);
 
   void Destroy();
@@ -21,6 +21,8 @@
 #include "ffmpeg_video_encoder.hpp"
 #include <string.h>
 
+#include <mutex>
+
 #define OUTPUT_BUFFER_SIZE 0x200000
 
 namespace cnstream {
@@ -30,53 +32,60 @@ FFmpegVideoEncoder::FFmpegVideoFrame::FFmpegVideoFrame(FFmpegVideoEncoder *encod
   frame_->width = encoder_->avcodec_ctx_->width;
   frame_->height = encoder_->avcodec_ctx_->height;
   frame_->format = encoder_->picture_format_;
-  int align = (encoder_->picture_format_ == AV_PIX_FMT_RGB24 || encoder_->picture_format_ == AV_PIX_FMT_BGR24) ? 24 : 8;
-  av_image_alloc(frame_->data, frame_->linesize, frame_->width, frame_->height, (AVPixelFormat)frame_->format, align);
+
+  codec_frame_ = av_frame_alloc();
+  codec_frame_->width = encoder_->avcodec_ctx_->width;
+  codec_frame_->height = encoder_->avcodec_ctx_->height;
+  codec_frame_->format = encoder_->avcodec_ctx_->pix_fmt;
+  av_image_alloc(codec_frame_->data, codec_frame_->linesize, codec_frame_->width, codec_frame_->height,
+                 (AVPixelFormat)codec_frame_->format, 8);
 }
 
 FFmpegVideoEncoder::FFmpegVideoFrame::~FFmpegVideoFrame() {
   if (frame_) {
-    av_freep(&(frame_->data[0]));
     av_frame_unref(frame_);
     av_free(frame_);
   }
+  if (codec_frame_) {
+    av_freep(&(codec_frame_->data[0]));
+    av_frame_unref(codec_frame_);
+    av_free(codec_frame_);
+  }
+  if (bgr_sws_ctx_) {
+    sws_freeContext(bgr_sws_ctx_);
+  }
 }
 
 void FFmpegVideoEncoder::FFmpegVideoFrame::Fill(uint8_t *data, int64_t timestamp) {
   if (frame_ == nullptr) return;
 
+  // Only points the frame to the caller data, it is read once by the converter or the codec while encoding.
   frame_->pts = timestamp;
-
-  int line_size;
-  if (frame_->format == AV_PIX_FMT_RGB24 || frame_->format == AV_PIX_FMT_BGR24) {
-    line_size = frame_->width * 3;
-    for (int i = 0; i < frame_->height; i++) {
-      memcpy(frame_->data[0] + frame_->linesize[0] * i, data + line_size * i, line_size);
-    }
-  } else if (frame_->format == AV_PIX_FMT_YUV420P) {
-    line_size = frame_->width;
-    int size = frame_->height * frame_->width;
-    for (int i = 0; i < frame_->height; i++) {
-      memcpy(frame_->data[0] + frame_->linesize[0] * i, data + line_size * i, line_size);
-    }
-    for (int i = 0; i < frame_->height / 2; i++) {
-      memcpy(frame_->data[1] + frame_->linesize[1] * i, data + size + line_size / 2 * i, line_size / 2);
-    }
-    for (int i = 0; i < frame_->height / 2; i++) {
-      memcpy(frame_->data[2] + frame_->linesize[2] * i, data + size * 5 / 4 + line_size / 2 * i, line_size / 2);
-    }
-  } else if (frame_->format == AV_PIX_FMT_NV21 || frame_->format == AV_PIX_FMT_NV12) {
-    line_size = frame_->width;
-    int size = frame_->height * frame_->width;
-    for (int i = 0; i < frame_->height; i++) {
-      memcpy(frame_->data[0] + frame_->linesize[0] * i, data + line_size * i, line_size);
-    }
-    for (int i = 0; i < frame_->height / 2; i++) {
-      memcpy(frame_->data[1] + frame_->linesize[1] * i, data + size + line_size * i, line_size);
-    }
-  } else {
+  int ret = av_image_fill_arrays(frame_->data, frame_->linesize, data, (AVPixelFormat)frame_->format,
+                                 frame_->width, frame_->height, 1);
+  if (ret < 0) {
     LOGE(RTSP) << "unsupport pixel format: " << frame_->format;
   }
+  codec_frame_ready_ = false;
+}
+
+void FFmpegVideoEncoder::FFmpegVideoFrame::FillBGR(const uint8_t *bgr, int stride, int64_t timestamp) {
+  if (codec_frame_ == nullptr) return;
+
+  bgr_sws_ctx_ = sws_getCachedContext(bgr_sws_ctx_, codec_frame_->width, codec_frame_->height, AV_PIX_FMT_BGR24,
+                                      codec_frame_->width, codec_frame_->height,
+                                      (AVPixelFormat)codec_frame_->format, SWS_FAST_BILINEAR, nullptr, nullptr,
+                                      nullptr);
+  if (!bgr_sws_ctx_) {
+    LOGE(RTSP) << "sws_getCachedContext() failed";
+    return;
+  }
+  const uint8_t *src_data[4] = {bgr, nullptr, nullptr, nullptr};
+  int src_linesize[4] = {stride, 0, 0, 0};
+  sws_scale(bgr_sws_ctx_, src_data, src_linesize, 0, codec_frame_->height, codec_frame_->data,
+            codec_frame_->linesize);
+  codec_frame_->pts = timestamp;
+  codec_frame_ready_ = true;
 }
 
 FFmpegVideoEncoder::FFmpegVideoEncoder(const RtspParam &rtsp_param) : VideoEncoder(OUTPUT_BUFFER_SIZE) {
@@ -222,10 +231,43 @@ void FFmpegVideoEncoder::Destroy() {
     av_free(avpacket_);
     avpacket_ = nullptr;
   }
+  std::lock_guard<std::mutex> lk(packet_pool_mutex_);
+  for (auto packet : packets_) {
+    av_packet_unref(packet);
+    av_free(packet);
+  }
+  packets_.clear();
+  free_packets_.clear();
 }
 
 VideoEncoder::VideoFrame *FFmpegVideoEncoder::NewFrame() { return new FFmpegVideoFrame(this); }
 
+AVPacket *FFmpegVideoEncoder::AcquirePacket() {
+  std::lock_guard<std::mutex> lk(packet_pool_mutex_);
+  if (!free_packets_.empty()) {
+    AVPacket *packet = free_packets_.back();
+    free_packets_.pop_back();
+    return packet;
+  }
+#if LIBAVCODEC_VERSION_MAJOR < 59
+  AVPacket *packet = reinterpret_cast<AVPacket *>(av_mallocz(sizeof(AVPacket)));
+  av_init_packet(packet);
+#else
+  AVPacket *packet = av_packet_alloc();
+#endif
+  packets_.push_back(packet);
+  free_packets_.reserve(packets_.size());
+  return packet;
+}
+
+void FFmpegVideoEncoder::ReleasePacket(void *opaque) {
+  AVPacket *packet = reinterpret_cast<AVPacket *>(opaque);
+  if (!packet) return;
+  av_packet_unref(packet);
+  std::lock_guard<std::mutex> lk(packet_pool_mutex_);
+  free_packets_.push_back(packet);
+}
+
 uint32_t FFmpegVideoEncoder::GetOffset(const uint8_t *data) {
   uint32_t offset = 0;
   const uint8_t *p = data;
@@ -241,12 +283,15 @@ uint32_t FFmpegVideoEncoder::GetOffset(const uint8_t *data) {
 
 void FFmpegVideoEncoder::EncodeFrame(VideoFrame *frame) {
   FFmpegVideoFrame *ffpic = dynamic_cast<FFmpegVideoFrame *>(frame);
-  AVFrame *picture = ffpic->Get();
+  AVFrame *picture = ffpic->GetCodecFrame();
 
-  if (sws_ctx_) {
-    sws_scale(sws_ctx_, picture->data, picture->linesize, 0, picture->height, avframe_->data, avframe_->linesize);
-    avframe_->pts = picture->pts;
-    picture = avframe_;
+  if (!picture) {
+    picture = ffpic->Get();
+    if (sws_ctx_) {
+      sws_scale(sws_ctx_, picture->data, picture->linesize, 0, picture->height, avframe_->data, avframe_->linesize);
+      avframe_->pts = picture->pts;
+      picture = avframe_;
+    }
   }
 
   int ret = 0, got_packet;
@@ -258,13 +303,14 @@ void FFmpegVideoEncoder::EncodeFrame(VideoFrame *frame) {
 
   if (!ret && got_packet && avpacket_->size) {
     // LOGI(RTSP) << "===got packet: size=" << avpacket_->size << ", pts=" << avpacket_->pts;
-    int offset = 0;
-    uint8_t *packet_data = nullptr;
-    packet_data = reinterpret_cast<uint8_t *>(avpacket_->data);
-    offset = GetOffset(packet_data);
-    size_t length = avpacket_->size - offset;
-    uint8_t *data = avpacket_->data + offset;
-    PushOutputBuffer(data, length, frame_count_, avpacket_->pts);
+    AVPacket *packet = AcquirePacket();
+    if (avpacket_->buf) {
+      av_packet_move_ref(packet, avpacket_);
+    } else {
+      av_packet_ref(packet, avpacket_);
+    }
+    uint32_t offset = GetOffset(packet->data);
+    PushOutputPacket(packet->data + offset, packet->size - offset, frame_count_, packet->pts, packet);
     frame_count_++;
     Callback(NEW_FRAME);
   }
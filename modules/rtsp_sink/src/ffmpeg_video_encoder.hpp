@@ -31,6 +31,9 @@ extern "C" {
 #include <libswscale/swscale.h>
 }
 
+#include <mutex>
+#include <vector>
+
 #include "rtsp_sink.hpp"
 #include "video_encoder.hpp"
 #include "cnstream_logging.hpp"
@@ -59,17 +62,27 @@ class FFmpegVideoEncoder : public VideoEncoder {
     explicit FFmpegVideoFrame(FFmpegVideoEncoder *encoder);
     ~FFmpegVideoFrame();
     void Fill(uint8_t *data, int64_t timestamp) override;
+    void FillBGR(const uint8_t *bgr, int stride, int64_t timestamp) override;
     AVFrame *Get() { return frame_; }
+    // The frame in the codec pixel format, nullptr if it needs converting before encoding.
+    AVFrame *GetCodecFrame() { return codec_frame_ready_ ? codec_frame_ : nullptr; }
 
    private:
     FFmpegVideoEncoder *encoder_ = nullptr;
+    // references the caller data of Fill(), never owns pixels
     AVFrame *frame_ = nullptr;
+    // owns pixels in the codec pixel format, written by FillBGR()
+    AVFrame *codec_frame_ = nullptr;
+    SwsContext *bgr_sws_ctx_ = nullptr;
+    bool codec_frame_ready_ = false;
   };
 
   virtual VideoFrame *NewFrame();
   uint32_t GetOffset(const uint8_t *data);
   virtual void EncodeFrame(VideoFrame *frame);
   // virtual void EncodeFrame(void *y, void *uv, int64_t timestamp) {return;};
+  void ReleasePacket(void *opaque) override;
+  AVPacket *AcquirePacket();
   void Destroy();
 
   AVPixelFormat picture_format_;
@@ -84,6 +97,11 @@ class FFmpegVideoEncoder : public VideoEncoder {
   AVFrame *avframe_ = nullptr;
   AVPacket *avpacket_ = nullptr;
   SwsContext *sws_ctx_ = nullptr;
+
+  // encoded packets are moved into pooled packets and handed to the rtsp server without copying
+  std::mutex packet_pool_mutex_;
+  std::vector<AVPacket *> packets_;
+  std::vector<AVPacket *> free_packets_;
 };  // FFmpegVideoEncoder
 
 }  // namespace cnstream
@@ -0,0 +1,110 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "mosaic_compositor.hpp"
+
+#include <memory>
+#include <vector>
+
+#include "cnstream_logging.hpp"
+
+namespace cnstream {
+
+/*
+ * A tile is double buffered between the producer and the consumer, with one extra buffer parked in between
+ * so neither side ever waits for the other: the producer writes `back`, the consumer reads `front`, and
+ * `ready` holds the index of the last published buffer (kFresh set until the consumer takes it).
+ */
+struct MosaicCompositor::TileSlot {
+  static constexpr int kFresh = 0x4;
+  static constexpr int kIndexMask = 0x3;
+
+  cv::Rect roi;
+  cv::Mat buffers[3];
+  std::mutex producer_mutex;  // only serializes producers of the same tile
+  int back = 0;
+  std::atomic<int> ready{1};
+  int front = 2;
+};
+
+MosaicCompositor::~MosaicCompositor() { Destroy(); }
+
+bool MosaicCompositor::Init(const cv::Size &canvas_size, const std::vector<cv::Rect> &tiles) {
+  Destroy();
+  cv::Rect canvas_rect(cv::Point(0, 0), canvas_size);
+  for (const auto &roi : tiles) {
+    if (roi.width <= 0 || roi.height <= 0 || (roi & canvas_rect) != roi) {
+      LOGE(RTSP) << "[MosaicCompositor] Tile " << roi << " is out of canvas " << canvas_size;
+      Destroy();
+      return false;
+    }
+    std::unique_ptr<TileSlot> slot(new TileSlot);
+    slot->roi = roi;
+    for (auto &buffer : slot->buffers) {
+      buffer = cv::Mat::zeros(roi.size(), CV_8UC3);
+    }
+    tiles_.push_back(std::move(slot));
+  }
+  canvas_size_ = canvas_size;
+  return true;
+}
+
+void MosaicCompositor::Destroy() { tiles_.clear(); }
+
+bool MosaicCompositor::Update(int tile_id, const cv::Mat &image) {
+  if (tile_id < 0 || static_cast<size_t>(tile_id) >= tiles_.size()) {
+    LOGE(RTSP) << "[MosaicCompositor] Invalid tile id: " << tile_id;
+    return false;
+  }
+  if (image.empty() || image.type() != CV_8UC3) {
+    LOGE(RTSP) << "[MosaicCompositor] Only BGR24 images are supported.";
+    return false;
+  }
+  TileSlot *slot = tiles_[tile_id].get();
+  std::lock_guard<std::mutex> lk(slot->producer_mutex);
+  cv::Mat &dst = slot->buffers[slot->back];
+  if (image.size() == dst.size()) {
+    image.copyTo(dst);
+  } else {
+    bool shrink = image.cols >= dst.cols && image.rows >= dst.rows;
+    cv::resize(image, dst, dst.size(), 0, 0, shrink ? cv::INTER_AREA : cv::INTER_LINEAR);
+  }
+  int prev = slot->ready.exchange(slot->back | TileSlot::kFresh, std::memory_order_acq_rel);
+  slot->back = prev & TileSlot::kIndexMask;
+  return true;
+}
+
+int MosaicCompositor::Compose(cv::Mat *canvas) {
+  if (!canvas) return 0;
+  if (canvas->size() != canvas_size_ || canvas->type() != CV_8UC3) {
+    *canvas = cv::Mat::zeros(canvas_size_, CV_8UC3);
+  }
+  int refreshed = 0;
+  for (auto &slot : tiles_) {
+    if (!(slot->ready.load(std::memory_order_acquire) & TileSlot::kFresh)) continue;
+    int prev = slot->ready.exchange(slot->front, std::memory_order_acq_rel);
+    slot->front = prev & TileSlot::kIndexMask;
+    slot->buffers[slot->front].copyTo((*canvas)(slot->roi));
+    ++refreshed;
+  }
+  return refreshed;
+}
+
+}  // namespace cnstream
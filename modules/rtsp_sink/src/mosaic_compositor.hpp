@@ -0,0 +1,93 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_RTSP_SINK_SRC_MOSAIC_COMPOSITOR_HPP_
+#define MODULES_RTSP_SINK_SRC_MOSAIC_COMPOSITOR_HPP_
+
+#ifdef HAVE_OPENCV
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#else
+#error OpenCV required
+#endif
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace cnstream {
+
+/**
+ * @brief Composes the views of several streams into one canvas.
+ *
+ * Every tile owns its own buffers, so streams never contend with each other. A producer scales its image into
+ * the back buffer of its tile and publishes it by swapping buffer indexes. The consumer (the encoder thread)
+ * only swaps in the latest published buffer of each changed tile and copies it into the canvas.
+ */
+class MosaicCompositor {
+ public:
+  MosaicCompositor() = default;
+  ~MosaicCompositor();
+
+  /**
+   * @brief Allocates tile buffers.
+   *
+   * @param canvas_size The size of the composed canvas.
+   * @param tiles The region of each tile on the canvas, indexed by tile id.
+   *
+   * @return Returns false if any tile lies outside the canvas.
+   */
+  bool Init(const cv::Size &canvas_size, const std::vector<cv::Rect> &tiles);
+
+  /**
+   * @brief Releases all tile buffers.
+   */
+  void Destroy();
+
+  /**
+   * @brief Scales a BGR24 image into the tile. Called by stream threads.
+   *
+   * Downscaling uses area interpolation and upscaling uses bilinear interpolation.
+   *
+   * @return Returns false if the tile id is out of range or the image is not BGR24.
+   */
+  bool Update(int tile_id, const cv::Mat &image);
+
+  /**
+   * @brief Copies the tiles updated since the last call into the canvas. Called by the encoder thread.
+   *
+   * @param canvas The canvas. It is allocated and cleared if its size or type does not match.
+   *
+   * @return Returns the number of tiles refreshed.
+   */
+  int Compose(cv::Mat *canvas);
+
+  size_t GetTileNum() const { return tiles_.size(); }
+
+ private:
+  struct TileSlot;
+  cv::Size canvas_size_;
+  std::vector<std::unique_ptr<TileSlot>> tiles_;
+};  // class MosaicCompositor
+
+}  // namespace cnstream
+
+#endif  // MODULES_RTSP_SINK_SRC_MOSAIC_COMPOSITOR_HPP_
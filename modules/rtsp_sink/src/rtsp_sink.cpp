@@ -191,16 +191,10 @@ int RtspSink::Process(CNFrameInfoPtr data) {
       cv::Mat image = *frame->ImageBGR();
       ctx->rtsp_stream_->UpdateBGR(image, data->timestamp, data->GetStreamIndex());
     } else if ("nv" == params_.color_mode) {
-      uint8_t *image_data = nullptr;
-      image_data = new uint8_t[frame->GetBytes()];
       uint8_t *plane_0 = reinterpret_cast<uint8_t *>(frame->data[0]->GetMutableCpuData());
       uint8_t *plane_1 = reinterpret_cast<uint8_t *>(frame->data[1]->GetMutableCpuData());
-      memcpy(image_data, plane_0, frame->GetPlaneBytes(0) * sizeof(uint8_t));
-      memcpy(image_data + frame->GetPlaneBytes(0), plane_1, frame->GetPlaneBytes(1) * sizeof(uint8_t));
       frame->deAllocator_.reset();
-      ctx->rtsp_stream_->UpdateYUV(image_data, data->timestamp);
-      delete[] image_data;
-      image_data = nullptr;
+      ctx->rtsp_stream_->UpdateYUV(plane_0, plane_1, data->timestamp);
     } else {
       LOGE(RTSP) << "color type must be set nv or bgr !!!";
       return -1;
@@ -22,6 +22,7 @@
 
 #include "cnstream_logging.hpp"
 #include <memory>
+#include <vector>
 
 #include "device/mlu_context.h"
 
@@ -63,8 +64,35 @@ bool RtspSinkJoinStream::Open(const RtspParam& rtsp_params) {
             << "  KBPS: " << rtsp_params.kbps;
   LOGI(RTSP) << "==================================================================";
 
+  std::vector<cv::Rect> tiles;
+  if (is_mosaic_style_) {
+    int view_num = rtsp_params.view_cols * rtsp_params.view_rows;
+    for (int channel_id = 0; channel_id < view_num; ++channel_id) {
+      int x = channel_id % rtsp_params.view_cols * mosaic_win_width_;
+      int y = channel_id / rtsp_params.view_cols * mosaic_win_height_;
+      if (3 == rtsp_params.view_cols && 2 == rtsp_params.view_rows) {
+        // channel 0 takes the 2x2 upper-left windows of a 3x3 grid
+        if (0 == channel_id) {
+          tiles.emplace_back(x, y, mosaic_win_width_ * 2, mosaic_win_height_ * 2);
+          continue;
+        } else if (1 == channel_id) {
+          x += mosaic_win_width_;
+        } else {
+          y += mosaic_win_height_;
+        }
+      }
+      tiles.emplace_back(x, y, mosaic_win_width_, mosaic_win_height_);
+    }
+  } else {
+    tiles.emplace_back(0, 0, rtsp_params.dst_width, rtsp_params.dst_height);
+  }
+  if (!compositor_.Init(cv::Size(rtsp_params.dst_width, rtsp_params.dst_height), tiles)) {
+    LOGE(RTSP) << "[Rtsp Sink] Init mosaic compositor failed.";
+    return false;
+  }
+
   ctx_ = StreamPipeCreate(rtsp_params);
-  canvas_ = cv::Mat(rtsp_params.dst_height, rtsp_params.dst_width, CV_8UC3);           // for bgr24
+  canvas_ = cv::Mat::zeros(rtsp_params.dst_height, rtsp_params.dst_width, CV_8UC3);    // for bgr24
   canvas_data_ = new uint8_t[rtsp_params.dst_height * rtsp_params.dst_width * 3 / 2];  // for nv21
 
   if (("cpu" == rtsp_params.preproc_type && MULTI_THREAD) || "bgr" == rtsp_params.color_mode) {
@@ -74,17 +102,15 @@ bool RtspSinkJoinStream::Open(const RtspParam& rtsp_params) {
 }
 
 void RtspSinkJoinStream::EncodeFrameBGR(const cv::Mat& bgr24, int64_t timestamp) {
-  cv::Mat bgr_tmp = cv::Mat(rtsp_param_->dst_height, rtsp_param_->dst_width, CV_8UC3);
-  if (rtsp_param_->src_width != rtsp_param_->dst_width || rtsp_param_->src_height != rtsp_param_->dst_height) {
-    cv::resize(bgr24, bgr_tmp, cv::Size(rtsp_param_->dst_width, rtsp_param_->dst_height), cv::INTER_CUBIC);
-  } else {
-    bgr_tmp = bgr24.clone();
+  const cv::Mat* bgr = &bgr24;
+  if (bgr24.cols != rtsp_param_->dst_width || bgr24.rows != rtsp_param_->dst_height) {
+    // resized_canvas_ keeps its buffer between calls
+    cv::resize(bgr24, resized_canvas_, cv::Size(rtsp_param_->dst_width, rtsp_param_->dst_height), 0, 0,
+               cv::INTER_LINEAR);
+    bgr = &resized_canvas_;
   }
-  uint8_t* nv_data = new uint8_t[rtsp_param_->dst_width * rtsp_param_->dst_height * 3 / 2];
-  Bgr2Yuv420nv(bgr_tmp, nv_data);
-  StreamPipePutPacket(ctx_, nv_data, timestamp);
-  delete[] nv_data;
-  bgr_tmp.release();
+  // converted by the encoder straight into its pooled input frame
+  StreamPipePutBGR(ctx_, bgr->data, static_cast<int>(bgr->step), timestamp);
 }
 
 void RtspSinkJoinStream::EncodeFrameYUV(uint8_t* s_data, int64_t timestamp) {
@@ -105,50 +131,34 @@ void RtspSinkJoinStream::Close() {
     refresh_thread_ = nullptr;
   }
 
-  StreamPipeClose(ctx_);
+  if (ctx_) {
+    StreamPipeClose(ctx_);
+    ctx_ = nullptr;
+  }
+  compositor_.Destroy();
   canvas_.release();
+  resized_canvas_.release();
+  yuv_i420_.release();
   delete[] canvas_data_;
+  canvas_data_ = nullptr;
   LOGI(RTSP) << "Release stream resources !!!" << std::endl;
 }
 
 bool RtspSinkJoinStream::UpdateBGR(cv::Mat image, int64_t timestamp, int channel_id) {
-  canvas_lock_.lock();
+  int tile_id = 0;
   if (is_mosaic_style_ && channel_id >= 0) {
-    if (3 == rtsp_param_->view_cols && 2 == rtsp_param_->view_rows) {
-      int x = channel_id % rtsp_param_->view_cols * mosaic_win_width_;
-      int y = channel_id / rtsp_param_->view_cols * mosaic_win_height_;
-      switch (channel_id) {
-        case 0:
-          cv::resize(image, image, cv::Size(mosaic_win_width_ * 2, mosaic_win_height_ * 2), cv::INTER_CUBIC);
-          image.copyTo(canvas_(cv::Rect(x, y, mosaic_win_width_ * 2, mosaic_win_height_ * 2)));
-          break;
-        case 1:
-          x += mosaic_win_width_;
-          cv::resize(image, image, cv::Size(mosaic_win_width_, mosaic_win_height_), cv::INTER_CUBIC);
-          image.copyTo(canvas_(cv::Rect(x, y, mosaic_win_width_, mosaic_win_height_)));
-          break;
-        default:
-          y += mosaic_win_height_;
-          cv::resize(image, image, cv::Size(mosaic_win_width_, mosaic_win_height_), cv::INTER_CUBIC);
-          image.copyTo(canvas_(cv::Rect(x, y, mosaic_win_width_, mosaic_win_height_)));
-          break;
-      }
-    } else {
-      int x = channel_id % rtsp_param_->view_cols * mosaic_win_width_;
-      int y = channel_id / rtsp_param_->view_cols * mosaic_win_height_;
-      cv::resize(image, image, cv::Size(mosaic_win_width_, mosaic_win_height_), cv::INTER_CUBIC);
-      image.copyTo(canvas_(cv::Rect(x, y, mosaic_win_width_, mosaic_win_height_)));
-    }
-  } else {
-    image.copyTo(canvas_);
+    tile_id = channel_id;
   }
-  canvas_lock_.unlock();
-  return true;
+  return compositor_.Update(tile_id, image);
 }
 
 bool RtspSinkJoinStream::UpdateYUV(uint8_t* image, int64_t timestamp) {
+  return UpdateYUV(image, image + rtsp_param_->src_width * rtsp_param_->src_height, timestamp);
+}
+
+bool RtspSinkJoinStream::UpdateYUV(uint8_t* y, uint8_t* uv, int64_t timestamp) {
   canvas_lock_.lock();
-  ResizeYuvNearest(image, canvas_data_);
+  ResizeYuvNearest(y, uv, canvas_data_);
   if (!MULTI_THREAD) {
     EncodeFrameYUV(canvas_data_, timestamp);
   }
@@ -190,15 +200,17 @@ void RtspSinkJoinStream::RefreshLoop() {
     pts_us = index++ * 1e6 / rtsp_param_->frame_rate;
 
     if (ctx_) {
-      canvas_lock_.lock();
       if ("cpu" == rtsp_param_->preproc_type) {
         if ("nv" == rtsp_param_->color_mode) {
+          canvas_lock_.lock();
           EncodeFrameYUV(canvas_data_, pts_us / 1000);
+          canvas_lock_.unlock();
         } else if ("bgr" == rtsp_param_->color_mode) {
+          // canvas_ is only touched by this thread, stream threads write to their own tiles
+          compositor_.Compose(&canvas_);
           EncodeFrameBGR(canvas_, pts_us / 1000);
         }
       }
-      canvas_lock_.unlock();
       delay_us = index * 1e6 / rtsp_param_->frame_rate - pts_us;
     }
   }
@@ -211,12 +223,12 @@ void RtspSinkJoinStream::Bgr2Yuv420nv(const cv::Mat& bgr, uint8_t* nv_data) {
   stride = bgr.cols;
 
   uint8_t *src_y, *src_u, *src_v, *dst_y, *dst_uv;
-  cv::Mat yuvI420 = cv::Mat(height * 3 / 2, width, CV_8UC1);
-  cv::cvtColor(bgr, yuvI420, cv::COLOR_BGR2YUV_I420);
+  // yuv_i420_ keeps its buffer between calls
+  cv::cvtColor(bgr, yuv_i420_, cv::COLOR_BGR2YUV_I420);
 
-  src_y = yuvI420.data;
-  src_u = yuvI420.data + width * height;
-  src_v = yuvI420.data + width * height * 5 / 4;
+  src_y = yuv_i420_.data;
+  src_u = yuv_i420_.data + width * height;
+  src_v = yuv_i420_.data + width * height * 5 / 4;
 
   dst_y = nv_data;
   dst_uv = nv_data + stride * height;
@@ -237,12 +249,17 @@ void RtspSinkJoinStream::Bgr2Yuv420nv(const cv::Mat& bgr, uint8_t* nv_data) {
       }
     }
   }
-  yuvI420.release();
 }
 
 void RtspSinkJoinStream::ResizeYuvNearest(uint8_t* src, uint8_t* dst) {
+  ResizeYuvNearest(src, src + rtsp_param_->src_height * rtsp_param_->src_width, dst);
+}
+
+void RtspSinkJoinStream::ResizeYuvNearest(uint8_t* src, uint8_t* src_uv, uint8_t* dst) {
   if (rtsp_param_->src_width == rtsp_param_->dst_width && rtsp_param_->src_height == rtsp_param_->dst_height) {
-    memcpy(dst, src, (rtsp_param_->dst_width * rtsp_param_->dst_height * 3 / 2) * sizeof(uint8_t));
+    memcpy(dst, src, (rtsp_param_->dst_width * rtsp_param_->dst_height) * sizeof(uint8_t));
+    memcpy(dst + rtsp_param_->dst_width * rtsp_param_->dst_height, src_uv,
+           (rtsp_param_->dst_width * rtsp_param_->dst_height / 2) * sizeof(uint8_t));
     return;
   }
   int srcy, srcx, src_index;
@@ -250,7 +267,6 @@ void RtspSinkJoinStream::ResizeYuvNearest(uint8_t* src, uint8_t* dst) {
   int yrIntFloat_16 = (rtsp_param_->src_height << 16) / rtsp_param_->dst_height + 1;
 
   uint8_t* dst_uv = dst + rtsp_param_->dst_height * rtsp_param_->dst_width;
-  uint8_t* src_uv = src + rtsp_param_->src_height * rtsp_param_->src_width;
   uint8_t* dst_uv_yScanline = nullptr;
   uint8_t* src_uv_yScanline = nullptr;
   uint8_t* dst_y_slice = dst;
@@ -40,6 +40,8 @@
 #include <string>
 #include <thread>
 
+#include "mosaic_compositor.hpp"
+
 namespace cnstream {
 
 struct RtspParam;
@@ -51,10 +53,12 @@ class RtspSinkJoinStream {
   ~RtspSinkJoinStream();
   void Close();
   bool UpdateYUV(uint8_t *image, int64_t timestamp);
+  bool UpdateYUV(uint8_t *y, uint8_t *uv, int64_t timestamp);
   // bool UpdateYUVs(void *y, void *yu, int64_t timestamp);
   bool UpdateBGR(cv::Mat image, int64_t timestamp, int channel_id = -1);
   void Bgr2Yuv420nv(const cv::Mat &bgr, uint8_t *nv_data);
   void ResizeYuvNearest(uint8_t *src, uint8_t *dst);
+  void ResizeYuvNearest(uint8_t *src, uint8_t *src_uv, uint8_t *dst);
 
  private:
   void RefreshLoop();
@@ -64,9 +68,12 @@ class RtspSinkJoinStream {
 
   std::shared_ptr<RtspParam> rtsp_param_ = nullptr;
 
-  std::mutex canvas_lock_;
+  std::mutex canvas_lock_;  // guards canvas_data_, bgr views go through compositor_ instead
   cv::Mat canvas_;
-  uint8_t *canvas_data_;
+  uint8_t *canvas_data_ = nullptr;
+  cv::Mat resized_canvas_;
+  cv::Mat yuv_i420_;
+  MosaicCompositor compositor_;
 
   std::thread *refresh_thread_ = nullptr;
   bool running_ = false;
@@ -63,6 +63,15 @@ int StreamPipePutPacket(StreamPipeCtx *ctx, uint8_t *data, int64_t timestamp) {
   return 0;
 }
 
+int StreamPipePutBGR(StreamPipeCtx *ctx, const uint8_t *bgr, int stride, int64_t timestamp) {
+  if (!ctx->init_flag) {
+    LOGI(RTSP) << "Init stream pipe firstly\n";
+    return -1;
+  }
+  ctx->video_encoder->SendFrameBGR(bgr, stride, timestamp);
+  return 0;
+}
+
 /*
 int StreamPipePutPacketMlu(StreamPipeCtx *ctx, void *y, void *uv, int64_t timestamp) {
   if (!ctx->init_flag) {
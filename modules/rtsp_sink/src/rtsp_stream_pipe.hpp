@@ -36,6 +36,7 @@ extern "C" {
 
 StreamPipeCtx* StreamPipeCreate(const RtspParam& rtsp_param);
 int StreamPipePutPacket(StreamPipeCtx* ctx, uint8_t* data, int64_t timestamp = 0);
+int StreamPipePutBGR(StreamPipeCtx* ctx, const uint8_t* bgr, int stride, int64_t timestamp = 0);
 // int StreamPipePutPacketMlu(StreamPipeCtx* ctx, void *y, void *uv, int64_t timestamp = 0);
 int StreamPipeClose(StreamPipeCtx* ctx);
 
@@ -23,9 +23,11 @@
 
 #include <fstream>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <thread>
+#include <vector>
 
 namespace cnstream {
 
@@ -36,7 +38,20 @@ class VideoEncoder {
     EOS,
   };
 
-  explicit VideoEncoder(size_t output_buffer_size = 0x100000);
+  class VideoFrame {
+   public:
+    VideoFrame() {}
+    virtual ~VideoFrame() {}
+    virtual void Fill(uint8_t *data, int64_t timestamp) = 0;
+    // Converts a BGR24 image of the encoder size into the frame in a single pass.
+    virtual void FillBGR(const uint8_t *bgr, int stride, int64_t timestamp) = 0;
+  };
+
+  /**
+   * @param output_buffer_size The maximum bytes of encoded packets waiting for the rtsp server.
+   * @param max_queued_packets The maximum number of encoded packets waiting for the rtsp server.
+   */
+  explicit VideoEncoder(size_t output_buffer_size = 0x100000, uint32_t max_queued_packets = 32);
   virtual ~VideoEncoder();
 
   void Start();
@@ -44,6 +59,9 @@ class VideoEncoder {
 
   bool SendFrame(uint8_t *data, int64_t timestamp);
   bool SendFrame(void *y, void *uv, int64_t timestamp);
+  // Converts a BGR24 image of the encoder size straight into a pooled input frame and encodes it.
+  bool SendFrameBGR(const uint8_t *bgr, int stride, int64_t timestamp);
+  // Copies the oldest encoded packet to data. If data is nullptr, only probes its size and timestamp.
   bool GetFrame(uint8_t *data, uint32_t max_size, uint32_t *size, int64_t *timestamp);
 
   virtual uint32_t GetBitRate() { return 0; }
@@ -51,65 +69,55 @@ class VideoEncoder {
   void SetCallback(std::function<void(Event)> func) { event_callback_ = func; }
 
  protected:
-  class VideoFrame {
-   public:
-    VideoFrame() {}
-    virtual ~VideoFrame() {}
-    virtual void Fill(uint8_t *data, int64_t timestamp) = 0;
-  };
-
   virtual VideoFrame *NewFrame() = 0;
   virtual void EncodeFrame(VideoFrame *frame) = 0;
   // virtual void EncodeFrame(void *y, void *uv, int64_t timestamp) = 0;
 
-  bool PushOutputBuffer(uint8_t *data, size_t size, uint32_t frame_id, int64_t timestamp);
+  /**
+   * Queues an encoded packet without copying it. The packet memory must stay valid until ReleasePacket(opaque)
+   * is called, which happens once the packet is delivered or dropped.
+   */
+  bool PushOutputPacket(uint8_t *data, size_t size, uint32_t frame_id, int64_t timestamp, void *opaque);
+  virtual void ReleasePacket(void *opaque) {}
 
   void Callback(Event event) {
     if (event_callback_) event_callback_(event);
   }
 
  private:
-  class CircularBuffer {
-   public:
-    explicit CircularBuffer(size_t capacity = 0x100000);
-    ~CircularBuffer();
-
-    size_t size() const { return size_; }
-    size_t capacity() const { return capacity_; }
-    // Return number of bytes written.
-    size_t write(const unsigned char *data, size_t bytes);
-    // Return number of bytes, without read pointer moving.
-    size_t probe(unsigned char *data, size_t bytes);
-    // Return number of bytes read. if data is nullptr, just move read pointer.
-    size_t read(unsigned char *data, size_t bytes);
-
-   private:
-    size_t beg_index_, end_index_, size_, capacity_;
-    unsigned char *data_;
-  };
-
-  struct EncodedFrameHeader {
-    uint32_t frame_id;
+  struct EncodedPacket {
+    uint8_t *data;
     uint32_t length;
-    uint32_t offset;
+    uint32_t frame_id;
     int64_t timestamp;
+    void *opaque;
   };
 
+  // Input frames are pooled, AcquireFrame() only allocates when all pooled frames are in use.
+  VideoFrame *AcquireFrame();
+  void ReleaseFrame(VideoFrame *frame);
+  // Encodes the frame and gives it back to the pool.
+  bool SendFrame(VideoFrame *frame);
+  int64_t GetRelativeTimestamp(int64_t timestamp);
+  void ClearOutputPackets();
+
   int64_t init_timestamp_ = -1;
 
   bool running_ = false;
   bool is_client_running_ = false;
-  std::thread *encode_thread_ = nullptr;
 
   std::mutex input_mutex_;
-  VideoFrame *sync_input_frame_ = nullptr;
+  std::mutex frame_pool_mutex_;
+  std::vector<std::unique_ptr<VideoFrame>> frames_;
+  std::vector<VideoFrame *> free_frames_;
 
   std::mutex output_mutex_;
-  CircularBuffer *output_circular_buffer_ = nullptr;
-  EncodedFrameHeader *output_frame_header_ = nullptr;
-  uint8_t *sync_output_frame_buffer_ = nullptr;
-  uint32_t sync_output_frame_buffer_length_ = 0;
-  bool sync_output_frame_new_ = false;
+  // ring of packets waiting for the rtsp server, preallocated to max_queued_packets
+  std::vector<EncodedPacket> output_packets_;
+  size_t output_head_ = 0;
+  size_t output_count_ = 0;
+  size_t output_bytes_ = 0;
+  size_t output_buffer_size_ = 0;
 
   uint32_t input_frames_dropped = 0;
   uint32_t output_frames_dropped = 0;
@@ -64,6 +64,8 @@ struct DataSourceParam {
   uint32_t input_buf_number_ = 2;               ///< valid when decoder_type = DECODER_MLU
   uint32_t output_buf_number_ = 3;              ///< valid when decoder_type = DECODER_MLU
   bool apply_stride_align_for_scaler_ = false;  //< recommended for use on m200 platforms
+  uint32_t priority_ = 1;                       ///< default priority of the streams, see StreamQos
+  uint32_t deadline_ms_ = 0;                    ///< default latency deadline of the streams, 0 means none
 };
 
 /**
@@ -102,6 +104,12 @@ class DataSource : public SourceModule, public ModuleCreator<DataSource> {
    *   input_buf_number: Optional. The input buffer number. The default value is 2.
    *   output_buf_number: Optional. The output buffer number. The default value is 3.
    *   apply_stride_align_for_scaler: Optional. Apply stride align for scaler on m220(m.2/edge).
+   *   priority: Optional. The default priority of the streams, at least 1. The default value is 1.
+                 Streams of higher priority get a larger share of the downstream modules, and frames of
+                 lower priority are dropped first when a module is overloaded. See StreamQos.
+   *   deadline_ms: Optional. The default latency deadline of the streams in milliseconds, 0 means no deadline.
+                    The default value is 0. Frames with a deadline are processed earliest deadline first.
+   *   A handler could override both by SourceHandler::SetQos.
    * @endverbatim
    *
    * @return
@@ -252,7 +252,7 @@ void FileHandlerImpl::OnDecodeError(DecodeErrorCode error_code) {
 }
 
 void FileHandlerImpl::OnDecodeFrame(DecodeFrame *frame) {
-  if (frame_count_++ % param_.interval_ != 0) {
+  if (frame_count_++ % (param_.interval_ * handler_.GetDecodeThrottle()) != 0) {
     return;  // discard frames
   }
   if (!frame) return;
@@ -172,7 +172,7 @@ void ESJpegMemHandlerImpl::OnDecodeError(DecodeErrorCode error_code) {
 }
 
 void ESJpegMemHandlerImpl::OnDecodeFrame(DecodeFrame *frame) {
-  if (frame_count_++ % param_.interval_ != 0) {
+  if (frame_count_++ % (param_.interval_ * handler_.GetDecodeThrottle()) != 0) {
     return;  // discard frames
   }
   if (!frame) return;
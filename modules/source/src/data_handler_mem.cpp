@@ -422,7 +422,7 @@ void ESMemHandlerImpl::OnDecodeError(DecodeErrorCode error_code) {
 }
 
 void ESMemHandlerImpl::OnDecodeFrame(DecodeFrame *frame) {
-  if (frame_count_++ % param_.interval_ != 0) {
+  if (frame_count_++ % (param_.interval_ * handler_.GetDecodeThrottle()) != 0) {
     return;  // discard frames
   }
   if (!frame) return;
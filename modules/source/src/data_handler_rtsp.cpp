@@ -436,7 +436,7 @@ void RtspHandlerImpl::OnDecodeError(DecodeErrorCode error_code) {
 }
 
 void RtspHandlerImpl::OnDecodeFrame(DecodeFrame *frame) {
-  if (frame_count_++ % param_.interval_ != 0) {
+  if (frame_count_++ % (param_.interval_ * handler_->GetDecodeThrottle()) != 0) {
     return;  // discard frames
   }
   if (!frame) return;
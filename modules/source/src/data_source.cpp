@@ -53,6 +53,12 @@ DataSource::DataSource(const std::string &name) : SourceModule(name) {
   param_register_.Register("apply_stride_align_for_scaler",
                            "The output data will align the scaler(hardware on mlu220) requirements."
                            " Recommended for use with scaler on mlu220 platforms.");
+  param_register_.Register("priority",
+                           "The default priority of the streams, at least 1. Streams of higher priority get a larger"
+                           " share of the downstream modules and are dropped later when they are overloaded.");
+  param_register_.Register("deadline_ms",
+                           "The default latency deadline of the streams in milliseconds. Frames with a deadline are"
+                           " processed earliest deadline first. 0 means no deadline.");
 }
 
 DataSource::~DataSource() {}
@@ -149,6 +155,34 @@ bool DataSource::Open(ModuleParamSet paramSet) {
     param_.apply_stride_align_for_scaler_ = paramSet["apply_stride_align_for_scaler"] == "true";
   }
 
+  if (paramSet.find("priority") != paramSet.end()) {
+    std::stringstream ss;
+    int priority = 0;
+    ss << paramSet["priority"];
+    ss >> priority;
+    if (priority <= 0) {
+      LOGE(SOURCE) << "priority : invalid";
+      return false;
+    }
+    param_.priority_ = priority;
+  }
+
+  if (paramSet.find("deadline_ms") != paramSet.end()) {
+    std::stringstream ss;
+    int deadline_ms = -1;
+    ss << paramSet["deadline_ms"];
+    ss >> deadline_ms;
+    if (deadline_ms < 0) {
+      LOGE(SOURCE) << "deadline_ms : invalid";
+      return false;
+    }
+    param_.deadline_ms_ = deadline_ms;
+  }
+  StreamQos qos;
+  qos.priority = param_.priority_;
+  qos.deadline_ms = param_.deadline_ms_;
+  SetDefaultQos(qos);
+
   return true;
 }
 
@@ -175,7 +209,8 @@ bool DataSource::CheckParamSet(const ModuleParamSet &paramSet) const {
   }
 
   std::string err_msg;
-  if (!checker.IsNum({"interval", "input_buf_number", "output_buf_number"}, paramSet, err_msg, true)) {
+  if (!checker.IsNum({"interval", "input_buf_number", "output_buf_number", "priority", "deadline_ms"}, paramSet,
+                     err_msg, true)) {
     LOGE(SOURCE) << "[DataSource] " << err_msg;
     ret = false;
   }
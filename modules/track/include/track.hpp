@@ -26,9 +26,11 @@
  *  This file contains a declaration of struct Tracker
  */
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
-#include <unordered_map>
+#include <vector>
 
 #include "cnstream_core.hpp"
 #include "cnstream_frame.hpp"
@@ -41,6 +43,8 @@ namespace cnstream {
 CNSTREAM_REGISTER_EXCEPTION(Tracker);
 
 struct TrackerContext;
+class TrackerContextTable;
+class FeatureExtractor;
 
 /// Pointer for frame info
 using CNFrameInfoPtr = std::shared_ptr<CNFrameInfo>;
@@ -79,6 +83,8 @@ class Tracker : public Module, public ModuleCreator<Tracker> {
    * model_path: Offline model path
    * func_name:  Function name defined in the offline model, could be found in the cambricon_twins description file
                It is "subnet0" for the most case
+   * idle_timeout: Seconds without frames after which the tracking context of a stream is released, 0 by default,
+               which keeps contexts until the end of their streams
    * @endverbatim
    *  @return if module open succeed
    */
@@ -113,16 +119,42 @@ class Tracker : public Module, public ModuleCreator<Tracker> {
    */
   bool CheckParamSet(const ModuleParamSet &paramSet) const override;
 
+  /**
+   * @brief Releases the tracking context of a stream when its EOS arrives.
+   *
+   * @param stream_id The stream identification.
+   */
+  void OnEos(const std::string &stream_id) override;
+
+  /**
+   * @brief Releases tracking contexts of streams which have not sent a frame for a while.
+   *
+   * Contexts in use are never released. A stream gets a new context with its next frame.
+   *
+   * @param idle_ms Idle time in milliseconds.
+   *
+   * @return Returns the number of contexts released.
+   */
+  size_t EvictIdleContexts(int64_t idle_ms);
+
  private:
-  TrackerContext *GetContext(CNFrameInfoPtr data);
-  std::unordered_map<int, TrackerContext *> contexts_;
+  TrackerContext *CreateContext(CNFrameInfoPtr data);
+  FeatureExtractor *GetFeatureExtractor();
+  void BindDevice();
+  std::unique_ptr<TrackerContextTable> contexts_;
+  std::atomic<int64_t> next_sweep_ms_{0};
+  int64_t idle_timeout_ms_ = 0;
+  // feature extractors of all threads processing this module, cached per thread
+  std::mutex extractors_mutex_;
+  std::vector<std::unique_ptr<FeatureExtractor>> extractors_;
+  uint64_t instance_id_ = 0;
   std::shared_ptr<edk::ModelLoader> model_loader_ = nullptr;
-  std::mutex mutex_;
   int device_id_ = 0;
   std::string model_path_ = "";
   std::string func_name_ = "";
   std::string track_name_ = "";
   float max_cosine_distance_ = 0.2;
+  edk::AssignmentSolver assignment_solver_ = edk::AssignmentSolver::HUNGARIAN;
 };  // class Tracker
 
 }  // namespace cnstream
@@ -18,6 +18,7 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -81,12 +82,40 @@ void FeatureExtractor::ExtractFeature(const cv::Mat& image,
                                       std::vector<std::vector<float>>* features) {
   features->clear();
   if (!model_loader_) {
-    ExtractFeatureOnCpu(image, objs_holder, features);
+    ExtractFeatureOnCpu(image, false, objs_holder, features);
   } else {
     ExtractFeatureOnMlu(image, objs_holder, features);
   }
 }
 
+void FeatureExtractor::ExtractFeature(CNDataFrame* frame, const CNInferObjsPtr& objs_holder,
+                                      std::vector<std::vector<float>>* features) {
+  features->clear();
+  if (model_loader_) {
+    ExtractFeatureOnMlu(*frame->ImageBGR(), objs_holder, features);
+    return;
+  }
+  if (objs_holder->objs_.empty()) return;
+  // wrap the frame without copy, ORB works on gray images so the luma plane is all it needs
+  switch (frame->fmt) {
+    case CN_PIXEL_FORMAT_YUV420_NV12:
+    case CN_PIXEL_FORMAT_YUV420_NV21: {
+      cv::Mat luma(frame->height, frame->width, CV_8UC1, const_cast<void*>(frame->data[0]->GetCpuData()),
+                   frame->stride[0]);
+      ExtractFeatureOnCpu(luma, false, objs_holder, features);
+    } break;
+    case CN_PIXEL_FORMAT_BGR24:
+    case CN_PIXEL_FORMAT_RGB24: {
+      cv::Mat image(frame->height, frame->width, CV_8UC3, const_cast<void*>(frame->data[0]->GetCpuData()),
+                    frame->stride[0] * 3);
+      ExtractFeatureOnCpu(image, frame->fmt == CN_PIXEL_FORMAT_RGB24, objs_holder, features);
+    } break;
+    default:
+      ExtractFeatureOnCpu(*frame->ImageBGR(), false, objs_holder, features);
+      break;
+  }
+}
+
 void FeatureExtractor::ExtractFeatureOnMlu(const cv::Mat& image,
                                            const CNInferObjsPtr& objs_holder,
                                            std::vector<std::vector<float>>* features) {
@@ -113,28 +142,55 @@ void FeatureExtractor::ExtractFeatureOnMlu(const cv::Mat& image,
   }
 }
 
-void FeatureExtractor::ExtractFeatureOnCpu(const cv::Mat& image,
-                                           const CNInferObjsPtr& objs_holder,
+namespace {
+
+class ExtractFeatureLoop : public cv::ParallelLoopBody {
+ public:
+  explicit ExtractFeatureLoop(const std::function<void(int)>& func) : func_(func) {}
+  void operator()(const cv::Range& range) const override {
+    for (int i = range.start; i < range.end; ++i) func_(i);
+  }
+
+ private:
+  const std::function<void(int)>& func_;
+};  // class ExtractFeatureLoop
+
+}  // namespace
+
+void FeatureExtractor::ExtractFeatureOnCpu(const cv::Mat& image, bool rgb, const CNInferObjsPtr& objs_holder,
                                            std::vector<std::vector<float>>* features) {
-  for (uint32_t num = 0; num < objs_holder->objs_.size(); ++num) {
-    auto obj = objs_holder->objs_[num];
-    cv::Rect rect = cv::Rect(obj->bbox.x * image.cols, obj->bbox.y * image.rows, obj->bbox.w * image.cols,
-                             obj->bbox.h * image.rows);
-    cv::Mat obj_img(image, rect);
+  const std::vector<CNInferObjectPtr>& objs = objs_holder->objs_;
+  features->assign(objs.size(), std::vector<float>(128, 0));
+  std::function<void(int)> func = [&](int i) {
+    ExtractFeatureOfObject(image, rgb, objs[i]->bbox, &(*features)[i]);
+  };
+  cv::parallel_for_(cv::Range(0, static_cast<int>(objs.size())), ExtractFeatureLoop(func));
+}
+
+void FeatureExtractor::ExtractFeatureOfObject(const cv::Mat& image, bool rgb, const CNInferBoundingBox& bbox,
+                                              std::vector<float>* feature) {
+  // every thread keeps its own ORB detector, which holds no state between images
 #if (CV_MAJOR_VERSION == 2)  // NOLINT
-    cv::Ptr<cv::ORB> processer = new cv::ORB(128);
+  static thread_local cv::Ptr<cv::ORB> processer = new cv::ORB(128);
 #elif (CV_MAJOR_VERSION >= 3)  //  NOLINT
-    cv::Ptr<cv::ORB> processer = cv::ORB::create(128);
+  static thread_local cv::Ptr<cv::ORB> processer = cv::ORB::create(128);
 #endif
-    std::vector<cv::KeyPoint> keypoints;
-    processer->detect(obj_img, keypoints);
-    cv::Mat desc;
-    processer->compute(obj_img, keypoints, desc);
-    std::vector<float> feature;
-    for (int i = 0; i < 128; i++) {
-      feature.push_back((i < desc.rows ? CalcFeatureOfRow(desc, i) : 0));
-    }
-    features->push_back(feature);
+  static thread_local cv::Mat gray;
+
+  cv::Rect rect = cv::Rect(bbox.x * image.cols, bbox.y * image.rows, bbox.w * image.cols, bbox.h * image.rows);
+  rect &= cv::Rect(0, 0, image.cols, image.rows);
+  if (rect.area() == 0) return;
+  cv::Mat obj_img(image, rect);
+  if (obj_img.channels() == 3) {
+    cv::cvtColor(obj_img, gray, rgb ? cv::COLOR_RGB2GRAY : cv::COLOR_BGR2GRAY);
+    obj_img = gray;
+  }
+  std::vector<cv::KeyPoint> keypoints;
+  cv::Mat desc;
+  processer->detect(obj_img, keypoints);
+  processer->compute(obj_img, keypoints, desc);
+  for (int i = 0; i < desc.rows && i < 128; i++) {
+    (*feature)[i] = CalcFeatureOfRow(desc, i);
   }
 }
 
@@ -57,12 +57,27 @@ class FeatureExtractor {
   void ExtractFeature(const cv::Mat& image, const CNInferObjsPtr& objs_holder,
                       std::vector<std::vector<float>>* features);
 
+  /*******************************************************
+   * @brief extract features of all objects of a frame
+   * @param
+   *   frame[in] frame
+   *   objs_holder[in] detected objects
+   *   features[out] features, one for each object
+   * @note On CPU, only object regions are cropped from the
+   *       luma plane or converted to gray, no full frame
+   *       BGR image is made, and objects are processed in
+   *       parallel.
+   * *****************************************************/
+  void ExtractFeature(CNDataFrame* frame, const CNInferObjsPtr& objs_holder,
+                      std::vector<std::vector<float>>* features);
 
  private:
   void ExtractFeatureOnMlu(const cv::Mat& image, const CNInferObjsPtr& objs_holder,
                            std::vector<std::vector<float>>* features);
-  void ExtractFeatureOnCpu(const cv::Mat& image, const CNInferObjsPtr& objs_holder,
+  void ExtractFeatureOnCpu(const cv::Mat& image, bool rgb, const CNInferObjsPtr& objs_holder,
                            std::vector<std::vector<float>>* features);
+  void ExtractFeatureOfObject(const cv::Mat& image, bool rgb, const CNInferBoundingBox& bbox,
+                              std::vector<float>* feature);
   int RunBatch(const std::vector<std::vector<float*>>& inputs,
                                std::vector<std::vector<float>>* outputs);
   cv::Mat CropImage(const cv::Mat& image, const CNInferBoundingBox& bbox);
@@ -18,8 +18,12 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "cnstream_frame_va.hpp"
@@ -31,14 +35,96 @@ namespace cnstream {
 
 struct TrackerContext {
   std::unique_ptr<edk::EasyTrack> processer_ = nullptr;
+  std::string stream_id;
+  std::atomic<int64_t> last_active_ms{0};
   TrackerContext() = default;
   ~TrackerContext() = default;
   TrackerContext(const TrackerContext &) = delete;
   TrackerContext &operator=(const TrackerContext &) = delete;
 };
 
+static int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/**
+ * Tracking contexts indexed by stream index.
+ *
+ * Looking up a context takes no lock: the thread processing a frame swaps a busy mark into the slot of its stream and
+ * puts the context back when the frame is done. Frames of one stream are processed in order, so the slot is only ever
+ * contended by eviction, which takes a context out of the slot only when it is not marked busy.
+ */
+class TrackerContextTable {
+ public:
+  explicit TrackerContextTable(uint32_t capacity)
+      : capacity_(capacity), slots_(new std::atomic<TrackerContext *>[capacity]) {
+    for (uint32_t i = 0; i < capacity_; ++i) slots_[i].store(nullptr, std::memory_order_relaxed);
+  }
+  ~TrackerContextTable() {
+    for (uint32_t i = 0; i < capacity_; ++i) {
+      TrackerContext *ctx = slots_[i].load();
+      if (ctx != Busy()) delete ctx;
+    }
+  }
+  uint32_t GetCapacity() const { return capacity_; }
+
+  /**
+   * Takes the context of a stream out of the table, nullptr if it has none yet. Must be paired with Release().
+   */
+  TrackerContext *Acquire(uint32_t idx) {
+    TrackerContext *ctx = slots_[idx].exchange(Busy(), std::memory_order_acquire);
+    while (ctx == Busy()) {
+      std::this_thread::yield();
+      ctx = slots_[idx].exchange(Busy(), std::memory_order_acquire);
+    }
+    return ctx;
+  }
+
+  void Release(uint32_t idx, TrackerContext *ctx) { slots_[idx].store(ctx, std::memory_order_release); }
+
+  /**
+   * Deletes the contexts not in use that match the predicate. Returns the number of contexts deleted.
+   */
+  template <typename Pred>
+  size_t EvictIf(Pred pred) {
+    // the predicate reads the context, so evictions must not overlap
+    std::lock_guard<std::mutex> lk(evict_mutex_);
+    size_t count = 0;
+    for (uint32_t i = 0; i < capacity_; ++i) {
+      TrackerContext *ctx = slots_[i].load(std::memory_order_acquire);
+      if (ctx == nullptr || ctx == Busy() || !pred(ctx)) continue;
+      if (slots_[i].compare_exchange_strong(ctx, Busy(), std::memory_order_acquire)) {
+        delete ctx;
+        slots_[i].store(nullptr, std::memory_order_release);
+        ++count;
+      }
+    }
+    return count;
+  }
+
+ private:
+  static TrackerContext *Busy() { return reinterpret_cast<TrackerContext *>(1); }
+  uint32_t capacity_;
+  std::unique_ptr<std::atomic<TrackerContext *>[]> slots_;
+  std::mutex evict_mutex_;
+};  // class TrackerContextTable
+
+// puts the context of a stream back into the table when its frame is done
+class TrackerContextGuard {
+ public:
+  TrackerContextGuard(TrackerContextTable *table, uint32_t idx, TrackerContext *ctx)
+      : table_(table), idx_(idx), ctx_(ctx) {}
+  ~TrackerContextGuard() { table_->Release(idx_, ctx_); }
+
+ private:
+  TrackerContextTable *table_;
+  uint32_t idx_;
+  TrackerContext *ctx_;
+};  // class TrackerContextGuard
+
 static thread_local std::unique_ptr<edk::MluContext> g_tl_mlu_env;
-static thread_local std::unique_ptr<FeatureExtractor> g_tl_feature_extractor;
+static std::atomic<uint64_t> g_tracker_instance_id{0};
 
 Tracker::Tracker(const std::string &name) : Module(name) {
   param_register_.SetModuleDesc("Tracker is a module for realtime tracking.");
@@ -49,50 +135,63 @@ Tracker::Tracker(const std::string &name) : Module(name) {
   param_register_.Register("track_name", "Track algorithm name. Choose from FeatureMatch and KCF.");
   param_register_.Register("device_id", "Which device will be used. If there is only one device, it might be 0.");
   param_register_.Register("max_cosine_distance", "Threshold of cosine distance.");
+  param_register_.Register("assignment_solver",
+                           "Assignment solver of FeatureMatch. Choose from Hungarian and Sparse."
+                           " Sparse is faster when few detections are close to each track.");
+  param_register_.Register("idle_timeout",
+                           "Seconds without frames after which the tracking context of a stream is released."
+                           " 0 by default, contexts are kept until the end of their streams.");
 }
 
 Tracker::~Tracker() { Close(); }
 
-TrackerContext *Tracker::GetContext(CNFrameInfoPtr data) {
+void Tracker::BindDevice() {
   if (!g_tl_mlu_env) {
     g_tl_mlu_env.reset(new edk::MluContext);
     g_tl_mlu_env->SetDeviceId(device_id_);
     g_tl_mlu_env->BindDevice();
   }
-  if (!g_tl_feature_extractor) {
-    if (!model_loader_) {
-      LOGI(TRACK) << "[FeatureExtractor] model not set, extract feature on CPU";
-      g_tl_feature_extractor.reset(new FeatureExtractor());
-    } else {
-      g_tl_feature_extractor.reset(new FeatureExtractor(model_loader_, device_id_));
-    }
-  }
+}
 
-  TrackerContext *ctx = nullptr;
-  std::unique_lock<std::mutex> guard(mutex_);
-  auto search = contexts_.find(data->GetStreamIndex());
-  if (data->GetStreamIndex() >= GetMaxStreamNumber()) {
-    return nullptr;
-  }
-  if (search != contexts_.end()) {
-    // context exists
-    ctx = search->second;
+FeatureExtractor *Tracker::GetFeatureExtractor() {
+  // extractors are owned by the module, so Close() releases the ones of all threads. The threads of a pipeline serve
+  // one module each, a single slot is kept per thread and is replaced once the module is opened again, as instance
+  // ids are never reused.
+  static thread_local uint64_t tl_instance_id = 0;
+  static thread_local FeatureExtractor *tl_extractor = nullptr;
+  if (tl_extractor && tl_instance_id == instance_id_) return tl_extractor;
+
+  std::unique_ptr<FeatureExtractor> extractor;
+  if (!model_loader_) {
+    LOGI(TRACK) << "[FeatureExtractor] model not set, extract feature on CPU";
+    extractor.reset(new FeatureExtractor());
   } else {
-    ctx = new TrackerContext;
-    if ("KCF" == track_name_) {
+    extractor.reset(new FeatureExtractor(model_loader_, device_id_));
+  }
+  FeatureExtractor *ptr = extractor.get();
+  std::lock_guard<std::mutex> lk(extractors_mutex_);
+  extractors_.push_back(std::move(extractor));
+  tl_instance_id = instance_id_;
+  tl_extractor = ptr;
+  return ptr;
+}
+
+TrackerContext *Tracker::CreateContext(CNFrameInfoPtr data) {
+  std::unique_ptr<TrackerContext> ctx(new TrackerContext);
+  ctx->stream_id = data->stream_id;
+  if ("KCF" == track_name_) {
 #ifdef ENABLE_KCF
-      ctx->processer_.reset(new edk::KcfTrack);
-      dynamic_cast<edk::KcfTrack *>(ctx->processer_.get())->SetModel(model_loader_, device_id_);
-      contexts_[data->GetStreamIndex()] = ctx;
+    ctx->processer_.reset(new edk::KcfTrack);
+    dynamic_cast<edk::KcfTrack *>(ctx->processer_.get())->SetModel(model_loader_, device_id_);
 #endif
-    } else {  // "FeatureMatch by default"
-      edk::FeatureMatchTrack *track = new edk::FeatureMatchTrack;
-      track->SetParams(max_cosine_distance_, 100, 0.7, 30, 3);
-      ctx->processer_.reset(track);
-      contexts_[data->GetStreamIndex()] = ctx;
-    }
+  } else {  // "FeatureMatch by default"
+    edk::FeatureMatchTrack *track = new edk::FeatureMatchTrack;
+    track->SetParams(max_cosine_distance_, 100, 0.7, 30, 3);
+    track->SetAssignmentSolver(assignment_solver_);
+    ctx->processer_.reset(track);
   }
-  return ctx;
+  if (!ctx->processer_) return nullptr;
+  return ctx.release();
 }
 
 bool Tracker::Open(ModuleParamSet paramSet) {
@@ -114,11 +213,28 @@ bool Tracker::Open(ModuleParamSet paramSet) {
     device_id_ = std::stoi(paramSet["device_id"]);
   }
 
+  assignment_solver_ = edk::AssignmentSolver::HUNGARIAN;
+  if (paramSet.find("assignment_solver") != paramSet.end() && paramSet["assignment_solver"] == "Sparse") {
+    assignment_solver_ = edk::AssignmentSolver::SPARSE;
+  }
+
   track_name_ = "FeatureMatch";
   if (paramSet.find("track_name") != paramSet.end()) {
     track_name_ = paramSet["track_name"];
   }
 
+  idle_timeout_ms_ = 0;
+  if (paramSet.find("idle_timeout") != paramSet.end()) {
+    idle_timeout_ms_ = std::stoll(paramSet["idle_timeout"]) * 1000;
+  }
+  next_sweep_ms_.store(NowMs() + idle_timeout_ms_);
+  contexts_.reset(new TrackerContextTable(GetMaxStreamNumber()));
+  {
+    std::lock_guard<std::mutex> lk(extractors_mutex_);
+    extractors_.clear();
+  }
+  instance_id_ = ++g_tracker_instance_id;
+
   if (!model_path_.empty()) {
     try {
       model_loader_ = std::make_shared<edk::ModelLoader>(model_path_, func_name_);
@@ -134,16 +250,26 @@ void Tracker::Close() {
   if (model_loader_) {
     model_loader_.reset();
   }
-  if (g_tl_feature_extractor) {
-    g_tl_feature_extractor.reset();
+  {
+    std::lock_guard<std::mutex> lk(extractors_mutex_);
+    extractors_.clear();
   }
   if (g_tl_mlu_env) {
     g_tl_mlu_env.reset();
   }
-  for (auto &pair : contexts_) {
-    delete pair.second;
-  }
-  contexts_.clear();
+  contexts_.reset();
+}
+
+void Tracker::OnEos(const std::string &stream_id) {
+  if (!contexts_) return;
+  // stream indexes are reused by new streams, which must not inherit the tracks
+  contexts_->EvictIf([&stream_id](const TrackerContext *ctx) { return ctx->stream_id == stream_id; });
+}
+
+size_t Tracker::EvictIdleContexts(int64_t idle_ms) {
+  if (!contexts_) return 0;
+  int64_t deadline = NowMs() - idle_ms;
+  return contexts_->EvictIf([deadline](const TrackerContext *ctx) { return ctx->last_active_ms.load() <= deadline; });
 }
 
 int Tracker::Process(std::shared_ptr<CNFrameInfo> data) {
@@ -168,15 +294,31 @@ int Tracker::Process(std::shared_ptr<CNFrameInfo> data) {
     bbox.w = (bbox.x + bbox.w > 1.0) ? (1.0 - bbox.x) : bbox.w;
     bbox.h = (bbox.y + bbox.h > 1.0) ? (1.0 - bbox.y) : bbox.h;
   }
-  TrackerContext *ctx = GetContext(data);
-  if (nullptr == ctx || nullptr == ctx->processer_) {
+  BindDevice();
+  uint32_t stream_idx = data->GetStreamIndex();
+  if (!contexts_ || stream_idx >= contexts_->GetCapacity()) {
     LOGE(TRACK) << "Get Tracker Context Failed.";
     return -1;
   }
+  TrackerContext *ctx = contexts_->Acquire(stream_idx);
+  if (nullptr == ctx) ctx = CreateContext(data);
+  TrackerContextGuard guard(contexts_.get(), stream_idx, ctx);
+  if (nullptr == ctx) {
+    LOGE(TRACK) << "Get Tracker Context Failed.";
+    return -1;
+  }
+  int64_t now = NowMs();
+  ctx->last_active_ms.store(now, std::memory_order_relaxed);
+  if (idle_timeout_ms_ > 0) {
+    int64_t next_sweep = next_sweep_ms_.load(std::memory_order_relaxed);
+    if (now >= next_sweep && next_sweep_ms_.compare_exchange_strong(next_sweep, now + idle_timeout_ms_)) {
+      EvictIdleContexts(idle_timeout_ms_);
+    }
+  }
 
   if (track_name_ == "FeatureMatch") {
     std::vector<std::vector<float>> features;
-    g_tl_feature_extractor->ExtractFeature(*frame->ImageBGR(), objs_holder, &features);
+    GetFeatureExtractor()->ExtractFeature(frame.get(), objs_holder, &features);
 
     std::vector<edk::DetectObject> in, out;
     for (size_t i = 0; i < objs_holder->objs_.size(); i++) {
@@ -266,6 +408,14 @@ bool Tracker::CheckParamSet(const ModuleParamSet &paramSet) const {
     }
   }
 
+  if (paramSet.find("assignment_solver") != paramSet.end()) {
+    std::string solver = paramSet.at("assignment_solver");
+    if (solver != "Hungarian" && solver != "Sparse") {
+      LOGE(TRACK) << "[Tracker] [assignment_solver] : Unsupported assignment solver " << solver;
+      ret = false;
+    }
+  }
+
   std::string err_msg;
   if (paramSet.find("device_id") != paramSet.end()) {
     if (!checker.IsNum({"device_id"}, paramSet, err_msg)) {
@@ -280,6 +430,13 @@ bool Tracker::CheckParamSet(const ModuleParamSet &paramSet) const {
       ret = false;
     }
   }
+
+  if (paramSet.find("idle_timeout") != paramSet.end()) {
+    if (!checker.IsNum({"idle_timeout"}, paramSet, err_msg)) {
+      LOGE(TRACK) << "[Tracker] " << err_msg;
+      ret = false;
+    }
+  }
   return ret;
 }
 
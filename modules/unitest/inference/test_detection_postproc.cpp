@@ -0,0 +1,257 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "detection_postproc.hpp"
+
+namespace cnstream {
+
+static float Iou(const DetectionBoxes& boxes, int a, int b) {
+  float w = std::min(boxes.x2[a], boxes.x2[b]) - std::max(boxes.x1[a], boxes.x1[b]);
+  float h = std::min(boxes.y2[a], boxes.y2[b]) - std::max(boxes.y1[a], boxes.y1[b]);
+  float inter = std::max(w, 0.f) * std::max(h, 0.f);
+  float area_a = (boxes.x2[a] - boxes.x1[a]) * (boxes.y2[a] - boxes.y1[a]);
+  float area_b = (boxes.x2[b] - boxes.x1[b]) * (boxes.y2[b] - boxes.y1[b]);
+  return inter / (area_a + area_b - inter);
+}
+
+// Clustered random boxes, so that many of them overlap.
+static DetectionBoxes RandomBoxes(int num, int label_num, unsigned seed) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> center(0.1f, 0.9f), jitter(-0.03f, 0.03f), size(0.05f, 0.2f), score(0, 1);
+  std::vector<std::pair<float, float>> clusters;
+  for (int i = 0; i < 8; ++i) clusters.emplace_back(center(gen), center(gen));
+  DetectionBoxes boxes;
+  for (int i = 0; i < num; ++i) {
+    auto cluster = clusters[i % clusters.size()];
+    float cx = cluster.first + jitter(gen), cy = cluster.second + jitter(gen);
+    float w = size(gen), h = size(gen);
+    boxes.Add(cx - w / 2, cy - h / 2, cx + w / 2, cy + h / 2, score(gen), i % label_num);
+  }
+  return boxes;
+}
+
+// Reference greedy NMS, returns the indices of the survivors.
+static std::vector<int> NaiveNms(const DetectionBoxes& boxes, float iou_threshold) {
+  std::vector<int> order(boxes.Size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return boxes.score[a] > boxes.score[b]; });
+  std::vector<int> keep;
+  for (int i : order) {
+    bool suppressed = false;
+    for (int k : keep) {
+      if (boxes.label[k] == boxes.label[i] && Iou(boxes, k, i) > iou_threshold) {
+        suppressed = true;
+        break;
+      }
+    }
+    if (!suppressed) keep.push_back(i);
+  }
+  return keep;
+}
+
+TEST(Inferencer, DetectionPostprocSigmoid) {
+  std::vector<float> src;
+  for (float x = -100.f; x <= 100.f; x += 0.37f) src.push_back(x);
+  std::vector<float> dst(src.size());
+  Sigmoid(src.data(), dst.data(), src.size());
+  for (size_t i = 0; i < src.size(); ++i) {
+    EXPECT_NEAR(dst[i], 1.f / (1.f + std::exp(-src[i])), 1e-6f) << src[i];
+  }
+  // in place
+  Sigmoid(src.data(), src.data(), src.size());
+  for (size_t i = 0; i < src.size(); ++i) EXPECT_EQ(dst[i], src[i]);
+}
+
+TEST(Inferencer, DetectionPostprocCompact) {
+  std::vector<float> values = {0.1f, 0.5f, 0.9f, 0.2f, 0.f, 0.f, 0.f, 0.f, 0.7f, 0.4f, 0.5f};
+  std::vector<int> indices(values.size());
+  size_t num = CompactByThreshold(values.data(), values.size(), 0.5f, indices.data());
+  indices.resize(num);
+  EXPECT_EQ(indices, std::vector<int>({1, 2, 8, 10}));
+  EXPECT_EQ(0u, CompactByThreshold(values.data(), values.size(), 2.f, indices.data()));
+}
+
+TEST(Inferencer, DetectionPostprocNms) {
+  for (int label_num : {1, 3}) {
+    DetectionBoxes boxes = RandomBoxes(501, label_num, 7);
+    std::vector<int> expected = NaiveNms(boxes, 0.45f);
+    DetectionBoxes reference = boxes;
+    reference.Keep(expected);
+    Nms(&boxes, 0.45f);
+    ASSERT_EQ(reference.Size(), boxes.Size());
+    EXPECT_EQ(reference.x1, boxes.x1);
+    EXPECT_EQ(reference.score, boxes.score);
+    EXPECT_EQ(reference.label, boxes.label);
+    EXPECT_TRUE(std::is_sorted(boxes.score.rbegin(), boxes.score.rend()));
+  }
+  // boxes of different labels do not suppress each other
+  DetectionBoxes boxes;
+  boxes.Add(0.1f, 0.1f, 0.5f, 0.5f, 0.9f, 0);
+  boxes.Add(0.1f, 0.1f, 0.5f, 0.5f, 0.8f, 1);
+  boxes.Add(0.11f, 0.1f, 0.5f, 0.5f, 0.7f, 0);
+  Nms(&boxes, 0.5f);
+  EXPECT_EQ(boxes.label, std::vector<int>({0, 1}));
+  // max output
+  boxes = RandomBoxes(100, 3, 1);
+  Nms(&boxes, 0.45f, 5);
+  EXPECT_EQ(5u, boxes.Size());
+  boxes.Clear();
+  Nms(&boxes, 0.45f);
+  EXPECT_EQ(0u, boxes.Size());
+}
+
+TEST(Inferencer, DetectionPostprocMatrixNms) {
+  DetectionBoxes boxes;
+  boxes.Add(0.1f, 0.1f, 0.5f, 0.5f, 0.9f, 0);
+  boxes.Add(0.1f, 0.1f, 0.5f, 0.4f, 0.8f, 0);  // IoU 0.75 with the first box
+  boxes.Add(0.6f, 0.6f, 0.9f, 0.9f, 0.7f, 0);  // apart from others
+  boxes.Add(0.1f, 0.1f, 0.5f, 0.5f, 0.6f, 1);  // another label
+  DetectionBoxes linear = boxes;
+  MatrixNms(&boxes, 2.f, 0.f);
+  ASSERT_EQ(4u, boxes.Size());
+  EXPECT_EQ(boxes.label, std::vector<int>({0, 0, 1, 0}));
+  EXPECT_NEAR(0.9f, boxes.score[0], 1e-6f);
+  EXPECT_NEAR(0.7f, boxes.score[1], 1e-6f);
+  EXPECT_NEAR(0.6f, boxes.score[2], 1e-6f);
+  EXPECT_NEAR(0.8f * std::exp(-2.f * 0.75f * 0.75f), boxes.score[3], 1e-5f);
+
+  MatrixNms(&linear, 0.f, 0.3f);
+  ASSERT_EQ(3u, linear.Size());
+  EXPECT_NEAR(0.9f, linear.score[0], 1e-6f);
+  EXPECT_NEAR(0.7f, linear.score[1], 1e-6f);
+  EXPECT_NEAR(0.6f, linear.score[2], 1e-6f);
+}
+
+TEST(Inferencer, DetectionPostprocYolo) {
+  YoloLayerParams layer;
+  layer.grid_w = 13;
+  layer.grid_h = 7;
+  layer.class_num = 4;
+  layer.input_w = 416;
+  layer.input_h = 224;
+  layer.anchors = {32, 64, 100, 50};
+  const int plane = layer.grid_w * layer.grid_h;
+  std::vector<float> data(2 * (5 + layer.class_num) * plane, -10.f);
+  // one box in anchor 1, cell (x 3, y 5)
+  const int cell = 5 * layer.grid_w + 3;
+  float* anchor = data.data() + (5 + layer.class_num) * plane;
+  anchor[cell] = 0.f;
+  anchor[plane + cell] = 0.f;
+  anchor[2 * plane + cell] = std::log(2.f);
+  anchor[3 * plane + cell] = 0.f;
+  anchor[4 * plane + cell] = 3.f;
+  anchor[(5 + 2) * plane + cell] = 2.f;
+  DetectionBoxes boxes;
+  ASSERT_TRUE(DecodeYoloLayer(data.data(), layer, 0.5f, &boxes));
+  ASSERT_EQ(1u, boxes.Size());
+  const float score = 1.f / (1.f + std::exp(-3.f)) / (1.f + std::exp(-2.f));
+  const float cx = 3.5f / 13, cy = 5.5f / 7, w = 200.f / 416, h = 50.f / 224;
+  EXPECT_EQ(2, boxes.label[0]);
+  EXPECT_NEAR(score, boxes.score[0], 1e-5f);
+  EXPECT_NEAR(cx - w / 2, boxes.x1[0], 1e-5f);
+  EXPECT_NEAR(cy - h / 2, boxes.y1[0], 1e-5f);
+  EXPECT_NEAR(cx + w / 2, boxes.x2[0], 1e-5f);
+  EXPECT_NEAR(cy + h / 2, boxes.y2[0], 1e-5f);
+
+  boxes.Clear();
+  ASSERT_TRUE(DecodeYoloLayer(data.data(), layer, 0.9f, &boxes));
+  EXPECT_EQ(0u, boxes.Size());
+  layer.anchors.pop_back();
+  EXPECT_FALSE(DecodeYoloLayer(data.data(), layer, 0.5f, &boxes));
+}
+
+TEST(Inferencer, DetectionPostprocBoxList) {
+  std::vector<float> data(64 + 3 * 7, 0.f);
+  data[0] = 3;
+  const float list[3][7] = {{0, 0, 0.9f, 0.1f, 0.1f, 0.2f, 0.2f},
+                            {0, 3, 0.8f, 0.3f, 0.3f, 0.6f, 0.5f},
+                            {0, 2, 0.2f, 0.1f, 0.1f, 0.2f, 0.2f}};
+  for (int i = 0; i < 3; ++i) std::copy(list[i], list[i] + 7, data.begin() + 64 + 7 * i);
+  DetectionBoxes boxes;
+  DecodeBoxList(data.data(), 0.5f, -1, &boxes);
+  ASSERT_EQ(1u, boxes.Size());
+  EXPECT_EQ(2, boxes.label[0]);
+  EXPECT_EQ(0.8f, boxes.score[0]);
+  EXPECT_EQ(0.6f, boxes.x2[0]);
+
+  boxes.Add(-0.1f, 0.5f, 0.3f, 1.2f, 0.7f, 5);
+  boxes.Add(0.4f, 0.5f, 0.4f, 0.6f, 0.7f, 5);  // empty
+  CNInferObjs objs;
+  AppendObjects(boxes, &objs);
+  ASSERT_EQ(2u, objs.objs_.size());
+  EXPECT_EQ("2", objs.objs_[0]->id);
+  EXPECT_EQ("5", objs.objs_[1]->id);
+  EXPECT_FLOAT_EQ(0.f, objs.objs_[1]->bbox.x);
+  EXPECT_FLOAT_EQ(0.3f, objs.objs_[1]->bbox.w);
+  EXPECT_FLOAT_EQ(0.5f, objs.objs_[1]->bbox.h);
+  EXPECT_FLOAT_EQ(0.7f, objs.objs_[1]->score);
+
+  CNObjectTable table;
+  AppendObjects(boxes, &table);
+  ASSERT_EQ(2u, table.Size());
+  EXPECT_EQ(5, table.Label(1));
+  EXPECT_FLOAT_EQ(0.3f, table.BBox(1).w);
+  EXPECT_EQ(CNObjectTable::kNoTrackId, table.TrackId(1));
+}
+
+TEST(Inferencer, DetectionPostprocPerf) {
+  // YOLOv3 at 416x416 with 80 classes, largest layer
+  YoloLayerParams layer;
+  layer.grid_w = layer.grid_h = 52;
+  layer.class_num = 80;
+  layer.input_w = layer.input_h = 416;
+  layer.anchors = {10, 13, 16, 30, 33, 23};
+  std::mt19937 gen(3);
+  std::normal_distribution<float> logit(-6.f, 2.f);
+  std::vector<float> data(3 * (5 + layer.class_num) * layer.grid_w * layer.grid_h);
+  for (auto& value : data) value = logit(gen);
+  DetectionBoxes boxes;
+  const int loop = 50;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < loop; ++i) {
+    boxes.Clear();
+    ASSERT_TRUE(DecodeYoloLayer(data.data(), layer, 0.05f, &boxes));
+    Nms(&boxes, 0.45f);
+  }
+  std::chrono::duration<double, std::milli> cost = std::chrono::steady_clock::now() - start;
+  std::cout << "decode and nms of a 52x52 yolo layer: " << cost.count() / loop << "ms, " << boxes.Size() << " boxes"
+            << std::endl;
+
+  DetectionBoxes many = RandomBoxes(2000, 4, 5);
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < loop; ++i) {
+    boxes = many;
+    Nms(&boxes, 0.45f);
+  }
+  cost = std::chrono::steady_clock::now() - start;
+  std::cout << "nms of 2000 boxes: " << cost.count() / loop << "ms, " << boxes.Size() << " kept" << std::endl;
+}
+
+}  // namespace cnstream
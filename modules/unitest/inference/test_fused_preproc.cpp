@@ -0,0 +1,319 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include "fused_preproc.hpp"
+
+namespace cnstream {
+
+// A smooth random NV12/NV21 image, with a stride larger than its width.
+static cv::Mat MakeYuvImage(int width, int height, int stride) {
+  cv::Mat yuv(height * 3 / 2, stride, CV_8UC1);
+  cv::randu(yuv, cv::Scalar::all(0), cv::Scalar::all(255));
+  cv::GaussianBlur(yuv, yuv, cv::Size(9, 9), 0);
+  return yuv;
+}
+
+static PreprocImage YuvImageOf(const cv::Mat& yuv, int width, int height, CNDataFormat fmt) {
+  PreprocImage image;
+  image.fmt = fmt;
+  image.width = width;
+  image.height = height;
+  image.planes[0] = yuv.data;
+  image.planes[1] = yuv.data + height * yuv.step;
+  image.strides[0] = image.strides[1] = static_cast<int>(yuv.step);
+  return image;
+}
+
+static double MaxDiff(const cv::Mat& a, const cv::Mat& b) {
+  return cv::norm(a.reshape(1, 1), b.reshape(1, 1), cv::NORM_INF);
+}
+
+TEST(Inferencer, FusedPreprocYuv) {
+  const int width = 1920, height = 1080, stride = 2048;
+  cv::Mat yuv = MakeYuvImage(width, height, stride);
+  for (auto fmt : {CN_PIXEL_FORMAT_YUV420_NV12, CN_PIXEL_FORMAT_YUV420_NV21}) {
+    cv::Mat bgr;
+    cv::cvtColor(yuv.colRange(0, width), bgr,
+                 fmt == CN_PIXEL_FORMAT_YUV420_NV12 ? cv::COLOR_YUV2BGR_NV12 : cv::COLOR_YUV2BGR_NV21);
+    for (auto roi : {cv::Rect(0, 0, width, height), cv::Rect(101, 51, 333, 211), cv::Rect(7, 9, 50, 40)}) {
+      FusedPreprocParams params;
+      params.dst_w = 300;
+      params.dst_h = 200;
+      cv::Mat expected, dst(params.dst_h, params.dst_w, CV_32FC3);
+      cv::resize(bgr(roi), expected, dst.size());
+      expected.convertTo(expected, CV_32F);
+      PreprocRoi proi;
+      proi.x = roi.x;
+      proi.y = roi.y;
+      proi.w = roi.width;
+      proi.h = roi.height;
+      ASSERT_TRUE(FusedPreprocess(YuvImageOf(yuv, width, height, fmt), proi, params, dst.ptr<float>()));
+      EXPECT_LE(MaxDiff(dst, expected), 1.0) << roi;
+    }
+  }
+}
+
+TEST(Inferencer, FusedPreprocBgr) {
+  cv::Mat image(480, 640, CV_8UC3);
+  cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(255));
+  PreprocImage src;
+  src.fmt = CN_PIXEL_FORMAT_BGR24;
+  src.width = image.cols;
+  src.height = image.rows;
+  src.planes[0] = image.data;
+  src.strides[0] = static_cast<int>(image.step);
+  PreprocRoi roi;
+  roi.w = image.cols;
+  roi.h = image.rows;
+  FusedPreprocParams params;
+  params.dst_w = 224;
+  params.dst_h = 224;
+  params.dst_rgb = true;
+  cv::Mat expected, dst(224, 224, CV_32FC3);
+  cv::resize(image, expected, dst.size());
+  cv::cvtColor(expected, expected, cv::COLOR_BGR2RGB);
+  expected.convertTo(expected, CV_32F);
+  ASSERT_TRUE(FusedPreprocess(src, roi, params, dst.ptr<float>()));
+  EXPECT_LE(MaxDiff(dst, expected), 1.0);
+
+  // out of image
+  roi.x = 1;
+  EXPECT_FALSE(FusedPreprocess(src, roi, params, dst.ptr<float>()));
+  roi.x = 0;
+  src.fmt = CN_PIXEL_FORMAT_ARGB32;
+  EXPECT_FALSE(FusedPreprocess(src, roi, params, dst.ptr<float>()));
+}
+
+TEST(Inferencer, FusedPreprocLetterboxNchw) {
+  const int width = 640, height = 360;
+  cv::Mat yuv = MakeYuvImage(width, height, width);
+  PreprocImage src = YuvImageOf(yuv, width, height, CN_PIXEL_FORMAT_YUV420_NV12);
+  PreprocRoi roi;
+  roi.w = width;
+  roi.h = height;
+  FusedPreprocParams nhwc;
+  nhwc.dst_w = 320;
+  nhwc.dst_h = 180;
+  std::vector<float> content(320 * 180 * 3);
+  ASSERT_TRUE(FusedPreprocess(src, roi, nhwc, content.data()));
+
+  FusedPreprocParams params;
+  params.dst_w = 320;
+  params.dst_h = 320;
+  params.dst_c = 4;
+  params.dst_nchw = true;
+  params.keep_aspect_ratio = true;
+  params.pad_value = 128;
+  const float mean[3] = {1, 2, 3}, std[3] = {2, 4, 8};
+  for (int k = 0; k < 3; ++k) {
+    params.mean[k] = mean[k];
+    params.std[k] = std[k];
+  }
+  std::vector<float> dst(320 * 320 * 4);
+  ASSERT_TRUE(FusedPreprocess(src, roi, params, dst.data()));
+  const int plane = 320 * 320, offset_y = (320 - 180) / 2;
+  for (int y = 0; y < 320; ++y) {
+    for (int x = 0; x < 320; ++x) {
+      for (int k = 0; k < 3; ++k) {
+        float value = (y < offset_y || y >= offset_y + 180) ? 128.f : content[((y - offset_y) * 320 + x) * 3 + k];
+        ASSERT_NEAR(dst[k * plane + y * 320 + x], (value - mean[k]) / std[k], 1e-4) << x << ", " << y;
+      }
+      ASSERT_EQ(dst[3 * plane + y * 320 + x], 0.f);
+    }
+  }
+}
+
+TEST(Inferencer, FusedPreprocParams) {
+  FusedPreprocParams params;
+  EXPECT_TRUE(ParseFusedPreprocParams({{"mean", "[0.5,0.5,0.5]"}, {"std", "255"}, {"color_order", "RGB"},
+                                       {"data_order", "NCHW"}, {"keep_aspect_ratio", "true"}, {"pad_value", "114"}},
+                                      &params));
+  EXPECT_FLOAT_EQ(params.mean[2], 0.5f);
+  EXPECT_FLOAT_EQ(params.std[1], 255.f);
+  EXPECT_TRUE(params.dst_rgb);
+  EXPECT_TRUE(params.dst_nchw);
+  EXPECT_TRUE(params.keep_aspect_ratio);
+  EXPECT_FLOAT_EQ(params.pad_value, 114.f);
+
+  EXPECT_FALSE(ParseFusedPreprocParams({{"mean", "1,2"}}, &params));
+  EXPECT_FALSE(ParseFusedPreprocParams({{"std", "[1, 0, 1]"}}, &params));
+  EXPECT_FALSE(ParseFusedPreprocParams({{"data_order", "CHWN"}}, &params));
+  EXPECT_FALSE(ParseFusedPreprocParams({{"fake_key", "1"}}, &params));
+
+  std::shared_ptr<Preproc> preproc(Preproc::Create("FusedPreprocCpu"));
+  ASSERT_TRUE(preproc != nullptr);
+  EXPECT_EQ(preproc->Init({{"color_order", "RGB"}}), 0);
+  EXPECT_NE(preproc->Init({{"color_order", "YUV"}}), 0);
+}
+
+static std::vector<PreprocRoi> RandomRois(int num, int width, int height) {
+  cv::RNG rng(0);
+  std::vector<PreprocRoi> rois(num);
+  for (auto& roi : rois) {
+    roi.w = rng.uniform(16, width / 4);
+    roi.h = rng.uniform(16, height / 4);
+    roi.x = rng.uniform(0, width - roi.w);
+    roi.y = rng.uniform(0, height - roi.h);
+  }
+  return rois;
+}
+
+TEST(Inferencer, FusedPreprocBatch) {
+  const int width = 1280, height = 720;
+  cv::Mat yuv = MakeYuvImage(width, height, width);
+  PreprocImage src = YuvImageOf(yuv, width, height, CN_PIXEL_FORMAT_YUV420_NV21);
+  FusedPreprocParams params;
+  params.dst_w = 64;
+  params.dst_h = 128;
+  params.dst_c = 4;
+  std::vector<PreprocRoi> rois = RandomRois(37, width, height);
+  const size_t size = 64 * 128 * 4;
+  std::vector<float> expected(rois.size() * size), output(rois.size() * size);
+  std::vector<float*> dsts;
+  for (size_t i = 0; i < rois.size(); ++i) {
+    ASSERT_TRUE(FusedPreprocess(src, rois[i], params, expected.data() + i * size));
+    dsts.push_back(output.data() + i * size);
+  }
+  PreprocWorkers workers(3);
+  for (PreprocWorkers* pworkers : {static_cast<PreprocWorkers*>(nullptr), &workers}) {
+    std::fill(output.begin(), output.end(), -1.f);
+    ASSERT_TRUE(FusedPreprocessBatch(src, rois, params, dsts, pworkers));
+    EXPECT_TRUE(expected == output);
+  }
+  // batches of several callers share the workers
+  std::vector<float> output2(output.size(), -1.f);
+  std::vector<float*> dsts2;
+  for (size_t i = 0; i < rois.size(); ++i) dsts2.push_back(output2.data() + i * size);
+  std::fill(output.begin(), output.end(), -1.f);
+  for (int n = 0; n < 10; ++n) {
+    std::thread caller([&]() { EXPECT_TRUE(FusedPreprocessBatch(src, rois, params, dsts2, &workers)); });
+    EXPECT_TRUE(FusedPreprocessBatch(src, rois, params, dsts, &workers));
+    caller.join();
+  }
+  EXPECT_TRUE(expected == output);
+  EXPECT_TRUE(expected == output2);
+  rois.back().x = width;
+  EXPECT_FALSE(FusedPreprocessBatch(src, rois, params, dsts, &workers));
+  dsts.pop_back();
+  EXPECT_FALSE(FusedPreprocessBatch(src, rois, params, dsts, &workers));
+
+  CNInferBoundingBox bbox = {-0.1f, 0.5f, 0.5f, 0.7f};
+  PreprocRoi roi = ObjectRoi(bbox, width, height);
+  EXPECT_EQ(roi.x, 0);
+  EXPECT_EQ(roi.y, 360);
+  EXPECT_EQ(roi.w, 640);
+  EXPECT_EQ(roi.h, 360);
+
+  std::shared_ptr<ObjPreproc> obj_preproc(ObjPreproc::Create("FusedObjPreprocCpu"));
+  ASSERT_TRUE(obj_preproc != nullptr);
+  EXPECT_EQ(obj_preproc->Init({{"thread_num", "2"}, {"data_order", "NCHW"}}), 0);
+  EXPECT_NE(obj_preproc->Init({{"thread_num", "0"}}), 0);
+}
+
+TEST(Inferencer, FusedPreprocBatchPerf) {
+  const int width = 1920, height = 1080, obj_num = 64;
+  cv::Mat yuv = MakeYuvImage(width, height, width);
+  PreprocImage src = YuvImageOf(yuv, width, height, CN_PIXEL_FORMAT_YUV420_NV12);
+  std::vector<PreprocRoi> rois = RandomRois(obj_num, width, height);
+  FusedPreprocParams params;
+  params.dst_w = 128;
+  params.dst_h = 256;
+  params.dst_c = 4;
+  std::vector<float> output(static_cast<size_t>(obj_num) * 128 * 256 * 4);
+  std::vector<float*> dsts;
+  for (int i = 0; i < obj_num; ++i) dsts.push_back(output.data() + static_cast<size_t>(i) * 128 * 256 * 4);
+  const int loop = 20;
+
+  // what ObjPreprocCpu of the samples does for each object, with the frame converted to BGR once
+  auto start = std::chrono::steady_clock::now();
+  for (int n = 0; n < loop; ++n) {
+    cv::Mat bgr;
+    cv::cvtColor(yuv, bgr, cv::COLOR_YUV2BGR_NV12);
+    for (int i = 0; i < obj_num; ++i) {
+      cv::Mat resized, bgra;
+      cv::resize(bgr(cv::Rect(rois[i].x, rois[i].y, rois[i].w, rois[i].h)), resized, cv::Size(128, 256));
+      cv::Mat alpha(256, 128, CV_8UC1, cv::Scalar(0));
+      std::vector<cv::Mat> channels = {resized, alpha};
+      cv::merge(channels, bgra);
+      cv::Mat dst(256, 128, CV_32FC4, dsts[i]);
+      bgra.convertTo(dst, CV_32FC4);
+    }
+  }
+  std::chrono::duration<double, std::milli> opencv_time = std::chrono::steady_clock::now() - start;
+  std::cout << "[FusedPreproc] " << obj_num << " objects to 128x256 float, opencv per object: "
+            << opencv_time.count() / loop << " ms";
+  PreprocWorkers workers(3);
+  for (int thread_num : {1, 4}) {
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < loop; ++n) {
+      ASSERT_TRUE(FusedPreprocessBatch(src, rois, params, dsts, thread_num > 1 ? &workers : nullptr));
+    }
+    std::chrono::duration<double, std::milli> fused_time = std::chrono::steady_clock::now() - start;
+    std::cout << ", batched with " << thread_num << " threads: " << fused_time.count() / loop << " ms";
+  }
+  std::cout << std::endl;
+}
+
+TEST(Inferencer, FusedPreprocPerf) {
+  const int width = 1920, height = 1080;
+  cv::Mat yuv = MakeYuvImage(width, height, width);
+  PreprocImage src = YuvImageOf(yuv, width, height, CN_PIXEL_FORMAT_YUV420_NV12);
+  PreprocRoi roi;
+  roi.w = width;
+  roi.h = height;
+  FusedPreprocParams params;
+  params.dst_w = 416;
+  params.dst_h = 416;
+  cv::Mat dst(416, 416, CV_32FC3);
+  const int loop = 50;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < loop; ++i) {
+    cv::Mat bgr, resized;
+    cv::cvtColor(yuv, bgr, cv::COLOR_YUV2BGR_NV12);
+    cv::resize(bgr, resized, dst.size());
+    resized.convertTo(dst, CV_32F);
+  }
+  std::chrono::duration<double, std::milli> opencv_time = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < loop; ++i) {
+    ASSERT_TRUE(FusedPreprocess(src, roi, params, dst.ptr<float>()));
+  }
+  std::chrono::duration<double, std::milli> fused_time = std::chrono::steady_clock::now() - start;
+  std::cout << "[FusedPreproc] 1080p NV12 to 416x416 float, opencv: " << opencv_time.count() / loop
+            << " ms, fused: " << fused_time.count() / loop << " ms" << std::endl;
+}
+
+}  // namespace cnstream
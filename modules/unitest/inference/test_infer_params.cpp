@@ -63,17 +63,23 @@ bool InferParamsEQ(const InferParams &p1, const InferParams &p2) {
          p1.use_scaler == p2.use_scaler &&
          p1.show_stats == p2.show_stats &&
          p1.infer_interval == p2.infer_interval &&
+         p1.propagate_objects == p2.propagate_objects &&
+         p1.motion_threshold == p2.motion_threshold &&
+         p1.motion_max_skip == p2.motion_max_skip &&
+         p1.roi == p2.roi &&
          p1.batching_timeout == p2.batching_timeout &&
          p1.keep_aspect_ratio == p2.keep_aspect_ratio &&
          p1.data_order == p2.data_order &&
          p1.func_name == p2.func_name &&
          p1.model_path == p2.model_path &&
          p1.preproc_name == p2.preproc_name &&
+         p1.custom_preproc_params == p2.custom_preproc_params &&
          p1.postproc_name == p2.postproc_name &&
          p1.stats_db_name == p2.stats_db_name &&
          p1.obj_filter_name == p2.obj_filter_name &&
          p1.dump_resized_image_dir == p2.dump_resized_image_dir &&
-         p1.model_input_pixel_format == p2.model_input_pixel_format;
+         p1.model_input_pixel_format == p2.model_input_pixel_format &&
+         p1.io_depth == p2.io_depth;
 }
 
 TEST(Inferencer, infer_param_manager) {
@@ -88,17 +94,23 @@ TEST(Inferencer, infer_param_manager) {
     "use_scaler",
     "show_stats",
     "infer_interval",
+    "propagate_objects",
+    "motion_threshold",
+    "motion_max_skip",
+    "roi",
     "batching_timeout",
     "keep_aspect_ratio",
     "data_order",
     "func_name",
     "model_path",
     "preproc_name",
+    "custom_preproc_params",
     "postproc_name",
     "stats_db_name",
     "obj_filter_name",
     "dump_resized_image_dir",
-    "model_input_pixel_format"
+    "model_input_pixel_format",
+    "io_depth"
   };
 
   for (const auto &it : infer_param_list)
@@ -112,17 +124,23 @@ TEST(Inferencer, infer_param_manager) {
   expect_ret.use_scaler = true;
   expect_ret.show_stats = false;
   expect_ret.infer_interval = 1;
+  expect_ret.propagate_objects = true;
+  expect_ret.motion_threshold = 0.25;
+  expect_ret.motion_max_skip = 10;
+  expect_ret.roi = {{"*", {{{0, 0.5f}, {1, 0.5f}, {1, 1}}}}, {"1", {{{0, 0}, {0.5f, 0}, {0.5f, 1}, {0, 1}}}}};
   expect_ret.batching_timeout = 3;
   expect_ret.keep_aspect_ratio = false;
   expect_ret.data_order = edk::DimOrder::NCHW;
   expect_ret.func_name = "fake_name";
   expect_ret.model_path = "fake_path";
   expect_ret.preproc_name = "fake_name";
+  expect_ret.custom_preproc_params = {{"mean", "[0.5,0.5,0.5]"}, {"data_order", "NCHW"}};
   expect_ret.postproc_name = "fake_name";
   expect_ret.stats_db_name = "db_name";
   expect_ret.obj_filter_name = "filter_name";
   expect_ret.dump_resized_image_dir = "dir";
   expect_ret.model_input_pixel_format = CNDataFormat::CN_PIXEL_FORMAT_BGRA32;
+  expect_ret.io_depth = 3;
 
   ModuleParamSet raw_params;
   raw_params["device_id"] = std::to_string(expect_ret.device_id);
@@ -131,17 +149,23 @@ TEST(Inferencer, infer_param_manager) {
   raw_params["use_scaler"] = std::to_string(expect_ret.use_scaler);
   raw_params["show_stats"] = std::to_string(expect_ret.show_stats);
   raw_params["infer_interval"] = std::to_string(expect_ret.infer_interval);
+  raw_params["propagate_objects"] = std::to_string(expect_ret.propagate_objects);
+  raw_params["motion_threshold"] = "0.25";
+  raw_params["motion_max_skip"] = std::to_string(expect_ret.motion_max_skip);
+  raw_params["roi"] = "{\"*\": [[[0, 0.5], [1, 0.5], [1, 1]]], \"1\": [[[0, 0], [0.5, 0], [0.5, 1], [0, 1]]]}";
   raw_params["batching_timeout"] = std::to_string(expect_ret.batching_timeout);
   raw_params["keep_aspect_ratio"] = std::to_string(expect_ret.keep_aspect_ratio);
   raw_params["data_order"] = "NCHW";
   raw_params["func_name"] = expect_ret.func_name;
   raw_params["model_path"] = expect_ret.model_path;
   raw_params["preproc_name"] = expect_ret.preproc_name;
+  raw_params["custom_preproc_params"] = "{\"mean\": [0.5, 0.5, 0.5], \"data_order\": \"NCHW\"}";
   raw_params["postproc_name"] = expect_ret.postproc_name;
   raw_params["stats_db_name"] = expect_ret.stats_db_name;
   raw_params["obj_filter_name"] = expect_ret.obj_filter_name;
   raw_params["dump_resized_image_dir"] = expect_ret.dump_resized_image_dir;
   raw_params["model_input_pixel_format"] = "BGRA32";
+  raw_params["io_depth"] = std::to_string(expect_ret.io_depth);
 
   {
     InferParams ret;
@@ -159,6 +183,10 @@ TEST(Inferencer, infer_param_manager) {
     default_value.use_scaler = false;
     default_value.show_stats = false;
     default_value.infer_interval = 1;
+    default_value.propagate_objects = false;
+    default_value.motion_threshold = 0;
+    default_value.motion_max_skip = 25;
+    default_value.roi.clear();
     default_value.batching_timeout = 3000;
     default_value.keep_aspect_ratio = false;
     default_value.data_order = edk::DimOrder::NHWC;
@@ -170,6 +198,7 @@ TEST(Inferencer, infer_param_manager) {
     default_value.obj_filter_name = "";
     default_value.dump_resized_image_dir = "";
     default_value.model_input_pixel_format = CNDataFormat::CN_PIXEL_FORMAT_RGBA32;
+    default_value.io_depth = 1;
 
     InferParams ret;
     EXPECT_TRUE(manager.ParseBy(raw_params, &ret));
@@ -219,6 +248,13 @@ TEST(Inferencer, infer_param_manager) {
     EXPECT_FALSE(manager.ParseBy(raw_params, &ret));
   }
 
+  raw_params.clear();
+  {
+    InferParams ret;
+    raw_params["propagate_objects"] = "wrong";
+    EXPECT_FALSE(manager.ParseBy(raw_params, &ret));
+  }
+
   raw_params.clear();
   {
     InferParams ret;
@@ -246,6 +282,35 @@ TEST(Inferencer, infer_param_manager) {
     raw_params["device_id"] = std::to_string(1ULL << 33);
     EXPECT_FALSE(manager.ParseBy(raw_params, &ret));
   }
+
+  raw_params.clear();
+  {
+    InferParams ret;
+    raw_params["custom_preproc_params"] = "[0.5, 0.5, 0.5]";
+    EXPECT_FALSE(manager.ParseBy(raw_params, &ret));
+  }
+
+  raw_params.clear();
+  {
+    InferParams ret;
+    raw_params["io_depth"] = "0";
+    EXPECT_FALSE(manager.ParseBy(raw_params, &ret));
+  }
+
+  raw_params.clear();
+  {
+    InferParams ret;
+    raw_params["motion_threshold"] = "1.5";
+    EXPECT_FALSE(manager.ParseBy(raw_params, &ret));
+  }
+
+  raw_params.clear();
+  {
+    InferParams ret;
+    // a polygon of two points
+    raw_params["roi"] = "{\"*\": [[[0, 0], [1, 1]]]}";
+    EXPECT_FALSE(manager.ParseBy(raw_params, &ret));
+  }
 }
 
 }  // namespace cnstream
@@ -0,0 +1,158 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "infer_resource.hpp"
+#include "stage_occupancy.hpp"
+
+namespace cnstream {
+
+class FakeIOResource : public IOResource {
+ public:
+  FakeIOResource(uint32_t batchsize, uint32_t depth) : IOResource(nullptr, batchsize, depth) {}
+  int allocated = 0;
+  int deallocated = 0;
+
+ protected:
+  IOResValue Allocate(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize) override {
+    IOResValue value;
+    value.datas.resize(1);
+    value.datas[0].ptr = reinterpret_cast<void*>(static_cast<intptr_t>(++allocated));
+    value.datas[0].batchsize = batchsize;
+    return value;
+  }
+  void Deallocate(std::shared_ptr<edk::ModelLoader> model, uint32_t batchsize, const IOResValue& value) override {
+    ++deallocated;
+  }
+};  // class FakeIOResource
+
+static bool Called(const IOResTicket& ticket) {
+  return ticket.ticket.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready;
+}
+
+TEST(Inferencer, IOResource_DepthOne) {
+  FakeIOResource res(4, 1);
+  res.Init();
+  EXPECT_EQ(1u, res.Depth());
+  IOResTicket t1 = res.PickUpNewTicket();
+  res.NextSlot();
+  IOResTicket t2 = res.PickUpNewTicket();
+  EXPECT_EQ(0u, t1.slot);
+  EXPECT_EQ(0u, t2.slot);
+  EXPECT_TRUE(Called(t1));
+  // one buffer, the second batch waits for the first one
+  EXPECT_FALSE(Called(t2));
+  res.DeallingDone(t1);
+  EXPECT_TRUE(Called(t2));
+  res.DeallingDone(t2);
+  res.Destroy();
+  EXPECT_EQ(1, res.allocated);
+  EXPECT_EQ(1, res.deallocated);
+}
+
+TEST(Inferencer, IOResource_Ring) {
+  FakeIOResource res(4, 2);
+  res.Init();
+  EXPECT_EQ(2u, res.Depth());
+  // batch 0: preprocessing ticket reserved for all frames, then the copy
+  IOResTicket pre0 = res.PickUpTicket(true);
+  IOResTicket pre0_last = res.PickUpTicket(false);
+  IOResTicket copy0 = res.PickUpNewTicket();
+  res.NextSlot();
+  // batch 1 goes to the other buffer
+  IOResTicket pre1 = res.PickUpTicket(false);
+  IOResTicket copy1 = res.PickUpNewTicket();
+  res.NextSlot();
+  // batch 2 reuses the buffer of batch 0
+  IOResTicket pre2 = res.PickUpTicket(false);
+
+  EXPECT_EQ(0u, pre0.slot);
+  EXPECT_EQ(0u, copy0.slot);
+  EXPECT_EQ(1u, pre1.slot);
+  EXPECT_EQ(1u, copy1.slot);
+  EXPECT_EQ(0u, pre2.slot);
+
+  IOResValue v0 = res.WaitResourceByTicket(&pre0);
+  // batch 1 is preprocessed while batch 0 is
+  ASSERT_TRUE(Called(pre1));
+  IOResValue v1 = res.WaitResourceByTicket(&pre1);
+  EXPECT_NE(v0.datas[0].ptr, v1.datas[0].ptr);
+  EXPECT_TRUE(Called(pre0_last));
+  EXPECT_FALSE(Called(copy0));
+  EXPECT_FALSE(Called(pre2));
+
+  res.DeallingDone(pre0);
+  res.DeallingDone(pre0_last);
+  EXPECT_TRUE(Called(copy0));
+  EXPECT_FALSE(Called(copy1));
+  res.DeallingDone(pre1);
+  EXPECT_TRUE(Called(copy1));
+  // batch 2 waits until batch 0 releases the buffer
+  EXPECT_FALSE(Called(pre2));
+  res.DeallingDone(copy0);
+  ASSERT_TRUE(Called(pre2));
+  EXPECT_EQ(v0.datas[0].ptr, res.WaitResourceByTicket(&pre2).datas[0].ptr);
+  res.DeallingDone(copy1);
+  res.DeallingDone(pre2);
+
+  res.Destroy();
+  EXPECT_EQ(2, res.allocated);
+  EXPECT_EQ(2, res.deallocated);
+}
+
+TEST(Inferencer, IOResource_ZeroDepth) {
+  EXPECT_THROW(FakeIOResource(4, 0), IOResourceError);
+}
+
+TEST(Inferencer, StageOccupancy) {
+  StageOccupancy occupancy;
+  occupancy.Submit(3);
+  InferStageOccupancy ret = occupancy.Get("infer");
+  EXPECT_EQ("infer", ret.stage);
+  EXPECT_EQ(3u, ret.pending);
+  EXPECT_EQ(0u, ret.running);
+  {
+    StageOccupancy::Running r1(&occupancy);
+    {
+      StageOccupancy::Running r2(&occupancy);
+      ret = occupancy.Get("infer");
+      EXPECT_EQ(1u, ret.pending);
+      EXPECT_EQ(2u, ret.running);
+    }
+    ret = occupancy.Get("infer");
+    EXPECT_EQ(1u, ret.running);
+    EXPECT_EQ(1u, ret.finished);
+  }
+  ret = occupancy.Get("infer");
+  EXPECT_EQ(1u, ret.pending);
+  EXPECT_EQ(0u, ret.running);
+  EXPECT_EQ(2u, ret.max_running);
+  EXPECT_EQ(2u, ret.finished);
+  // no occupancy set to the stage
+  StageOccupancy::Running none(nullptr);
+}
+
+}  // namespace cnstream
@@ -0,0 +1,125 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+#include "motion_gate.hpp"
+
+namespace cnstream {
+
+static constexpr int kWidth = 320;
+static constexpr int kHeight = 180;
+
+// A gray NV12 frame, the pixels of [x0, x1) x [y0, y1) are white.
+static std::shared_ptr<CNFrameInfo> MakeFrame(const std::string& stream_id, std::vector<uint8_t>* buffer,
+                                              int x0 = 0, int y0 = 0, int x1 = 0, int y1 = 0) {
+  buffer->assign(kWidth * kHeight * 3 / 2, 128);
+  for (int y = y0; y < y1; ++y) {
+    for (int x = x0; x < x1; ++x) (*buffer)[y * kWidth + x] = 255;
+  }
+  auto finfo = CNFrameInfo::Create(stream_id);
+  auto frame = std::make_shared<CNDataFrame>();
+  frame->fmt = CN_PIXEL_FORMAT_YUV420_NV12;
+  frame->width = kWidth;
+  frame->height = kHeight;
+  frame->stride[0] = frame->stride[1] = kWidth;
+  frame->data[0].reset(new CNSyncedMemory(kWidth * kHeight));
+  frame->data[0]->SetCpuData(buffer->data());
+  finfo->datas[CNDataFramePtrKey] = frame;
+  return finfo;
+}
+
+TEST(Inferencer, MotionGate_Skip) {
+  MotionGate gate(0.01f, 2);
+  std::vector<uint8_t> buffer;
+  // the first frame is always inferred
+  EXPECT_FALSE(gate.Skip(MakeFrame("0", &buffer)));
+  EXPECT_TRUE(gate.Skip(MakeFrame("0", &buffer)));
+  EXPECT_TRUE(gate.Skip(MakeFrame("0", &buffer)));
+  // at most max_skip frames in a row
+  EXPECT_FALSE(gate.Skip(MakeFrame("0", &buffer)));
+  EXPECT_TRUE(gate.Skip(MakeFrame("0", &buffer)));
+  // a quarter of the frame changes
+  EXPECT_FALSE(gate.Skip(MakeFrame("0", &buffer, 0, 0, kWidth / 2, kHeight / 2)));
+  EXPECT_TRUE(gate.Skip(MakeFrame("0", &buffer, 0, 0, kWidth / 2, kHeight / 2)));
+  // streams are gated separately
+  EXPECT_FALSE(gate.Skip(MakeFrame("1", &buffer)));
+  // the reference is dropped on eos
+  gate.Eos("0");
+  EXPECT_FALSE(gate.Skip(MakeFrame("0", &buffer)));
+
+  MotionGate never_skip(0, 2);
+  EXPECT_FALSE(never_skip.Skip(MakeFrame("0", &buffer)));
+  EXPECT_FALSE(never_skip.Skip(MakeFrame("0", &buffer)));
+}
+
+TEST(Inferencer, MotionGate_MluFrame) {
+  MotionGate gate(0.01f, 2);
+  std::vector<uint8_t> buffer;
+  EXPECT_FALSE(gate.Skip(MakeFrame("0", &buffer)));
+  EXPECT_TRUE(gate.Skip(MakeFrame("0", &buffer)));
+  // the frame is not copied from the MLU to be gated
+  auto finfo = MakeFrame("0", &buffer);
+  auto frame = GetCNDataFramePtr(finfo);
+  frame->data[0]->SetMluData(buffer.data());
+  EXPECT_FALSE(gate.Skip(finfo));
+  EXPECT_EQ(CNSyncedMemory::HEAD_AT_MLU, frame->data[0]->GetHead());
+}
+
+TEST(Inferencer, MotionGate_Roi) {
+  // the right half of stream 0, the bottom half of the others
+  RoiPolygons roi = {{"0", {{{0.5f, 0}, {1, 0}, {1, 1}, {0.5f, 1}}}}, {"*", {{{0, 0.5f}, {1, 0.5f}, {1, 1}, {0, 1}}}}};
+  MotionGate gate(0.01f, 100, roi);
+  std::vector<uint8_t> buffer;
+  EXPECT_FALSE(gate.Skip(MakeFrame("0", &buffer)));
+  // changes on the left half are ignored
+  EXPECT_TRUE(gate.Skip(MakeFrame("0", &buffer, 0, 0, kWidth / 2, kHeight)));
+  EXPECT_FALSE(gate.Skip(MakeFrame("0", &buffer, kWidth / 2, 0, kWidth, kHeight / 4)));
+
+  EXPECT_FALSE(gate.Skip(MakeFrame("1", &buffer)));
+  EXPECT_TRUE(gate.Skip(MakeFrame("1", &buffer, 0, 0, kWidth, kHeight / 2)));
+  EXPECT_FALSE(gate.Skip(MakeFrame("1", &buffer, 0, kHeight / 2, kWidth, kHeight)));
+
+  auto finfo = MakeFrame("1", &buffer);
+  auto objs_holder = std::make_shared<CNInferObjs>();
+  for (float y : {0.1f, 0.6f}) {
+    auto obj = std::make_shared<CNInferObject>();
+    obj->bbox = {0.2f, y, 0.2f, 0.2f};
+    objs_holder->objs_.push_back(obj);
+  }
+  finfo->datas[CNInferObjsPtrKey] = objs_holder;
+  gate.Filter(finfo);
+  ASSERT_EQ(1u, objs_holder->objs_.size());
+  EXPECT_FLOAT_EQ(0.6f, objs_holder->objs_[0]->bbox.y);
+}
+
+TEST(Inferencer, MotionGate_InPolygon) {
+  RoiPolygon triangle = {{0, 0}, {1, 0}, {0, 1}};
+  EXPECT_TRUE(MotionGate::InPolygon(triangle, 0.2f, 0.2f));
+  EXPECT_FALSE(MotionGate::InPolygon(triangle, 0.8f, 0.8f));
+  EXPECT_FALSE(MotionGate::InPolygon(triangle, -0.1f, 0.5f));
+}
+
+}  // namespace cnstream
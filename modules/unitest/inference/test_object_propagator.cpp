@@ -0,0 +1,175 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+#include "object_propagator.hpp"
+
+namespace cnstream {
+
+static std::shared_ptr<CNFrameInfo> MakeFrame(const std::string& stream_id, uint64_t frame_id) {
+  auto finfo = CNFrameInfo::Create(stream_id);
+  auto frame = std::make_shared<CNDataFrame>();
+  frame->frame_id = frame_id;
+  finfo->datas[CNDataFramePtrKey] = frame;
+  finfo->datas[CNInferObjsPtrKey] = std::make_shared<CNInferObjs>();
+  return finfo;
+}
+
+static void AddObject(const std::shared_ptr<CNFrameInfo>& finfo, const std::string& label, CNInferBoundingBox bbox,
+                      const std::string& track_id = "") {
+  auto obj = std::make_shared<CNInferObject>();
+  obj->id = label;
+  obj->track_id = track_id;
+  obj->score = 0.9f;
+  obj->bbox = bbox;
+  GetCNInferObjsPtr(finfo)->objs_.push_back(obj);
+}
+
+static const std::vector<std::shared_ptr<CNInferObject>>& Objects(const std::shared_ptr<CNFrameInfo>& finfo) {
+  return GetCNInferObjsPtr(finfo)->objs_;
+}
+
+TEST(Inferencer, ObjectPropagator_FirstInferredFrame) {
+  ObjectPropagator propagator;
+  // nothing inferred yet
+  auto skipped = MakeFrame("0", 0);
+  propagator.Skipped(skipped);
+  EXPECT_TRUE(Objects(skipped).empty());
+
+  auto inferred = MakeFrame("0", 1);
+  AddObject(inferred, "2", {0.1f, 0.1f, 0.2f, 0.2f});
+  Objects(inferred)[0]->AddAttribute("color", CNInferAttr());
+  Objects(inferred)[0]->AddExtraAttribute("plate", "abc");
+  propagator.Inferred(inferred);
+
+  skipped = MakeFrame("0", 2);
+  propagator.Skipped(skipped);
+  ASSERT_EQ(1u, Objects(skipped).size());
+  auto obj = Objects(skipped)[0];
+  EXPECT_NE(Objects(inferred)[0], obj);
+  // no velocity from a single frame
+  EXPECT_FLOAT_EQ(0.1f, obj->bbox.x);
+  EXPECT_FLOAT_EQ(0.2f, obj->bbox.w);
+  EXPECT_EQ("2", obj->id);
+  EXPECT_EQ(1u, obj->GetAttributes().size());
+  EXPECT_EQ("abc", obj->GetExtraAttribute("plate"));
+
+  // other streams are not affected
+  auto other = MakeFrame("1", 2);
+  propagator.Skipped(other);
+  EXPECT_TRUE(Objects(other).empty());
+}
+
+TEST(Inferencer, ObjectPropagator_Motion) {
+  ObjectPropagator propagator;
+  auto frame0 = MakeFrame("0", 0);
+  AddObject(frame0, "0", {0.1f, 0.1f, 0.2f, 0.2f});
+  AddObject(frame0, "1", {0.5f, 0.5f, 0.2f, 0.2f});
+  propagator.Inferred(frame0);
+
+  auto frame3 = MakeFrame("0", 3);
+  // moves right by 0.03 per frame
+  AddObject(frame3, "0", {0.19f, 0.1f, 0.2f, 0.2f});
+  // grows by 0.02 per frame
+  AddObject(frame3, "1", {0.5f, 0.5f, 0.26f, 0.2f});
+  propagator.Inferred(frame3);
+
+  auto frame5 = MakeFrame("0", 5);
+  propagator.Skipped(frame5);
+  ASSERT_EQ(2u, Objects(frame5).size());
+  EXPECT_NEAR(0.25f, Objects(frame5)[0]->bbox.x, 1e-5);
+  EXPECT_NEAR(0.1f, Objects(frame5)[0]->bbox.y, 1e-5);
+  EXPECT_NEAR(0.2f, Objects(frame5)[0]->bbox.w, 1e-5);
+  EXPECT_NEAR(0.5f, Objects(frame5)[1]->bbox.x, 1e-5);
+  EXPECT_NEAR(0.3f, Objects(frame5)[1]->bbox.w, 1e-5);
+}
+
+TEST(Inferencer, ObjectPropagator_TrackIdAndClip) {
+  ObjectPropagator propagator;
+  auto frame0 = MakeFrame("0", 0);
+  AddObject(frame0, "0", {0.2f, 0.1f, 0.3f, 0.2f}, "7");
+  AddObject(frame0, "0", {0.0f, 0.6f, 0.1f, 0.1f}, "8");
+  propagator.Inferred(frame0);
+
+  auto frame1 = MakeFrame("0", 1);
+  // no overlap, matched by track id
+  AddObject(frame1, "0", {0.55f, 0.1f, 0.3f, 0.2f}, "7");
+  // shrinks to nothing
+  AddObject(frame1, "0", {0.0f, 0.6f, 0.05f, 0.1f}, "8");
+  propagator.Inferred(frame1);
+
+  auto frame2 = MakeFrame("0", 2);
+  propagator.Skipped(frame2);
+  ASSERT_EQ(1u, Objects(frame2).size());
+  EXPECT_EQ("7", Objects(frame2)[0]->track_id);
+  // clipped to the right border
+  EXPECT_NEAR(0.9f, Objects(frame2)[0]->bbox.x, 1e-5);
+  EXPECT_NEAR(0.1f, Objects(frame2)[0]->bbox.w, 1e-5);
+}
+
+TEST(Inferencer, ObjectPropagator_CopiesObjects) {
+  ObjectPropagator propagator;
+  auto inferred = MakeFrame("0", 0);
+  AddObject(inferred, "0", {0.1f, 0.1f, 0.2f, 0.2f}, "7");
+  Objects(inferred)[0]->AddExtraAttribute("plate", "abc");
+  Objects(inferred)[0]->AddFeature("reid", CNInferFeature{1.f, 2.f});
+  propagator.Inferred(inferred);
+
+  // downstream modules change the objects of the inferred frame
+  auto original = Objects(inferred)[0];
+  original->track_id = "8";
+  original->id = "1";
+  original->score = 0.1f;
+  original->bbox = {0.5f, 0.5f, 0.1f, 0.1f};
+  original->AddExtraAttribute("color", "red");
+  original->AddFeature("other", CNInferFeature{3.f});
+
+  auto skipped = MakeFrame("0", 1);
+  propagator.Skipped(skipped);
+  ASSERT_EQ(1u, Objects(skipped).size());
+  auto obj = Objects(skipped)[0];
+  EXPECT_EQ("7", obj->track_id);
+  EXPECT_EQ("0", obj->id);
+  EXPECT_FLOAT_EQ(0.9f, obj->score);
+  EXPECT_FLOAT_EQ(0.1f, obj->bbox.x);
+  EXPECT_FLOAT_EQ(0.2f, obj->bbox.w);
+  EXPECT_EQ(1u, obj->GetExtraAttributes().size());
+  ASSERT_EQ(1u, obj->GetFeatures().size());
+  EXPECT_EQ("reid", obj->GetFeatures()[0].first);
+}
+
+TEST(Inferencer, ObjectPropagator_Eos) {
+  ObjectPropagator propagator;
+  auto frame0 = MakeFrame("0", 0);
+  AddObject(frame0, "0", {0.1f, 0.1f, 0.2f, 0.2f});
+  propagator.Inferred(frame0);
+  propagator.Eos("0");
+  auto frame1 = MakeFrame("0", 1);
+  propagator.Skipped(frame1);
+  EXPECT_TRUE(Objects(frame1).empty());
+}
+
+}  // namespace cnstream
@@ -88,6 +88,26 @@ TEST(Inferencer, TimeoutHelper_Reset) {
   EXPECT_EQ(static_cast<int>(th_test.getState()), 0);
 }
 
+TEST(Inferencer, TimeoutHelper_ResetWithTimeout) {
+  TimeoutHelper th;
+  th.SetTimeout(3000);
+  std::promise<void> called;
+  auto stime = std::chrono::steady_clock::now();
+  th.LockOperator();
+  th.Reset([&called]() -> void { called.set_value(); }, 50);
+  th.UnlockOperator();
+  ASSERT_EQ(std::future_status::ready, called.get_future().wait_for(std::chrono::seconds(2)));
+  EXPECT_GE(std::chrono::steady_clock::now() - stime, std::chrono::milliseconds(50));
+
+  // never longer than the timeout set
+  th.SetTimeout(50);
+  std::promise<void> called_again;
+  th.LockOperator();
+  th.Reset([&called_again]() -> void { called_again.set_value(); }, 3000);
+  th.UnlockOperator();
+  EXPECT_EQ(std::future_status::ready, called_again.get_future().wait_for(std::chrono::seconds(2)));
+}
+
 TEST(Inferencer, TimeoutHelper_HandleFunc) {
   double wait_time = 600.0;  // ms
   std::shared_ptr<TimeoutHelper> th = std::make_shared<TimeoutHelper>();
@@ -21,6 +21,7 @@
 #include <gtest/gtest.h>
 
 #include <chrono>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <thread>
@@ -29,6 +30,7 @@
 #include "cnstream_frame_va.hpp"
 #include "ipc_handler.hpp"
 #include "module_ipc.hpp"
+#include "shm_frame_ring.hpp"
 
 namespace cnstream {
 
@@ -50,162 +52,6 @@ TEST(IPCHandler, Construct) {
   EXPECT_TRUE(handler != nullptr);
 }
 
-TEST(IPCHandler, ParseStringToPackage) {
-  std::shared_ptr<ModuleIPC> ipc = std::make_shared<ModuleIPC>("ipc");
-  auto handler = std::make_shared<IPCHandlerTest>(IPC_CLIENT, ipc.get());
-  std::string json_str = "{\"pkg_type\":2}";
-  EXPECT_FALSE(handler->ParseStringToPackage(json_str, nullptr));
-
-  FrameInfoPackage msg_pack;
-  EXPECT_TRUE(handler->ParseStringToPackage(json_str, &msg_pack));
-
-  json_str = "{\"pkg_type\":3}";
-  EXPECT_TRUE(handler->ParseStringToPackage(json_str, &msg_pack));
-
-  json_str = "{\"pkg_type\":1,\"stream_id\":\"0\",\"stream_idx\":0,\"frame_id\":0}";
-  EXPECT_TRUE(handler->ParseStringToPackage(json_str, &msg_pack));
-
-  json_str =
-      "{\"pkg_type\":0,\"stream_id\":\"0\",\"stream_idx\":0,\"frame_id\":0,\"flags\":0,\"timestamp\":0,\"data_fmt\":0,"
-      "\"width\":1920,\"height\":1080,\"strides\":[1920,1920],\"dev_type\":0,\"dev_id\":0,"
-      "\"ddr_channel\":0,\"mem_map_type\":0,\"mlu_mem_handle\":\"0\"}";
-  EXPECT_TRUE(handler->ParseStringToPackage(json_str, &msg_pack));
-
-  json_str =
-      "{\"stream_id\":\"0\",\"stream_idx\":0,\"frame_id\":0,\"flags\":0,\"timestamp\":0,\"data_fmt\":0,"
-      "\"width\":1920,\"height\":1080,\"strides\":[1920,1920],\"dev_type\":0,\"dev_id\":0,"
-      "\"ddr_channel\":0,\"mem_map_type\":0,\"mlu_mem_handle\":\"0\"}";
-  EXPECT_FALSE(handler->ParseStringToPackage(json_str, &msg_pack));
-
-  json_str =
-      "{\"pkg_type\":0,\"stream_idx\":0,\"frame_id\":0,\"flags\":0,\"timestamp\":0,\"data_fmt\":0,"
-      "\"width\":1920,\"height\":1080,\"strides\":[1920,1920],\"dev_type\":0,\"dev_id\":0,"
-      "\"ddr_channel\":0,\"mem_map_type\":0,\"mlu_mem_handle\":\"0\"}";
-  EXPECT_FALSE(handler->ParseStringToPackage(json_str, &msg_pack));
-
-  json_str =
-      "{\"pkg_type\":0,\"stream_id\":\"0\",\"frame_id\":0,\"flags\":0,\"timestamp\":0,\"data_fmt\":0,"
-      "\"width\":1920,\"height\":1080,\"strides\":[1920,1920],\"dev_type\":0,\"dev_id\":0,"
-      "\"ddr_channel\":0,\"mem_map_type\":0,\"mlu_mem_handle\":\"0\"}";
-  EXPECT_FALSE(handler->ParseStringToPackage(json_str, &msg_pack));
-
-  json_str =
-      "{\"pkg_type\":0,\"stream_id\":\"0\",\"stream_idx\":0,\"flags\":0,\"timestamp\":0,\"data_fmt\":0,"
-      "\"width\":1920,\"height\":1080,\"strides\":[1920,1920],\"dev_type\":0,\"dev_id\":0,"
-      "\"ddr_channel\":0,\"mem_map_type\":0,\"mlu_mem_handle\":\"0\"}";
-  EXPECT_FALSE(handler->ParseStringToPackage(json_str, &msg_pack));
-
-  json_str =
-      "{\"pkg_type\":0,\"stream_id\":\"0\",\"stream_idx\":0,\"frame_id\":0,\"timestamp\":0,\"data_fmt\":0,"
-      "\"width\":1920,\"height\":1080,\"strides\":[1920,1920],\"dev_type\":0,\"dev_id\":0,"
-      "\"ddr_channel\":0,\"mem_map_type\":0,\"mlu_mem_handle\":\"0\"}";
-  EXPECT_FALSE(handler->ParseStringToPackage(json_str, &msg_pack));
-
-  json_str =
-      "{\"pkg_type\":0,\"stream_id\":\"0\",\"stream_idx\":0,\"frame_id\":0,\"flags\":0,\"data_fmt\":0,"
-      "\"width\":1920,\"height\":1080,\"strides\":[1920,1920],\"dev_type\":0,\"dev_id\":0,"
-      "\"ddr_channel\":0,\"mem_map_type\":0,\"mlu_mem_handle\":\"0\"}";
-  EXPECT_FALSE(handler->ParseStringToPackage(json_str, &msg_pack));
-
-  json_str =
-      "{\"pkg_type\":0,\"stream_id\":\"0\",\"stream_idx\":0,\"frame_id\":0,\"flags\":0,\"timestamp\":0,"
-      "\"width\":1920,\"height\":1080,\"strides\":[1920,1920],\"dev_type\":0,\"dev_id\":0,"
-      "\"ddr_channel\":0,\"mem_map_type\":0,\"mlu_mem_handle\":\"0\"}";
-  EXPECT_FALSE(handler->ParseStringToPackage(json_str, &msg_pack));
-
-  json_str =
-      "{\"pkg_type\":0,\"stream_id\":\"0\",\"stream_idx\":0,\"frame_id\":0,\"flags\":0,\"timestamp\":0,\"data_fmt\":0,"
-      "\"height\":1080,\"strides\":[1920,1920],\"dev_type\":0,\"dev_id\":0,"
-      "\"ddr_channel\":0,\"mem_map_type\":0,\"mlu_mem_handle\":\"0\"}";
-  EXPECT_FALSE(handler->ParseStringToPackage(json_str, &msg_pack));
-
-  json_str =
-      "{\"pkg_type\":0,\"stream_id\":\"0\",\"stream_idx\":0,\"frame_id\":0,\"flags\":0,\"timestamp\":0,\"data_fmt\":0,"
-      "\"width\":1920,\"strides\":[1920,1920],\"dev_type\":0,\"dev_id\":0,"
-      "\"ddr_channel\":0,\"mem_map_type\":0,\"mlu_mem_handle\":\"0\"}";
-  EXPECT_FALSE(handler->ParseStringToPackage(json_str, &msg_pack));
-
-  json_str =
-      "{\"pkg_type\":0,\"stream_id\":\"0\",\"stream_idx\":0,\"frame_id\":0,\"flags\":0,\"timestamp\":0,\"data_fmt\":0,"
-      "\"width\":1920,\"height\":1080,\"strides\":[\"str\",1920],\"dev_type\":0,\"dev_id\":0,"
-      "\"ddr_channel\":0,\"mem_map_type\":0,\"mlu_mem_handle\":\"0\"}";
-  EXPECT_FALSE(handler->ParseStringToPackage(json_str, &msg_pack));
-
-  json_str =
-      "{\"pkg_type\":0,\"stream_id\":\"0\",\"stream_idx\":0,\"frame_id\":0,\"flags\":0,\"timestamp\":0,\"data_fmt\":0,"
-      "\"width\":1920,\"height\":1080,\"dev_type\":0,\"dev_id\":0,"
-      "\"ddr_channel\":0,\"mem_map_type\":0,\"mlu_mem_handle\":\"0\"}";
-  EXPECT_FALSE(handler->ParseStringToPackage(json_str, &msg_pack));
-
-  json_str =
-      "{\"pkg_type\":0,\"stream_id\":\"0\",\"stream_idx\":0,\"frame_id\":0,\"flags\":0,\"timestamp\":0,\"data_fmt\":0,"
-      "\"width\":1920,\"height\":1080,\"strides\":[1920,1920],\"dev_type\":\"string\",\"dev_"
-      "id\":0,"
-      "\"ddr_channel\":0,\"mem_map_type\":0,\"mlu_mem_handle\":\"0\"}";
-  EXPECT_FALSE(handler->ParseStringToPackage(json_str, &msg_pack));
-
-  json_str =
-      "{\"pkg_type\":0,\"stream_id\":\"0\",\"stream_idx\":0,\"frame_id\":0,\"flags\":0,\"timestamp\":0,\"data_fmt\":0,"
-      "\"width\":1920,\"height\":1080,\"strides\":[1920,1920],\"dev_type\":0,"
-      "\"ddr_channel\":0,\"mem_map_type\":0,\"mlu_mem_handle\":\"0\"}";
-  EXPECT_FALSE(handler->ParseStringToPackage(json_str, &msg_pack));
-
-  json_str =
-      "{\"pkg_type\":0,\"stream_id\":\"0\",\"stream_idx\":0,\"frame_id\":0,\"flags\":0,\"timestamp\":0,\"data_fmt\":0,"
-      "\"width\":1920,\"height\":1080,\"strides\":[1920,1920],\"dev_type\":0,\"dev_id\":0,"
-      "\"mem_map_type\":0,\"mlu_mem_handle\":\"0\"}";
-  EXPECT_FALSE(handler->ParseStringToPackage(json_str, &msg_pack));
-
-  json_str =
-      "{\"pkg_type\":0,\"stream_id\":\"0\",\"stream_idx\":0,\"frame_id\":0,\"flags\":0,\"timestamp\":0,\"data_fmt\":0,"
-      "\"width\":1920,\"height\":1080,\"strides\":[1920,1920],\"dev_type\":0,\"dev_id\":0,"
-      "\"ddr_channel\":0,\"mlu_mem_handle\":\"0\"}";
-  EXPECT_FALSE(handler->ParseStringToPackage(json_str, &msg_pack));
-
-  json_str =
-      "{\"pkg_type\":0,\"stream_id\":\"0\",\"stream_idx\":0,\"frame_id\":0,\"flags\":0,\"timestamp\":0,\"data_fmt\":0,"
-      "\"width\":1920,\"height\":1080,\"strides\":[1920,1920],\"dev_type\":0,\"dev_id\":0,"
-      "\"ddr_channel\":0,\"mem_map_type\":0}";
-  EXPECT_FALSE(handler->ParseStringToPackage(json_str, &msg_pack));
-}
-
-TEST(IPCHandler, SerializeToString) {
-  std::shared_ptr<ModuleIPC> ipc = std::make_shared<ModuleIPC>("ipc");
-  auto handler = std::make_shared<IPCHandlerTest>(IPC_CLIENT, ipc.get());
-  std::string str;
-  FrameInfoPackage pkg;
-  EXPECT_FALSE(handler->SerializeToString(pkg, nullptr));
-
-  pkg.pkg_type = PKG_ERROR;
-  EXPECT_TRUE(handler->SerializeToString(pkg, &str));
-
-  pkg.pkg_type = PKG_EXIT;
-  EXPECT_TRUE(handler->SerializeToString(pkg, &str));
-
-  pkg.pkg_type = PKG_RELEASE_MEM;
-  pkg.stream_idx = 0;
-  pkg.frame_id = 0;
-  pkg.stream_id = "0";
-  EXPECT_TRUE(handler->SerializeToString(pkg, &str));
-
-  pkg.pkg_type = PKG_DATA;
-  pkg.flags = 0;
-  pkg.timestamp = 0;
-  pkg.fmt = CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21;
-  pkg.width = 1920;
-  pkg.height = 1080;
-  pkg.stride[0] = 1920;
-  pkg.stride[1] = 1920;
-  pkg.ptr_mlu[0] = nullptr;
-  pkg.ptr_mlu[1] = nullptr;
-  pkg.ctx.dev_type = DevContext::DevType::MLU;
-  pkg.ctx.dev_id = 0;
-  pkg.ctx.ddr_channel = 0;
-  pkg.mem_map_type = MEMMAP_MLU;
-  pkg.mlu_mem_handle = nullptr;
-  EXPECT_TRUE(handler->SerializeToString(pkg, &str));
-}
-
 TEST(IPCHandler, PreparePackageToSend) {
   std::shared_ptr<ModuleIPC> ipc = std::make_shared<ModuleIPC>("ipc");
   auto handler = std::make_shared<IPCHandlerTest>(IPC_CLIENT, ipc.get());
@@ -246,4 +92,39 @@ TEST(IPCHandler, PackageToCNData) {
   std::shared_ptr<CNFrameInfo> data = CNFrameInfo::Create("0");
   EXPECT_NO_THROW(handler->PackageToCNData(pkg, data));
 }
+
+TEST(IPCHandler, PackageToCNDataFromFrameRing) {
+  std::shared_ptr<ModuleIPC> ipc = std::make_shared<ModuleIPC>("ipc");
+  auto handler = std::make_shared<IPCHandlerTest>(IPC_SERVER, ipc.get());
+  handler->SetSocketAddress("test_ipc_handler_ring");
+  const int width = 64, height = 32;
+  FrameInfoPackage pkg;
+  pkg.pkg_type = PKG_DATA;
+  pkg.stream_id = "0";
+  pkg.stream_idx = 3;
+  pkg.flags = 0;
+  pkg.fmt = CNDataFormat::CN_PIXEL_FORMAT_YUV420_NV21;
+  pkg.width = width;
+  pkg.height = height;
+  pkg.stride[0] = width;
+  pkg.stride[1] = width;
+  pkg.ctx.dev_type = DevContext::DevType::CPU;
+  pkg.mem_map_type = MEMMAP_CPU;
+  pkg.shm_slot = 0;
+
+  // the ring of the client does not exist yet, the frame is dropped
+  std::shared_ptr<CNFrameInfo> data = CNFrameInfo::Create("0");
+  EXPECT_FALSE(handler->PackageToCNData(pkg, data));
+
+  // the ring created afterwards is picked up
+  auto ring = ShmFrameRing::Create(ShmFrameRing::GetName("test_ipc_handler_ring", 3), 2, width * height * 3 / 2);
+  ASSERT_TRUE(ring != nullptr);
+  ASSERT_EQ(0, ring->Acquire());
+  memset(ring->GetSlot(0), 7, width * height * 3 / 2);
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  data = CNFrameInfo::Create("0");
+  ASSERT_TRUE(handler->PackageToCNData(pkg, data));
+  CNDataFramePtr frame = GetCNDataFramePtr(data);
+  EXPECT_EQ(7, static_cast<const uint8_t*>(frame->data[1]->GetCpuData())[0]);
+}
 }  // namespace cnstream
@@ -0,0 +1,294 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rapidjson/document.h>
+
+#include "ipc_handler.hpp"
+#include "ipc_protocol.hpp"
+#include "module_ipc.hpp"
+
+namespace cnstream {
+
+static FrameInfoPackage MakeDataPackage(uint64_t frame_id, int obj_num) {
+  FrameInfoPackage pkg;
+  pkg.pkg_type = PKG_DATA;
+  pkg.stream_idx = 3;
+  pkg.stream_id = "rtsp://127.0.0.1/stream_3";
+  pkg.flags = 0;
+  pkg.frame_id = frame_id;
+  pkg.timestamp = 1000 + frame_id;
+  pkg.fmt = CN_PIXEL_FORMAT_YUV420_NV12;
+  pkg.width = 1920;
+  pkg.height = 1080;
+  for (int i = 0; i < CN_MAX_PLANES; i++) pkg.stride[i] = i < 2 ? 1920 : 0;
+  pkg.ctx.dev_type = DevContext::MLU;
+  pkg.ctx.dev_id = 1;
+  pkg.ctx.ddr_channel = 2;
+  pkg.mem_map_type = MEMMAP_CPU;
+  pkg.mlu_mem_handle = reinterpret_cast<void*>(0x1234);
+  pkg.shm_slot = 5;
+  if (obj_num > 0) {
+    pkg.objs = std::make_shared<CNInferObjs>();
+    for (int i = 0; i < obj_num; ++i) {
+      auto obj = std::make_shared<CNInferObject>();
+      obj->id = std::to_string(i % 3);
+      obj->track_id = std::to_string(i);
+      obj->score = 0.5f + i * 0.01f;
+      obj->bbox = {0.1f, 0.2f, 0.3f, 0.4f};
+      CNInferAttr attr;
+      attr.id = 1;
+      attr.value = i;
+      attr.score = 0.9f;
+      obj->AddAttribute("color", attr);
+      obj->AddExtraAttribute("plate", "A" + std::to_string(i));
+      obj->AddFeature("reid", CNInferFeature(128, static_cast<float>(i)));
+      pkg.objs->objs_.push_back(obj);
+    }
+  }
+  return pkg;
+}
+
+TEST(ModuleIPC, BinaryProtocolDataPackage) {
+  FrameInfoPackage pkg = MakeDataPackage(7, 2);
+  std::string buf;
+  SerializeToBinary(pkg, &buf);
+
+  FrameInfoPackage out;
+  EXPECT_EQ(ParseBinaryToPackage(buf.data(), buf.size() - 1, &out), 0);
+  ASSERT_EQ(ParseBinaryToPackage(buf.data(), buf.size(), &out), static_cast<int>(buf.size()));
+  EXPECT_EQ(out.pkg_type, PKG_DATA);
+  EXPECT_EQ(out.stream_idx, pkg.stream_idx);
+  EXPECT_EQ(out.stream_id, pkg.stream_id);
+  EXPECT_EQ(out.frame_id, pkg.frame_id);
+  EXPECT_EQ(out.timestamp, pkg.timestamp);
+  EXPECT_EQ(out.fmt, pkg.fmt);
+  EXPECT_EQ(out.width, pkg.width);
+  EXPECT_EQ(out.height, pkg.height);
+  EXPECT_EQ(out.stride[1], pkg.stride[1]);
+  EXPECT_EQ(out.ctx.dev_type, pkg.ctx.dev_type);
+  EXPECT_EQ(out.ctx.dev_id, pkg.ctx.dev_id);
+  EXPECT_EQ(out.ctx.ddr_channel, pkg.ctx.ddr_channel);
+  EXPECT_EQ(out.mem_map_type, pkg.mem_map_type);
+  EXPECT_EQ(out.mlu_mem_handle, pkg.mlu_mem_handle);
+  EXPECT_EQ(out.shm_slot, pkg.shm_slot);
+
+  ASSERT_NE(out.objs, nullptr);
+  ASSERT_EQ(out.objs->objs_.size(), 2u);
+  auto obj = out.objs->objs_[1];
+  EXPECT_EQ(obj->id, "1");
+  EXPECT_EQ(obj->track_id, "1");
+  EXPECT_FLOAT_EQ(obj->score, 0.51f);
+  EXPECT_FLOAT_EQ(obj->bbox.h, 0.4f);
+  EXPECT_EQ(obj->GetAttribute("color").value, 1);
+  EXPECT_EQ(obj->GetExtraAttribute("plate"), "A1");
+  EXPECT_EQ(obj->GetFeature("reid"), CNInferFeature(128, 1.0f));
+
+  // a frame without inference results has no objects
+  buf.clear();
+  SerializeToBinary(MakeDataPackage(8, 0), &buf);
+  ASSERT_GT(ParseBinaryToPackage(buf.data(), buf.size(), &out), 0);
+  EXPECT_EQ(out.objs, nullptr);
+}
+
+TEST(ModuleIPC, BinaryProtocolControlPackage) {
+  FrameInfoPackage pkg;
+  pkg.pkg_type = PKG_RELEASE_MEM;
+  pkg.stream_idx = 1;
+  pkg.stream_id = "1";
+  pkg.frame_id = 99;
+  std::string buf;
+  SerializeToBinary(pkg, &buf);
+  pkg.pkg_type = PKG_EXIT;
+  SerializeToBinary(pkg, &buf);
+
+  FrameInfoPackage out;
+  int size = ParseBinaryToPackage(buf.data(), buf.size(), &out);
+  ASSERT_GT(size, 0);
+  EXPECT_EQ(out.pkg_type, PKG_RELEASE_MEM);
+  EXPECT_EQ(out.stream_id, "1");
+  EXPECT_EQ(out.frame_id, 99u);
+  EXPECT_EQ(ParseBinaryToPackage(buf.data() + size, buf.size() - size, &out), static_cast<int>(buf.size()) - size);
+  EXPECT_EQ(out.pkg_type, PKG_EXIT);
+  EXPECT_TRUE(out.stream_id.empty());
+
+  buf[0] = 'x';
+  EXPECT_EQ(ParseBinaryToPackage(buf.data(), buf.size(), &out), -1);
+}
+
+TEST(ModuleIPC, BinaryProtocolUnknownSection) {
+  std::string buf;
+  SerializeToBinary(MakeDataPackage(1, 1), &buf);
+  // a section added by a newer writer
+  const char extra[] = {0x7f, 0, 0, 0, 4, 0, 0, 0, 'n', 'e', 'w', '!'};
+  buf.append(extra, sizeof(extra));
+  IPCMessageHeader header;
+  memcpy(&header, buf.data(), sizeof(header));
+  header.payload_size += sizeof(extra);
+  memcpy(&buf[0], &header, sizeof(header));
+
+  FrameInfoPackage out;
+  EXPECT_EQ(ParseBinaryToPackage(buf.data(), buf.size(), &out), static_cast<int>(buf.size()));
+  EXPECT_EQ(out.frame_id, 1u);
+  ASSERT_NE(out.objs, nullptr);
+  EXPECT_EQ(out.objs->objs_.size(), 1u);
+}
+
+TEST(ModuleIPC, BinaryProtocolMessageReader) {
+  std::string stream;
+  for (int i = 0; i < 10; ++i) SerializeToBinary(MakeDataPackage(i, i % 3), &stream);
+
+  // bytes arrive in arbitrary pieces
+  IPCMessageReader reader;
+  std::vector<FrameInfoPackage> pkgs;
+  size_t pos = 0, piece = 1;
+  while (pos < stream.size()) {
+    size_t size = 0;
+    char* buf = reader.GetWriteBuffer(&size);
+    size = std::min(std::min(size, piece), stream.size() - pos);
+    memcpy(buf, stream.data() + pos, size);
+    reader.Commit(size);
+    pos += size;
+    piece = piece * 3 % 1031 + 1;
+    FrameInfoPackage pkg;
+    while (reader.Next(&pkg) > 0) pkgs.push_back(pkg);
+  }
+  ASSERT_EQ(pkgs.size(), 10u);
+  for (size_t i = 0; i < pkgs.size(); ++i) {
+    EXPECT_EQ(pkgs[i].frame_id, i);
+    EXPECT_EQ(pkgs[i].objs ? pkgs[i].objs->objs_.size() : 0u, i % 3);
+  }
+}
+
+// A data message of the former json format, as MakeDataPackage(0, 0) was sent.
+static const char kJsonSample[] =
+    "{\"pkg_type\":0,\"stream_idx\":3,\"stream_id\":\"rtsp://127.0.0.1/stream_3\",\"frame_id\":0,\"flags\":0,"
+    "\"timestamp\":1000,\"data_fmt\":1,\"width\":1920,\"height\":1080,\"strides\":[1920,1920,0,0,0,0],"
+    "\"dev_type\":1,\"dev_id\":1,\"ddr_channel\":2,\"mem_map_type\":1,\"mlu_mem_handle\":\"4660\",\"shm_slot\":5}";
+
+// Reads the fields of a json message, as the former format was parsed.
+static bool ParseJsonSample(const char* str, FrameInfoPackage* pkg) {
+  rapidjson::Document doc;
+  if (doc.Parse<rapidjson::kParseCommentsFlag>(str).HasParseError() || !doc.IsObject()) return false;
+  pkg->pkg_type = static_cast<PkgType>(doc["pkg_type"].GetInt());
+  pkg->stream_idx = doc["stream_idx"].GetUint();
+  pkg->stream_id = doc["stream_id"].GetString();
+  pkg->frame_id = doc["frame_id"].GetUint64();
+  pkg->flags = doc["flags"].GetUint();
+  pkg->timestamp = doc["timestamp"].GetInt64();
+  pkg->fmt = static_cast<CNDataFormat>(doc["data_fmt"].GetInt());
+  pkg->width = doc["width"].GetInt();
+  pkg->height = doc["height"].GetInt();
+  const auto& strides = doc["strides"].GetArray();
+  for (rapidjson::SizeType i = 0; i < strides.Size() && i < CN_MAX_PLANES; ++i) pkg->stride[i] = strides[i].GetInt();
+  pkg->ctx.dev_type = static_cast<DevContext::DevType>(doc["dev_type"].GetInt());
+  pkg->ctx.dev_id = doc["dev_id"].GetInt();
+  pkg->ctx.ddr_channel = doc["ddr_channel"].GetInt();
+  pkg->mem_map_type = static_cast<MemMapType>(doc["mem_map_type"].GetInt());
+  pkg->mlu_mem_handle = reinterpret_cast<void*>(std::stoll(doc["mlu_mem_handle"].GetString()));
+  pkg->shm_slot = doc["shm_slot"].GetInt();
+  return true;
+}
+
+TEST(ModuleIPC, BinaryProtocolThroughput) {
+  const int msg_num = 100000;
+  const int batch = 64;
+  FrameInfoPackage pkg = MakeDataPackage(0, 0);
+
+  // old format: one json string in a 512 bytes buffer per syscall. The recorded message is sent as it is, so the
+  // cost of serializing it is left out of the comparison.
+  {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    std::thread reader([&]() {
+      char buf[512];
+      FrameInfoPackage out;
+      for (int i = 0; i < msg_num; ++i) {
+        size_t got = 0;
+        while (got < sizeof(buf)) got += recv(fds[1], buf + got, sizeof(buf) - got, 0);
+        EXPECT_TRUE(ParseJsonSample(buf, &out));
+      }
+    });
+    auto start = std::chrono::steady_clock::now();
+    char buf[512];
+    for (int i = 0; i < msg_num; ++i) {
+      memset(buf, 0, sizeof(buf));
+      memcpy(buf, kJsonSample, sizeof(kJsonSample));
+      send(fds[0], buf, sizeof(buf), 0);
+    }
+    reader.join();
+    std::chrono::duration<double> dura = std::chrono::steady_clock::now() - start;
+    std::cout << "[ModuleIPC] json, 512 bytes per message: " << msg_num / dura.count() << " msgs/s" << std::endl;
+    close(fds[0]);
+    close(fds[1]);
+  }
+
+  // binary messages, sent in batches
+  for (int obj_num : {0, 8}) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    pkg = MakeDataPackage(0, obj_num);
+    int received = 0;
+    std::thread reader([&]() {
+      IPCMessageReader msg_reader;
+      FrameInfoPackage out;
+      while (received < msg_num) {
+        size_t size = 0;
+        char* buf = msg_reader.GetWriteBuffer(&size);
+        ssize_t ret = recv(fds[1], buf, size, 0);
+        if (ret <= 0) break;
+        msg_reader.Commit(ret);
+        while (msg_reader.Next(&out) > 0) received++;
+      }
+    });
+    auto start = std::chrono::steady_clock::now();
+    std::string buf;
+    for (int i = 0; i < msg_num; i += batch) {
+      buf.clear();
+      for (int j = i; j < i + batch && j < msg_num; ++j) {
+        pkg.frame_id = j;
+        SerializeToBinary(pkg, &buf);
+      }
+      size_t sent = 0;
+      while (sent < buf.size()) sent += send(fds[0], buf.data() + sent, buf.size() - sent, 0);
+    }
+    reader.join();
+    std::chrono::duration<double> dura = std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(received, msg_num);
+    std::cout << "[ModuleIPC] binary, batch " << batch << ", " << obj_num << " objects per frame: "
+              << msg_num / dura.count() << " msgs/s, " << buf.size() / batch << " bytes per message" << std::endl;
+    close(fds[0]);
+    close(fds[1]);
+  }
+}
+
+}  // namespace cnstream
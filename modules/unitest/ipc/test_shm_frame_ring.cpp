@@ -0,0 +1,85 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "shm_frame_ring.hpp"
+
+namespace cnstream {
+
+TEST(ModuleIPC, ShmFrameRingCreateAndOpen) {
+  const std::string name = ShmFrameRing::GetName("test/shm_ring", 0);
+  EXPECT_EQ(ShmFrameRing::Create(name, 0, 1024), nullptr);
+  EXPECT_EQ(ShmFrameRing::Open(name), nullptr);
+
+  auto producer = ShmFrameRing::Create(name, 4, 1000);
+  ASSERT_NE(producer, nullptr);
+  EXPECT_EQ(producer->GetSlotNum(), 4u);
+  EXPECT_GE(producer->GetSlotSize(), 1000u);
+  auto consumer = ShmFrameRing::Open(name);
+  ASSERT_NE(consumer, nullptr);
+  EXPECT_EQ(consumer->GetSlotNum(), producer->GetSlotNum());
+  EXPECT_EQ(consumer->GetSlotSize(), producer->GetSlotSize());
+
+  producer.reset();
+  // name is removed by the creator, the mapping of the peer is still valid
+  EXPECT_EQ(ShmFrameRing::Open(name), nullptr);
+  EXPECT_NE(consumer->GetSlot(0), nullptr);
+}
+
+TEST(ModuleIPC, ShmFrameRingAcquireRelease) {
+  const std::string name = ShmFrameRing::GetName("test_shm_ring", 1);
+  auto producer = ShmFrameRing::Create(name, 3, 4096);
+  ASSERT_NE(producer, nullptr);
+  auto consumer = ShmFrameRing::Open(name);
+  ASSERT_NE(consumer, nullptr);
+
+  int slots[3];
+  for (int i = 0; i < 3; ++i) {
+    slots[i] = producer->Acquire();
+    ASSERT_GE(slots[i], 0);
+    memset(producer->GetSlot(slots[i]), i + 1, producer->GetSlotSize());
+  }
+  EXPECT_EQ(producer->Acquire(), -1);
+  EXPECT_EQ(producer->GetSlot(3), nullptr);
+
+  for (int i = 0; i < 3; ++i) {
+    uint8_t* data = consumer->GetSlot(slots[i]);
+    EXPECT_EQ(data[0], i + 1);
+    EXPECT_EQ(data[consumer->GetSlotSize() - 1], i + 1);
+  }
+
+  // released by the peer, slots come back in any order
+  consumer->Release(slots[1]);
+  EXPECT_EQ(producer->Acquire(), slots[1]);
+  EXPECT_EQ(producer->Acquire(), -1);
+  consumer->Release(slots[2]);
+  consumer->Release(slots[0]);
+  int a = producer->Acquire();
+  int b = producer->Acquire();
+  EXPECT_TRUE((a == slots[0] && b == slots[2]) || (a == slots[2] && b == slots[0]));
+  EXPECT_EQ(producer->Acquire(), -1);
+}
+
+}  // namespace cnstream
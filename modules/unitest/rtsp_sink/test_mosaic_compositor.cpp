@@ -0,0 +1,101 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "mosaic_compositor.hpp"
+
+namespace cnstream {
+
+static std::vector<cv::Rect> GridTiles(int cols, int rows, int win_w, int win_h) {
+  std::vector<cv::Rect> tiles;
+  for (int i = 0; i < cols * rows; ++i) {
+    tiles.emplace_back(i % cols * win_w, i / cols * win_h, win_w, win_h);
+  }
+  return tiles;
+}
+
+TEST(RtspSink, MosaicCompositorInit) {
+  MosaicCompositor compositor;
+  EXPECT_TRUE(compositor.Init(cv::Size(640, 480), GridTiles(2, 2, 320, 240)));
+  EXPECT_EQ(compositor.GetTileNum(), 4u);
+  EXPECT_FALSE(compositor.Init(cv::Size(640, 480), {cv::Rect(400, 0, 320, 240)}));
+  EXPECT_EQ(compositor.GetTileNum(), 0u);
+  EXPECT_FALSE(compositor.Update(0, cv::Mat::zeros(240, 320, CV_8UC3)));
+}
+
+TEST(RtspSink, MosaicCompositorCompose) {
+  MosaicCompositor compositor;
+  ASSERT_TRUE(compositor.Init(cv::Size(640, 480), GridTiles(2, 2, 320, 240)));
+  cv::Mat canvas;
+  EXPECT_EQ(compositor.Compose(&canvas), 0);
+  ASSERT_EQ(canvas.size(), cv::Size(640, 480));
+
+  cv::Mat image(720, 1280, CV_8UC3, cv::Scalar(10, 20, 30));
+  EXPECT_FALSE(compositor.Update(4, image));
+  EXPECT_FALSE(compositor.Update(0, cv::Mat::zeros(720, 1280, CV_8UC1)));
+  EXPECT_TRUE(compositor.Update(3, image));
+  EXPECT_EQ(compositor.Compose(&canvas), 1);
+  EXPECT_EQ(canvas.at<cv::Vec3b>(479, 639), cv::Vec3b(10, 20, 30));
+  EXPECT_EQ(canvas.at<cv::Vec3b>(0, 0), cv::Vec3b(0, 0, 0));
+  // nothing changed, canvas keeps the last composed tiles
+  EXPECT_EQ(compositor.Compose(&canvas), 0);
+  EXPECT_EQ(canvas.at<cv::Vec3b>(240, 320), cv::Vec3b(10, 20, 30));
+
+  // upscaling goes through the same path
+  EXPECT_TRUE(compositor.Update(0, cv::Mat(120, 160, CV_8UC3, cv::Scalar(1, 2, 3))));
+  EXPECT_EQ(compositor.Compose(&canvas), 1);
+  EXPECT_EQ(canvas.at<cv::Vec3b>(120, 160), cv::Vec3b(1, 2, 3));
+}
+
+TEST(RtspSink, MosaicCompositorConcurrent) {
+  MosaicCompositor compositor;
+  const int tile_num = 16;
+  ASSERT_TRUE(compositor.Init(cv::Size(640, 480), GridTiles(4, 4, 160, 120)));
+  std::atomic<bool> running{true};
+  std::vector<std::thread> producers;
+  for (int i = 0; i < tile_num; ++i) {
+    producers.emplace_back([&, i]() {
+      // every published tile is a solid color, so a torn tile would show up as mixed pixels
+      uchar value = 0;
+      while (running.load()) {
+        compositor.Update(i, cv::Mat(360, 640, CV_8UC3, cv::Scalar::all(value++)));
+      }
+    });
+  }
+  cv::Mat canvas;
+  for (int n = 0; n < 200; ++n) {
+    compositor.Compose(&canvas);
+    for (int i = 0; i < tile_num; ++i) {
+      cv::Mat tile = canvas(cv::Rect(i % 4 * 160, i / 4 * 120, 160, 120));
+      double min_val, max_val;
+      cv::minMaxLoc(tile.reshape(1), &min_val, &max_val);
+      EXPECT_EQ(min_val, max_val);
+    }
+  }
+  running.store(false);
+  for (auto &producer : producers) producer.join();
+}
+
+}  // namespace cnstream
@@ -127,6 +127,18 @@ TEST(Source, OpenClose) {
   param.clear();
   src->Close();
 
+  // scheduling attributes of the streams
+  param["output_type"] = "cpu";
+  param["decoder_type"] = "cpu";
+  param["priority"] = "3";
+  param["deadline_ms"] = "40";
+  EXPECT_TRUE(src->Open(param));
+  StreamQos qos = std::dynamic_pointer_cast<DataSource>(src)->GetDefaultQos();
+  EXPECT_EQ(qos.priority, 3u);
+  EXPECT_EQ(qos.deadline_ms, 40u);
+  param.clear();
+  src->Close();
+
   // DataSource module should not invoke Process()
   std::shared_ptr<CNFrameInfo> data = nullptr;
   EXPECT_FALSE(src->Process(data));
@@ -169,14 +181,15 @@ TEST(Source, AddSource) {
   auto handler_error = FileHandler::Create(src.get(), std::to_string(5), "", 24, false);
   EXPECT_EQ(handler_error, nullptr);
 
-  // filename valid, return 0
-  for (uint32_t i = 0; i < GetMaxStreamNumber(); i++) {
+  // filename valid, return 0, more streams than the former limit of 64
+  const uint32_t stream_num = 65;
+  for (uint32_t i = 0; i < stream_num; i++) {
     auto handler = FileHandler::Create(src.get(), std::to_string(i), video_path, 24, false);
     EXPECT_EQ(src->AddSource(handler), 0);
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
   }
-  // open source failed, return -1
-  auto handler = FileHandler::Create(src.get(), std::to_string(GetMaxStreamNumber()), video_path, 24, false);
+  // same stream id, return -1
+  auto handler = FileHandler::Create(src.get(), std::to_string(stream_num - 1), video_path, 24, false);
   EXPECT_EQ(src->AddSource(handler), -1);
 
   std::this_thread::sleep_for(std::chrono::milliseconds(500));
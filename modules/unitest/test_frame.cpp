@@ -18,6 +18,7 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <cstring>
 #include <ctime>
 #include <memory>
 #include <string>
@@ -35,6 +36,7 @@
 #include "cnrt.h"
 #include "cnstream_frame.hpp"
 #include "cnstream_frame_va.hpp"
+#include "cnstream_object_table.hpp"
 
 namespace cnstream {
 
@@ -263,6 +265,149 @@ TEST(CoreFrame, InferObjAddAndGetfeature) {
   EXPECT_EQ(infer_obj.GetFeature("feature2"), infer_feature2);
 }
 
+TEST(CoreFrame, ObjectTableAddAndGet) {
+  CNObjectTable table;
+  CNInferBoundingBox bbox = {0.1, 0.2, 0.3, 0.4};
+  EXPECT_EQ(table.Add(3, 0.9, bbox), 0u);
+  EXPECT_EQ(table.Add(5, 0.8, bbox, 7), 1u);
+  ASSERT_EQ(table.Size(), 2u);
+  EXPECT_EQ(table.Labels()[1], 5);
+  EXPECT_EQ(table.TrackId(0), CNObjectTable::kNoTrackId);
+  EXPECT_EQ(table.TrackIds()[1], 7);
+  EXPECT_FLOAT_EQ(table.BBoxes()[1].h, 0.4);
+
+  CNInferAttr value;
+  value.id = 1;
+  value.value = 2;
+  value.score = 0.5;
+  EXPECT_TRUE(table.AddAttribute(0, "color", value));
+  EXPECT_FALSE(table.AddAttribute(0, "color", value));
+  EXPECT_TRUE(table.AddAttribute(1, "color", value));
+  EXPECT_TRUE(table.AddAttribute(0, "type", value));
+  EXPECT_EQ(table.GetAttribute(0, "color").value, 2);
+  EXPECT_EQ(table.GetAttribute(0, "wrong_key").id, -1);
+  auto attributes = table.GetAttributes(0);
+  ASSERT_EQ(attributes.size(), 2u);
+  EXPECT_EQ(attributes[0].first, "color");
+  EXPECT_EQ(attributes[1].first, "type");
+
+  EXPECT_TRUE(table.AddExtraAttribute(1, "plate", "A12345"));
+  EXPECT_FALSE(table.AddExtraAttribute(1, "plate", "B12345"));
+  EXPECT_EQ(table.GetExtraAttribute(1, "plate"), "A12345");
+  EXPECT_EQ(table.GetExtraAttribute(0, "plate"), "");
+
+  CNInferFeature feature{1, 2, 3, 4, 5};
+  EXPECT_TRUE(table.AddFeature(1, "feature1", feature.data(), feature.size()));
+  EXPECT_FALSE(table.AddFeature(1, "feature1", feature.data(), feature.size()));
+  size_t size = 0;
+  const float* data = table.GetFeature(1, "feature1", &size);
+  ASSERT_EQ(size, feature.size());
+  EXPECT_EQ(CNInferFeature(data, data + size), feature);
+  EXPECT_EQ(table.GetFeature(0, "feature1", &size), nullptr);
+  EXPECT_EQ(size, 0u);
+
+  table.Clear();
+  EXPECT_TRUE(table.Empty());
+  table.Add(1, 0.5, bbox);
+  EXPECT_TRUE(table.GetAttributes(0).empty());
+  EXPECT_TRUE(table.GetFeatures(0).empty());
+}
+
+TEST(CoreFrame, ObjectTableConvertInferObjs) {
+  CNObjectTable table;
+  CNInferBoundingBox bbox = {0.1, 0.2, 0.3, 0.4};
+  table.Add(3, 0.9, bbox);
+  table.Add(5, 0.8, bbox, 7);
+  CNInferAttr value;
+  value.id = 1;
+  value.value = 2;
+  value.score = 0.5;
+  table.AddAttribute(1, "color", value);
+  table.AddExtraAttribute(1, "plate", "A12345");
+  CNInferFeature feature{1, 2, 3};
+  table.AddFeature(1, "feature1", feature.data(), feature.size());
+
+  CNInferObjs objs;
+  table.ToInferObjs(&objs);
+  ASSERT_EQ(objs.objs_.size(), 2u);
+  EXPECT_EQ(objs.objs_[0]->id, "3");
+  EXPECT_EQ(objs.objs_[0]->track_id, "");
+  EXPECT_EQ(objs.objs_[1]->track_id, "7");
+  EXPECT_FLOAT_EQ(objs.objs_[1]->score, 0.8);
+  EXPECT_EQ(objs.objs_[1]->GetAttribute("color").value, 2);
+  EXPECT_EQ(objs.objs_[1]->GetExtraAttribute("plate"), "A12345");
+  EXPECT_EQ(objs.objs_[1]->GetFeature("feature1"), feature);
+
+  objs.objs_[0]->id = "person";
+  CNObjectTable converted;
+  converted.FromInferObjs(&objs);
+  ASSERT_EQ(converted.Size(), 2u);
+  EXPECT_EQ(converted.Label(0), -1);
+  EXPECT_EQ(converted.Label(1), 5);
+  EXPECT_EQ(converted.TrackId(0), CNObjectTable::kNoTrackId);
+  EXPECT_EQ(converted.TrackId(1), 7);
+  EXPECT_FLOAT_EQ(converted.BBox(1).x, 0.1);
+  EXPECT_EQ(converted.GetAttribute(1, "color").id, 1);
+  EXPECT_EQ(converted.GetExtraAttribute(1, "plate"), "A12345");
+  EXPECT_EQ(converted.GetFeatures(1).size(), 1u);
+}
+
+static std::shared_ptr<CNDataFrame> CreateNV12Frame() {
+  auto frame = std::make_shared<CNDataFrame>();
+  frame->ctx.dev_type = DevContext::CPU;
+  frame->fmt = CN_PIXEL_FORMAT_YUV420_NV12;
+  frame->width = 4;
+  frame->height = 2;
+  frame->stride[0] = frame->stride[1] = 4;
+  for (int i = 0; i < frame->GetPlanes(); ++i) {
+    frame->data[i].reset(new CNSyncedMemory(frame->GetPlaneBytes(i)));
+    memset(frame->data[i]->GetMutableCpuData(), i + 1, frame->GetPlaneBytes(i));
+  }
+  return frame;
+}
+
+TEST(CoreFrame, ForkDataFrameCopyOnWrite) {
+  auto frame = CreateNV12Frame();
+  auto fork = CNDataFrame::Fork(frame);
+  EXPECT_EQ(fork->fmt, frame->fmt);
+  EXPECT_EQ(fork->GetBytes(), frame->GetBytes());
+  EXPECT_EQ(fork->data[0], frame->data[0]);
+  EXPECT_EQ(fork->data[1], frame->data[1]);
+  EXPECT_EQ(nullptr, fork->MutablePlane(2));
+
+  // only the written plane is copied
+  uint8_t* y = static_cast<uint8_t*>(fork->MutablePlane(0)->GetMutableCpuData());
+  EXPECT_NE(fork->data[0], frame->data[0]);
+  EXPECT_EQ(fork->data[1], frame->data[1]);
+  EXPECT_EQ(1, y[0]);
+  y[0] = 9;
+  EXPECT_EQ(1, static_cast<const uint8_t*>(frame->data[0]->GetCpuData())[0]);
+  // and only once
+  EXPECT_EQ(fork->data[0].get(), fork->MutablePlane(0));
+
+  // the original frame is held only by the fork, its planes are not shared anymore
+  CNSyncedMemory* uv = fork->data[1].get();
+  frame.reset();
+  EXPECT_EQ(uv, fork->MutablePlane(1));
+}
+
+TEST(CoreFrame, GetMutableDataFrame) {
+  auto finfo = CNFrameInfo::Create("mutable_frame");
+  finfo->datas[CNDataFramePtrKey] = CreateNV12Frame();
+  CNDataFrame* frame = GetCNDataFramePtr(finfo).get();
+  // not shared
+  EXPECT_EQ(frame, GetMutableCNDataFramePtr(finfo).get());
+
+  // shared with the frame of another branch
+  auto other = CNFrameInfo::Create("mutable_frame");
+  other->datas[CNDataFramePtrKey] = finfo->datas[CNDataFramePtrKey];
+  CNDataFramePtr fork = GetMutableCNDataFramePtr(finfo);
+  EXPECT_NE(frame, fork.get());
+  EXPECT_EQ(fork, GetCNDataFramePtr(finfo));
+  EXPECT_EQ(frame, GetCNDataFramePtr(other).get());
+  EXPECT_EQ(fork->data[0], GetCNDataFramePtr(other)->data[0]);
+}
+
 TEST(CoreFrame, SetAndGetFlowDepth) {
   int flow_depth = 32;
   SetFlowDepth(flow_depth);
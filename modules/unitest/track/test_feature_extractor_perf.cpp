@@ -0,0 +1,119 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/features2d/features2d.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "cnstream_frame_va.hpp"
+#include "feature_extractor.hpp"
+
+namespace cnstream {
+
+// what the CPU path did before: convert the whole frame to BGR, then build an ORB detector for each object
+static void ExtractOnFullFrame(CNDataFrame *frame, const CNInferObjsPtr &objs_holder,
+                               std::vector<std::vector<float>> *features) {
+  cv::Mat yuv(frame->height * 3 / 2, frame->width, CV_8UC1);
+  memcpy(yuv.data, frame->data[0]->GetCpuData(), frame->GetPlaneBytes(0));
+  memcpy(yuv.data + frame->GetPlaneBytes(0), frame->data[1]->GetCpuData(), frame->GetPlaneBytes(1));
+  cv::Mat image;
+  cv::cvtColor(yuv, image, cv::COLOR_YUV2BGR_NV12);
+  features->clear();
+  for (auto &obj : objs_holder->objs_) {
+    cv::Rect rect(obj->bbox.x * image.cols, obj->bbox.y * image.rows, obj->bbox.w * image.cols,
+                  obj->bbox.h * image.rows);
+    cv::Mat obj_img(image, rect);
+#if (CV_MAJOR_VERSION == 2)  // NOLINT
+    cv::Ptr<cv::ORB> processer = new cv::ORB(128);
+#elif (CV_MAJOR_VERSION >= 3)  //  NOLINT
+    cv::Ptr<cv::ORB> processer = cv::ORB::create(128);
+#endif
+    std::vector<cv::KeyPoint> keypoints;
+    cv::Mat desc;
+    processer->detect(obj_img, keypoints);
+    processer->compute(obj_img, keypoints, desc);
+    features->emplace_back(128, desc.rows > 0 ? 1.f : 0.f);
+  }
+}
+
+TEST(TrackerPerf, FeatureExtractorOnCpu) {
+  const int width = 1920, height = 1080, obj_num = 32, frame_num = 20;
+  cv::Mat img(height * 3 / 2, width, CV_8UC1);
+  cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+  cv::GaussianBlur(img, img, cv::Size(5, 5), 2);  // give ORB some corners, not only noise
+
+  std::shared_ptr<CNDataFrame> frame(new CNDataFrame());
+  frame->width = width;
+  frame->height = height;
+  frame->ptr_cpu[0] = img.data;
+  frame->ptr_cpu[1] = img.data + width * height;
+  frame->stride[0] = frame->stride[1] = width;
+  frame->ctx.dev_type = DevContext::DevType::CPU;
+  frame->fmt = CN_PIXEL_FORMAT_YUV420_NV12;
+  frame->CopyToSyncMem(false);
+
+  std::mt19937 gen(2020);
+  std::uniform_real_distribution<float> pos(0.f, 0.8f), size(0.05f, 0.2f);
+  CNInferObjsPtr objs_holder = std::make_shared<CNInferObjs>();
+  for (int i = 0; i < obj_num; ++i) {
+    auto obj = std::make_shared<CNInferObject>();
+    obj->id = "0";
+    obj->bbox = {pos(gen), pos(gen), size(gen), size(gen)};
+    objs_holder->objs_.push_back(obj);
+  }
+
+  FeatureExtractor extractor;
+  std::vector<std::vector<float>> features;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < frame_num; ++i) ExtractOnFullFrame(frame.get(), objs_holder, &features);
+  std::chrono::duration<double, std::milli> full_frame = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < frame_num; ++i) extractor.ExtractFeature(frame.get(), objs_holder, &features);
+  std::chrono::duration<double, std::milli> roi = std::chrono::steady_clock::now() - start;
+
+  ASSERT_EQ(features.size(), static_cast<size_t>(obj_num));
+  int featured = 0;
+  for (auto &feature : features) {
+    ASSERT_EQ(feature.size(), 128u);
+    for (auto &v : feature) {
+      if (v != 0) {
+        ++featured;
+        break;
+      }
+    }
+  }
+  EXPECT_GT(featured, 0);
+  EXPECT_FALSE(frame->HasBGRImage());
+  std::cout << "[TrackerPerf] feature extractor, " << obj_num << " objects: full frame BGR "
+            << obj_num * frame_num * 1000 / full_frame.count() << " objects/s, ROI "
+            << obj_num * frame_num * 1000 / roi.count() << " objects/s" << std::endl;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,152 @@
+/*************************************************************************
+ * Copyright (C) [2019] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "easytrack/easy_track.h"
+
+namespace cnstream {
+
+/*
+ * A crowded scene for FeatureMatchTrack: every object moves at a constant speed and keeps a stable appearance
+ * feature with a little noise on every frame.
+ */
+class CrowdScene {
+ public:
+  CrowdScene(int object_num, int feature_dim, unsigned seed) : gen_(seed), objects_(object_num) {
+    std::uniform_real_distribution<float> pos(0.f, 1.f), speed(-0.002f, 0.002f), size(0.02f, 0.06f);
+    std::normal_distribution<float> feat(0.f, 1.f);
+    for (auto &obj : objects_) {
+      obj.bbox = {pos(gen_), pos(gen_), size(gen_), size(gen_) * 2};
+      obj.vx = speed(gen_);
+      obj.vy = speed(gen_);
+      obj.feature.resize(feature_dim);
+      float norm = 0;
+      for (auto &v : obj.feature) {
+        v = feat(gen_);
+        norm += v * v;
+      }
+      for (auto &v : obj.feature) v /= std::sqrt(norm);
+    }
+  }
+
+  edk::Objects NextFrame() {
+    std::normal_distribution<float> noise(0.f, 0.01f);
+    edk::Objects detects;
+    detects.reserve(objects_.size());
+    for (auto &obj : objects_) {
+      obj.bbox.x += obj.vx;
+      obj.bbox.y += obj.vy;
+      edk::DetectObject det;
+      det.label = 0;
+      det.score = 0.9f;
+      det.bbox = obj.bbox;
+      det.track_id = -1;
+      det.detect_id = 0;
+      det.feature = obj.feature;
+      for (auto &v : det.feature) v += noise(gen_);
+      detects.push_back(std::move(det));
+    }
+    return detects;
+  }
+
+ private:
+  struct Object {
+    edk::BoundingBox bbox;
+    float vx, vy;
+    std::vector<float> feature;
+  };
+  std::mt19937 gen_;
+  std::vector<Object> objects_;
+};
+
+/*
+ * Returns the average time of a frame, and the final track id of every object in last_ids.
+ */
+static double RunCrowd(const char *name, int object_num, int feature_dim, int nn_budget, int frame_num,
+                       edk::AssignmentSolver solver = edk::AssignmentSolver::HUNGARIAN,
+                       std::vector<int> *last_ids = nullptr) {
+  CrowdScene scene(object_num, feature_dim, 2020);
+  edk::FeatureMatchTrack tracker;
+  tracker.SetParams(0.2f, nn_budget, 0.7f, 30, 3);
+  tracker.SetAssignmentSolver(solver);
+  edk::TrackFrame frame;
+  frame.data = nullptr;
+  frame.width = 1920;
+  frame.height = 1080;
+  frame.device_id = 0;
+  frame.format = edk::TrackFrame::ColorSpace::NV12;
+  frame.dev_type = edk::TrackFrame::DevType::CPU;
+
+  // warm up until all tracks are confirmed and matched by features
+  for (int i = 0; i < 10; ++i) {
+    frame.frame_id = i;
+    edk::Objects tracks;
+    tracker.UpdateFrame(frame, scene.NextFrame(), &tracks);
+  }
+  double total_ms = 0;
+  std::set<int> ids;
+  for (int i = 0; i < frame_num; ++i) {
+    frame.frame_id = 10 + i;
+    edk::Objects detects = scene.NextFrame();
+    edk::Objects tracks;
+    auto start = std::chrono::steady_clock::now();
+    tracker.UpdateFrame(frame, detects, &tracks);
+    total_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(tracks.size(), detects.size());
+    if (i == frame_num - 1) {
+      if (last_ids) last_ids->assign(object_num, -1);
+      for (auto &obj : tracks) {
+        ids.insert(obj.track_id);
+        if (last_ids) (*last_ids)[obj.detect_id] = obj.track_id;
+      }
+    }
+  }
+  // every object keeps its own track
+  EXPECT_EQ(ids.size(), static_cast<size_t>(object_num));
+  EXPECT_EQ(ids.count(-1), 0u);
+  std::cout << "[TrackerPerf] " << name << ", " << object_num << " tracks x " << object_num
+            << " detections: " << total_ms / frame_num << " ms/frame" << std::endl;
+  return total_ms / frame_num;
+}
+
+// small features and one feature per track, so the time goes to Kalman filtering and gating
+TEST(TrackerPerf, FeatureMatchCrowdMotion) { RunCrowd("motion", 200, 8, 1, 100); }
+
+// deep features with a long feature history
+TEST(TrackerPerf, FeatureMatchCrowdAppearance) { RunCrowd("appearance", 200, 128, 100, 20); }
+
+// gating leaves a few candidates for every track, the sparse solver splits the problem into small components
+TEST(TrackerPerf, FeatureMatchSparseAssignment) {
+  std::vector<int> hungarian_ids, sparse_ids;
+  double hungarian_ms = RunCrowd("motion, hungarian", 400, 8, 1, 50, edk::AssignmentSolver::HUNGARIAN, &hungarian_ids);
+  double sparse_ms = RunCrowd("motion, sparse", 400, 8, 1, 50, edk::AssignmentSolver::SPARSE, &sparse_ids);
+  EXPECT_EQ(hungarian_ids, sparse_ids);
+  std::cout << "[TrackerPerf] sparse assignment speedup: " << hungarian_ms / sparse_ms << "x" << std::endl;
+}
+
+}  // namespace cnstream
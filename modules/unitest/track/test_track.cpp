@@ -85,6 +85,12 @@ TEST(Tracker, CheckParamSet) {
 
   param["max_cosine_distance"] = std::to_string(g_max_cosine_distance);
   EXPECT_TRUE(track->CheckParamSet(param));
+
+  param["assignment_solver"] = "fake_solver";
+  EXPECT_FALSE(track->CheckParamSet(param));
+
+  param["assignment_solver"] = "Sparse";
+  EXPECT_TRUE(track->CheckParamSet(param));
 }
 
 TEST(Tracker, OpenClose) {
@@ -273,6 +279,26 @@ TEST(Tracker, ProcessFeatureMatchCPU0) {
   EXPECT_EQ(track->Process(data), 0);
 }
 
+TEST(Tracker, EvictContexts) {
+  std::shared_ptr<Tracker> track = std::make_shared<Tracker>(gname);
+  ModuleParamSet param;
+  param["track_name"] = "FeatureMatch";
+  ASSERT_TRUE(track->Open(param));
+  auto data = GenTestData(0, 3);
+  EXPECT_EQ(track->Process(data), 0);
+  EXPECT_EQ(track->EvictIdleContexts(60 * 1000), 0u);
+  EXPECT_EQ(track->EvictIdleContexts(0), 1u);
+  EXPECT_EQ(track->EvictIdleContexts(0), 0u);
+
+  // a stream gets a new context after eviction, and loses it at EOS
+  EXPECT_EQ(track->Process(data), 0);
+  track->OnEos("another_stream");
+  EXPECT_EQ(track->EvictIdleContexts(60 * 1000), 0u);
+  track->OnEos(data->stream_id);
+  EXPECT_EQ(track->EvictIdleContexts(0), 0u);
+  track->Close();
+}
+
 TEST(Tracker, ProcessFeatureMatchCPU1) {
   // create track
   std::shared_ptr<Module> track = std::make_shared<Tracker>(gname);
@@ -0,0 +1,133 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_CONTRIB_COUNTING_SINK_HPP_
+#define MODULES_CONTRIB_COUNTING_SINK_HPP_
+
+/**
+ *  \file counting_sink.hpp
+ *
+ *  This file contains a declaration of CountingSink, a sink module counting frames and their latency.
+ */
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cnstream_module.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief Latency histogram with logarithmic buckets, 16 per power of two, so percentiles are within about 3%.
+ */
+class LatencyHistogram {
+ public:
+  void Add(uint64_t value);
+  void Merge(const LatencyHistogram& other);
+  uint64_t Count() const { return count_; }
+  uint64_t Max() const { return max_; }
+  double Mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0; }
+  /**
+   * @brief Gets the value below which a fraction q of the values fall, q in [0, 1].
+   */
+  uint64_t Percentile(double q) const;
+
+ private:
+  static constexpr int kSubBits = 4;
+  static constexpr int kSubBuckets = 1 << kSubBits;
+  // values below kSubBuckets have buckets of their own, then each power of two has kSubBuckets buckets
+  static constexpr int kBucketNum = (64 - kSubBits + 1) * kSubBuckets;
+  static int Bucket(uint64_t value);
+  static uint64_t BucketMid(int bucket);
+
+  std::array<uint64_t, kBucketNum> buckets_{};
+  uint64_t count_ = 0;
+  uint64_t sum_ = 0;
+  uint64_t max_ = 0;
+};  // class LatencyHistogram
+
+/**
+ * @brief Frames and latency of a stream received by CountingSink. Latencies are in milliseconds.
+ */
+struct CountingSinkStats {
+  uint64_t frame_count = 0;
+  double fps = 0;  ///< Frames per second, between the first and the last frame.
+  double latency_mean = 0;
+  double latency_p50 = 0;
+  double latency_p90 = 0;
+  double latency_p99 = 0;
+  double latency_max = 0;
+};
+
+/**
+ * @brief CountingSink is a sink module counting frames of each stream and their end-to-end latency.
+ *
+ * The latency of a frame is the time it reaches the sink minus its pts, so it is valid only if the pts is the time
+ * the frame is generated, in microseconds of TimeStamp::Current(), as SyntheticSource does. Statistics of a stream
+ * are logged when its eos arrives and when the module is closed.
+ */
+class CountingSink : public Module, public ModuleCreator<CountingSink> {
+ public:
+  explicit CountingSink(const std::string& name);
+
+  bool Open(ModuleParamSet paramSet) override;
+  void Close() override;
+  int Process(std::shared_ptr<CNFrameInfo> data) override;
+  void OnEos(const std::string& stream_id) override;
+  bool CheckParamSet(const ModuleParamSet& paramSet) const override;
+
+  /**
+   * @brief Gets the statistics of a stream, all zero if no frame of it has arrived.
+   */
+  CountingSinkStats GetStats(const std::string& stream_id);
+  /**
+   * @brief Gets the statistics of all streams together.
+   */
+  CountingSinkStats GetTotalStats();
+  std::vector<std::string> GetStreamIds();
+  /**
+   * @brief Forgets all streams.
+   */
+  void Reset();
+
+ private:
+  struct StreamRecord {
+    std::mutex mutex;
+    LatencyHistogram latency;  ///< In microseconds, of the frames with a valid pts.
+    uint64_t frame_count = 0;
+    uint64_t first_time = 0;
+    uint64_t last_time = 0;
+  };
+  std::shared_ptr<StreamRecord> GetRecord(const std::string& stream_id, bool create);
+  static CountingSinkStats MakeStats(const LatencyHistogram& latency, uint64_t frame_count, uint64_t first_time,
+                                     uint64_t last_time);
+  void LogStats(const std::string& stream_id, const CountingSinkStats& stats);
+
+  std::mutex records_mutex_;
+  std::unordered_map<std::string, std::shared_ptr<StreamRecord>> records_;
+};  // class CountingSink
+
+}  // namespace cnstream
+
+#endif  // MODULES_CONTRIB_COUNTING_SINK_HPP_
@@ -0,0 +1,177 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "counting_sink.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cnstream_frame.hpp"
+#include "util/cnstream_time_utility.hpp"
+
+namespace cnstream {
+
+constexpr int LatencyHistogram::kSubBits;
+constexpr int LatencyHistogram::kSubBuckets;
+constexpr int LatencyHistogram::kBucketNum;
+
+int LatencyHistogram::Bucket(uint64_t value) {
+  if (value < kSubBuckets) return static_cast<int>(value);
+  int exp = 63 - __builtin_clzll(value);
+  int sub = static_cast<int>(value >> (exp - kSubBits)) & (kSubBuckets - 1);
+  return (exp - kSubBits + 1) * kSubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::BucketMid(int bucket) {
+  if (bucket < kSubBuckets) return bucket;
+  int shift = bucket / kSubBuckets - 1;
+  uint64_t lower = static_cast<uint64_t>(kSubBuckets + bucket % kSubBuckets) << shift;
+  return lower + ((1ULL << shift) >> 1);
+}
+
+void LatencyHistogram::Add(uint64_t value) {
+  ++buckets_[Bucket(value)];
+  ++count_;
+  sum_ += value;
+  max_ = std::max(max_, value);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  for (int i = 0; i < kBucketNum; ++i) buckets_[i] += other.buckets_[i];
+  count_ += other.count_;
+  sum_ += other.sum_;
+  max_ = std::max(max_, other.max_);
+}
+
+uint64_t LatencyHistogram::Percentile(double q) const {
+  if (!count_) return 0;
+  uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * count_)));
+  if (target >= count_) return max_;
+  uint64_t seen = 0;
+  for (int i = 0; i < kBucketNum; ++i) {
+    seen += buckets_[i];
+    if (seen >= target) return std::min(BucketMid(i), max_);
+  }
+  return max_;
+}
+
+CountingSink::CountingSink(const std::string& name) : Module(name) {
+  param_register_.SetModuleDesc("CountingSink is a module counting frames of each stream and their latency.");
+}
+
+bool CountingSink::Open(ModuleParamSet paramSet) { return true; }
+
+void CountingSink::Close() {
+  for (const auto& stream_id : GetStreamIds()) LogStats(stream_id, GetStats(stream_id));
+}
+
+int CountingSink::Process(std::shared_ptr<CNFrameInfo> data) {
+  uint64_t now = TimeStamp::Current();
+  std::shared_ptr<StreamRecord> record = GetRecord(data->stream_id, true);
+  std::lock_guard<std::mutex> lk(record->mutex);
+  if (data->timestamp >= 0 && now >= static_cast<uint64_t>(data->timestamp)) {
+    record->latency.Add(now - data->timestamp);
+  }
+  ++record->frame_count;
+  if (!record->first_time) record->first_time = now;
+  record->last_time = now;
+  return 0;
+}
+
+void CountingSink::OnEos(const std::string& stream_id) { LogStats(stream_id, GetStats(stream_id)); }
+
+bool CountingSink::CheckParamSet(const ModuleParamSet& paramSet) const {
+  for (auto& it : paramSet) {
+    if (!param_register_.IsRegisted(it.first)) {
+      LOGW(COUNTINGSINK) << "[CountingSink] Unknown param: " << it.first;
+    }
+  }
+  return true;
+}
+
+std::shared_ptr<CountingSink::StreamRecord> CountingSink::GetRecord(const std::string& stream_id, bool create) {
+  std::lock_guard<std::mutex> lk(records_mutex_);
+  auto iter = records_.find(stream_id);
+  if (iter != records_.end()) return iter->second;
+  if (!create) return nullptr;
+  std::shared_ptr<StreamRecord> record = std::make_shared<StreamRecord>();
+  records_.emplace(stream_id, record);
+  return record;
+}
+
+CountingSinkStats CountingSink::MakeStats(const LatencyHistogram& latency, uint64_t frame_count, uint64_t first_time,
+                                          uint64_t last_time) {
+  CountingSinkStats stats;
+  stats.frame_count = frame_count;
+  if (last_time > first_time && stats.frame_count > 1) {
+    stats.fps = (stats.frame_count - 1) * 1e6 / (last_time - first_time);
+  }
+  stats.latency_mean = latency.Mean() / 1e3;
+  stats.latency_p50 = latency.Percentile(0.5) / 1e3;
+  stats.latency_p90 = latency.Percentile(0.9) / 1e3;
+  stats.latency_p99 = latency.Percentile(0.99) / 1e3;
+  stats.latency_max = latency.Max() / 1e3;
+  return stats;
+}
+
+CountingSinkStats CountingSink::GetStats(const std::string& stream_id) {
+  std::shared_ptr<StreamRecord> record = GetRecord(stream_id, false);
+  if (!record) return CountingSinkStats();
+  std::lock_guard<std::mutex> lk(record->mutex);
+  return MakeStats(record->latency, record->frame_count, record->first_time, record->last_time);
+}
+
+CountingSinkStats CountingSink::GetTotalStats() {
+  LatencyHistogram latency;
+  uint64_t frame_count = 0, first_time = 0, last_time = 0;
+  std::lock_guard<std::mutex> lk(records_mutex_);
+  for (auto& it : records_) {
+    std::lock_guard<std::mutex> record_lk(it.second->mutex);
+    latency.Merge(it.second->latency);
+    frame_count += it.second->frame_count;
+    if (!first_time || it.second->first_time < first_time) first_time = it.second->first_time;
+    last_time = std::max(last_time, it.second->last_time);
+  }
+  return MakeStats(latency, frame_count, first_time, last_time);
+}
+
+std::vector<std::string> CountingSink::GetStreamIds() {
+  std::vector<std::string> stream_ids;
+  std::lock_guard<std::mutex> lk(records_mutex_);
+  for (auto& it : records_) stream_ids.push_back(it.first);
+  return stream_ids;
+}
+
+void CountingSink::Reset() {
+  std::lock_guard<std::mutex> lk(records_mutex_);
+  records_.clear();
+}
+
+void CountingSink::LogStats(const std::string& stream_id, const CountingSinkStats& stats) {
+  LOGI(COUNTINGSINK) << "[" << GetName() << "] stream_id: " << stream_id << ", frames: " << stats.frame_count
+                     << ", fps: " << stats.fps << ", latency(ms) mean: " << stats.latency_mean
+                     << ", p50: " << stats.latency_p50 << ", p90: " << stats.latency_p90
+                     << ", p99: " << stats.latency_p99 << ", max: " << stats.latency_max;
+}
+
+}  // namespace cnstream
@@ -0,0 +1,79 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+#include "counting_sink.hpp"
+#include "util/cnstream_time_utility.hpp"
+
+namespace cnstream {
+
+TEST(CountingSink, LatencyHistogram) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(histogram.Percentile(0.5), 0u);
+  for (uint64_t i = 1; i <= 10000; ++i) histogram.Add(i);
+  EXPECT_EQ(histogram.Count(), 10000u);
+  EXPECT_EQ(histogram.Max(), 10000u);
+  EXPECT_DOUBLE_EQ(histogram.Mean(), 5000.5);
+  EXPECT_NEAR(histogram.Percentile(0.5), 5000, 5000 * 0.035);
+  EXPECT_NEAR(histogram.Percentile(0.99), 9900, 9900 * 0.035);
+  EXPECT_EQ(histogram.Percentile(1), 10000u);
+
+  LatencyHistogram small;
+  for (uint64_t i = 0; i < 16; ++i) small.Add(i);
+  EXPECT_EQ(small.Percentile(0.5), 7u);
+  small.Merge(histogram);
+  EXPECT_EQ(small.Count(), 10016u);
+  EXPECT_EQ(small.Max(), 10000u);
+}
+
+TEST(CountingSink, Process) {
+  std::shared_ptr<CountingSink> sink = std::make_shared<CountingSink>("counting_sink");
+  ModuleParamSet param;
+  EXPECT_TRUE(sink->Open(param));
+  for (int i = 0; i < 10; ++i) {
+    auto data = CNFrameInfo::Create("0");
+    data->timestamp = TimeStamp::Current() - 20000;
+    EXPECT_EQ(sink->Process(data), 0);
+  }
+  // frames without a valid pts are counted, but not in the latency
+  auto data = CNFrameInfo::Create("1");
+  EXPECT_EQ(sink->Process(data), 0);
+
+  CountingSinkStats stats = sink->GetStats("0");
+  EXPECT_EQ(stats.frame_count, 10u);
+  EXPECT_GE(stats.latency_p50, 20 * 0.97);
+  EXPECT_GE(stats.latency_max, 20);
+  EXPECT_LE(stats.latency_p50, stats.latency_max);
+  EXPECT_EQ(sink->GetStats("1").frame_count, 1u);
+  EXPECT_EQ(sink->GetStats("1").latency_max, 0);
+  EXPECT_EQ(sink->GetStats("2").frame_count, 0u);
+  EXPECT_EQ(sink->GetTotalStats().frame_count, 11u);
+  EXPECT_EQ(sink->GetStreamIds().size(), 2u);
+
+  sink->Reset();
+  EXPECT_EQ(sink->GetTotalStats().frame_count, 0u);
+  sink->Close();
+}
+
+}  // namespace cnstream
@@ -0,0 +1,143 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef MODULES_CONTRIB_SYNTHETIC_SOURCE_HPP_
+#define MODULES_CONTRIB_SYNTHETIC_SOURCE_HPP_
+
+/**
+ *  \file synthetic_source.hpp
+ *
+ *  This file contains a declaration of SyntheticSource, a source module generating frames without decoding.
+ */
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "cnstream_frame_va.hpp"
+#include "cnstream_source.hpp"
+
+namespace cnstream {
+
+/**
+ * @brief Parameters of the frames generated by SyntheticSource.
+ */
+struct SyntheticSourceParam {
+  int width = 1920;
+  int height = 1080;
+  CNDataFormat fmt = CN_PIXEL_FORMAT_YUV420_NV12;  ///< NV12 or BGR24.
+  double fps = 25;                                 ///< Frames per second of each stream, unthrottled if not positive.
+  uint64_t frame_num = 0;                          ///< Frames of each stream before eos, endless if 0.
+  uint32_t object_num = 0;                         ///< Objects attached to each frame.
+};
+
+/**
+ * @brief SyntheticSource is a source module generating frames at a controlled rate, for load testing pipelines.
+ *
+ * Each stream is a SyntheticHandler sending frames from its own thread. Pixels are allocated once per stream and
+ * shared by all its frames, so the cost of a frame is the framework cost alone. The pts of a frame is the time it is
+ * generated, in microseconds of TimeStamp::Current(), so that sinks can measure the end-to-end latency, see
+ * CountingSink.
+ *
+ * @note Frames of a stream share pixels, modules writing to them see the writes of each other.
+ */
+class SyntheticSource : public SourceModule, public ModuleCreator<SyntheticSource> {
+ public:
+  explicit SyntheticSource(const std::string& name);
+  ~SyntheticSource();
+
+  /**
+   * @brief Called by pipeline when the pipeline is started.
+   *
+   * @param paramSet
+   * @verbatim
+   *   width: Optional. The width of frames, 1920 by default.
+   *   height: Optional. The height of frames, 1080 by default.
+   *   pixel_format: Optional. ``nv12`` or ``bgr24``, nv12 by default.
+   *   fps: Optional. Frames per second of each stream, 25 by default. Frames are sent as fast as possible if it is 0.
+   *   frame_num: Optional. Frames of each stream before eos. Streams are endless by default.
+   *   object_num: Optional. Objects attached to each frame, 0 by default.
+   * @endverbatim
+   *
+   * @return Returns true if the parameters are valid.
+   */
+  bool Open(ModuleParamSet paramSet) override;
+  void Close() override;
+  bool CheckParamSet(const ModuleParamSet& paramSet) const override;
+
+  SyntheticSourceParam GetSourceParam() const { return param_; }
+
+  /**
+   * @brief Adds stream_num streams, named by stream_prefix and the index of the stream.
+   *
+   * @return Returns the number of streams added.
+   *
+   * @note Calls this function after the pipeline starts.
+   */
+  uint32_t AddStreams(uint32_t stream_num, const std::string& stream_prefix = "synthetic_");
+
+ private:
+  SyntheticSourceParam param_;
+};  // class SyntheticSource
+
+/**
+ * @brief Source handler generating the frames of one stream.
+ */
+class SyntheticHandler : public SourceHandler {
+ public:
+  /**
+   * @brief Creates source handler.
+   *
+   * @param module The synthetic source module.
+   * @param stream_id The stream id of the stream.
+   *
+   * @return Returns source handler if it is created successfully, otherwise returns nullptr.
+   */
+  static std::shared_ptr<SourceHandler> Create(SyntheticSource* module, const std::string& stream_id);
+  ~SyntheticHandler();
+
+  /**
+   * @brief Allocates the pixels and starts sending frames.
+   */
+  bool Open() override;
+  /**
+   * @brief Stops sending frames and sends eos.
+   */
+  void Close() override;
+
+ private:
+  SyntheticHandler(SyntheticSource* module, const std::string& stream_id) : SourceHandler(module, stream_id) {}
+
+#ifdef UNIT_TEST
+ public:  // NOLINT
+#endif
+  std::shared_ptr<CNFrameInfo> MakeFrame(uint64_t frame_id, int64_t pts);
+  void Loop();
+
+  SyntheticSourceParam param_;
+  std::shared_ptr<void> pixels_ = nullptr;
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+};  // class SyntheticHandler
+
+}  // namespace cnstream
+
+#endif  // MODULES_CONTRIB_SYNTHETIC_SOURCE_HPP_
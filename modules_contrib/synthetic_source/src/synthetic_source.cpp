@@ -0,0 +1,210 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "synthetic_source.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "cnstream_allocator.hpp"
+#include "util/cnstream_time_utility.hpp"
+
+namespace cnstream {
+
+SyntheticSource::SyntheticSource(const std::string& name) : SourceModule(name) {
+  param_register_.SetModuleDesc("SyntheticSource is a module generating frames without decoding, for load testing.");
+  param_register_.Register("width", "The width of frames, 1920 by default.");
+  param_register_.Register("height", "The height of frames, 1080 by default.");
+  param_register_.Register("pixel_format", "nv12 or bgr24, nv12 by default.");
+  param_register_.Register("fps", "Frames per second of each stream, 25 by default. 0 means unthrottled.");
+  param_register_.Register("frame_num", "Frames of each stream before eos. Streams are endless by default.");
+  param_register_.Register("object_num", "Objects attached to each frame, 0 by default.");
+}
+
+SyntheticSource::~SyntheticSource() { Close(); }
+
+bool SyntheticSource::Open(ModuleParamSet paramSet) {
+  if (!CheckParamSet(paramSet)) return false;
+  param_ = SyntheticSourceParam();
+  if (paramSet.find("width") != paramSet.end()) param_.width = std::stoi(paramSet["width"]);
+  if (paramSet.find("height") != paramSet.end()) param_.height = std::stoi(paramSet["height"]);
+  if (paramSet.find("pixel_format") != paramSet.end() && paramSet["pixel_format"] == "bgr24") {
+    param_.fmt = CN_PIXEL_FORMAT_BGR24;
+  }
+  if (paramSet.find("fps") != paramSet.end()) param_.fps = std::stod(paramSet["fps"]);
+  if (paramSet.find("frame_num") != paramSet.end()) param_.frame_num = std::stoull(paramSet["frame_num"]);
+  if (paramSet.find("object_num") != paramSet.end()) param_.object_num = std::stoul(paramSet["object_num"]);
+  return true;
+}
+
+void SyntheticSource::Close() { RemoveSources(); }
+
+bool SyntheticSource::CheckParamSet(const ModuleParamSet& paramSet) const {
+  ParametersChecker checker;
+  for (auto& it : paramSet) {
+    if (!param_register_.IsRegisted(it.first)) {
+      LOGW(SOURCE) << "[SyntheticSource] Unknown param: " << it.first;
+    }
+  }
+  std::string err_msg;
+  if (!checker.IsNum({"width", "height", "fps", "frame_num", "object_num"}, paramSet, err_msg, true)) {
+    LOGE(SOURCE) << "[SyntheticSource] " << err_msg;
+    return false;
+  }
+  for (const std::string key : {"width", "height"}) {
+    auto iter = paramSet.find(key);
+    if (iter != paramSet.end() && (std::stoi(iter->second) <= 0 || std::stoi(iter->second) % 2 != 0)) {
+      LOGE(SOURCE) << "[SyntheticSource] " << key << " should be a positive even number.";
+      return false;
+    }
+  }
+  auto iter = paramSet.find("pixel_format");
+  if (iter != paramSet.end() && iter->second != "nv12" && iter->second != "bgr24") {
+    LOGE(SOURCE) << "[SyntheticSource] pixel_format should be nv12 or bgr24.";
+    return false;
+  }
+  return true;
+}
+
+uint32_t SyntheticSource::AddStreams(uint32_t stream_num, const std::string& stream_prefix) {
+  uint32_t added = 0;
+  for (uint32_t i = 0; i < stream_num; ++i) {
+    if (AddSource(SyntheticHandler::Create(this, stream_prefix + std::to_string(i))) == 0) ++added;
+  }
+  return added;
+}
+
+std::shared_ptr<SourceHandler> SyntheticHandler::Create(SyntheticSource* module, const std::string& stream_id) {
+  if (!module || stream_id.empty()) {
+    return nullptr;
+  }
+  return std::shared_ptr<SyntheticHandler>(new (std::nothrow) SyntheticHandler(module, stream_id));
+}
+
+SyntheticHandler::~SyntheticHandler() { Close(); }
+
+bool SyntheticHandler::Open() {
+  if (!module_ || stream_index_ == INVALID_STREAM_IDX) {
+    LOGE(SOURCE) << "[SyntheticHandler] invalid module or stream index, stream_id: " << stream_id_;
+    return false;
+  }
+  if (running_.load()) return true;
+  param_ = static_cast<SyntheticSource*>(module_)->GetSourceParam();
+  size_t bytes = param_.fmt == CN_PIXEL_FORMAT_BGR24 ? param_.width * param_.height * 3
+                                                      : param_.width * param_.height * 3 / 2;
+  pixels_ = cnCpuMemAlloc(bytes);
+  if (!pixels_) {
+    LOGE(SOURCE) << "[SyntheticHandler] failed to alloc " << bytes << " bytes, stream_id: " << stream_id_;
+    return false;
+  }
+  // mid gray, in NV12 as well as in BGR
+  memset(pixels_.get(), 128, bytes);
+  running_.store(true);
+  thread_ = std::thread(&SyntheticHandler::Loop, this);
+  return true;
+}
+
+void SyntheticHandler::Close() {
+  running_.store(false);
+  if (thread_.joinable()) thread_.join();
+}
+
+std::shared_ptr<CNFrameInfo> SyntheticHandler::MakeFrame(uint64_t frame_id, int64_t pts) {
+  std::shared_ptr<CNFrameInfo> data = CreateFrameInfo();
+  if (!data) return nullptr;
+  std::shared_ptr<CNDataFrame> dataframe = std::make_shared<CNDataFrame>();
+  dataframe->ctx.dev_type = DevContext::CPU;
+  dataframe->ctx.dev_id = -1;
+  dataframe->ctx.ddr_channel = -1;
+  dataframe->fmt = param_.fmt;
+  dataframe->width = param_.width;
+  dataframe->height = param_.height;
+  // strides are in pixels
+  dataframe->stride[0] = dataframe->stride[1] = param_.width;
+  dataframe->cpu_data = pixels_;
+  uint8_t* t = static_cast<uint8_t*>(pixels_.get());
+  for (int i = 0; i < dataframe->GetPlanes(); ++i) {
+    size_t plane_size = dataframe->GetPlaneBytes(i);
+    dataframe->data[i].reset(new CNSyncedMemory(plane_size));
+    dataframe->data[i]->SetCpuData(t);
+    t += plane_size;
+  }
+  dataframe->frame_id = frame_id;
+  data->timestamp = pts;
+  data->datas[CNDataFramePtrKey] = dataframe;
+
+  std::shared_ptr<CNInferObjs> objs_holder = std::make_shared<CNInferObjs>();
+  if (param_.object_num) {
+    // objects are laid out on a grid, drifting a little from frame to frame
+    const uint32_t cols = static_cast<uint32_t>(std::ceil(std::sqrt(param_.object_num)));
+    const float cell = 1.0f / cols;
+    const float drift = (frame_id % 10) * cell * 0.02f;
+    objs_holder->objs_.reserve(param_.object_num);
+    for (uint32_t i = 0; i < param_.object_num; ++i) {
+      auto obj = std::make_shared<CNInferObject>();
+      obj->id = "0";
+      obj->score = 0.9f;
+      obj->bbox.x = (i % cols) * cell + cell * 0.25f + drift;
+      obj->bbox.y = (i / cols) * cell + cell * 0.25f;
+      obj->bbox.w = obj->bbox.h = cell * 0.5f;
+      objs_holder->objs_.push_back(obj);
+    }
+  }
+  data->datas[CNInferObjsPtrKey] = objs_holder;
+  return data;
+}
+
+void SyntheticHandler::Loop() {
+  using Clock = std::chrono::steady_clock;
+  const bool throttled = param_.fps > 0;
+  const Clock::duration interval =
+      throttled ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / param_.fps))
+                : Clock::duration::zero();
+  Clock::time_point next = Clock::now();
+  int64_t last_pts = -1;
+  uint64_t frame_id = 0;
+  while (running_.load() && (param_.frame_num == 0 || frame_id < param_.frame_num)) {
+    if (throttled) {
+      std::this_thread::sleep_until(next);
+      // a live camera does not catch up after the pipeline stalls, it drops the frames instead
+      next = std::max(next + interval, Clock::now());
+    }
+    // pts are unique within a stream even if frames are generated within the same microsecond
+    int64_t pts = std::max(static_cast<int64_t>(TimeStamp::Current()), last_pts + 1);
+    std::shared_ptr<CNFrameInfo> data = MakeFrame(frame_id, pts);
+    if (!data) {
+      // the flow depth is reached
+      std::this_thread::sleep_for(std::chrono::microseconds(5));
+      continue;
+    }
+    last_pts = pts;
+    ++frame_id;
+    SendData(data);
+  }
+  std::shared_ptr<CNFrameInfo> eos = CreateFrameInfo(true);
+  if (eos) SendData(eos);
+}
+
+}  // namespace cnstream
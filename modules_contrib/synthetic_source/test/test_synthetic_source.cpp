@@ -0,0 +1,164 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "cnstream_pipeline.hpp"
+#include "counting_sink.hpp"
+#include "synthetic_source.hpp"
+
+namespace cnstream {
+
+static constexpr const char *gname = "synthetic_source";
+
+TEST(SyntheticSource, OpenClose) {
+  std::shared_ptr<SyntheticSource> source = std::make_shared<SyntheticSource>(gname);
+  ModuleParamSet param;
+  EXPECT_TRUE(source->Open(param));
+  EXPECT_EQ(source->GetSourceParam().width, 1920);
+  EXPECT_EQ(source->GetSourceParam().fmt, CN_PIXEL_FORMAT_YUV420_NV12);
+
+  param["width"] = "640";
+  param["height"] = "360";
+  param["pixel_format"] = "bgr24";
+  param["fps"] = "0";
+  param["frame_num"] = "100";
+  param["object_num"] = "8";
+  EXPECT_TRUE(source->Open(param));
+  SyntheticSourceParam source_param = source->GetSourceParam();
+  EXPECT_EQ(source_param.width, 640);
+  EXPECT_EQ(source_param.height, 360);
+  EXPECT_EQ(source_param.fmt, CN_PIXEL_FORMAT_BGR24);
+  EXPECT_EQ(source_param.fps, 0);
+  EXPECT_EQ(source_param.frame_num, 100u);
+  EXPECT_EQ(source_param.object_num, 8u);
+
+  param["width"] = "641";
+  EXPECT_FALSE(source->Open(param));
+  param["width"] = "640";
+  param["fps"] = "-1";
+  EXPECT_FALSE(source->Open(param));
+  param["fps"] = "30";
+  param["pixel_format"] = "rgb24";
+  EXPECT_FALSE(source->Open(param));
+  source->Close();
+}
+
+TEST(SyntheticSource, MakeFrame) {
+  std::shared_ptr<SyntheticSource> source = std::make_shared<SyntheticSource>(gname);
+  ModuleParamSet param;
+  param["width"] = "64";
+  param["height"] = "32";
+  param["object_num"] = "5";
+  param["frame_num"] = "0";
+  ASSERT_TRUE(source->Open(param));
+  auto handler = std::dynamic_pointer_cast<SyntheticHandler>(SyntheticHandler::Create(source.get(), "0"));
+  ASSERT_TRUE(handler != nullptr);
+  handler->param_ = source->GetSourceParam();
+  handler->pixels_ = cnCpuMemAlloc(64 * 32 * 3 / 2);
+
+  auto data = handler->MakeFrame(3, 100);
+  ASSERT_TRUE(data != nullptr);
+  EXPECT_EQ(data->timestamp, 100);
+  CNDataFramePtr frame = GetCNDataFramePtr(data);
+  EXPECT_EQ(frame->frame_id, 3u);
+  EXPECT_EQ(frame->width, 64);
+  EXPECT_EQ(frame->height, 32);
+  EXPECT_EQ(frame->GetPlanes(), 2);
+  EXPECT_EQ(frame->GetBytes(), 64u * 32 * 3 / 2);
+  EXPECT_EQ(frame->data[0]->GetCpuData(), handler->pixels_.get());
+  CNInferObjsPtr objs_holder = GetCNInferObjsPtr(data);
+  ASSERT_EQ(objs_holder->objs_.size(), 5u);
+  for (const auto &obj : objs_holder->objs_) {
+    EXPECT_GE(obj->bbox.x, 0);
+    EXPECT_LE(obj->bbox.x + obj->bbox.w, 1);
+    EXPECT_GE(obj->bbox.y, 0);
+    EXPECT_LE(obj->bbox.y + obj->bbox.h, 1);
+  }
+
+  // frames of a stream share pixels
+  auto next = handler->MakeFrame(4, 101);
+  EXPECT_EQ(GetCNDataFramePtr(next)->data[0]->GetCpuData(), frame->data[0]->GetCpuData());
+}
+
+TEST(SyntheticSource, MakeBgrFrame) {
+  std::shared_ptr<SyntheticSource> source = std::make_shared<SyntheticSource>(gname);
+  ModuleParamSet param;
+  param["width"] = "64";
+  param["height"] = "32";
+  param["pixel_format"] = "bgr24";
+  param["frame_num"] = "0";
+  ASSERT_TRUE(source->Open(param));
+  auto handler = std::dynamic_pointer_cast<SyntheticHandler>(SyntheticHandler::Create(source.get(), "0"));
+  ASSERT_TRUE(handler != nullptr);
+  handler->param_ = source->GetSourceParam();
+  handler->pixels_ = cnCpuMemAlloc(64 * 32 * 3);
+  memset(handler->pixels_.get(), 128, 64 * 32 * 3);
+
+  auto data = handler->MakeFrame(0, 0);
+  ASSERT_TRUE(data != nullptr);
+  CNDataFramePtr frame = GetCNDataFramePtr(data);
+  EXPECT_EQ(frame->GetPlanes(), 1);
+  EXPECT_EQ(frame->stride[0], 64);
+  EXPECT_EQ(frame->GetPlaneBytes(0), 64u * 32 * 3);
+  EXPECT_EQ(frame->GetBytes(), 64u * 32 * 3);
+#ifdef HAVE_OPENCV
+  cv::Mat* bgr = frame->ImageBGR();
+  ASSERT_TRUE(bgr != nullptr);
+  EXPECT_EQ(bgr->cols, 64);
+  EXPECT_EQ(bgr->rows, 32);
+  EXPECT_EQ(bgr->type(), CV_8UC3);
+  // mid gray
+  EXPECT_EQ(cv::countNonZero(bgr->reshape(1) != 128), 0);
+#endif
+}
+
+TEST(SyntheticSource, SendFrames) {
+  Pipeline pipeline("pipeline");
+  std::shared_ptr<SyntheticSource> source = std::make_shared<SyntheticSource>(gname);
+  std::shared_ptr<CountingSink> sink = std::make_shared<CountingSink>("counting_sink");
+  ASSERT_TRUE(pipeline.AddModule(source));
+  ASSERT_TRUE(pipeline.AddModule(sink));
+  pipeline.SetModuleAttribute(source, 0);
+  pipeline.SetModuleAttribute(sink, 2);
+  pipeline.LinkModules(source, sink);
+  CNModuleConfig config;
+  config.name = gname;
+  config.parameters = {{"width", "64"}, {"height", "32"}, {"fps", "0"}, {"frame_num", "50"}};
+  pipeline.AddModuleConfig(config);
+  ASSERT_TRUE(pipeline.Start());
+
+  EXPECT_EQ(source->AddStreams(2), 2u);
+  for (int i = 0; i < 500 && sink->GetTotalStats().frame_count < 100; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(sink->GetStats("synthetic_0").frame_count, 50u);
+  EXPECT_EQ(sink->GetStats("synthetic_1").frame_count, 50u);
+  EXPECT_GE(sink->GetStats("synthetic_0").latency_max, 0);
+  pipeline.Stop();
+}
+
+}  // namespace cnstream